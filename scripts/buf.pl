@@ -42,6 +42,8 @@ my %suppress;
 sub _filename { sprintf '%s/scrollbuffer', get_irssi_dir }
 
 sub upgrade {
+    # scrollback is saved by irssi itself unless this is off
+    return if settings_get_bool 'upgrade_scrollback';
     my $out = { suppress => [ map $_->{server}->{address} . $_->{name}, channels ] };
     for my $window (windows) {
         next unless defined $window;
@@ -71,6 +73,7 @@ sub upgrade {
 
 sub restore {
     my $fn = _filename;
+    return unless -e $fn;
     my $in = retrieve($fn) or die "Could not retrieve data from $fn";
     unlink $fn or warn "unlink $fn: $!";
   
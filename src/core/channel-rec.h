@@ -7,6 +7,7 @@ char *topic_by;
 time_t topic_time;
 
 GHashTable *nicks; /* list of nicks */
+GSequence *nicks_sorted; /* nicks in display order, see nicklist_get_sorted() */
 NICK_REC *ownnick; /* our own nick */
 
 unsigned int no_modes:1; /* channel doesn't support modes */
@@ -23,6 +24,7 @@ unsigned int joined:1; /* Have we even received JOIN event for this channel? */
 unsigned int left:1; /* You just left the channel */
 unsigned int kicked:1; /* You just got kicked */
 unsigned int session_rejoin:1; /* This channel was joined with /UPGRADE */
+unsigned int session_names:1; /* /UPGRADE lost the nicklist, get it with NAMES */
 unsigned int destroying:1;
 
 /* Return the information needed to call SERVER_REC->channels_join() for
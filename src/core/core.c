@@ -51,6 +51,7 @@
 #include <irssi/src/core/refstrings.h>
 #include <irssi/src/core/servers.h>
 #include <irssi/src/core/special-vars.h>
+#include <irssi/src/core/timers.h>
 #include <irssi/src/core/write-buffer.h>
 #include <irssi/src/core/utf8.h>
 
@@ -257,6 +258,7 @@ void core_init(void)
 
 	net_disconnect_init();
 	signals_init();
+	timers_init();
 
 	signal_add_first("gui dialog", (SIGNAL_FUNC) sig_gui_dialog);
 	signal_add_first("irssi init finished", (SIGNAL_FUNC) sig_init_finished);
@@ -351,6 +353,7 @@ void core_deinit(void)
 	commands_deinit();
 	credential_deinit();
 	settings_deinit();
+	timers_deinit();
 	signals_deinit();
 	net_disconnect_deinit();
 
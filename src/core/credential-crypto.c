@@ -28,6 +28,7 @@
 
 /* OpenSSL is always available in Irssi (dependency in meson.build) */
 #include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
 
@@ -35,8 +36,35 @@
 #define CREDENTIAL_SALT_SIZE 32
 #define CREDENTIAL_KEY_SIZE 32
 #define CREDENTIAL_IV_SIZE 16
+#define CREDENTIAL_FIELD_SALT_SIZE 16
 #define CREDENTIAL_PBKDF2_ITERATIONS 100000
 
+/* Values are stored in two formats:
+
+     salt_hex:iv_hex:encrypted_base64
+       old format, every value has its own PBKDF2 salt
+
+     2:key_salt_hex:field_salt_hex:iv_hex:encrypted_base64
+       the master key is derived with PBKDF2 from the password and key
+       salt, and the key of the value with HKDF from the master key and
+       field salt
+
+   All values written in one session share the key salt, so unlocking
+   costs one PBKDF2 run instead of one per value. Old values are still
+   read and get written in the new format on the next save. */
+#define CREDENTIAL_FORMAT_V2 "2"
+#define CREDENTIAL_HKDF_INFO "erssi credential"
+
+typedef struct {
+	unsigned char salt[CREDENTIAL_SALT_SIZE];
+	unsigned char key[CREDENTIAL_KEY_SIZE];
+} CREDENTIAL_KEY_REC;
+
+/* Master keys derived from keys_password, newest first. The newest one is
+   used for encrypting. */
+static GSList *keys;
+static char *keys_password;
+
 /* === Funkcje pomocnicze === */
 
 static char *bytes_to_hex(const unsigned char *bytes, size_t len)
@@ -94,6 +122,110 @@ static gboolean derive_key_openssl(const char *password, const unsigned char *sa
 	                         key_len, key) == 1;
 }
 
+/* RFC 5869 HKDF-SHA256, `key_len' must be at most SHA256_DIGEST_LENGTH */
+static gboolean hkdf_sha256_openssl(const unsigned char *ikm, size_t ikm_len,
+                                    const unsigned char *salt, size_t salt_len,
+                                    const char *info, unsigned char *key, size_t key_len)
+{
+	unsigned char prk[SHA256_DIGEST_LENGTH];
+	unsigned char okm[SHA256_DIGEST_LENGTH];
+	unsigned char *data;
+	size_t info_len;
+	gboolean ret;
+
+	g_return_val_if_fail(key_len <= SHA256_DIGEST_LENGTH, FALSE);
+
+	/* extract */
+	if (HMAC(EVP_sha256(), salt, salt_len, ikm, ikm_len, prk, NULL) == NULL) {
+		return FALSE;
+	}
+
+	/* expand, one block is enough */
+	info_len = strlen(info);
+	data = g_malloc(info_len + 1);
+	memcpy(data, info, info_len);
+	data[info_len] = 0x01;
+
+	ret = HMAC(EVP_sha256(), prk, sizeof(prk), data, info_len + 1, okm, NULL) != NULL;
+	if (ret) {
+		memcpy(key, okm, key_len);
+	}
+
+	memset(prk, 0, sizeof(prk));
+	memset(okm, 0, sizeof(okm));
+	g_free(data);
+	return ret;
+}
+
+static void master_key_free(CREDENTIAL_KEY_REC *rec)
+{
+	memset(rec, 0, sizeof(*rec));
+	g_free(rec);
+}
+
+void credential_crypto_forget_keys(void)
+{
+	g_slist_free_full(keys, (GDestroyNotify) master_key_free);
+	keys = NULL;
+
+	if (keys_password != NULL) {
+		memset(keys_password, 0, strlen(keys_password));
+		g_free(keys_password);
+		keys_password = NULL;
+	}
+}
+
+/* Return the master key for `salt', or the newest one if `salt' is NULL.
+   Keys are derived only once per password and salt. */
+static CREDENTIAL_KEY_REC *master_key_get(const char *password, const unsigned char *salt)
+{
+	CREDENTIAL_KEY_REC *rec;
+	GSList *tmp;
+
+	if (keys_password != NULL && strcmp(keys_password, password) != 0) {
+		credential_crypto_forget_keys();
+	}
+
+	if (salt == NULL && keys != NULL) {
+		return keys->data;
+	}
+
+	for (tmp = keys; tmp != NULL; tmp = tmp->next) {
+		rec = tmp->data;
+		if (memcmp(rec->salt, salt, sizeof(rec->salt)) == 0) {
+			return rec;
+		}
+	}
+
+	rec = g_new0(CREDENTIAL_KEY_REC, 1);
+	if (salt != NULL) {
+		memcpy(rec->salt, salt, sizeof(rec->salt));
+	} else if (!generate_salt_openssl(rec->salt, sizeof(rec->salt))) {
+		master_key_free(rec);
+		return NULL;
+	}
+
+	if (!derive_key_openssl(password, rec->salt, sizeof(rec->salt),
+	                        rec->key, sizeof(rec->key))) {
+		master_key_free(rec);
+		return NULL;
+	}
+
+	if (keys_password == NULL) {
+		keys_password = g_strdup(password);
+	}
+	keys = g_slist_prepend(keys, rec);
+	return rec;
+}
+
+static gboolean field_key_derive(CREDENTIAL_KEY_REC *master, const unsigned char *field_salt,
+                                 unsigned char *key)
+{
+	return hkdf_sha256_openssl(master->key, sizeof(master->key),
+	                           field_salt, CREDENTIAL_FIELD_SALT_SIZE,
+	                           CREDENTIAL_HKDF_INFO, key, CREDENTIAL_KEY_SIZE);
+}
+
 static char *encrypt_aes256_cbc_openssl(const char *plaintext, const unsigned char *key,
                                         const unsigned char *iv)
 {
@@ -212,47 +344,90 @@ static char *decrypt_aes256_cbc_openssl(const char *ciphertext_b64, const unsign
 
 char *credential_encrypt(const char *plaintext, const char *password)
 {
-	unsigned char salt[CREDENTIAL_SALT_SIZE];
+	CREDENTIAL_KEY_REC *master;
+	unsigned char field_salt[CREDENTIAL_FIELD_SALT_SIZE];
 	unsigned char key[CREDENTIAL_KEY_SIZE];
 	unsigned char iv[CREDENTIAL_IV_SIZE];
-	char *salt_hex, *iv_hex, *encrypted, *result;
+	char *salt_hex, *field_salt_hex, *iv_hex, *encrypted, *result;
 	
 	g_return_val_if_fail(plaintext != NULL, NULL);
 	g_return_val_if_fail(password != NULL, NULL);
 
-	/* Generate salt and IV */
-	if (!generate_salt_openssl(salt, sizeof(salt)) ||
+	/* Generate field salt and IV */
+	if (!generate_salt_openssl(field_salt, sizeof(field_salt)) ||
 	    !generate_salt_openssl(iv, sizeof(iv))) {
 		return NULL;
 	}
 
-	/* Derive key from password */
-	if (!derive_key_openssl(password, salt, sizeof(salt), key, sizeof(key))) {
+	/* Derive key of this value from the master key */
+	master = master_key_get(password, NULL);
+	if (master == NULL || !field_key_derive(master, field_salt, key)) {
 		return NULL;
 	}
 
 	/* Encrypt */
 	encrypted = encrypt_aes256_cbc_openssl(plaintext, key, iv);
+	memset(key, 0, sizeof(key));
 	if (encrypted == NULL) {
 		return NULL;
 	}
 
-	/* Convert salt and IV to hex */
-	salt_hex = bytes_to_hex(salt, sizeof(salt));
+	/* Convert salts and IV to hex */
+	salt_hex = bytes_to_hex(master->salt, sizeof(master->salt));
+	field_salt_hex = bytes_to_hex(field_salt, sizeof(field_salt));
 	iv_hex = bytes_to_hex(iv, sizeof(iv));
 
-	/* Format: salt_hex:iv_hex:encrypted_base64 */
-	result = g_strdup_printf("%s:%s:%s", salt_hex, iv_hex, encrypted);
+	result = g_strdup_printf(CREDENTIAL_FORMAT_V2 ":%s:%s:%s:%s",
+	                         salt_hex, field_salt_hex, iv_hex, encrypted);
 
-	/* Secure cleanup */
-	memset(key, 0, sizeof(key));
 	g_free(salt_hex);
+	g_free(field_salt_hex);
 	g_free(iv_hex);
 	g_free(encrypted);
 	
 	return result;
 }
 
+static char *credential_decrypt_v2(const char *encrypted_data, const char *password)
+{
+	CREDENTIAL_KEY_REC *master;
+	char **parts;
+	unsigned char *salt, *field_salt, *iv;
+	unsigned char key[CREDENTIAL_KEY_SIZE];
+	size_t salt_len, field_salt_len, iv_len;
+	char *result;
+
+	/* Parse 2:key_salt:field_salt:iv:encrypted */
+	parts = g_strsplit(encrypted_data, ":", 5);
+	if (g_strv_length(parts) != 5) {
+		g_strfreev(parts);
+		return NULL;
+	}
+
+	salt = hex_to_bytes(parts[1], &salt_len);
+	field_salt = hex_to_bytes(parts[2], &field_salt_len);
+	iv = hex_to_bytes(parts[3], &iv_len);
+
+	result = NULL;
+	if (salt != NULL && field_salt != NULL && iv != NULL &&
+	    salt_len == CREDENTIAL_SALT_SIZE &&
+	    field_salt_len == CREDENTIAL_FIELD_SALT_SIZE &&
+	    iv_len == CREDENTIAL_IV_SIZE) {
+		master = master_key_get(password, salt);
+		if (master != NULL && field_key_derive(master, field_salt, key)) {
+			result = decrypt_aes256_cbc_openssl(parts[4], key, iv);
+			memset(key, 0, sizeof(key));
+		}
+	}
+
+	g_strfreev(parts);
+	g_free(salt);
+	g_free(field_salt);
+	g_free(iv);
+
+	return result;
+}
+
 char *credential_decrypt(const char *encrypted_data, const char *password)
 {
 	char **parts;
@@ -270,7 +445,11 @@ char *credential_decrypt(const char *encrypted_data, const char *password)
 		return g_strdup(encrypted_data);
 	}
 
-	/* Parse salt:iv:encrypted */
+	if (g_str_has_prefix(encrypted_data, CREDENTIAL_FORMAT_V2 ":")) {
+		return credential_decrypt_v2(encrypted_data, password);
+	}
+
+	/* Parse salt:iv:encrypted, written by older versions */
 	parts = g_strsplit(encrypted_data, ":", 3);
 	if (!parts[0] || !parts[1] || !parts[2]) {
 		g_strfreev(parts);
@@ -319,4 +498,5 @@ gboolean credential_crypto_init(void)
 void credential_crypto_deinit(void)
 {
 	/* OpenSSL doesn't require special cleanup */
+	credential_crypto_forget_keys();
 }
\ No newline at end of file
@@ -318,6 +318,7 @@ gboolean credential_set_master_password(const char *password)
 		memset(master_password, 0, strlen(master_password));
 		g_free(master_password);
 	}
+	credential_crypto_forget_keys();
 	
 	master_password = g_strdup(password);
 	return TRUE;
@@ -330,6 +331,7 @@ void credential_clear_master_password(void)
 		g_free(master_password);
 		master_password = NULL;
 	}
+	credential_crypto_forget_keys();
 }
 
 gboolean credential_has_master_password(void)
@@ -97,6 +97,8 @@ char *credential_encrypt(const char *plaintext, const char *password);
 char *credential_decrypt(const char *encrypted_data, const char *password);
 gboolean credential_crypto_init(void);
 void credential_crypto_deinit(void);
+/* Wipe the master keys cached for the current password */
+void credential_crypto_forget_keys(void);
 
 /* Global variables */
 extern CredentialStorageMode credential_storage_mode;
@@ -26,6 +26,7 @@
 #include <irssi/src/core/settings.h>
 #include <irssi/src/core/commands.h>
 #include <irssi/src/core/misc.h>
+#include <irssi/src/core/timers.h>
 #include <irssi/irssi-version.h>
 
 #include <irssi/src/core/servers.h>
@@ -51,7 +52,10 @@ const char *current_expando = NULL;
 time_t reference_time = (time_t) -1;
 time_t current_time = (time_t)-1;
 
-static int timer_tag;
+static int timer_tag, timer_signal;
+
+static void expando_timer_schedule(void);
+static void expando_timer_wakeup(void);
 
 static EXPANDO_REC *char_expandos[256];
 static GHashTable *expandos;
@@ -177,6 +181,7 @@ void expando_bind(const char *key, int funccount, SIGNAL_FUNC *funcs)
 	if (rec->signals == 0) {
 		/* it's unknown when this expando changes..
 		   check it once in a second */
+		expando_timer_wakeup();
                 signal_add("expando timer", funcs[EXPANDO_ARG_NONE]);
 	}
 
@@ -235,8 +240,9 @@ int *expando_get_signals(const char *key)
 	if (rec->signals == 0) {
 		/* it's unknown when this expando changes..
 		   check it once in a second */
+		expando_timer_wakeup();
 		signals = g_new(int, 3);
-		signals[0] = signal_get_uniq_id("expando timer");
+		signals[0] = timer_signal;
 		signals[1] = EXPANDO_ARG_NONE;
 		signals[2] = -1;
                 return signals;
@@ -559,13 +565,15 @@ static void sig_message_own_private(SERVER_REC *server, const char *msg,
 	}
 }
 
-static int sig_timer(void)
+static void sig_timer(void *data)
 {
 	time_t now;
 	struct tm *tm;
         int last_min;
 
-        signal_emit("expando timer", 0);
+	timer_tag = 0;
+	if (signal_has_hooks(timer_signal))
+		signal_emit_id(timer_signal, 0);
 
         /* check if $Z has changed */
 	now = time(NULL);
@@ -576,15 +584,50 @@ static int sig_timer(void)
 			last_min = tm->tm_min;
 
 			tm = localtime(&now);
-			if (tm->tm_min == last_min)
-                                return 1;
+			if (tm->tm_min == last_min) {
+				expando_timer_schedule();
+				return;
+			}
 		}
 
                 signal_emit("time changed", 0);
 		last_timestamp = now;
 	}
 
-        return 1;
+	expando_timer_schedule();
+}
+
+/* Expandos without change signals are polled once a second, but only
+   while something is bound to "expando timer". Otherwise it's enough to
+   wake up when $Z changes, which is usually once a minute. */
+static void expando_timer_schedule(void)
+{
+	struct tm *tm;
+	time_t now;
+	int secs;
+
+	if (timestamp_seconds || signal_has_hooks(timer_signal)) {
+		secs = 1;
+	} else {
+		now = time(NULL);
+		tm = localtime(&now);
+		secs = 60 - tm->tm_sec;
+		if (secs <= 0)
+			secs = 1;
+	}
+
+	timer_remove(timer_tag);
+	timer_tag = timer_add_seconds(secs, sig_timer, NULL);
+}
+
+/* someone is going to bind to "expando timer", make sure it's polled */
+static void expando_timer_wakeup(void)
+{
+	if (timer_tag != 0 && !timestamp_seconds &&
+	    !signal_has_hooks(timer_signal)) {
+		timer_remove(timer_tag);
+		timer_tag = timer_add_seconds(1, sig_timer, NULL);
+	}
 }
 
 static void read_settings(void)
@@ -601,6 +644,8 @@ static void read_settings(void)
 		strstr(timestamp_format, "%X") != NULL ||
 		strstr(timestamp_format, "%T") != NULL;
 
+	if (timer_tag != 0)
+		expando_timer_schedule();
 }
 
 void expandos_init(void)
@@ -720,9 +765,11 @@ void expandos_init(void)
 		       "window item name changed", EXPANDO_ARG_WINDOW_ITEM,
 		       NULL);
 
+	timer_signal = signal_get_uniq_id("expando timer");
+	timer_tag = 0;
 	read_settings();
 
-        timer_tag = g_timeout_add(1000, (GSourceFunc) sig_timer, NULL);
+	expando_timer_schedule();
 	signal_add("message public", (SIGNAL_FUNC) sig_message_public);
 	signal_add("message private", (SIGNAL_FUNC) sig_message_private);
 	signal_add("message own_private", (SIGNAL_FUNC) sig_message_own_private);
@@ -749,7 +796,7 @@ void expandos_deinit(void)
 	g_free_not_null(timestamp_format);
 	g_free_not_null(timestamp_format_alt);
 
-	g_source_remove(timer_tag);
+	timer_remove(timer_tag);
 	signal_remove("message public", (SIGNAL_FUNC) sig_message_public);
 	signal_remove("message private", (SIGNAL_FUNC) sig_message_private);
 	signal_remove("message own_private", (SIGNAL_FUNC) sig_message_own_private);
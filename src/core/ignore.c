@@ -25,6 +25,7 @@
 #include <irssi/src/lib-config/iconfig.h>
 #include <irssi/src/core/settings.h>
 #include <irssi/src/core/iregex.h>
+#include <irssi/src/core/timers.h>
 
 #include <irssi/src/core/masks.h>
 #include <irssi/src/core/servers.h>
@@ -36,9 +37,210 @@
 
 GSList *ignores;
 
+/* Index of the ignore masks by their literal parts, so the ignores which
+   may match a nick are found without trying all of them. Keys are
+   uppercased with i_toupper() the same way match_wildcards() compares. */
+typedef struct {
+	IGNORE_REC *rec;
+	int pos; /* position in ignores */
+} IGNORE_INDEX_REC;
+
+static IGNORE_INDEX_REC *index_recs;
+static GHashTable *index_nicks; /* nick prefix, masks without '!' */
+static GHashTable *index_prefixes; /* nick!host prefix, up to the first '!' */
+static GHashTable *index_suffixes; /* nick!host suffix after a '.', '@' or '!' */
+static GPtrArray *index_others; /* no mask, or no usable literal part */
+static int index_valid;
+
+#define is_mask_boundary(c) \
+	((c) == '.' || (c) == '@' || (c) == '!')
+
 static NICKMATCH_REC *nickmatch;
 static int time_tag;
 
+static void unignore_schedule(void);
+static void ignore_nickmatch_update(IGNORE_REC *rec);
+
+static char *ignore_index_key(const char *str, int len)
+{
+	char *key, *p;
+
+	key = len < 0 ? g_strdup(str) : g_strndup(str, len);
+	for (p = key; *p != '\0'; p++)
+		*p = i_toupper(*p);
+	return key;
+}
+
+static void ignore_index_add(GHashTable *table, const char *str, int len,
+			     IGNORE_INDEX_REC *entry)
+{
+	GPtrArray *entries;
+	char *key;
+
+	key = ignore_index_key(str, len);
+	entries = g_hash_table_lookup(table, key);
+	if (entries == NULL) {
+		entries = g_ptr_array_new();
+		g_hash_table_insert(table, key, entries);
+	} else {
+		g_free(key);
+	}
+	g_ptr_array_add(entries, entry);
+}
+
+static void ignore_index_add_rec(IGNORE_INDEX_REC *entry)
+{
+	const char *mask, *suffix, *p;
+	int prefix_len;
+
+	mask = entry->rec->mask;
+	if (mask == NULL) {
+		g_ptr_array_add(index_others, entry);
+		return;
+	}
+
+	/* match_wildcards() requires the text to begin with the part before
+	   the first wildcard and end with the part after the last one */
+	prefix_len = strcspn(mask, "*?");
+	if (strchr(mask, '!') == NULL) {
+		if (prefix_len > 0)
+			ignore_index_add(index_nicks, mask, prefix_len, entry);
+		else
+			g_ptr_array_add(index_others, entry);
+		return;
+	}
+
+	/* whole nick given */
+	p = memchr(mask, '!', prefix_len);
+	if (p != NULL) {
+		ignore_index_add(index_prefixes, mask, p - mask + 1, entry);
+		return;
+	}
+
+	/* end of the host, starting after a '.' or '@' so it can be found
+	   without trying every suffix */
+	suffix = mask + strlen(mask);
+	while (suffix > mask && suffix[-1] != '*' && suffix[-1] != '?')
+		suffix--;
+	for (p = suffix; *p != '\0' && !is_mask_boundary(*p); p++) ;
+	if (*p != '\0' && p[1] != '\0')
+		ignore_index_add(index_suffixes, p + 1, -1, entry);
+	else if (prefix_len > 0)
+		ignore_index_add(index_prefixes, mask, prefix_len, entry);
+	else
+		g_ptr_array_add(index_others, entry);
+}
+
+static void ignore_index_free(void)
+{
+	if (index_nicks != NULL) g_hash_table_destroy(index_nicks);
+	if (index_prefixes != NULL) g_hash_table_destroy(index_prefixes);
+	if (index_suffixes != NULL) g_hash_table_destroy(index_suffixes);
+	if (index_others != NULL) g_ptr_array_free(index_others, TRUE);
+	g_free(index_recs);
+
+	index_nicks = index_prefixes = index_suffixes = NULL;
+	index_others = NULL;
+	index_recs = NULL;
+	index_valid = FALSE;
+}
+
+static GHashTable *ignore_index_table_new(void)
+{
+	return g_hash_table_new_full((GHashFunc) g_str_hash, (GEqualFunc) g_str_equal,
+				     (GDestroyNotify) g_free,
+				     (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void ignore_index_build(void)
+{
+	GSList *tmp;
+	int pos;
+
+	ignore_index_free();
+
+	index_recs = g_new0(IGNORE_INDEX_REC, g_slist_length(ignores));
+	index_nicks = ignore_index_table_new();
+	index_prefixes = ignore_index_table_new();
+	index_suffixes = ignore_index_table_new();
+	index_others = g_ptr_array_new();
+
+	for (tmp = ignores, pos = 0; tmp != NULL; tmp = tmp->next, pos++) {
+		index_recs[pos].rec = tmp->data;
+		index_recs[pos].pos = pos;
+		ignore_index_add_rec(&index_recs[pos]);
+	}
+	index_valid = TRUE;
+}
+
+static void ignore_index_lookup(GHashTable *table, char *key, int len,
+				GPtrArray *found)
+{
+	GPtrArray *entries;
+	char chr;
+	int i;
+
+	chr = key[len];
+	key[len] = '\0';
+	entries = g_hash_table_lookup(table, key);
+	key[len] = chr;
+
+	if (entries != NULL) {
+		for (i = 0; i < entries->len; i++)
+			g_ptr_array_add(found, g_ptr_array_index(entries, i));
+	}
+}
+
+static int ignore_index_cmp(IGNORE_INDEX_REC **a, IGNORE_INDEX_REC **b)
+{
+	return (*a)->pos - (*b)->pos;
+}
+
+/* Return the ignores whose mask may match, in the same order as they are
+   in ignores. The masks still need to be checked. */
+static GSList *ignore_index_find(const char *nick, const char *nickmask)
+{
+	IGNORE_INDEX_REC *entry;
+	GPtrArray *found;
+	GSList *list;
+	char *knick, *kmask, *p;
+	int i, len;
+
+	if (!index_valid)
+		ignore_index_build();
+
+	found = g_ptr_array_new();
+	knick = ignore_index_key(nick, -1);
+	kmask = ignore_index_key(nickmask, -1);
+
+	for (len = 1; knick[len-1] != '\0'; len++)
+		ignore_index_lookup(index_nicks, knick, len, found);
+	for (len = 1; kmask[len-1] != '\0'; len++) {
+		ignore_index_lookup(index_prefixes, kmask, len, found);
+		if (kmask[len-1] == '!')
+			break;
+	}
+	for (p = kmask; *p != '\0'; p++) {
+		if (is_mask_boundary(*p) && p[1] != '\0')
+			ignore_index_lookup(index_suffixes, p + 1, strlen(p + 1), found);
+	}
+	for (i = 0; i < index_others->len; i++)
+		g_ptr_array_add(found, g_ptr_array_index(index_others, i));
+
+	g_ptr_array_sort(found, (GCompareFunc) ignore_index_cmp);
+
+	list = NULL;
+	for (i = found->len - 1; i >= 0; i--) {
+		entry = g_ptr_array_index(found, i);
+		list = g_slist_prepend(list, entry->rec);
+	}
+
+	g_ptr_array_free(found, TRUE);
+	g_free(knick);
+	g_free(kmask);
+	return list;
+}
+
 /* check if `text' contains ignored nick at the start of the line. */
 static int ignore_check_replies_rec(IGNORE_REC *rec, CHANNEL_REC *channel,
 				    const char *text)
@@ -141,12 +343,13 @@ int ignore_check_flags(SERVER_REC *server, const char *nick, const char *host,
 	CHANNEL_REC *chanrec;
 	NICK_REC *nickrec;
         IGNORE_REC *rec;
-	GSList *tmp;
+	GSList *tmp, *found;
         char *nickmask;
         int len, best_mask, best_match, best_patt;
 
         if (nick == NULL) nick = "";
 
+	found = NULL;
 	chanrec = server == NULL || channel == NULL ? NULL :
 		channel_find(server, channel);
 	if (chanrec != NULL && nick != NULL &&
@@ -158,8 +361,8 @@ int ignore_check_flags(SERVER_REC *server, const char *nick, const char *host,
 		tmp = nickmatch_find(nickmatch, nickrec);
 		nickmask = NULL;
 	} else {
-		tmp = ignores;
 		nickmask = g_strconcat(nick, "!", host, NULL);
+		tmp = found = ignore_index_find(nick, nickmask);
 	}
 
         best_mask = best_patt = -1; best_match = FALSE;
@@ -189,6 +392,7 @@ int ignore_check_flags(SERVER_REC *server, const char *nick, const char *host,
 		}
 	}
         g_free(nickmask);
+	g_slist_free(found);
 
 	if (best_match || (level & MSGLEVEL_PUBLIC) == 0)
 		return best_match;
@@ -390,12 +594,15 @@ void ignore_add_rec(IGNORE_REC *rec)
 	ignore_set_config(rec);
 
 	signal_emit("ignore created", 1, rec);
-	nickmatch_rebuild(nickmatch);
+	index_valid = FALSE;
+	ignore_nickmatch_update(rec);
+	unignore_schedule();
 }
 
 static void ignore_destroy(IGNORE_REC *rec, int send_signal)
 {
 	ignores = g_slist_remove(ignores, rec);
+	index_valid = FALSE;
 	if (send_signal)
 		signal_emit("ignore destroyed", 1, rec);
 
@@ -412,6 +619,9 @@ void ignore_update_rec(IGNORE_REC *rec)
 	if (rec->level == 0) {
 		/* unignored everything */
 		ignore_remove_config(rec);
+		ignores = g_slist_remove(ignores, rec);
+		index_valid = FALSE;
+		ignore_nickmatch_update(rec);
 		ignore_destroy(rec, TRUE);
 	} else {
 		/* unignore just some levels.. */
@@ -423,15 +633,21 @@ void ignore_update_rec(IGNORE_REC *rec)
 
                 ignore_init_rec(rec);
 		signal_emit("ignore changed", 1, rec);
+
+		/* moved to the end of the list */
+		index_valid = FALSE;
+		ignore_nickmatch_update(rec);
 	}
-        nickmatch_rebuild(nickmatch);
+	unignore_schedule();
 }
 
-static int unignore_timeout(void)
+static void unignore_timeout(void *data)
 {
 	GSList *tmp, *next;
         time_t now;
 
+	time_tag = 0;
+
         now = time(NULL);
 	for (tmp = ignores; tmp != NULL; tmp = next) {
 		IGNORE_REC *rec = tmp->data;
@@ -443,7 +659,33 @@ static int unignore_timeout(void)
 		}
 	}
 
-	return TRUE;
+	unignore_schedule();
+}
+
+/* Wake up when the first timed ignore expires */
+static void unignore_schedule(void)
+{
+	GSList *tmp;
+	time_t now, next;
+
+	timer_remove(time_tag);
+	time_tag = 0;
+
+	next = 0;
+	for (tmp = ignores; tmp != NULL; tmp = tmp->next) {
+		IGNORE_REC *rec = tmp->data;
+
+		if (rec->unignore_time > 0 &&
+		    (next == 0 || rec->unignore_time < next))
+			next = rec->unignore_time;
+	}
+
+	if (next == 0)
+		return;
+
+	now = time(NULL);
+	time_tag = timer_add_seconds(next <= now ? 0 : next - now,
+				     unignore_timeout, NULL);
 }
 
 static void read_ignores(void)
@@ -458,6 +700,7 @@ static void read_ignores(void)
 	node = iconfig_node_traverse("ignores", FALSE);
 	if (node == NULL) {
 		nickmatch_rebuild(nickmatch);
+		unignore_schedule();
 		return;
 	}
 
@@ -487,7 +730,9 @@ static void read_ignores(void)
 		ignore_init_rec(rec);
 	}
 
+	index_valid = FALSE;
 	nickmatch_rebuild(nickmatch);
+	unignore_schedule();
 }
 
 static void free_cache_matches(GSList *matches)
@@ -498,21 +743,22 @@ static void free_cache_matches(GSList *matches)
 static void ignore_nick_cache(GHashTable *list, CHANNEL_REC *channel,
 			      NICK_REC *nick)
 {
-	GSList *tmp, *matches;
+	GSList *tmp, *next, *matches;
         char *nickmask;
 
 	if (nick->host == NULL)
 		return; /* don't check until host is known */
 
-        matches = NULL;
 	nickmask = g_strconcat(nick->nick, "!", nick->host, NULL);
-	for (tmp = ignores; tmp != NULL; tmp = tmp->next) {
+	matches = ignore_index_find(nick->nick, nickmask);
+	for (tmp = matches; tmp != NULL; tmp = next) {
 		IGNORE_REC *rec = tmp->data;
 
-		if (ignore_match_nickmask(rec, nick->nick, nickmask) &&
-		    ignore_match_server(rec, channel->server) &&
-		    ignore_match_channel(rec, channel->name))
-			matches = g_slist_append(matches, rec);
+		next = tmp->next;
+		if (!ignore_match_nickmask(rec, nick->nick, nickmask) ||
+		    !ignore_match_server(rec, channel->server) ||
+		    !ignore_match_channel(rec, channel->name))
+			matches = g_slist_delete_link(matches, tmp);
 	}
 	g_free_not_null(nickmask);
 
@@ -522,11 +768,38 @@ static void ignore_nick_cache(GHashTable *list, CHANNEL_REC *channel,
                 g_hash_table_insert(list, nick, matches);
 }
 
+/* nick is or was matched by `rec' */
+static int ignore_nick_affected(CHANNEL_REC *channel, NICK_REC *nick,
+				IGNORE_REC *rec)
+{
+	char *nickmask;
+	int ret;
+
+	if (g_slist_find(nickmatch_find(nickmatch, nick), rec) != NULL)
+		return TRUE;
+
+	if (nick->host == NULL ||
+	    !ignore_match_server(rec, channel->server) ||
+	    !ignore_match_channel(rec, channel->name))
+		return FALSE;
+
+	nickmask = g_strconcat(nick->nick, "!", nick->host, NULL);
+	ret = ignore_match_nickmask(rec, nick->nick, nickmask);
+	g_free(nickmask);
+	return ret;
+}
+
+/* Update the cached ignores of only the nicks affected by the change of `rec' */
+static void ignore_nickmatch_update(IGNORE_REC *rec)
+{
+	nickmatch_update(nickmatch, (NICKMATCH_CHECK_FUNC) ignore_nick_affected, rec);
+}
+
 void ignore_init(void)
 {
 	ignores = NULL;
 	nickmatch = nickmatch_init(ignore_nick_cache, (GDestroyNotify) free_cache_matches);
-	time_tag = g_timeout_add(1000, (GSourceFunc) unignore_timeout, NULL);
+	time_tag = 0;
 
         read_ignores();
         signal_add("setup reread", (SIGNAL_FUNC) read_ignores);
@@ -534,10 +807,11 @@ void ignore_init(void)
 
 void ignore_deinit(void)
 {
-	g_source_remove(time_tag);
+	timer_remove(time_tag);
 	while (ignores != NULL)
                 ignore_destroy(ignores->data, TRUE);
         nickmatch_deinit(nickmatch);
+	ignore_index_free();
 
 	signal_remove("setup reread", (SIGNAL_FUNC) read_ignores);
 }
@@ -32,32 +32,68 @@
    too high. */
 #define MAX_CHARS_IN_LINE 65536
 
+/* Lines are handed out as views into `str' and consumed by moving
+   `start' forward, so a burst of lines costs no copying. The unprocessed
+   data is moved to the beginning of the buffer only when new data doesn't
+   fit to its end and at least as much has been consumed as there is left
+   to move, which keeps splitting linear in the amount of input. */
 struct _LINEBUF_REC {
-        int len;
+	int start; /* offset of the first unprocessed byte in str */
+        int len; /* unprocessed bytes after start */
 	int alloc;
-	int remove;
+	int remove; /* size of the previously returned line */
+	int scanned; /* bytes after start known not to contain LF */
         char *str;
 };
 
 static void linebuf_append(LINEBUF_REC *rec, const char *data, int len)
 {
-	if (rec->len+len > rec->alloc) {
-		rec->alloc = nearest_power(rec->len+len);;
-		rec->str = g_realloc(rec->str, rec->alloc);
+	if (rec->start+rec->len+len > rec->alloc) {
+		if (rec->start > 0 && rec->start >= rec->len) {
+			/* cheap enough to compact */
+			memmove(rec->str, rec->str+rec->start, rec->len);
+			rec->start = 0;
+		}
+
+		if (rec->start+rec->len+len > rec->alloc) {
+			rec->alloc = nearest_power(rec->start+rec->len+len);
+			rec->str = g_realloc(rec->str, rec->alloc);
+		}
 	}
 
-	memcpy(rec->str + rec->len, data, len);
+	memcpy(rec->str + rec->start + rec->len, data, len);
 	rec->len += len;
 }
 
+/* drop the line returned by the previous line_split() call */
+static void linebuf_consume(LINEBUF_REC *rec)
+{
+	if (rec->remove == 0)
+		return;
+
+	rec->start += rec->remove;
+	rec->len -= rec->remove;
+	rec->remove = 0;
+	rec->scanned = 0;
+
+	if (rec->len == 0)
+		rec->start = 0;
+}
+
 static char *linebuf_find(LINEBUF_REC *rec, char chr)
 {
-	return memchr(rec->str, chr, rec->len);
+	char *ptr;
+
+	ptr = memchr(rec->str + rec->start + rec->scanned, chr,
+		     rec->len - rec->scanned);
+	if (ptr == NULL)
+		rec->scanned = rec->len;
+	return ptr;
 }
 
 static int remove_newline(LINEBUF_REC *rec)
 {
-	char *ptr;
+	char *line, *ptr;
 
 	ptr = linebuf_find(rec, '\n');
 	if (ptr == NULL) {
@@ -67,11 +103,12 @@ static int remove_newline(LINEBUF_REC *rec)
 
 		/* line buffer is too big - force a newline. */
                 linebuf_append(rec, "\n", 1);
-		ptr = rec->str+rec->len-1;
+		ptr = rec->str+rec->start+rec->len-1;
 	}
 
-	rec->remove = (int) (ptr-rec->str)+1;
-	if (ptr != rec->str && ptr[-1] == '\r') {
+	line = rec->str+rec->start;
+	rec->remove = (int) (ptr-line)+1;
+	if (ptr != line && ptr[-1] == '\r') {
 		/* remove CR too. */
 		ptr--;
 	}
@@ -94,11 +131,7 @@ int line_split(const char *data, int len, char **output, LINEBUF_REC **buffer)
 		*buffer = g_new0(LINEBUF_REC, 1);
 	rec = *buffer;
 
-	if (rec->remove > 0) {
-		rec->len -= rec->remove;
-		memmove(rec->str, rec->str+rec->remove, rec->len);
-		rec->remove = 0;
-	}
+	linebuf_consume(rec);
 
 	if (len > 0)
 		linebuf_append(rec, data, len);
@@ -117,10 +150,21 @@ int line_split(const char *data, int len, char **output, LINEBUF_REC **buffer)
 	}
 
 	ret = remove_newline(rec);
-	*output = rec->str;
+	*output = rec->str+rec->start;
 	return ret;
 }
 
+/* Return 1 if the next line_split() call can return a full line without
+   any new data */
+int line_split_has_line(LINEBUF_REC *buffer)
+{
+	if (buffer == NULL)
+		return 0;
+
+	linebuf_consume(buffer);
+	return buffer->len > 0 && linebuf_find(buffer, '\n') != NULL;
+}
+
 void line_split_free(LINEBUF_REC *buffer)
 {
 	if (buffer != NULL) {
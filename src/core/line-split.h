@@ -5,6 +5,10 @@
 int line_split(const char *data, int len, char **output, LINEBUF_REC **buffer);
 void line_split_free(LINEBUF_REC *buffer);
 
+/* Return 1 if the next line_split() call can return a full line without
+   any new data */
+int line_split_has_line(LINEBUF_REC *buffer);
+
 /* Return 1 if there is no data in the buffer */
 int line_split_is_empty(LINEBUF_REC *buffer);
 
@@ -24,6 +24,47 @@
 #include <irssi/src/core/net-sendbuffer.h>
 #include <irssi/src/core/line-split.h>
 
+struct _NET_SENDBUF_BLOCK_REC {
+	int pos; /* first unsent byte */
+	int len; /* bytes used */
+	int size;
+	char *data;
+};
+
+static NET_SENDBUF_BLOCK_REC *block_new(NET_SENDBUF_REC *rec, int size)
+{
+	NET_SENDBUF_BLOCK_REC *block;
+
+	if (rec->spare != NULL && size <= rec->spare->size) {
+		block = rec->spare;
+		rec->spare = NULL;
+	} else {
+		size = MAX(size, rec->bufsize);
+		block = g_malloc(sizeof(NET_SENDBUF_BLOCK_REC) + size);
+		block->size = size;
+		block->data = (char *) (block + 1);
+	}
+	block->pos = block->len = 0;
+	return block;
+}
+
+static void block_free(NET_SENDBUF_REC *rec, NET_SENDBUF_BLOCK_REC *block)
+{
+	if (rec->spare == NULL && block->size == rec->bufsize)
+		rec->spare = block;
+	else
+		g_free(block);
+}
+
+static void buffer_clear(NET_SENDBUF_REC *rec)
+{
+	NET_SENDBUF_BLOCK_REC *block;
+
+	while ((block = g_queue_pop_head(&rec->blocks)) != NULL)
+		block_free(rec, block);
+	rec->bufpos = 0;
+}
+
 /* Create new buffer - if `bufsize' is zero or less, DEFAULT_BUFFER_SIZE
    is used */
 NET_SENDBUF_REC *net_sendbuffer_create(GIOChannel *handle, int bufsize)
@@ -34,116 +75,160 @@ NET_SENDBUF_REC *net_sendbuffer_create(GIOChannel *handle, int bufsize)
 
 	rec = g_new0(NET_SENDBUF_REC, 1);
         rec->send_tag = -1;
+	rec->flush_tag = -1;
 	rec->handle = handle;
 	rec->bufsize = bufsize > 0 ? bufsize : DEFAULT_BUFFER_SIZE;
-	rec->def_bufsize = rec->bufsize;
+	g_queue_init(&rec->blocks);
 
 	return rec;
 }
 
+static int buffer_send(NET_SENDBUF_REC *rec);
+
 /* Destroy the buffer. `close' specifies if socket handle should be closed. */
 void net_sendbuffer_destroy(NET_SENDBUF_REC *rec, int close)
 {
+	/* give the data queued during this main loop iteration (like
+	   a QUIT) one chance to get out before the socket goes away */
+	if (rec->bufpos > 0)
+		buffer_send(rec);
+
         if (rec->send_tag != -1) g_source_remove(rec->send_tag);
+	if (rec->flush_tag != -1) g_source_remove(rec->flush_tag);
 	if (close) net_disconnect(rec->handle);
 	if (rec->readbuffer != NULL) line_split_free(rec->readbuffer);
-	g_free_not_null(rec->buffer);
+	buffer_clear(rec);
+	g_free_not_null(rec->spare);
 	g_free(rec);
 }
 
-/* Transmit all data from buffer - return TRUE if the whole buffer was sent */
+/* Transmit as much of the block chain as the socket takes - return TRUE
+   if the whole buffer was sent */
 static int buffer_send(NET_SENDBUF_REC *rec)
 {
-	int ret;
-
-	ret = net_transmit(rec->handle, rec->buffer, rec->bufpos);
-	if (ret < 0 || rec->bufpos == ret) {
-		/* error/all sent - don't try to send it anymore */
-		rec->bufsize = rec->def_bufsize;
-		rec->buffer = g_realloc(rec->buffer, rec->bufsize);
-		rec->bufpos = 0;
-		return TRUE;
-	}
+	struct iovec iov[NET_SENDBUF_MAX_IOV];
+	NET_SENDBUF_BLOCK_REC *block;
+	GList *tmp;
+	int count, ret, sent;
+
+	while (rec->bufpos > 0) {
+		count = 0;
+		for (tmp = rec->blocks.head; tmp != NULL && count < NET_SENDBUF_MAX_IOV;
+		     tmp = tmp->next) {
+			block = tmp->data;
+			iov[count].iov_base = block->data + block->pos;
+			iov[count].iov_len = block->len - block->pos;
+			count++;
+		}
+
+		ret = net_transmitv(rec->handle, iov, count);
+		if (ret < 0) {
+			/* error - don't try to send it anymore */
+			rec->failed = 1;
+			buffer_clear(rec);
+			return TRUE;
+		}
+
+		sent = ret;
+		rec->bufpos -= ret;
+		while (ret > 0) {
+			block = g_queue_peek_head(&rec->blocks);
+			if (ret < block->len - block->pos) {
+				block->pos += ret;
+				break;
+			}
+			ret -= block->len - block->pos;
+			block_free(rec, g_queue_pop_head(&rec->blocks));
+		}
 
-	if (ret > 0) {
-                rec->bufpos -= ret;
-		memmove(rec->buffer, rec->buffer+ret, rec->bufpos);
+		if (sent == 0)
+			return FALSE; /* socket is full */
 	}
-	return FALSE;
+	return TRUE;
 }
 
 static void sig_sendbuffer(NET_SENDBUF_REC *rec)
 {
-	if (rec->buffer != NULL) {
-		if (!buffer_send(rec))
-                        return;
-	}
+	if (!buffer_send(rec))
+		return;
 
 	g_source_remove(rec->send_tag);
 	rec->send_tag = -1;
 }
 
+static int sig_flush(NET_SENDBUF_REC *rec)
+{
+	rec->flush_tag = -1;
+
+	if (!buffer_send(rec) && rec->send_tag == -1) {
+		/* everything couldn't be sent. */
+		rec->send_tag =
+		    i_input_add(rec->handle, I_INPUT_WRITE, (GInputFunction) sig_sendbuffer, rec);
+	}
+	return FALSE;
+}
+
 /* Add `data' to transmit buffer - return FALSE if buffer is full */
 static int buffer_add(NET_SENDBUF_REC *rec, const void *data, int size)
 {
-	if (rec->buffer == NULL) {
-		rec->buffer = g_malloc(rec->bufsize);
-		rec->bufpos = 0;
+	NET_SENDBUF_BLOCK_REC *block;
+	int len;
+
+	if (rec->bufpos + size > MAX_BUFFER_SIZE) {
+		if (!rec->dead)
+			g_warning("Dropping some data on an outgoing connection");
+		rec->dead = 1;
+		return FALSE;
 	}
 
-	while (rec->bufpos+size > rec->bufsize) {
-		if (rec->bufsize >= MAX_BUFFER_SIZE) {
-			if (!rec->dead)
-				g_warning("Dropping some data on an outgoing connection");
-			rec->dead = 1;
-			return FALSE;
-		}
-		rec->bufsize *= 2;
-		rec->buffer = g_realloc(rec->buffer, rec->bufsize);
+	/* fill the free space of the last block first */
+	block = g_queue_peek_tail(&rec->blocks);
+	if (block != NULL && block->len < block->size) {
+		len = MIN(size, block->size - block->len);
+		memcpy(block->data + block->len, data, len);
+		block->len += len;
+		data = ((const char *) data) + len;
+		size -= len;
+		rec->bufpos += len;
 	}
 
-	memcpy(rec->buffer+rec->bufpos, data, size);
-	rec->bufpos += size;
+	if (size > 0) {
+		block = block_new(rec, size);
+		memcpy(block->data, data, size);
+		block->len = size;
+		g_queue_push_tail(&rec->blocks, block);
+		rec->bufpos += size;
+	}
 	return TRUE;
 }
 
-/* Send data, if all of it couldn't be sent immediately, it will be resent
-   automatically after a while. Returns -1 if some unrecoverable error
-   occurred. */
+/* Queue data for sending, see net-sendbuffer.h */
 int net_sendbuffer_send(NET_SENDBUF_REC *rec, const void *data, int size)
 {
-	int ret;
-
 	g_return_val_if_fail(rec != NULL, -1);
 	g_return_val_if_fail(data != NULL, -1);
+	if (rec->failed) return -1;
 	if (size <= 0) return 0;
 
-	if (rec->buffer == NULL || rec->bufpos == 0) {
-                /* nothing in buffer - transmit immediately */
-		ret = net_transmit(rec->handle, data, size);
-		if (ret < 0) return -1;
-		size -= ret;
-		data = ((const char *) data) + ret;
-	}
+	if (!buffer_add(rec, data, size))
+		return -1;
 
-	if (size <= 0)
-		return 0;
-
-	/* everything couldn't be sent. */
-	if (rec->send_tag == -1) {
-		rec->send_tag =
-		    i_input_add(rec->handle, I_INPUT_WRITE, (GInputFunction) sig_sendbuffer, rec);
+	/* while waiting for the socket to be writable the queue is sent from
+	   there, otherwise flush once everything for this iteration is in */
+	if (rec->send_tag == -1 && rec->flush_tag == -1) {
+		rec->flush_tag = g_idle_add_full(G_PRIORITY_HIGH,
+						 (GSourceFunc) sig_flush, rec, NULL);
 	}
-
-	return buffer_add(rec, data, size) ? 0 : -1;
+	return 0;
 }
 
 int net_sendbuffer_receive_line(NET_SENDBUF_REC *rec, char **str, int read_socket)
 {
-	char tmpbuf[2048];
+	char tmpbuf[16384];
 	int recvlen = 0;
 
-	if (read_socket)
+	/* don't read more before the lines we already have are processed */
+	if (read_socket && !line_split_has_line(rec->readbuffer))
 		recvlen = net_receive(rec->handle, tmpbuf, sizeof(tmpbuf));
 
 	return line_split(tmpbuf, recvlen, str, &rec->readbuffer);
@@ -154,7 +239,7 @@ void net_sendbuffer_flush(NET_SENDBUF_REC *rec)
 {
 	int handle;
 
-	if (rec->buffer == NULL)
+	if (rec->bufpos == 0)
 		return;
 
         /* set the socket blocking while doing this */
@@ -162,6 +247,15 @@ void net_sendbuffer_flush(NET_SENDBUF_REC *rec)
 	fcntl(handle, F_SETFL, 0);
 	while (!buffer_send(rec)) ;
 	fcntl(handle, F_SETFL, O_NONBLOCK);
+
+	if (rec->flush_tag != -1) {
+		g_source_remove(rec->flush_tag);
+		rec->flush_tag = -1;
+	}
+	if (rec->send_tag != -1) {
+		g_source_remove(rec->send_tag);
+		rec->send_tag = -1;
+	}
 }
 
 /* Returns the socket handle */
@@ -4,16 +4,23 @@
 #define DEFAULT_BUFFER_SIZE 8192
 #define MAX_BUFFER_SIZE 1048576
 
+/* max. buffers given to one writev() */
+#define NET_SENDBUF_MAX_IOV 64
+
+typedef struct _NET_SENDBUF_BLOCK_REC NET_SENDBUF_BLOCK_REC;
+
 struct _NET_SENDBUF_REC {
         GIOChannel *handle;
         LINEBUF_REC *readbuffer; /* receive buffer */
 
-        int send_tag;
-        int bufsize;
-        int bufpos;
-        char *buffer; /* Buffer is NULL until it's actually needed. */
-        int def_bufsize;
+        int send_tag; /* waiting for the socket to become writable */
+        int flush_tag; /* idle flush at the start of next main loop iteration */
+        int bufsize; /* size of newly allocated blocks */
+        int bufpos; /* bytes waiting in `blocks' */
+        GQueue blocks; /* NET_SENDBUF_BLOCK_REC chain, oldest first */
+        NET_SENDBUF_BLOCK_REC *spare; /* emptied block kept for reuse */
         unsigned int dead:1;
+        unsigned int failed:1; /* transmit failed, nothing more is sent */
 };
 
 /* Create new buffer - if `bufsize' is zero or less, DEFAULT_BUFFER_SIZE
@@ -22,9 +29,10 @@ NET_SENDBUF_REC *net_sendbuffer_create(GIOChannel *handle, int bufsize);
 /* Destroy the buffer. `close' specifies if socket handle should be closed. */
 void net_sendbuffer_destroy(NET_SENDBUF_REC *rec, int close);
 
-/* Send data, if all of it couldn't be sent immediately, it will be resent
-   automatically after a while. Returns -1 if some unrecoverable error
-   occurred. */
+/* Queue data for sending. Everything queued during one main loop iteration
+   is sent with a single writev() (or TLS record) at the start of the next
+   one; what the socket doesn't accept is resent when it becomes writable.
+   Returns -1 if the buffer is full or an earlier transmit failed. */
 int net_sendbuffer_send(NET_SENDBUF_REC *rec, const void *data, int size);
 
 int net_sendbuffer_receive_line(NET_SENDBUF_REC *rec, char **str, int read_socket);
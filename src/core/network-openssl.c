@@ -830,6 +830,11 @@ GIOChannel *net_start_ssl(SERVER_REC *server)
 }
 
 
+int irssi_ssl_is_channel(GIOChannel *handle)
+{
+	return handle->funcs == &irssi_ssl_channel_funcs;
+}
+
 int irssi_ssl_handshake(GIOChannel *handle)
 {
 	GIOSSLChannel *chan = (GIOSSLChannel *)handle;
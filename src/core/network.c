@@ -359,6 +359,43 @@ int net_transmit(GIOChannel *handle, const char *data, int len)
 	return ret;
 }
 
+/* TLS records carry at most 16k of data */
+#define MAX_TLS_RECORD_DATA 16384
+
+int net_transmitv(GIOChannel *handle, const struct iovec *iov, int iovcnt)
+{
+	char buf[MAX_TLS_RECORD_DATA];
+	ssize_t ret;
+	int i, len;
+
+	g_return_val_if_fail(handle != NULL, -1);
+	g_return_val_if_fail(iov != NULL, -1);
+
+	if (iovcnt == 1)
+		return net_transmit(handle, iov[0].iov_base, iov[0].iov_len);
+
+	if (irssi_ssl_is_channel(handle)) {
+		/* coalesce into one record instead of one per buffer */
+		len = 0;
+		for (i = 0; i < iovcnt && len < (int) sizeof(buf); i++) {
+			int size = MIN((int) iov[i].iov_len, (int) sizeof(buf) - len);
+
+			memcpy(buf + len, iov[i].iov_base, size);
+			len += size;
+		}
+		return net_transmit(handle, buf, len);
+	}
+
+	/* plain channels are unbuffered, so the fd can be written directly */
+	ret = writev(g_io_channel_unix_get_fd(handle), iov, iovcnt);
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
+		return -1;
+	}
+	return (int) ret;
+}
+
 /* Get socket address/port */
 int net_getsockname(GIOChannel *handle, IPADDR *addr, int *port)
 {
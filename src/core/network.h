@@ -3,6 +3,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <arpa/inet.h>
@@ -62,6 +63,9 @@ GIOChannel *net_connect_ip_ssl(IPADDR *ip, int port, IPADDR *my_ip, SERVER_REC *
 GIOChannel *net_start_ssl(SERVER_REC *server);
 
 int irssi_ssl_handshake(GIOChannel *handle);
+/* Returns TRUE if `handle' is a TLS channel from net_connect_ip_ssl()
+   or net_start_ssl() */
+int irssi_ssl_is_channel(GIOChannel *handle);
 /* Connect to socket with ip address */
 GIOChannel *net_connect_ip(IPADDR *ip, int port, IPADDR *my_ip);
 /* Connect to named UNIX socket */
@@ -78,6 +82,9 @@ GIOChannel *net_accept(GIOChannel *handle, IPADDR *addr, int *port);
 int net_receive(GIOChannel *handle, char *buf, int len);
 /* Transmit data, return number of bytes sent, -1 = error */
 int net_transmit(GIOChannel *handle, const char *data, int len);
+/* Transmit data from `iovcnt' buffers with one writev(), or as a single
+   TLS record for TLS channels. Returns number of bytes sent, -1 = error */
+int net_transmitv(GIOChannel *handle, const struct iovec *iov, int iovcnt);
 
 /* Get the first IP address for host, both IPv4 and IPv6 if possible. */
 int net_gethostbyname_first_ips(const char *addr, GResolverNameLookupFlags flags, IPADDR *ip4,
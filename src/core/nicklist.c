@@ -30,6 +30,37 @@
 #define isalnumhigh(a) \
         (i_isalnum(a) || (unsigned char) (a) >= 128)
 
+/* used when the server hasn't told us its PREFIX */
+#define DEFAULT_NICK_PREFIX "~&@%+"
+
+static int nick_sort_compare(NICK_REC *p1, NICK_REC *p2, CHANNEL_REC *channel)
+{
+	SERVER_REC *server = channel->server;
+	const char *nick_prefix;
+
+	nick_prefix = server == NULL || server->get_nick_flags == NULL ? NULL :
+		server->get_nick_flags(server);
+	if (nick_prefix == NULL || *nick_prefix == '\0')
+		nick_prefix = DEFAULT_NICK_PREFIX;
+
+	return nicklist_compare(p1, p2, nick_prefix);
+}
+
+static void nick_sort_add(CHANNEL_REC *channel, NICK_REC *nick)
+{
+	nick->sort_pos = g_sequence_insert_sorted(channel->nicks_sorted, nick,
+						  (GCompareDataFunc) nick_sort_compare,
+						  channel);
+}
+
+static void nick_sort_remove(NICK_REC *nick)
+{
+	if (nick->sort_pos != NULL) {
+		g_sequence_remove(nick->sort_pos);
+		nick->sort_pos = NULL;
+	}
+}
+
 static void nick_hash_add(CHANNEL_REC *channel, NICK_REC *nick)
 {
 	NICK_REC *list;
@@ -85,6 +116,7 @@ void nicklist_insert(CHANNEL_REC *channel, NICK_REC *nick)
         nick->chat_type = channel->chat_type;
 
         nick_hash_add(channel, nick);
+	nick_sort_add(channel, nick);
 	signal_emit("nicklist new", 2, channel, nick);
 }
 
@@ -131,6 +163,7 @@ void nicklist_remove(CHANNEL_REC *channel, NICK_REC *nick)
 	g_return_if_fail(nick != NULL);
 
         nick_hash_remove(channel, nick);
+	nick_sort_remove(nick);
 	nicklist_destroy(channel, nick);
 }
 
@@ -157,6 +190,7 @@ static void nicklist_rename_list(SERVER_REC *server, void *new_nick_id,
 
 		/* add new nick to hash table */
                 nick_hash_add(channel, nickrec);
+		nicklist_update_sort(channel, nickrec);
 
 		signal_emit("nicklist changed", 3, channel, nickrec, old_nick);
 	}
@@ -295,6 +329,45 @@ GSList *nicklist_getnicks(CHANNEL_REC *channel)
 	return list;
 }
 
+GSList *nicklist_get_sorted(CHANNEL_REC *channel, int start, int count)
+{
+	GSequenceIter *iter;
+	GSList *list;
+
+	g_return_val_if_fail(IS_CHANNEL(channel), NULL);
+	g_return_val_if_fail(start >= 0, NULL);
+
+	list = NULL;
+	iter = g_sequence_get_iter_at_pos(channel->nicks_sorted, start);
+	for (; count != 0 && !g_sequence_iter_is_end(iter);
+	     iter = g_sequence_iter_next(iter)) {
+		list = g_slist_prepend(list, g_sequence_get(iter));
+		if (count > 0)
+			count--;
+	}
+	return g_slist_reverse(list);
+}
+
+NICK_REC *nicklist_get_nth(CHANNEL_REC *channel, int pos)
+{
+	GSequenceIter *iter;
+
+	g_return_val_if_fail(IS_CHANNEL(channel), NULL);
+
+	if (pos < 0)
+		return NULL;
+
+	iter = g_sequence_get_iter_at_pos(channel->nicks_sorted, pos);
+	return g_sequence_iter_is_end(iter) ? NULL : g_sequence_get(iter);
+}
+
+int nicklist_count(CHANNEL_REC *channel)
+{
+	g_return_val_if_fail(IS_CHANNEL(channel), 0);
+
+	return g_sequence_get_length(channel->nicks_sorted);
+}
+
 GSList *nicklist_get_same(SERVER_REC *server, const char *nick)
 {
 	GSList *tmp;
@@ -429,6 +502,19 @@ void nicklist_update_flags_unique(SERVER_REC *server, void *id,
 				   nicklist_get_same_unique(server, id));
 }
 
+void nicklist_update_sort(CHANNEL_REC *channel, NICK_REC *nick)
+{
+	g_return_if_fail(IS_CHANNEL(channel));
+	g_return_if_fail(nick != NULL);
+
+	/* not inserted yet, nicklist_insert() will place it */
+	if (nick->sort_pos == NULL)
+		return;
+
+	g_sequence_sort_changed(nick->sort_pos,
+				(GCompareDataFunc) nick_sort_compare, channel);
+}
+
 /* Specify which nick in channel is ours */
 void nicklist_set_own(CHANNEL_REC *channel, NICK_REC *nick)
 {
@@ -457,6 +543,7 @@ static void sig_channel_created(CHANNEL_REC *channel)
 	g_return_if_fail(IS_CHANNEL(channel));
 
 	channel->nicks = g_hash_table_new((GHashFunc) i_istr_hash, (GCompareFunc) i_istr_equal);
+	channel->nicks_sorted = g_sequence_new(NULL);
 }
 
 static void nicklist_remove_hash(gpointer key, NICK_REC *nick,
@@ -478,6 +565,8 @@ static void sig_channel_destroyed(CHANNEL_REC *channel)
 	g_hash_table_foreach(channel->nicks,
 			     (GHFunc) nicklist_remove_hash, channel);
 	g_hash_table_destroy(channel->nicks);
+	g_sequence_free(channel->nicks_sorted);
+	channel->nicks_sorted = NULL;
 }
 
 static NICK_REC *nick_nfind(CHANNEL_REC *channel, const char *nick, int len)
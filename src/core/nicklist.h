@@ -38,6 +38,13 @@ NICK_REC *nicklist_find_mask(CHANNEL_REC *channel, const char *mask);
 GSList *nicklist_find_multiple(CHANNEL_REC *channel, const char *mask);
 /* Get list of nicks */
 GSList *nicklist_getnicks(CHANNEL_REC *channel);
+/* Get `count' nicks starting from position `start' in display order
+   (prefix rank, then nick). -1 = until the end of the list. */
+GSList *nicklist_get_sorted(CHANNEL_REC *channel, int start, int count);
+/* Get nick at position `pos' in display order, NULL if out of range */
+NICK_REC *nicklist_get_nth(CHANNEL_REC *channel, int pos);
+/* Number of nicks in channel */
+int nicklist_count(CHANNEL_REC *channel);
 /* Get all the nick records of `nick'. Returns channel, nick, channel, ... */
 GSList *nicklist_get_same(SERVER_REC *server, const char *nick);
 GSList *nicklist_get_same_unique(SERVER_REC *server, void *id);
@@ -48,6 +55,9 @@ void nicklist_update_flags(SERVER_REC *server, const char *nick,
 void nicklist_update_flags_unique(SERVER_REC *server, void *id,
 			   int gone, int ircop);
 
+/* Nick's prefixes changed, move it to its new place in display order */
+void nicklist_update_sort(CHANNEL_REC *channel, NICK_REC *nick);
+
 /* Specify which nick in channel is ours */
 void nicklist_set_own(CHANNEL_REC *channel, NICK_REC *nick);
 
@@ -73,6 +73,24 @@ void nickmatch_rebuild(NICKMATCH_REC *rec)
 	g_slist_foreach(channels, (GFunc) nickmatch_check_channel, rec);
 }
 
+void nickmatch_update(NICKMATCH_REC *rec, NICKMATCH_CHECK_FUNC func, void *data)
+{
+	GSList *tmp, *nicks, *ntmp;
+
+	for (tmp = channels; tmp != NULL; tmp = tmp->next) {
+		CHANNEL_REC *channel = tmp->data;
+
+		nicks = nicklist_getnicks(channel);
+		for (ntmp = nicks; ntmp != NULL; ntmp = ntmp->next) {
+			NICK_REC *nick = ntmp->data;
+
+			if (func(channel, nick, data))
+				rec->func(rec->nicks, channel, nick);
+		}
+		g_slist_free(nicks);
+	}
+}
+
 static void sig_nick_new(CHANNEL_REC *channel, NICK_REC *nick)
 {
 	GSList *tmp;
@@ -3,6 +3,8 @@
 
 typedef void (*NICKMATCH_REBUILD_FUNC) (GHashTable *list,
 					CHANNEL_REC *channel, NICK_REC *nick);
+typedef int (*NICKMATCH_CHECK_FUNC) (CHANNEL_REC *channel, NICK_REC *nick,
+				     void *data);
 
 typedef struct {
         GHashTable *nicks;
@@ -17,6 +19,9 @@ void nickmatch_deinit(NICKMATCH_REC *rec);
    This must be called soon after nickmatch_init(), before any nicklist
    signals get sent. */
 void nickmatch_rebuild(NICKMATCH_REC *rec);
+/* Calls rebuild function only for the nicks `func' returns TRUE for,
+   when a change can affect just some of them. */
+void nickmatch_update(NICKMATCH_REC *rec, NICKMATCH_CHECK_FUNC func, void *data);
 
 #define nickmatch_find(rec, nick) \
         g_hash_table_lookup((rec)->nicks, nick)
@@ -29,6 +29,7 @@
 #include <irssi/src/core/servers-reconnect.h>
 
 #include <irssi/src/core/settings.h>
+#include <irssi/src/core/timers.h>
 
 GSList *reconnects;
 static int last_reconnect_tag;
@@ -36,6 +37,8 @@ static int reconnect_timeout_tag;
 static int reconnect_time;
 static int connect_timeout;
 
+static void reconnect_schedule(void);
+
 void reconnect_save_status(SERVER_CONNECT_REC *conn, SERVER_REC *server)
 {
         g_free_not_null(conn->tag);
@@ -74,6 +77,7 @@ static void server_reconnect_add(SERVER_CONNECT_REC *conn,
 	server_connect_ref(conn);
 
 	reconnects = g_slist_append(reconnects, rec);
+	reconnect_schedule();
 }
 
 void server_reconnect_destroy(RECONNECT_REC *rec)
@@ -90,12 +94,13 @@ void server_reconnect_destroy(RECONNECT_REC *rec)
 	    last_reconnect_tag = 0;
 }
 
-static int server_reconnect_timeout(void)
+static void server_reconnect_timeout(void *data)
 {
 	SERVER_CONNECT_REC *conn;
 	GSList *list, *tmp, *next;
 	time_t now;
 
+	reconnect_timeout_tag = 0;
 	now = time(NULL);
 
 	/* timeout any connections that haven't gotten to connected-stage */
@@ -150,7 +155,56 @@ static int server_reconnect_timeout(void)
 	}
 
 	g_slist_free(list);
-	return 1;
+	reconnect_schedule();
+}
+
+static void reconnect_schedule_at(time_t *next, time_t when)
+{
+	if (*next == 0 || when < *next)
+		*next = when;
+}
+
+/* Wake up for the next pending reconnection or connect timeout */
+static void reconnect_schedule(void)
+{
+	GSList *tmp;
+	time_t now, next;
+
+	timer_remove(reconnect_timeout_tag);
+	reconnect_timeout_tag = 0;
+
+	next = 0;
+	if (connect_timeout > 0) {
+		for (tmp = servers; tmp != NULL; tmp = tmp->next) {
+			SERVER_REC *server = tmp->data;
+
+			if (!server->connected) {
+				reconnect_schedule_at(&next, server->connect_time +
+						      connect_timeout + 1);
+			}
+		}
+
+		for (tmp = lookup_servers; tmp != NULL; tmp = tmp->next) {
+			SERVER_REC *server = tmp->data;
+
+			reconnect_schedule_at(&next, server->connect_time +
+					      connect_timeout + 1);
+		}
+	}
+
+	for (tmp = reconnects; tmp != NULL; tmp = tmp->next) {
+		RECONNECT_REC *rec = tmp->data;
+
+		reconnect_schedule_at(&next, rec->next_connect);
+	}
+
+	if (next == 0)
+		return;
+
+	now = time(NULL);
+	reconnect_timeout_tag =
+		timer_add_seconds(next <= now ? 0 : next - now,
+				  server_reconnect_timeout, NULL);
 }
 
 static void sserver_connect(SERVER_SETUP_REC *rec, SERVER_CONNECT_REC *conn)
@@ -496,6 +550,7 @@ static void read_settings(void)
 {
 	reconnect_time = settings_get_time("server_reconnect_time")/1000;
         connect_timeout = settings_get_time("server_connect_timeout")/1000;
+	reconnect_schedule();
 }
 
 void servers_reconnect_init(void)
@@ -506,7 +561,7 @@ void servers_reconnect_init(void)
 	reconnects = NULL;
 	last_reconnect_tag = 0;
 
-	reconnect_timeout_tag = g_timeout_add(1000, (GSourceFunc) server_reconnect_timeout, NULL);
+	reconnect_timeout_tag = 0;
 	read_settings();
 
 	signal_add("server connect failed", (SIGNAL_FUNC) sig_reconnect);
@@ -514,6 +569,8 @@ void servers_reconnect_init(void)
 	signal_add("event connected", (SIGNAL_FUNC) sig_connected);
 	signal_add("chat protocol deinit", (SIGNAL_FUNC) sig_chat_protocol_deinit);
 	signal_add("setup changed", (SIGNAL_FUNC) read_settings);
+	signal_add_last("server looking", (SIGNAL_FUNC) reconnect_schedule);
+	signal_add_last("server connected", (SIGNAL_FUNC) reconnect_schedule);
 
 	command_bind("rmreconns", NULL, (SIGNAL_FUNC) cmd_rmreconns);
 	command_bind("reconnect", NULL, (SIGNAL_FUNC) cmd_reconnect);
@@ -522,13 +579,15 @@ void servers_reconnect_init(void)
 
 void servers_reconnect_deinit(void)
 {
-	g_source_remove(reconnect_timeout_tag);
+	timer_remove(reconnect_timeout_tag);
 
 	signal_remove("server connect failed", (SIGNAL_FUNC) sig_reconnect);
 	signal_remove("server disconnected", (SIGNAL_FUNC) sig_reconnect);
 	signal_remove("event connected", (SIGNAL_FUNC) sig_connected);
 	signal_remove("chat protocol deinit", (SIGNAL_FUNC) sig_chat_protocol_deinit);
 	signal_remove("setup changed", (SIGNAL_FUNC) read_settings);
+	signal_remove("server looking", (SIGNAL_FUNC) reconnect_schedule);
+	signal_remove("server connected", (SIGNAL_FUNC) reconnect_schedule);
 
 	command_unbind("rmreconns", (SIGNAL_FUNC) cmd_rmreconns);
 	command_unbind("reconnect", (SIGNAL_FUNC) cmd_reconnect);
@@ -0,0 +1,325 @@
+/*
+ session-snapshot.c : Binary /UPGRADE session data
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "module.h"
+#include <irssi/src/core/session-snapshot.h>
+
+#include <sys/mman.h>
+
+/* File layout:
+
+     magic, NUL padded to SNAPSHOT_MAGIC_SIZE bytes
+     int version
+     sections: int name length, name, gint64 data length, data
+
+   Strings are written as int length (-1 for NULL), the string and its
+   NUL, so they can be used directly from the mapped file. */
+
+#define SNAPSHOT_MAGIC "erssi session"
+#define SNAPSHOT_MAGIC_SIZE 16
+
+typedef struct {
+	const unsigned char *data;
+	gsize size;
+} SNAPSHOT_SECTION_REC;
+
+struct _SESSION_SNAPSHOT_REC {
+	/* writing */
+	int fd;
+	char *path;
+	char *section;
+	GString *data;
+	unsigned int failed:1;
+
+	/* reading */
+	unsigned char *map;
+	gsize map_size;
+	GHashTable *sections; /* name -> SNAPSHOT_SECTION_REC */
+};
+
+static void snapshot_write(SESSION_SNAPSHOT_REC *snap, const void *data, gsize size)
+{
+	const char *pos = data;
+	ssize_t ret;
+
+	while (size > 0 && !snap->failed) {
+		ret = write(snap->fd, pos, size);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			snap->failed = TRUE;
+			break;
+		}
+		pos += ret;
+		size -= ret;
+	}
+}
+
+static void snapshot_end_section(SESSION_SNAPSHOT_REC *snap)
+{
+	gint64 size;
+	int len;
+
+	if (snap->section == NULL)
+		return;
+
+	len = strlen(snap->section);
+	size = snap->data->len;
+	snapshot_write(snap, &len, sizeof(len));
+	snapshot_write(snap, snap->section, len);
+	snapshot_write(snap, &size, sizeof(size));
+	snapshot_write(snap, snap->data->str, snap->data->len);
+
+	g_string_truncate(snap->data, 0);
+	g_free_and_null(snap->section);
+}
+
+SESSION_SNAPSHOT_REC *session_snapshot_create(const char *path)
+{
+	SESSION_SNAPSHOT_REC *snap;
+	char magic[SNAPSHOT_MAGIC_SIZE] = SNAPSHOT_MAGIC;
+	int fd, version;
+
+	g_return_val_if_fail(path != NULL, NULL);
+
+	unlink(path);
+	fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+	if (fd == -1)
+		return NULL;
+
+	snap = g_new0(SESSION_SNAPSHOT_REC, 1);
+	snap->fd = fd;
+	snap->path = g_strdup(path);
+	snap->data = g_string_sized_new(65536);
+
+	version = SESSION_SNAPSHOT_VERSION;
+	snapshot_write(snap, magic, sizeof(magic));
+	snapshot_write(snap, &version, sizeof(version));
+	return snap;
+}
+
+void session_snapshot_section(SESSION_SNAPSHOT_REC *snap, const char *name)
+{
+	g_return_if_fail(snap != NULL);
+	g_return_if_fail(name != NULL);
+
+	snapshot_end_section(snap);
+	snap->section = g_strdup(name);
+}
+
+void session_snapshot_write_int(SESSION_SNAPSHOT_REC *snap, int value)
+{
+	g_string_append_len(snap->data, (const char *) &value, sizeof(value));
+}
+
+void session_snapshot_write_int64(SESSION_SNAPSHOT_REC *snap, gint64 value)
+{
+	g_string_append_len(snap->data, (const char *) &value, sizeof(value));
+}
+
+void session_snapshot_write_str(SESSION_SNAPSHOT_REC *snap, const char *str)
+{
+	int len;
+
+	len = str == NULL ? -1 : strlen(str);
+	session_snapshot_write_int(snap, len);
+	if (str != NULL)
+		g_string_append_len(snap->data, str, len + 1);
+}
+
+int session_snapshot_finish(SESSION_SNAPSHOT_REC *snap)
+{
+	int ret;
+
+	g_return_val_if_fail(snap != NULL, FALSE);
+
+	snapshot_end_section(snap);
+	if (close(snap->fd) != 0)
+		snap->failed = TRUE;
+
+	ret = !snap->failed;
+	if (!ret)
+		unlink(snap->path);
+
+	g_string_free(snap->data, TRUE);
+	g_free(snap->path);
+	g_free(snap);
+	return ret;
+}
+
+static int snapshot_read(SESSION_SNAPSHOT_READER *reader, void *data, gsize size)
+{
+	if ((gsize) (reader->end - reader->data) < size) {
+		reader->error = TRUE;
+		reader->data = reader->end;
+		memset(data, 0, size);
+		return FALSE;
+	}
+
+	memcpy(data, reader->data, size);
+	reader->data += size;
+	return TRUE;
+}
+
+/* Index the sections of a mapped file */
+static int snapshot_read_sections(SESSION_SNAPSHOT_REC *snap)
+{
+	SESSION_SNAPSHOT_READER reader;
+	SNAPSHOT_SECTION_REC *section;
+	gint64 size;
+	char *name;
+	int len, version;
+
+	reader.data = snap->map;
+	reader.end = snap->map + snap->map_size;
+	reader.error = FALSE;
+
+	if (snap->map_size < SNAPSHOT_MAGIC_SIZE ||
+	    strcmp((const char *) snap->map, SNAPSHOT_MAGIC) != 0)
+		return FALSE;
+	reader.data += SNAPSHOT_MAGIC_SIZE;
+
+	if (!snapshot_read(&reader, &version, sizeof(version)) ||
+	    version != SESSION_SNAPSHOT_VERSION)
+		return FALSE;
+
+	while (reader.data < reader.end) {
+		if (!snapshot_read(&reader, &len, sizeof(len)) || len < 0 ||
+		    reader.end - reader.data < len)
+			return FALSE;
+
+		name = g_strndup((const char *) reader.data, len);
+		reader.data += len;
+
+		if (!snapshot_read(&reader, &size, sizeof(size)) || size < 0 ||
+		    reader.end - reader.data < size) {
+			g_free(name);
+			return FALSE;
+		}
+
+		section = g_new(SNAPSHOT_SECTION_REC, 1);
+		section->data = reader.data;
+		section->size = size;
+		g_hash_table_replace(snap->sections, name, section);
+		reader.data += size;
+	}
+	return TRUE;
+}
+
+SESSION_SNAPSHOT_REC *session_snapshot_open(const char *path)
+{
+	SESSION_SNAPSHOT_REC *snap;
+	struct stat statbuf;
+	void *map;
+	int fd;
+
+	g_return_val_if_fail(path != NULL, NULL);
+
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+
+	if (fstat(fd, &statbuf) != 0 || statbuf.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	map = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	snap = g_new0(SESSION_SNAPSHOT_REC, 1);
+	snap->fd = -1;
+	snap->map = map;
+	snap->map_size = statbuf.st_size;
+	snap->sections = g_hash_table_new_full((GHashFunc) g_str_hash, (GEqualFunc) g_str_equal,
+					       (GDestroyNotify) g_free, (GDestroyNotify) g_free);
+
+	if (!snapshot_read_sections(snap)) {
+		session_snapshot_close(snap);
+		return NULL;
+	}
+	return snap;
+}
+
+void session_snapshot_close(SESSION_SNAPSHOT_REC *snap)
+{
+	g_return_if_fail(snap != NULL);
+
+	munmap(snap->map, snap->map_size);
+	g_hash_table_destroy(snap->sections);
+	g_free(snap);
+}
+
+int session_snapshot_find(SESSION_SNAPSHOT_REC *snap, const char *name,
+			  SESSION_SNAPSHOT_READER *reader)
+{
+	SNAPSHOT_SECTION_REC *section;
+
+	g_return_val_if_fail(snap != NULL, FALSE);
+	g_return_val_if_fail(name != NULL, FALSE);
+
+	section = g_hash_table_lookup(snap->sections, name);
+	if (section == NULL)
+		return FALSE;
+
+	reader->data = section->data;
+	reader->end = section->data + section->size;
+	reader->error = FALSE;
+	return TRUE;
+}
+
+int session_snapshot_read_int(SESSION_SNAPSHOT_READER *reader)
+{
+	int value;
+
+	snapshot_read(reader, &value, sizeof(value));
+	return value;
+}
+
+gint64 session_snapshot_read_int64(SESSION_SNAPSHOT_READER *reader)
+{
+	gint64 value;
+
+	snapshot_read(reader, &value, sizeof(value));
+	return value;
+}
+
+const char *session_snapshot_read_str(SESSION_SNAPSHOT_READER *reader)
+{
+	const char *str;
+	int len;
+
+	len = session_snapshot_read_int(reader);
+	if (len < 0)
+		return NULL;
+
+	if (reader->end - reader->data <= len || reader->data[len] != '\0') {
+		reader->error = TRUE;
+		reader->data = reader->end;
+		return NULL;
+	}
+
+	str = (const char *) reader->data;
+	reader->data += len + 1;
+	return str;
+}
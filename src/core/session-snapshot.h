@@ -0,0 +1,45 @@
+#ifndef IRSSI_CORE_SESSION_SNAPSHOT_H
+#define IRSSI_CORE_SESSION_SNAPSHOT_H
+
+/* Binary file for the bulk data of /UPGRADE (nicklists, scrollback) which
+   would be slow to write and parse as config nodes. The file consists of
+   named sections of integers and strings. It's only read by the next
+   irssi process on the same host, so values are in host byte order. */
+
+#define SESSION_SNAPSHOT_VERSION 1
+
+typedef struct _SESSION_SNAPSHOT_REC SESSION_SNAPSHOT_REC;
+
+typedef struct {
+	const unsigned char *data, *end;
+	unsigned int error:1; /* tried to read past the end of section */
+} SESSION_SNAPSHOT_READER;
+
+/* Create a new snapshot file, readable only by the user */
+SESSION_SNAPSHOT_REC *session_snapshot_create(const char *path);
+/* Start a new section, data written after this goes to it */
+void session_snapshot_section(SESSION_SNAPSHOT_REC *snap, const char *name);
+void session_snapshot_write_int(SESSION_SNAPSHOT_REC *snap, int value);
+void session_snapshot_write_int64(SESSION_SNAPSHOT_REC *snap, gint64 value);
+/* `str' may be NULL */
+void session_snapshot_write_str(SESSION_SNAPSHOT_REC *snap, const char *str);
+/* Write the last section and close the file. Returns FALSE if any write
+   failed, the file is removed then. */
+int session_snapshot_finish(SESSION_SNAPSHOT_REC *snap);
+
+/* Map an existing snapshot file to memory. Returns NULL if it doesn't exist
+   or isn't a valid snapshot of this version. */
+SESSION_SNAPSHOT_REC *session_snapshot_open(const char *path);
+void session_snapshot_close(SESSION_SNAPSHOT_REC *snap);
+
+/* Set `reader' to the start of section `name', returns FALSE if there's
+   no such section */
+int session_snapshot_find(SESSION_SNAPSHOT_REC *snap, const char *name,
+			  SESSION_SNAPSHOT_READER *reader);
+int session_snapshot_read_int(SESSION_SNAPSHOT_READER *reader);
+gint64 session_snapshot_read_int64(SESSION_SNAPSHOT_READER *reader);
+/* Returned string points inside the snapshot and is valid until it's
+   closed. NULL if NULL was written or on error. */
+const char *session_snapshot_read_str(SESSION_SNAPSHOT_READER *reader);
+
+#endif
@@ -27,6 +27,8 @@
 #include <irssi/src/core/pidwait.h>
 #include <irssi/src/lib-config/iconfig.h>
 #include <irssi/src/core/misc.h>
+#include <irssi/src/core/session.h>
+#include <irssi/src/core/session-snapshot.h>
 
 #include <irssi/src/core/chat-protocols.h>
 #include <irssi/src/core/servers.h>
@@ -39,6 +41,11 @@ char *irssi_binary = NULL;
 
 static char **session_args;
 
+/* nicklists and scrollback go to a binary snapshot next to the session
+   config, it's open only while saving or restoring */
+static SESSION_SNAPSHOT_REC *snapshot;
+static int snapshot_sections;
+
 void session_set_binary(const char *path)
 {
 	g_free_and_null(irssi_binary);
@@ -60,7 +67,7 @@ void session_upgrade(void)
 static void cmd_upgrade(const char *data)
 {
 	CONFIG_REC *session;
-	char *session_file, *str, *name;
+	char *session_file, *snapshot_file, *str, *name;
 	char *binary;
 
 	if (*data == '\0')
@@ -80,7 +87,26 @@ static void cmd_upgrade(const char *data)
 	session = config_open(session_file, 0600);
         unlink(session_file);
 
+	snapshot_file = g_strdup_printf("%s/session.snapshot", get_irssi_dir());
+	snapshot = session_snapshot_create(snapshot_file);
+	snapshot_sections = 0;
+	if (snapshot != NULL) {
+		config_node_set_str(session, session->mainnode,
+				    "snapshot", snapshot_file);
+	}
+
 	signal_emit("session save", 1, session);
+	if (snapshot != NULL) {
+		signal_emit("session save snapshot", 1, snapshot);
+		if (!session_snapshot_finish(snapshot)) {
+			/* restore falls back to an empty nicklist */
+			config_node_set_str(session, session->mainnode,
+					    "snapshot", NULL);
+		}
+		snapshot = NULL;
+	}
+	g_free(snapshot_file);
+
         config_write(session, NULL, -1);
         config_close(session);
 
@@ -115,12 +141,35 @@ static void session_save_channel_nicks(CHANNEL_REC *channel, CONFIG_REC *config,
 				       CONFIG_NODE *node)
 {
 	GSList *tmp, *nicks;
+	NICK_REC *nick;
+	char *section;
+
+	nicks = nicklist_getnicks(channel);
+	if (snapshot == NULL) {
+		node = config_node_section(config, node, "nicks", NODE_TYPE_LIST);
+		for (tmp = nicks; tmp != NULL; tmp = tmp->next)
+			session_save_nick(channel, tmp->data, config, node);
+		g_slist_free(nicks);
+		return;
+	}
+
+	section = g_strdup_printf("nicks/%d", snapshot_sections++);
+	config_node_set_str(config, node, "nicks_snapshot", section);
 
-	node = config_node_section(config, node, "nicks", NODE_TYPE_LIST);
-        nicks = nicklist_getnicks(channel);
-	for (tmp = nicks; tmp != NULL; tmp = tmp->next)
-		session_save_nick(channel, tmp->data, config, node);
-        g_slist_free(nicks);
+	session_snapshot_section(snapshot, section);
+	session_snapshot_write_int(snapshot, g_slist_length(nicks));
+	for (tmp = nicks; tmp != NULL; tmp = tmp->next) {
+		nick = tmp->data;
+
+		session_snapshot_write_str(snapshot, nick->nick);
+		session_snapshot_write_int(snapshot,
+					   (nick->op ? SESSION_NICK_OP : 0) |
+					   (nick->halfop ? SESSION_NICK_HALFOP : 0) |
+					   (nick->voice ? SESSION_NICK_VOICE : 0));
+		session_snapshot_write_str(snapshot, nick->prefixes);
+	}
+	g_slist_free(nicks);
+	g_free(section);
 }
 
 static void session_save_channel(CHANNEL_REC *channel, CONFIG_REC *config,
@@ -193,9 +242,24 @@ static void session_save_server(SERVER_REC *server, CONFIG_REC *config,
 static void session_restore_channel_nicks(CHANNEL_REC *channel,
 					  CONFIG_NODE *node)
 {
+	SESSION_SNAPSHOT_READER reader;
+	const char *section;
 	GSList *tmp;
 
-	/* restore nicks */
+	section = config_node_get_str(node, "nicks_snapshot", NULL);
+	if (section != NULL) {
+		if (snapshot != NULL &&
+		    session_snapshot_find(snapshot, section, &reader))
+			signal_emit("session restore nicklist", 2, channel, &reader);
+		else {
+			/* the snapshot couldn't be written or read back,
+			   let the server send the nicklist again */
+			channel->session_names = TRUE;
+		}
+		return;
+	}
+
+	/* restore nicks, saved by an older version */
 	node = config_node_section(NULL, node, "nicks", -1);
 	if (node != NULL && node->type == NODE_TYPE_LIST) {
 		tmp = config_node_first(node->value);
@@ -335,6 +399,7 @@ static void sig_session_restore(CONFIG_REC *config)
 static void sig_init_finished(void)
 {
 	CONFIG_REC *session;
+	const char *snapshot_file;
 
 	if (session_file == NULL)
 		return;
@@ -344,7 +409,19 @@ static void sig_init_finished(void)
 		return;
 
 	config_parse(session);
+
+	snapshot_file = config_node_get_str(session->mainnode, "snapshot", NULL);
+	snapshot = snapshot_file == NULL ? NULL :
+		session_snapshot_open(snapshot_file);
+
         signal_emit("session restore", 1, session);
+	if (snapshot != NULL) {
+		signal_emit("session restore snapshot", 1, snapshot);
+		session_snapshot_close(snapshot);
+		snapshot = NULL;
+	}
+	if (snapshot_file != NULL)
+		unlink(snapshot_file);
 	config_close(session);
 
 	unlink(session_file);
@@ -1,6 +1,12 @@
 #ifndef IRSSI_CORE_SESSION_H
 #define IRSSI_CORE_SESSION_H
 
+/* nick flags in the "nicks/<n>" sections of the /UPGRADE snapshot:
+   int count, then for each nick str nick, int flags, str prefixes */
+#define SESSION_NICK_OP		0x01
+#define SESSION_NICK_HALFOP	0x02
+#define SESSION_NICK_VOICE	0x04
+
 extern char *irssi_binary;
 
 void session_set_binary(const char *path);
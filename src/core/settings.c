@@ -43,6 +43,8 @@ static unsigned int user_settings_changed;
 
 static GHashTable *settings;
 static int timeout_tag;
+/* bumped when mainconfig is replaced, see settings_rec_update() */
+static int settings_generation;
 
 static int config_last_modifycounter;
 static time_t config_last_mtime;
@@ -68,82 +70,191 @@ static SETTINGS_REC *settings_get(const char *key, SettingType type)
 	return rec;
 }
 
-static const char *
-settings_get_str_type(const char *key, SettingType type)
+static CONFIG_NODE *settings_get_module_node(SETTINGS_REC *rec)
 {
-	SETTINGS_REC *rec;
 	CONFIG_NODE *node;
 
-	rec = settings_get(key, type);
-	if (rec == NULL) return NULL;
-
 	node = iconfig_node_traverse("settings", FALSE);
-	node = node == NULL ? NULL : iconfig_node_section(node, rec->module, -1);
+	return node == NULL ? NULL : iconfig_node_section(node, rec->module, -1);
+}
+
+/* re-read the value from config if it has changed since last time */
+static void settings_rec_update(SETTINGS_REC *rec)
+{
+	CONFIG_NODE *node;
+	const char *str;
+	int value;
+
+	if (rec->cache_generation == settings_generation &&
+	    rec->cache_counter == mainconfig->modifycounter)
+		return;
+
+	rec->cache_generation = settings_generation;
+	rec->cache_counter = mainconfig->modifycounter;
+
+	node = settings_get_module_node(rec);
+	switch (rec->type) {
+	case SETTING_TYPE_INT:
+		rec->cache_value.v_int = node == NULL ? rec->default_value.v_int :
+			config_node_get_int(node, rec->key, rec->default_value.v_int);
+		return;
+	case SETTING_TYPE_BOOLEAN:
+		rec->cache_value.v_bool = node == NULL ? rec->default_value.v_bool :
+			config_node_get_bool(node, rec->key, rec->default_value.v_bool);
+		return;
+	case SETTING_TYPE_CHOICE:
+		str = node == NULL ? NULL :
+			config_node_get_str(node, rec->key, NULL);
+		value = str == NULL ? -1 : strarray_find(rec->choices, str);
+		if (value < 0) {
+			value = rec->default_value.v_int;
+			str = rec->choices[value];
+		}
+		rec->cache_value.v_int = value;
+		break;
+	default:
+		str = node == NULL ? rec->default_value.v_string :
+			config_node_get_str(node, rec->key, rec->default_value.v_string);
+		break;
+	}
+
+	g_free(rec->cache_value.v_string);
+	rec->cache_value.v_string = g_strdup(str);
 
-	return node == NULL ? rec->default_value.v_string :
-		config_node_get_str(node, key, rec->default_value.v_string);
+	value = 0;
+	if (str == NULL)
+		;
+	else if (rec->type == SETTING_TYPE_TIME) {
+		if (!parse_time_interval(str, &value))
+			g_warning("settings_get_time(%s) : Invalid time '%s'", rec->key, str);
+	} else if (rec->type == SETTING_TYPE_SIZE) {
+		if (!parse_size(str, &value))
+			g_warning("settings_get_size(%s) : Invalid size '%s'", rec->key, str);
+	} else if (rec->type == SETTING_TYPE_LEVEL) {
+		value = level2bits(str, NULL);
+	} else {
+		return;
+	}
+	rec->cache_value.v_int = value;
+}
+
+const char *settings_rec_get_str(SETTINGS_REC *rec)
+{
+	g_return_val_if_fail(rec != NULL, NULL);
+
+	if (rec->type == SETTING_TYPE_INT || rec->type == SETTING_TYPE_BOOLEAN) {
+		/* not cached as string */
+		CONFIG_NODE *node = settings_get_module_node(rec);
+
+		return node == NULL ? NULL : config_node_get_str(node, rec->key, NULL);
+	}
+
+	settings_rec_update(rec);
+	return rec->cache_value.v_string;
+}
+
+int settings_rec_get_int(SETTINGS_REC *rec)
+{
+	g_return_val_if_fail(rec != NULL, 0);
+	g_return_val_if_fail(rec->type == SETTING_TYPE_INT, 0);
+
+	settings_rec_update(rec);
+	return rec->cache_value.v_int;
+}
+
+int settings_rec_get_bool(SETTINGS_REC *rec)
+{
+	g_return_val_if_fail(rec != NULL, FALSE);
+	g_return_val_if_fail(rec->type == SETTING_TYPE_BOOLEAN, FALSE);
+
+	settings_rec_update(rec);
+	return rec->cache_value.v_bool;
+}
+
+int settings_rec_get_time(SETTINGS_REC *rec)
+{
+	g_return_val_if_fail(rec != NULL, 0);
+	g_return_val_if_fail(rec->type == SETTING_TYPE_TIME, 0);
+
+	settings_rec_update(rec);
+	return rec->cache_value.v_int;
+}
+
+int settings_rec_get_level(SETTINGS_REC *rec)
+{
+	g_return_val_if_fail(rec != NULL, 0);
+	g_return_val_if_fail(rec->type == SETTING_TYPE_LEVEL, 0);
+
+	settings_rec_update(rec);
+	return rec->cache_value.v_int;
+}
+
+int settings_rec_get_size(SETTINGS_REC *rec)
+{
+	g_return_val_if_fail(rec != NULL, 0);
+	g_return_val_if_fail(rec->type == SETTING_TYPE_SIZE, 0);
+
+	settings_rec_update(rec);
+	return rec->cache_value.v_int;
+}
+
+int settings_rec_get_choice(SETTINGS_REC *rec)
+{
+	g_return_val_if_fail(rec != NULL, -1);
+	g_return_val_if_fail(rec->type == SETTING_TYPE_CHOICE, -1);
+
+	settings_rec_update(rec);
+	return rec->cache_value.v_int;
 }
 
 const char *settings_get_str(const char *key)
 {
-	return settings_get_str_type(key, SETTING_TYPE_ANY);
+	SETTINGS_REC *rec;
+
+	rec = settings_get(key, SETTING_TYPE_ANY);
+	return rec == NULL ? NULL : settings_rec_get_str(rec);
 }
 
 int settings_get_int(const char *key)
 {
 	SETTINGS_REC *rec;
-	CONFIG_NODE *node;
 
 	rec = settings_get(key, SETTING_TYPE_INT);
-	if (rec == NULL) return 0;
-
-	node = iconfig_node_traverse("settings", FALSE);
-	node = node == NULL ? NULL : iconfig_node_section(node, rec->module, -1);
-
-	return node == NULL ? rec->default_value.v_int :
-		config_node_get_int(node, key, rec->default_value.v_int);
+	return rec == NULL ? 0 : settings_rec_get_int(rec);
 }
 
 int settings_get_bool(const char *key)
 {
 	SETTINGS_REC *rec;
-	CONFIG_NODE *node;
 
 	rec = settings_get(key, SETTING_TYPE_BOOLEAN);
-	if (rec == NULL) return FALSE;
-
-	node = iconfig_node_traverse("settings", FALSE);
-	node = node == NULL ? NULL : iconfig_node_section(node, rec->module, -1);
-
-	return node == NULL ? rec->default_value.v_bool :
-		config_node_get_bool(node, key, rec->default_value.v_bool);
+	return rec == NULL ? FALSE : settings_rec_get_bool(rec);
 }
 
 int settings_get_time(const char *key)
 {
-	const char *str;
-	int msecs = 0;
+	SETTINGS_REC *rec;
 
-	str = settings_get_str_type(key, SETTING_TYPE_TIME);
-	if (str != NULL && !parse_time_interval(str, &msecs))
-		g_warning("settings_get_time(%s) : Invalid time '%s'", key, str);
-	return str == NULL ? 0 : msecs;
+	rec = settings_get(key, SETTING_TYPE_TIME);
+	return rec == NULL ? 0 : settings_rec_get_time(rec);
 }
 
 int settings_get_level(const char *key)
 {
-	const char *str;
+	SETTINGS_REC *rec;
 
-	str = settings_get_str_type(key, SETTING_TYPE_LEVEL);
-	return str == NULL ? 0 : level2bits(str, NULL);
+	rec = settings_get(key, SETTING_TYPE_LEVEL);
+	return rec == NULL ? 0 : settings_rec_get_level(rec);
 }
 
 int settings_get_level_negative(const char *key)
 {
+	SETTINGS_REC *rec;
 	const char *str, *tmp, *all_levels;
 	int levels;
 
-	str = settings_get_str_type(key, SETTING_TYPE_LEVEL);
+	rec = settings_get(key, SETTING_TYPE_LEVEL);
+	str = rec == NULL ? NULL : settings_rec_get_str(rec);
 	if (str == NULL)
 		return 0;
 
@@ -157,35 +268,18 @@ int settings_get_level_negative(const char *key)
 
 int settings_get_size(const char *key)
 {
-	const char *str;
-	int bytes = 0;
+	SETTINGS_REC *rec;
 
-	str = settings_get_str_type(key, SETTING_TYPE_SIZE);
-	if (str != NULL && !parse_size(str, &bytes))
-		g_warning("settings_get_size(%s) : Invalid size '%s'", key, str);
-	return str == NULL ? 0 : bytes;
+	rec = settings_get(key, SETTING_TYPE_SIZE);
+	return rec == NULL ? 0 : settings_rec_get_size(rec);
 }
 
 int settings_get_choice(const char *key)
 {
 	SETTINGS_REC *rec;
-	CONFIG_NODE *node;
-	char *str;
-	int index;
 
 	rec = settings_get(key, SETTING_TYPE_CHOICE);
-	if (rec == NULL) return -1;
-
-	node = iconfig_node_traverse("settings", FALSE);
-	node = node == NULL ? NULL : iconfig_node_section(node, rec->module, -1);
-
-	str = node == NULL ? rec->default_value.v_string :
-		config_node_get_str(node, key, rec->default_value.v_string);
-
-	if (str == NULL || (index = strarray_find(rec->choices, str)) < 0)
-		return rec->default_value.v_int;
-
-	return index;
+	return rec == NULL ? -1 : settings_rec_get_choice(rec);
 }
 
 char *settings_get_print(SETTINGS_REC *rec)
@@ -260,6 +354,10 @@ static void settings_add(const char *module, const char *section,
 
 		rec->default_value = *default_value;
 		rec->choices = choices_vec;
+
+		memset(&rec->cache_value, 0, sizeof(rec->cache_value));
+		rec->cache_generation = -1;
+		rec->cache_counter = 0;
 		g_hash_table_insert(settings, rec->key, rec);
 	}
 }
@@ -340,6 +438,7 @@ static void settings_destroy(SETTINGS_REC *rec)
 	    rec->type != SETTING_TYPE_BOOLEAN &&
 	    rec->type != SETTING_TYPE_CHOICE)
 		g_free(rec->default_value.v_string);
+	g_free(rec->cache_value.v_string);
 	g_strfreev(rec->choices);
         g_free(rec->module);
         g_free(rec->section);
@@ -822,6 +921,7 @@ int settings_reread(const char *fname)
 	config_close(mainconfig);
 	mainconfig = tempconfig;
 	config_last_modifycounter = mainconfig->modifycounter;
+	settings_generation++;
 
 	signal_emit("setup changed", 0);
 	signal_emit("setup reread", 1, mainconfig->fname);
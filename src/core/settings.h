@@ -28,6 +28,11 @@ typedef struct {
 	SettingType type;
 	SettingValue default_value;
 	char **choices;
+
+	/* parsed value, valid while the configuration hasn't changed */
+	SettingValue cache_value;
+	int cache_generation;
+	int cache_counter;
 } SETTINGS_REC;
 
 enum {
@@ -72,6 +77,18 @@ int settings_get_size(const char *key); /* as bytes */
 int settings_get_choice(const char *key);
 char *settings_get_print(SETTINGS_REC *rec);
 
+/* Same as above, but for a record returned by settings_get_record(). The
+   parsed value is cached in the record and refreshed only after the
+   configuration has changed, so these don't do any lookups and are meant
+   for code that runs for every message. */
+const char *settings_rec_get_str(SETTINGS_REC *rec);
+int settings_rec_get_int(SETTINGS_REC *rec);
+int settings_rec_get_bool(SETTINGS_REC *rec);
+int settings_rec_get_time(SETTINGS_REC *rec); /* as milliseconds */
+int settings_rec_get_level(SETTINGS_REC *rec);
+int settings_rec_get_size(SETTINGS_REC *rec); /* as bytes */
+int settings_rec_get_choice(SETTINGS_REC *rec);
+
 /* Functions to add/remove settings */
 void settings_add_str_module(const char *module, const char *section,
 			     const char *key, const char *def);
@@ -22,9 +22,7 @@
 #include <irssi/src/core/signals.h>
 #include <irssi/src/core/modules.h>
 
-typedef struct _SignalHook {
-	struct _SignalHook *next;
-
+typedef struct {
         int priority;
 	const char *module;
 	SIGNAL_FUNC func;
@@ -40,46 +38,72 @@ typedef struct {
 	int continue_emit; /* this signal emit was continued elsewhere */
         int remove_count; /* hooks were removed from signal */
 
-        SignalHook *hooks;
+	/* priority sorted array of SignalHooks. The array is never resized
+	   while the signal is being emitted, so the emit loop can walk it by
+	   index without following any pointers. */
+	GArray *hooks;
+	/* hooks added while the signal was being emitted, merged into
+	   `hooks' once the outermost emit has finished */
+	GArray *pending;
 } Signal;
 
 void *signal_user_data;
 
-static GHashTable *signals;
+/* Signal records indexed directly by signal id. Signal ids come from
+   module_get_uniq_id_str() which hands them out sequentially, so the
+   array stays dense. */
+static GPtrArray *signals;
 static Signal *current_emitted_signal;
-static SignalHook *current_emitted_hook;
+static int current_emitted_pos;
 
 #define signal_ref(signal) ++(signal)->refcount
-#define signal_unref(signal) (signal_unref_full(signal, TRUE))
 
-static int signal_unref_full(Signal *rec, int remove)
+static Signal *signal_find(int signal_id)
+{
+	if (signal_id < 0 || (guint) signal_id >= signals->len)
+		return NULL;
+
+	return g_ptr_array_index(signals, signal_id);
+}
+
+static void signal_unref(Signal *rec)
 {
         g_assert(rec->refcount > 0);
 
 	if (--rec->refcount != 0)
-		return TRUE;
+		return;
 
 	/* remove whole signal from memory */
-	if (rec->hooks != NULL) {
+	if (rec->hooks->len != 0 ||
+	    (rec->pending != NULL && rec->pending->len != 0)) {
 		g_error("signal_unref(%s) : BUG - hook list wasn't empty",
 			signal_get_id_str(rec->id));
 	}
 
-	if (remove)
-		g_hash_table_remove(signals, GINT_TO_POINTER(rec->id));
+	g_ptr_array_index(signals, rec->id) = NULL;
+	g_array_free(rec->hooks, TRUE);
+	if (rec->pending != NULL)
+		g_array_free(rec->pending, TRUE);
         g_free(rec);
-
-	return FALSE;
 }
 
-static void signal_hash_ref(void *key, Signal *rec)
+/* insert `hook' before other hooks with the same priority */
+static void signal_hooks_insert(GArray *hooks, SignalHook *hook)
 {
-	signal_ref(rec);
-}
+	SignalHook *data;
+	guint low, high, mid;
+
+	data = (SignalHook *) hooks->data;
+	low = 0; high = hooks->len;
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (data[mid].priority < hook->priority)
+			low = mid + 1;
+		else
+			high = mid;
+	}
 
-static int signal_hash_unref(void *key, Signal *rec)
-{
-	return !signal_unref_full(rec, FALSE);
+	g_array_insert_vals(hooks, low, hook, 1);
 }
 
 void signal_add_full(const char *module, int priority,
@@ -94,73 +118,77 @@ void signal_add_full_id(const char *module, int priority,
 			int signal_id, SIGNAL_FUNC func, void *user_data)
 {
 	Signal *signal;
-        SignalHook *hook, **tmp;
+        SignalHook hook;
 
 	g_return_if_fail(signal_id >= 0);
 	g_return_if_fail(func != NULL);
 
-	signal = g_hash_table_lookup(signals, GINT_TO_POINTER(signal_id));
+	signal = signal_find(signal_id);
 	if (signal == NULL) {
                 /* new signal */
 		signal = g_new0(Signal, 1);
 		signal->id = signal_id;
-		g_hash_table_insert(signals, GINT_TO_POINTER(signal_id), signal);
+		signal->hooks = g_array_new(FALSE, FALSE, sizeof(SignalHook));
+
+		if ((guint) signal_id >= signals->len)
+			g_ptr_array_set_size(signals, signal_id + 1);
+		g_ptr_array_index(signals, signal_id) = signal;
 	}
 
-	hook = g_new0(SignalHook, 1);
-	hook->priority = priority;
-	hook->module = module;
-	hook->func = func;
-	hook->user_data = user_data;
-
-	/* insert signal to proper position in list */
-	for (tmp = &signal->hooks; ; tmp = &(*tmp)->next) {
-		if (*tmp == NULL) {
-                        /* last in list */
-			*tmp = hook;
-                        break;
-		} else if (priority <= (*tmp)->priority) {
-                        /* insert before others with same priority */
-			hook->next = *tmp;
-			*tmp = hook;
-                        break;
+	hook.priority = priority;
+	hook.module = module;
+	hook.func = func;
+	hook.user_data = user_data;
+
+	if (signal->emitting) {
+		/* can't touch the hook array while it's being walked */
+		if (signal->pending == NULL) {
+			signal->pending = g_array_new(FALSE, FALSE,
+						      sizeof(SignalHook));
 		}
+		g_array_append_val(signal->pending, hook);
+	} else {
+		signal_hooks_insert(signal->hooks, &hook);
 	}
 
         signal_ref(signal);
 }
 
-static void signal_remove_hook(Signal *rec, SignalHook **hook_pos)
-{
-	SignalHook *hook;
-
-        hook = *hook_pos;
-        *hook_pos = hook->next;
-
-	g_free(hook);
-
-	signal_unref(rec);
-}
-
 /* Remove function from signal's emit list */
 static int signal_remove_func(Signal *rec, SIGNAL_FUNC func, void *user_data)
 {
-        SignalHook **hook;
+	SignalHook *hook;
+	guint i;
 
-	for (hook = &rec->hooks; *hook != NULL; hook = &(*hook)->next) {
-		if ((*hook)->func == func && (*hook)->user_data == user_data) {
+	for (i = 0; i < rec->hooks->len; i++) {
+		hook = &g_array_index(rec->hooks, SignalHook, i);
+		if (hook->func == func && hook->user_data == user_data) {
 			if (rec->emitting) {
 				/* mark it removed after emitting is done */
-				(*hook)->func = NULL;
+				hook->func = NULL;
                                 rec->remove_count++;
 			} else {
 				/* remove the function from emit list */
-				signal_remove_hook(rec, hook);
+				g_array_remove_index(rec->hooks, i);
+				signal_unref(rec);
 			}
 			return TRUE;
 		}
 	}
 
+	if (rec->pending == NULL)
+		return FALSE;
+
+	for (i = 0; i < rec->pending->len; i++) {
+		hook = &g_array_index(rec->pending, SignalHook, i);
+		if (hook->func == func && hook->user_data == user_data) {
+			/* pending hooks aren't being walked by anyone */
+			g_array_remove_index(rec->pending, i);
+			signal_unref(rec);
+			return TRUE;
+		}
+	}
+
         return FALSE;
 }
 
@@ -171,7 +199,7 @@ void signal_remove_id(int signal_id, SIGNAL_FUNC func, void *user_data)
 	g_return_if_fail(signal_id >= 0);
 	g_return_if_fail(func != NULL);
 
-	rec = g_hash_table_lookup(signals, GINT_TO_POINTER(signal_id));
+	rec = signal_find(signal_id);
         if (rec != NULL)
                 signal_remove_func(rec, func, user_data);
 }
@@ -184,34 +212,45 @@ void signal_remove_full(const char *signal, SIGNAL_FUNC func, void *user_data)
 	signal_remove_id(signal_get_uniq_id(signal), func, user_data);
 }
 
+/* rebuild the hook array after emitting: drop the hooks that were
+   removed and merge the ones that were added meanwhile. The caller must
+   hold a reference to `rec'. */
 static void signal_hooks_clean(Signal *rec)
 {
-	SignalHook **hook, **next;
-        int count;
-
-        count = rec->remove_count;
-        rec->remove_count = 0;
+	SignalHook *hook;
+	guint i;
 
-	for (hook = &rec->hooks; *hook != NULL; hook = next) {
-		next = &(*hook)->next;
+	if (rec->remove_count > 0) {
+		rec->remove_count = 0;
 
-		if ((*hook)->func == NULL) {
-                        next = hook;
-			signal_remove_hook(rec, hook);
+		for (i = rec->hooks->len; i > 0; i--) {
+			hook = &g_array_index(rec->hooks, SignalHook, i-1);
+			if (hook->func == NULL) {
+				g_array_remove_index(rec->hooks, i-1);
+				signal_unref(rec);
+			}
+		}
+	}
 
-			if (--count == 0)
-                                break;
+	if (rec->pending != NULL) {
+		for (i = 0; i < rec->pending->len; i++) {
+			signal_hooks_insert(rec->hooks,
+					    &g_array_index(rec->pending,
+							   SignalHook, i));
 		}
+		g_array_free(rec->pending, TRUE);
+		rec->pending = NULL;
 	}
 }
 
 static int signal_emit_real(Signal *rec, int params, va_list va,
-			    SignalHook *first_hook)
+			    int first_hook)
 {
 	const void *arglist[SIGNAL_MAX_ARGUMENTS];
 	Signal *prev_emitted_signal;
-        SignalHook *hook, *prev_emitted_hook;
-	int i, stopped, stop_emit_count, continue_emit_count;
+        SignalHook *hooks;
+	int i, count, prev_emitted_pos;
+	int stopped, stop_emit_count, continue_emit_count;
 
 	for (i = 0; i < SIGNAL_MAX_ARGUMENTS; i++)
 		arglist[i] = i >= params ? NULL : va_arg(va, const void *);
@@ -227,20 +266,24 @@ static int signal_emit_real(Signal *rec, int params, va_list va,
 	rec->emitting++;
 
 	prev_emitted_signal = current_emitted_signal;
-	prev_emitted_hook = current_emitted_hook;
+	prev_emitted_pos = current_emitted_pos;
 	current_emitted_signal = rec;
 
-	for (hook = first_hook; hook != NULL; hook = hook->next) {
-		if (hook->func == NULL)
+	/* the array can't be reallocated while we're emitting */
+	hooks = (SignalHook *) rec->hooks->data;
+	count = rec->hooks->len;
+
+	for (i = first_hook; i < count; i++) {
+		if (hooks[i].func == NULL)
 			continue; /* removed */
 
-		current_emitted_hook = hook;
+		current_emitted_pos = i;
 #if SIGNAL_MAX_ARGUMENTS != 6
 #  error SIGNAL_MAX_ARGUMENTS changed - update code
 #endif
-                signal_user_data = hook->user_data;
-		hook->func(arglist[0], arglist[1], arglist[2], arglist[3],
-			   arglist[4], arglist[5]);
+                signal_user_data = hooks[i].user_data;
+		hooks[i].func(arglist[0], arglist[1], arglist[2], arglist[3],
+			      arglist[4], arglist[5]);
 
 		if (rec->continue_emit != continue_emit_count)
 			rec->continue_emit--;
@@ -253,7 +296,7 @@ static int signal_emit_real(Signal *rec, int params, va_list va,
 	}
 
 	current_emitted_signal = prev_emitted_signal;
-	current_emitted_hook = prev_emitted_hook;
+	current_emitted_pos = prev_emitted_pos;
 
 	rec->emitting--;
 	signal_user_data = NULL;
@@ -262,7 +305,7 @@ static int signal_emit_real(Signal *rec, int params, va_list va,
 		g_assert(rec->stop_emit == 0);
 		g_assert(rec->continue_emit == 0);
 
-                if (rec->remove_count > 0)
+                if (rec->remove_count > 0 || rec->pending != NULL)
 			signal_hooks_clean(rec);
 	}
 
@@ -280,10 +323,10 @@ int signal_emit(const char *signal, int params, ...)
 
 	signal_id = signal_get_uniq_id(signal);
 
-	rec = g_hash_table_lookup(signals, GINT_TO_POINTER(signal_id));
+	rec = signal_find(signal_id);
 	if (rec != NULL) {
 		va_start(va, params);
-		signal_emit_real(rec, params, va, rec->hooks);
+		signal_emit_real(rec, params, va, 0);
 		va_end(va);
 	}
 
@@ -298,10 +341,10 @@ int signal_emit_id(int signal_id, int params, ...)
 	g_return_val_if_fail(signal_id >= 0, FALSE);
 	g_return_val_if_fail(params >= 0 && params <= SIGNAL_MAX_ARGUMENTS, FALSE);
 
-	rec = g_hash_table_lookup(signals, GINT_TO_POINTER(signal_id));
+	rec = signal_find(signal_id);
 	if (rec != NULL) {
 		va_start(va, params);
-		signal_emit_real(rec, params, va, rec->hooks);
+		signal_emit_real(rec, params, va, 0);
 		va_end(va);
 	}
 
@@ -325,7 +368,7 @@ void signal_continue(int params, ...)
 
 		/* re-emit */
 		rec->continue_emit++;
-		signal_emit_real(rec, params, va, current_emitted_hook->next);
+		signal_emit_real(rec, params, va, current_emitted_pos + 1);
 		va_end(va);
 	}
 }
@@ -349,7 +392,7 @@ void signal_stop_by_name(const char *signal)
 	int signal_id;
 
 	signal_id = signal_get_uniq_id(signal);
-	rec = g_hash_table_lookup(signals, GINT_TO_POINTER(signal_id));
+	rec = signal_find(signal_id);
 	if (rec == NULL)
 		g_warning("signal_stop_by_name() : unknown signal \"%s\"", signal);
 	else if (rec->emitting > rec->stop_emit)
@@ -377,23 +420,50 @@ int signal_is_stopped(int signal_id)
 {
 	Signal *rec;
 
-	rec = g_hash_table_lookup(signals, GINT_TO_POINTER(signal_id));
+	rec = signal_find(signal_id);
 	g_return_val_if_fail(rec != NULL, FALSE);
 
         return rec->emitting <= rec->stop_emit;
 }
 
-static void signal_remove_module(void *signal, Signal *rec,
-				 const char *module)
+/* return TRUE if anything is bound to the signal */
+int signal_has_hooks(int signal_id)
 {
-	SignalHook **hook, **next;
+	Signal *rec;
 
-	for (hook = &rec->hooks; *hook != NULL; hook = next) {
-		next = &(*hook)->next;
+	rec = signal_find(signal_id);
+	if (rec == NULL)
+		return FALSE;
+
+	return rec->hooks->len > (guint) rec->remove_count ||
+		(rec->pending != NULL && rec->pending->len > 0);
+}
 
-		if (strcasecmp((*hook)->module, module) == 0) {
-                        next = hook;
-			signal_remove_hook(rec, hook);
+static void signal_remove_module(Signal *rec, const char *module)
+{
+	SignalHook *hook;
+	guint i;
+
+	for (i = rec->hooks->len; i > 0; i--) {
+		hook = &g_array_index(rec->hooks, SignalHook, i-1);
+		if (hook->func == NULL ||
+		    strcasecmp(hook->module, module) != 0)
+			continue;
+
+		if (rec->emitting) {
+			hook->func = NULL;
+			rec->remove_count++;
+		} else {
+			g_array_remove_index(rec->hooks, i-1);
+			signal_unref(rec);
+		}
+	}
+
+	for (i = rec->pending == NULL ? 0 : rec->pending->len; i > 0; i--) {
+		hook = &g_array_index(rec->pending, SignalHook, i-1);
+		if (strcasecmp(hook->module, module) == 0) {
+			g_array_remove_index(rec->pending, i-1);
+			signal_unref(rec);
 		}
 	}
 }
@@ -401,39 +471,68 @@ static void signal_remove_module(void *signal, Signal *rec,
 /* remove all signals that belong to `module' */
 void signals_remove_module(const char *module)
 {
+	Signal *rec;
+	guint i;
+
 	g_return_if_fail(module != NULL);
 
-	g_hash_table_foreach(signals, (GHFunc) signal_hash_ref, NULL);
-	g_hash_table_foreach(signals, (GHFunc) signal_remove_module,
-			     (void *) module);
-	g_hash_table_foreach_remove(signals, (GHRFunc) signal_hash_unref, NULL);
+	for (i = 0; i < signals->len; i++) {
+		rec = g_ptr_array_index(signals, i);
+		if (rec == NULL)
+			continue;
+
+		/* keep the record alive until we've gone through it */
+		signal_ref(rec);
+		signal_remove_module(rec, module);
+		signal_unref(rec);
+	}
 }
 
 void signals_init(void)
 {
-	signals = g_hash_table_new(NULL, NULL);
+	signals = g_ptr_array_new();
 }
 
-static void signal_free(void *key, Signal *rec)
+static void signal_free(Signal *rec)
 {
+	SignalHook *hook;
+
 	/* refcount-1 because we just referenced it ourself */
 	g_warning("signal_free(%s) : signal still has %d references:",
 		  signal_get_id_str(rec->id), rec->refcount-1);
 
-	while (rec->hooks != NULL) {
+	if (rec->pending != NULL) {
+		g_array_append_vals(rec->hooks, rec->pending->data,
+				    rec->pending->len);
+		g_array_set_size(rec->pending, 0);
+	}
+
+	while (rec->hooks->len > 0) {
+		hook = &g_array_index(rec->hooks, SignalHook, 0);
 		g_warning(" - module '%s' function %p",
-			  rec->hooks->module, rec->hooks->func);
+			  hook->module, hook->func);
 
-		signal_remove_hook(rec, &rec->hooks);
+		g_array_remove_index(rec->hooks, 0);
+		signal_unref(rec);
 	}
 }
 
 void signals_deinit(void)
 {
-	g_hash_table_foreach(signals, (GHFunc) signal_hash_ref, NULL);
-        g_hash_table_foreach(signals, (GHFunc) signal_free, NULL);
-	g_hash_table_foreach_remove(signals, (GHRFunc) signal_hash_unref, NULL);
-	g_hash_table_destroy(signals);
+	Signal *rec;
+	guint i;
+
+	for (i = 0; i < signals->len; i++) {
+		rec = g_ptr_array_index(signals, i);
+		if (rec == NULL)
+			continue;
+
+		signal_ref(rec);
+		signal_free(rec);
+		signal_unref(rec);
+	}
+	g_ptr_array_free(signals, TRUE);
+	signals = NULL;
 
 	module_uniq_destroy("signals");
 }
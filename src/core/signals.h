@@ -57,6 +57,8 @@ const char *signal_get_emitted(void);
 int signal_get_emitted_id(void);
 /* return TRUE if specified signal was stopped */
 int signal_is_stopped(int signal_id);
+/* return TRUE if anything is bound to the signal */
+int signal_has_hooks(int signal_id);
 /* return the user data of the signal function currently being emitted */
 #define signal_get_user_data() signal_user_data
 
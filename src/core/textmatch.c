@@ -0,0 +1,231 @@
+/*
+ textmatch.c : Multi-string search
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "module.h"
+#include <irssi/src/core/textmatch.h>
+
+/* The strings are stored in a trie. After all strings are added, every node
+   gets a failure link to the node of its longest proper suffix in the trie
+   and an output link to the nearest node on that chain where a string ends,
+   so the text can be searched in one pass. */
+
+typedef struct {
+	int child; /* first child, -1 if none */
+	int sibling; /* next child of the same parent */
+	int fail;
+	int output; /* this or the nearest node on the fail chain which ends
+		       a string, -1 if none */
+	int pattern; /* first string ending in this node, -1 if none */
+	unsigned char c;
+} TEXTMATCH_NODE;
+
+typedef struct {
+	int len;
+	int next; /* next string ending in the same node */
+	void *data;
+} TEXTMATCH_PATTERN;
+
+struct _TEXTMATCH_REC {
+	GArray *nodes; /* node 0 is the root */
+	GArray *patterns;
+	int root_next[256]; /* children of the root by character */
+
+	unsigned int icase:1;
+	unsigned int compiled:1;
+};
+
+#define node_at(rec, n) (&g_array_index((rec)->nodes, TEXTMATCH_NODE, n))
+#define pattern_at(rec, n) (&g_array_index((rec)->patterns, TEXTMATCH_PATTERN, n))
+#define textmatch_char(rec, c) \
+	((rec)->icase ? (unsigned char) i_toupper(c) : (unsigned char) (c))
+
+static int node_new(TEXTMATCH_REC *rec, unsigned char c)
+{
+	TEXTMATCH_NODE node;
+
+	node.child = node.sibling = -1;
+	node.fail = 0;
+	node.output = node.pattern = -1;
+	node.c = c;
+	g_array_append_val(rec->nodes, node);
+	return rec->nodes->len - 1;
+}
+
+TEXTMATCH_REC *textmatch_create(int icase)
+{
+	TEXTMATCH_REC *rec;
+	int n;
+
+	rec = g_new0(TEXTMATCH_REC, 1);
+	rec->icase = icase;
+	rec->nodes = g_array_new(FALSE, FALSE, sizeof(TEXTMATCH_NODE));
+	rec->patterns = g_array_new(FALSE, FALSE, sizeof(TEXTMATCH_PATTERN));
+	for (n = 0; n < 256; n++)
+		rec->root_next[n] = -1;
+	node_new(rec, '\0');
+	return rec;
+}
+
+void textmatch_destroy(TEXTMATCH_REC *rec)
+{
+	g_array_free(rec->nodes, TRUE);
+	g_array_free(rec->patterns, TRUE);
+	g_free(rec);
+}
+
+static int node_child(TEXTMATCH_REC *rec, int node, unsigned char c)
+{
+	int child;
+
+	if (node == 0)
+		return rec->root_next[c];
+
+	for (child = node_at(rec, node)->child; child != -1;
+	     child = node_at(rec, child)->sibling) {
+		if (node_at(rec, child)->c == c)
+			return child;
+	}
+	return -1;
+}
+
+void textmatch_add(TEXTMATCH_REC *rec, const char *pattern, void *pattern_data)
+{
+	TEXTMATCH_PATTERN pat;
+	const char *p;
+	unsigned char c;
+	int node, child;
+
+	g_return_if_fail(rec != NULL);
+	g_return_if_fail(pattern != NULL);
+
+	if (*pattern == '\0')
+		return;
+
+	node = 0;
+	for (p = pattern; *p != '\0'; p++) {
+		c = textmatch_char(rec, *p);
+		child = node_child(rec, node, c);
+		if (child == -1) {
+			child = node_new(rec, c);
+			if (node == 0) {
+				rec->root_next[c] = child;
+			} else {
+				node_at(rec, child)->sibling = node_at(rec, node)->child;
+				node_at(rec, node)->child = child;
+			}
+		}
+		node = child;
+	}
+
+	pat.len = p - pattern;
+	pat.next = node_at(rec, node)->pattern;
+	pat.data = pattern_data;
+	g_array_append_val(rec->patterns, pat);
+	node_at(rec, node)->pattern = rec->patterns->len - 1;
+
+	rec->compiled = FALSE;
+}
+
+int textmatch_count(TEXTMATCH_REC *rec)
+{
+	return rec->patterns->len;
+}
+
+static void node_set_fail(TEXTMATCH_REC *rec, int parent, int node)
+{
+	TEXTMATCH_NODE *nodep;
+	int fail, next;
+
+	nodep = node_at(rec, node);
+	if (parent == 0) {
+		fail = 0;
+	} else {
+		fail = node_at(rec, parent)->fail;
+		while ((next = node_child(rec, fail, nodep->c)) == -1 && fail != 0)
+			fail = node_at(rec, fail)->fail;
+		fail = next == -1 ? 0 : next;
+	}
+
+	nodep->fail = fail;
+	nodep->output = nodep->pattern != -1 ? node :
+		node_at(rec, fail)->output;
+}
+
+/* set the links in breadth first order, so the nodes closer to the root
+   which they point to are always done first */
+static void textmatch_compile(TEXTMATCH_REC *rec)
+{
+	GQueue queue = G_QUEUE_INIT;
+	int c, node, child;
+
+	for (c = 0; c < 256; c++) {
+		if (rec->root_next[c] != -1) {
+			node_set_fail(rec, 0, rec->root_next[c]);
+			g_queue_push_tail(&queue, GINT_TO_POINTER(rec->root_next[c]));
+		}
+	}
+
+	while (!g_queue_is_empty(&queue)) {
+		node = GPOINTER_TO_INT(g_queue_pop_head(&queue));
+		for (child = node_at(rec, node)->child; child != -1;
+		     child = node_at(rec, child)->sibling) {
+			node_set_fail(rec, node, child);
+			g_queue_push_tail(&queue, GINT_TO_POINTER(child));
+		}
+	}
+
+	rec->compiled = TRUE;
+}
+
+void textmatch_search(TEXTMATCH_REC *rec, const char *text,
+		      TEXTMATCH_FUNC func, void *data)
+{
+	TEXTMATCH_PATTERN *pat;
+	int pos, state, next, out, n;
+	unsigned char c;
+
+	g_return_if_fail(rec != NULL);
+	g_return_if_fail(text != NULL);
+
+	if (rec->patterns->len == 0)
+		return;
+
+	if (!rec->compiled)
+		textmatch_compile(rec);
+
+	state = 0;
+	for (pos = 0; text[pos] != '\0'; pos++) {
+		c = textmatch_char(rec, text[pos]);
+		while ((next = node_child(rec, state, c)) == -1 && state != 0)
+			state = node_at(rec, state)->fail;
+		state = next == -1 ? 0 : next;
+
+		for (out = node_at(rec, state)->output; out != -1;
+		     out = node_at(rec, node_at(rec, out)->fail)->output) {
+			for (n = node_at(rec, out)->pattern; n != -1; n = pat->next) {
+				pat = pattern_at(rec, n);
+				if (!func(text, pos + 1 - pat->len, pos + 1,
+					  pat->data, data))
+					return;
+			}
+		}
+	}
+}
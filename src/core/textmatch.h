@@ -0,0 +1,29 @@
+#ifndef IRSSI_CORE_TEXTMATCH_H
+#define IRSSI_CORE_TEXTMATCH_H
+
+/* Set of fixed strings searched from a text all at once (Aho-Corasick),
+   so the cost of a search doesn't grow with the number of strings. */
+
+typedef struct _TEXTMATCH_REC TEXTMATCH_REC;
+
+/* Called for each occurrence of a string, in the order of the end
+   positions. `start' and `end' are byte offsets in `text'. Return FALSE
+   to stop the search. */
+typedef int (*TEXTMATCH_FUNC) (const char *text, int start, int end,
+			       void *pattern_data, void *data);
+
+/* If `icase' is TRUE, strings match case insensitively like stristr() */
+TEXTMATCH_REC *textmatch_create(int icase);
+void textmatch_destroy(TEXTMATCH_REC *rec);
+
+/* Add `pattern' to set, `pattern_data' is passed to the search callback.
+   Empty strings are ignored. */
+void textmatch_add(TEXTMATCH_REC *rec, const char *pattern, void *pattern_data);
+/* Number of strings in the set */
+int textmatch_count(TEXTMATCH_REC *rec);
+
+/* Find all occurrences of the strings from `text' */
+void textmatch_search(TEXTMATCH_REC *rec, const char *text,
+		      TEXTMATCH_FUNC func, void *data);
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ timers.c : Shared deadline scheduler for core timeouts
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "module.h"
+#include <irssi/src/core/timers.h>
+
+typedef struct {
+	gint64 deadline; /* g_get_monotonic_time() */
+	guint64 seq; /* order of adding, for equal deadlines */
+	int tag;
+	guint pos; /* index in heap */
+
+	TIMER_FUNC func;
+	void *data;
+} TIMER_REC;
+
+/* binary min-heap of TIMER_REC ordered by deadline, and then by the order
+   they were added */
+static GPtrArray *heap;
+static GHashTable *timers; /* tag -> TIMER_REC */
+static int next_tag;
+static guint64 next_seq;
+static GSource *timer_source;
+
+#define heap_rec(pos) ((TIMER_REC *) g_ptr_array_index(heap, pos))
+#define timer_before(a, b) \
+	((a)->deadline < (b)->deadline || \
+	 ((a)->deadline == (b)->deadline && (a)->seq < (b)->seq))
+
+static void heap_set(guint pos, TIMER_REC *rec)
+{
+	g_ptr_array_index(heap, pos) = rec;
+	rec->pos = pos;
+}
+
+static void heap_up(guint pos)
+{
+	TIMER_REC *rec = heap_rec(pos);
+
+	while (pos > 0) {
+		guint parent = (pos - 1) / 2;
+
+		if (!timer_before(rec, heap_rec(parent)))
+			break;
+		heap_set(pos, heap_rec(parent));
+		pos = parent;
+	}
+	heap_set(pos, rec);
+}
+
+static void heap_down(guint pos)
+{
+	TIMER_REC *rec = heap_rec(pos);
+
+	for (;;) {
+		guint child = pos * 2 + 1;
+
+		if (child >= heap->len)
+			break;
+		if (child + 1 < heap->len &&
+		    timer_before(heap_rec(child + 1), heap_rec(child)))
+			child++;
+		if (!timer_before(heap_rec(child), rec))
+			break;
+		heap_set(pos, heap_rec(child));
+		pos = child;
+	}
+	heap_set(pos, rec);
+}
+
+static void heap_remove(TIMER_REC *rec)
+{
+	TIMER_REC *last;
+	guint pos = rec->pos;
+
+	last = g_ptr_array_remove_index(heap, heap->len - 1);
+	if (last == rec)
+		return;
+
+	heap_set(pos, last);
+	if (pos > 0 && timer_before(last, heap_rec((pos - 1) / 2)))
+		heap_up(pos);
+	else
+		heap_down(pos);
+}
+
+static int timer_add_deadline(gint64 deadline, TIMER_FUNC func, void *data)
+{
+	TIMER_REC *rec;
+
+	g_return_val_if_fail(func != NULL, 0);
+
+	rec = g_new0(TIMER_REC, 1);
+	do {
+		if (++next_tag <= 0)
+			next_tag = 1;
+	} while (g_hash_table_contains(timers, GINT_TO_POINTER(next_tag)));
+
+	rec->tag = next_tag;
+	rec->deadline = deadline;
+	rec->seq = next_seq++;
+	rec->func = func;
+	rec->data = data;
+
+	g_hash_table_insert(timers, GINT_TO_POINTER(rec->tag), rec);
+	g_ptr_array_add(heap, rec);
+	heap_up(heap->len - 1);
+	return rec->tag;
+}
+
+int timer_add(int msecs, TIMER_FUNC func, void *data)
+{
+	return timer_add_deadline(g_get_monotonic_time() +
+				  (gint64) MAX(msecs, 0) * G_TIME_SPAN_MILLISECOND,
+				  func, data);
+}
+
+int timer_add_seconds(int secs, TIMER_FUNC func, void *data)
+{
+	gint64 now;
+
+	now = g_get_monotonic_time();
+	if (secs <= 0)
+		return timer_add_deadline(now, func, data);
+
+	now -= now % G_TIME_SPAN_SECOND;
+	return timer_add_deadline(now + (gint64) secs * G_TIME_SPAN_SECOND,
+				  func, data);
+}
+
+void timer_remove(int tag)
+{
+	TIMER_REC *rec;
+
+	if (tag == 0)
+		return;
+
+	rec = g_hash_table_lookup(timers, GINT_TO_POINTER(tag));
+	if (rec == NULL)
+		return;
+
+	g_hash_table_remove(timers, GINT_TO_POINTER(tag));
+	heap_remove(rec);
+	g_free(rec);
+}
+
+static gboolean timer_source_prepare(GSource *source, gint *timeout)
+{
+	gint64 diff;
+
+	if (heap->len == 0) {
+		*timeout = -1;
+		return FALSE;
+	}
+
+	diff = heap_rec(0)->deadline - g_source_get_time(source);
+	if (diff <= 0) {
+		*timeout = 0;
+		return TRUE;
+	}
+
+	diff = (diff + G_TIME_SPAN_MILLISECOND - 1) / G_TIME_SPAN_MILLISECOND;
+	*timeout = (gint) MIN(diff, G_MAXINT);
+	return FALSE;
+}
+
+static gboolean timer_source_check(GSource *source)
+{
+	return heap->len > 0 &&
+		heap_rec(0)->deadline <= g_source_get_time(source);
+}
+
+static gboolean timer_source_dispatch(GSource *source, GSourceFunc callback,
+				      gpointer user_data)
+{
+	TIMER_REC *rec;
+	gint64 now;
+
+	/* timers added by the callbacks run on the next dispatch at the
+	   earliest, even if they're already due */
+	now = g_source_get_time(source);
+	while (heap->len > 0 && heap_rec(0)->deadline <= now) {
+		rec = heap_rec(0);
+
+		g_hash_table_remove(timers, GINT_TO_POINTER(rec->tag));
+		heap_remove(rec);
+
+		rec->func(rec->data);
+		g_free(rec);
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs timer_source_funcs = {
+	timer_source_prepare,
+	timer_source_check,
+	timer_source_dispatch,
+	NULL
+};
+
+void timers_init(void)
+{
+	heap = g_ptr_array_new();
+	timers = g_hash_table_new(NULL, NULL);
+	next_tag = 0;
+	next_seq = 0;
+
+	timer_source = g_source_new(&timer_source_funcs, sizeof(GSource));
+	g_source_attach(timer_source, NULL);
+}
+
+void timers_deinit(void)
+{
+	g_source_destroy(timer_source);
+	g_source_unref(timer_source);
+	timer_source = NULL;
+
+	g_hash_table_destroy(timers);
+	g_ptr_array_set_free_func(heap, g_free);
+	g_ptr_array_free(heap, TRUE);
+}
@@ -0,0 +1,24 @@
+#ifndef IRSSI_CORE_TIMERS_H
+#define IRSSI_CORE_TIMERS_H
+
+/* One-shot deadlines shared by all modules. Everything is kept in a single
+   heap driven by one main loop source, so the main loop only wakes up when
+   the earliest deadline is due instead of once a second per module. */
+
+typedef void (*TIMER_FUNC) (void *data);
+
+/* Call `func' once after `msecs' milliseconds. Returns tag for
+   timer_remove(), never 0. Timers due at the same time are called in the
+   order they were added. */
+int timer_add(int msecs, TIMER_FUNC func, void *data);
+/* Call `func' on the `secs'th whole second of the monotonic clock from now,
+   ie. after secs-1 .. secs seconds. Second-granularity timers of different
+   modules get aligned this way and are handled in the same wakeup. */
+int timer_add_seconds(int secs, TIMER_FUNC func, void *data);
+/* Remove timer that hasn't fired yet. Tag 0 is ignored. */
+void timer_remove(int tag);
+
+void timers_init(void);
+void timers_deinit(void);
+
+#endif
@@ -64,6 +64,9 @@ void textbuffer_commands_deinit(void);
 void textbuffer_formats_init(void);
 void textbuffer_formats_deinit(void);
 
+void textbuffer_session_init(void);
+void textbuffer_session_deinit(void);
+
 void lastlog_init(void);
 void lastlog_deinit(void);
 
@@ -217,6 +220,7 @@ static void textui_finish_init(void)
 	textbuffer_view_init();
 	textbuffer_commands_init();
 	textbuffer_formats_init();
+	textbuffer_session_init();
 	gui_expandos_init();
 	gui_printtext_init();
 	gui_readline_init();
@@ -332,6 +336,7 @@ static void textui_deinit(void)
 	mainwindow_activity_deinit();
 	mainwindows_deinit();
 	gui_expandos_deinit();
+	textbuffer_session_deinit();
 	textbuffer_formats_deinit();
 	textbuffer_commands_deinit();
 	textbuffer_view_deinit();
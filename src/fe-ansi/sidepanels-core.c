@@ -132,10 +132,6 @@ static void destroy_ctx(MAIN_WINDOW_REC *mw)
 		term_window_destroy(ctx->right_tw);
 		ctx->right_tw = NULL;
 	}
-	if (ctx->right_order) {
-		g_slist_free(ctx->right_order);
-		ctx->right_order = NULL;
-	}
 	/* Free differential rendering caches */
 	if (ctx->left_cache) {
 		sp_cache_free(ctx->left_cache);
@@ -416,10 +412,8 @@ static gboolean handle_click_at(int x, int y, int button)
 				if (aw && IS_CHANNEL(aw->active)) {
 					CHANNEL_REC *ch = CHANNEL(aw->active);
 					int target_index = ctx->right_scroll_offset + row;
-					int count = g_slist_length(ctx->right_order);
-					if (target_index >= 0 && target_index < count) {
-						NICK_REC *nick = g_slist_nth_data(ctx->right_order,
-						                                  target_index);
+					if (target_index >= 0 && target_index < nicklist_count(ch)) {
+						NICK_REC *nick = nicklist_get_nth(ch, target_index);
 						ctx->right_selected_index = target_index;
 						if (nick && nick->nick)
 							signal_emit("command query", 3, nick->nick,
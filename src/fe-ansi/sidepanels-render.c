@@ -798,16 +798,6 @@ void draw_left_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 
 /* Nick comparison function for case-insensitive sorting - moved to activity module */
 
-/* Wrapper for nicklist_compare to work with g_slist_sort_with_data */
-static gint nick_display_compare_with_server(gconstpointer a, gconstpointer b, gpointer user_data)
-{
-	const NICK_REC *nick_a = a;
-	const NICK_REC *nick_b = b;
-	const char *nick_prefix = user_data;
-
-	return nicklist_compare((NICK_REC *) nick_a, (NICK_REC *) nick_b, nick_prefix);
-}
-
 /* Get format and prefix string for a nick based on their highest privilege */
 static void get_nick_format_and_prefix(NICK_REC *nick, int *format, const char **prefix_str)
 {
@@ -848,7 +838,6 @@ void draw_right_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 	int height;
 	int width;
 	int skip = 0;
-	int index;
 	int row;
 	SP_PANEL_CACHE *cache = NULL;
 	gboolean full_redraw;
@@ -868,7 +857,6 @@ void draw_right_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 	height = ctx->right_h;
 	width = ctx->right_w;
 	aw = mw->active;
-	index = 0;
 	row = 0;
 	new_count = 0;
 	total_items = 0;
@@ -890,12 +878,6 @@ void draw_right_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 	/* Check if we need full redraw (dimensions or scroll changed) */
 	full_redraw = sp_cache_needs_full_redraw(cache, height, width, skip);
 
-	/* Free previous right_order list */
-	if (ctx->right_order) {
-		g_slist_free(ctx->right_order);
-		ctx->right_order = NULL;
-	}
-
 	/* If no channel active, clear panel and draw border */
 	if (!aw || !aw->active || !aw->active->visible_name ||
 	    !IS_CHANNEL(aw->active)) {
@@ -922,21 +904,18 @@ void draw_right_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 	if (IS_CHANNEL(aw->active)) {
 		CHANNEL_REC *ch = CHANNEL(aw->active);
 		SERVER_REC *server = ch->server;
-		GSList *nicks = nicklist_getnicks(ch);
-		GSList *sorted_nicks;
+		GSList *visible_nicks;
 		GSList *cur;
 		NICK_REC *nick;
 		char *truncated_nick;
 		int format;
 		const char *prefix_str;
-		const char *nick_prefix;
 		/* Calculate available width for nick display */
 		/* Available width = total panel width - 1 (start position) - 1 (status) - 1 (border margin) */
 		int nick_max_width = MAX(1, width - 3);
 
 		/* Safety check for server */
 		if (!server) {
-			g_slist_free(nicks);
 			/* Clear any cached lines */
 			if (cache->count > 0) {
 				int i;
@@ -951,20 +930,8 @@ void draw_right_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 			return;
 		}
 
-		/* Get nick prefix order from server (from ISUPPORT PREFIX) */
-		nick_prefix = server->get_nick_flags ? server->get_nick_flags(server) : NULL;
-		if (!nick_prefix || *nick_prefix == '\0')
-			nick_prefix = "~&@%+"; /* fallback for servers without PREFIX */
-
-		/* Sort all nicks using official nicklist_compare with server's prefix order */
-		sorted_nicks = g_slist_copy(nicks);
-		sorted_nicks = g_slist_sort_with_data(sorted_nicks,
-		                                      (GCompareDataFunc) nick_display_compare_with_server,
-		                                      (gpointer) nick_prefix);
-		g_slist_free(nicks);
-
-		/* Count total nicks and clamp scroll offset */
-		total_items = g_slist_length(sorted_nicks);
+		/* Nicklist core keeps the nicks sorted by prefix rank and nick */
+		total_items = nicklist_count(ch);
 		ctx->right_total_items = total_items;
 
 		/* DEBUG: Log nick count and cache state */
@@ -991,8 +958,9 @@ void draw_right_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 		has_more_above = (skip > 0);
 		has_more_below = (total_items > skip + height);
 
-		/* Render sorted nicks with differential rendering */
-		for (cur = sorted_nicks; cur; cur = cur->next) {
+		/* Render only the visible slice with differential rendering */
+		visible_nicks = nicklist_get_sorted(ch, skip, height);
+		for (cur = visible_nicks; cur; cur = cur->next) {
 			gboolean line_changed;
 			int nick_hash;
 
@@ -1000,14 +968,6 @@ void draw_right_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 			if (!nick || !nick->nick)
 				continue;
 
-			/* Use prepend (O(1)) instead of append (O(n)) - will reverse at end */
-			ctx->right_order = g_slist_prepend(ctx->right_order, nick);
-
-			if (index++ < skip)
-				continue;
-			if (row >= height)
-				continue;
-
 			/* Get appropriate format and prefix for this nick */
 			get_nick_format_and_prefix(nick, &format, &prefix_str);
 
@@ -1043,10 +1003,7 @@ void draw_right_contents(MAIN_WINDOW_REC *mw, SP_MAINWIN_CTX *ctx)
 			new_count++;
 		}
 
-		/* Reverse to get correct order (we used prepend for performance) */
-		ctx->right_order = g_slist_reverse(ctx->right_order);
-
-		g_slist_free(sorted_nicks);
+		g_slist_free(visible_nicks);
 	}
 
 	/* Clear ALL remaining lines below content (not just cached ones) */
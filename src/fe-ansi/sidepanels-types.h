@@ -51,8 +51,6 @@ typedef struct {
 	int right_x;
 	int right_y;
 	int right_h;
-	/* ordered nick pointers matching rendered order */
-	GSList *right_order;
 	/* differential rendering cache */
 	SP_PANEL_CACHE *left_cache;
 	SP_PANEL_CACHE *right_cache;
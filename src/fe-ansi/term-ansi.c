@@ -26,6 +26,7 @@
 #include <termios.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <errno.h>
 
 #ifdef HAVE_SYS_IOCTL_H
@@ -77,6 +78,10 @@
 #define APPKEY_ON         CSI "?1h"
 #define APPKEY_OFF        CSI "?1l"
 
+/* Synchronized output: terminal shows the frame only when it's complete */
+#define SYNC_BEGIN        CSI "?2026h"
+#define SYNC_END          CSI "?2026l"
+
 /* DCS passthrough for tmux */
 #define TMUX_WRAP_START   "\033Ptmux;\033"
 #define TMUX_WRAP_END     "\033\\"
@@ -189,6 +194,7 @@ static gboolean sigcont_dispatch(GSource *s, GSourceFunc cb, gpointer data)
 
 static gboolean do_redraw(gpointer unused)
 {
+	term_invalidate();
 	irssi_redraw();
 	return TRUE;
 }
@@ -538,6 +544,9 @@ static void read_settings(void)
 	term_use_colors24 = settings_get_bool("colors_ansi_24bit") &&
 		(force_colors || term_has_colors());
 
+	if (ansi_term != NULL)
+		ansi_term->sync_output = settings_get_bool("term_sync_output");
+
 	if (term_use_colors != old_colors || term_use_colors24 != old_colors24)
 		irssi_redraw();
 }
@@ -550,6 +559,7 @@ static void cmd_resize(void)
 
 static void cmd_redraw(void)
 {
+	term_invalidate();
 	irssi_redraw();
 }
 
@@ -570,6 +580,7 @@ void term_common_init(void)
 	settings_add_bool("lookandfeel", "colors", TRUE);
 	settings_add_bool("lookandfeel", "term_force_colors", FALSE);
 	settings_add_bool("lookandfeel", "mirc_blink_fix", FALSE);
+	settings_add_bool("lookandfeel", "term_sync_output", TRUE);
 
 	force_colors = FALSE;
 	term_use_colors = term_has_colors() && settings_get_bool("colors");
@@ -604,30 +615,428 @@ void term_common_deinit(void)
 }
 
 /* ========================================================================
- * TERM API IMPLEMENTATION
+ * CELL GRID
  * ======================================================================== */
 
-static void term_move_real(void)
+#define COLOR_RESET UINT_MAX
+#define COLOR_BLACK24 (COLOR_RESET - 1)
+
+/* never stored to the back buffer, so an invalid front cell always differs */
+#define CELL_INVALID ((unichar) -1)
+
+#define PEN_ATTRS (ATTR_BOLD | ATTR_BLINK | ATTR_UNDERLINE | ATTR_REVERSE | ATTR_ITALIC)
+
+static const TERM_PEN default_pen = { COLOR_RESET, COLOR_RESET, 0 };
+
+#define grid_row(term, grid, y) ((term)->grid + (y) * (term)->width)
+
+static int pen_equal(const TERM_PEN *p1, const TERM_PEN *p2)
 {
-	ANSI_TERM *term = ansi_term;
+	return p1->fg == p2->fg && p1->bg == p2->bg && p1->attrs == p2->attrs;
+}
+
+static int cell_equal(const TERM_CELL *c1, const TERM_CELL *c2)
+{
+	return c1->chr == c2->chr && c1->cluster == c2->cluster &&
+		c1->width == c2->width && pen_equal(&c1->pen, &c2->pen);
+}
+
+static void cell_set_blank(TERM_CELL *cell, const TERM_PEN *pen)
+{
+	cell->chr = ' ';
+	cell->cluster = NULL;
+	cell->width = 1;
+	cell->pen = *pen;
+}
+
+static int cell_is_blank(const TERM_CELL *cell)
+{
+	return cell->chr == ' ' && cell->cluster == NULL && cell->width == 1 &&
+		pen_equal(&cell->pen, &default_pen);
+}
+
+static void grid_clear(TERM_CELL *cells, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		cell_set_blank(&cells[i], &default_pen);
+}
+
+/* (Re)allocate both buffers for the terminal size, the screen is
+   expected to be cleared by the caller. */
+static void grid_init(ANSI_TERM *term)
+{
+	int count = term->width * term->height;
+
+	g_free(term->back);
+	g_free(term->front);
+	g_free(term->lines_dirty);
+
+	term->back = g_new(TERM_CELL, count);
+	term->front = g_new(TERM_CELL, count);
+	term->lines_dirty = g_new0(char, term->height);
+	grid_clear(term->back, count);
+	grid_clear(term->front, count);
+	term->front_invalid = FALSE;
+}
+
+static void grid_deinit(ANSI_TERM *term)
+{
+	g_free(term->back);
+	g_free(term->front);
+	g_free(term->lines_dirty);
+	term->back = term->front = NULL;
+	term->lines_dirty = NULL;
+}
+
+/* Forget what the screen has, everything is sent again */
+static void grid_invalidate(ANSI_TERM *term)
+{
+	int i, count = term->width * term->height;
+
+	for (i = 0; i < count; i++)
+		term->front[i].chr = CELL_INVALID;
+	memset(term->lines_dirty, 1, term->height);
+	term->front_invalid = TRUE;
+	term->real_pen_known = FALSE;
+	term->cforcemove = TRUE;
+}
+
+/* Cells x1..x2-1 of the row are about to be overwritten, don't leave
+   half of a wide character around them */
+static void grid_fix_wide(ANSI_TERM *term, TERM_CELL *row, int x1, int x2)
+{
+	if (x1 > 0 && row[x1].width == 0)
+		cell_set_blank(&row[x1 - 1], &row[x1 - 1].pen);
+	if (x2 < term->width && row[x2].width == 0)
+		cell_set_blank(&row[x2], &row[x2].pen);
+}
+
+/* Fill cells x1..x2-1 of line y with blanks in the current pen */
+static void grid_fill(ANSI_TERM *term, int x1, int x2, int y)
+{
+	TERM_CELL *row;
+	int x;
+
+	if (x1 >= x2)
+		return;
+
+	row = grid_row(term, back, y);
+	grid_fix_wide(term, row, x1, x2);
+	for (x = x1; x < x2; x++)
+		cell_set_blank(&row[x], &term->pen);
+	term->lines_dirty[y] = TRUE;
+}
+
+/* Add a zero width character to the cell before the cursor */
+static void grid_combine(ANSI_TERM *term, const char *str, int len)
+{
+	TERM_CELL *cell;
+	GString *text;
+	char buf[7];
+	int x;
+
+	x = term->vcx - 1;
+	if (x < 0 || x >= term->width)
+		return;
+
+	cell = grid_row(term, back, term->vcy) + x;
+	if (cell->width == 0 && x > 0)
+		cell--;
+
+	text = g_string_new(cell->cluster);
+	if (cell->cluster == NULL)
+		g_string_append_len(text, buf, g_unichar_to_utf8(cell->chr, buf));
+	g_string_append_len(text, str, len);
+
+	cell->cluster = g_intern_string(text->str);
+	g_string_free(text, TRUE);
+	term->lines_dirty[term->vcy] = TRUE;
+}
 
-	if (term->vcx != term->crealx || term->vcy != term->crealy || term->cforcemove) {
-		if (term->curs_visible) {
-			ansi_set_cursor_visible(term, FALSE);
-			term->curs_visible = FALSE;
+/* Store one character at the cursor position and move it forward */
+static void grid_put(ANSI_TERM *term, unichar chr, const char *cluster, int width)
+{
+	TERM_CELL *row;
+	int i;
+
+	if (term->vcx + width > term->width) {
+		/* doesn't fit, continue from the next line like the
+		   terminal would */
+		if (term->vcx < term->width)
+			grid_fill(term, term->vcx, term->width, term->vcy);
+		term->vcx = 0;
+		if (term->vcy < term->height - 1)
+			term->vcy++;
+		if (width > term->width)
+			return;
+	}
+
+	row = grid_row(term, back, term->vcy);
+	grid_fix_wide(term, row, term->vcx, term->vcx + width);
+
+	row[term->vcx].chr = chr;
+	row[term->vcx].cluster = cluster;
+	row[term->vcx].width = width;
+	row[term->vcx].pen = term->pen;
+	for (i = 1; i < width; i++) {
+		row[term->vcx + i].chr = 0;
+		row[term->vcx + i].cluster = NULL;
+		row[term->vcx + i].width = 0;
+		row[term->vcx + i].pen = term->pen;
+	}
+
+	term->lines_dirty[term->vcy] = TRUE;
+	term->vcx += width;
+}
+
+/* Store one grapheme cluster of UTF-8 text */
+static void grid_put_utf8(ANSI_TERM *term, const char *str, int len, int width)
+{
+	unichar chr;
+	char *text;
+
+	chr = g_utf8_get_char_validated(str, len);
+	if (chr < (unichar) -2 && g_utf8_next_char(str) == str + len) {
+		if (width == 0)
+			grid_combine(term, str, len);
+		else
+			grid_put(term, chr, NULL, width);
+		return;
+	}
+
+	/* several characters, or invalid UTF-8 which is sent as it is */
+	text = g_strndup(str, len);
+	grid_put(term, 0, g_intern_string(text), width);
+	g_free(text);
+}
+
+/* Scroll lines y1..y2 of the grid, new lines are blank */
+static void grid_scroll(ANSI_TERM *term, TERM_CELL *grid, int y1, int y2, int count)
+{
+	int lines, width = term->width;
+
+	lines = y2 - y1 + 1;
+	if (count >= lines || -count >= lines) {
+		grid_clear(grid + y1 * width, lines * width);
+	} else if (count > 0) {
+		memmove(grid + y1 * width, grid + (y1 + count) * width,
+			(lines - count) * width * sizeof(TERM_CELL));
+		grid_clear(grid + (y2 - count + 1) * width, count * width);
+	} else if (count < 0) {
+		memmove(grid + (y1 - count) * width, grid + y1 * width,
+			(lines + count) * width * sizeof(TERM_CELL));
+		grid_clear(grid + y1 * width, -count * width);
+	}
+}
+
+/* Start sending a frame */
+static void grid_begin_output(ANSI_TERM *term)
+{
+	if (term->sync_output && !term->in_sync) {
+		fputs(SYNC_BEGIN, term->out);
+		term->in_sync = TRUE;
+	}
+
+	if (term->curs_visible) {
+		ansi_set_cursor_visible(term, FALSE);
+		term->curs_visible = FALSE;
+	}
+}
+
+static void sgr_param(ANSI_TERM *term, int *first, const char *fmt, ...)
+{
+	va_list va;
+
+	fputs(*first ? CSI : ";", term->out);
+	*first = FALSE;
+
+	va_start(va, fmt);
+	vfprintf(term->out, fmt, va);
+	va_end(va);
+}
+
+static void sgr_color(ANSI_TERM *term, int *first, unsigned int color, int base)
+{
+	unsigned int rgb;
+	int ansi_color;
+
+	if (color == COLOR_RESET) {
+		sgr_param(term, first, "%d", base + 9);
+	} else if (color >> 8) {
+		rgb = color == COLOR_BLACK24 ? 0 : color >> 8;
+		sgr_param(term, first, "%d;2;%u;%u;%u", base + 8,
+			  (rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
+	} else if (color < 16) {
+		ansi_color = ansitab[color];
+		sgr_param(term, first, "%d", ansi_color < 8 ? base + ansi_color :
+			  base + 60 + ansi_color - 8);
+	} else {
+		sgr_param(term, first, "%d;5;%u", base + 8, color);
+	}
+}
+
+/* Switch the terminal to `pen' with one SGR sequence */
+static void grid_set_pen(ANSI_TERM *term, const TERM_PEN *pen)
+{
+	TERM_PEN old;
+	int first, off, on;
+
+	if (term->real_pen_known && pen_equal(pen, &term->real_pen))
+		return;
+
+	first = TRUE;
+	if (term->real_pen_known) {
+		old = term->real_pen;
+	} else {
+		sgr_param(term, &first, "0");
+		old = default_pen;
+	}
+
+	off = old.attrs & ~pen->attrs;
+	on = pen->attrs & ~old.attrs;
+	if (off & ATTR_BOLD) sgr_param(term, &first, "22");
+	if (off & ATTR_ITALIC) sgr_param(term, &first, "23");
+	if (off & ATTR_UNDERLINE) sgr_param(term, &first, "24");
+	if (off & ATTR_BLINK) sgr_param(term, &first, "25");
+	if (off & ATTR_REVERSE) sgr_param(term, &first, "27");
+	if (on & ATTR_BOLD) sgr_param(term, &first, "1");
+	if (on & ATTR_ITALIC) sgr_param(term, &first, "3");
+	if (on & ATTR_UNDERLINE) sgr_param(term, &first, "4");
+	if (on & ATTR_BLINK) sgr_param(term, &first, "5");
+	if (on & ATTR_REVERSE) sgr_param(term, &first, "7");
+
+	if (pen->fg != old.fg)
+		sgr_color(term, &first, pen->fg, 30);
+	if (pen->bg != old.bg)
+		sgr_color(term, &first, pen->bg, 40);
+
+	if (!first)
+		fputc('m', term->out);
+
+	term->real_pen = *pen;
+	term->real_pen_known = TRUE;
+}
+
+static void cell_output(ANSI_TERM *term, const TERM_CELL *cell)
+{
+	char buf[7];
+
+	if (cell->cluster != NULL) {
+		fputs(cell->cluster, term->out);
+	} else if (term_type == TERM_TYPE_UTF8) {
+		fwrite(buf, 1, g_unichar_to_utf8(cell->chr, buf), term->out);
+	} else {
+		if (term_type == TERM_TYPE_BIG5 && cell->chr > 0xff)
+			fputc((cell->chr >> 8) & 0xff, term->out);
+		fputc(cell->chr & 0xff, term->out);
+	}
+}
+
+/* Move the real cursor to x, y */
+static void grid_move_real(ANSI_TERM *term, int x, int y)
+{
+	TERM_CELL *back, *front;
+	int i;
+
+	if (term->cforcemove || term->crealy != y || term->crealx > x ||
+	    term->crealx >= term->width) {
+		ansi_move(term, x, y);
+	} else if (x - term->crealx > 4) {
+		fprintf(term->out, CSI "%dC", x - term->crealx);
+	} else if (x > term->crealx) {
+		/* a few unchanged cells - sending them again is shorter
+		   than moving over them, if they're simple */
+		back = grid_row(term, back, y);
+		front = grid_row(term, front, y);
+		for (i = term->crealx; i < x; i++) {
+			if (back[i].width != 1 || back[i].cluster != NULL ||
+			    !cell_equal(&back[i], &front[i]) ||
+			    !pen_equal(&back[i].pen, &term->real_pen))
+				break;
+		}
+		if (i == x) {
+			for (i = term->crealx; i < x; i++)
+				cell_output(term, &back[i]);
+		} else {
+			fprintf(term->out, CSI "%dC", x - term->crealx);
 		}
+	}
+
+	term->crealx = x;
+	term->crealy = y;
+	term->cforcemove = FALSE;
+}
 
-		if (term->cforcemove) {
-			term->crealx = term->crealy = -1;
-			term->cforcemove = FALSE;
+/* Send the changed cells of line y */
+static void grid_flush_line(ANSI_TERM *term, int y)
+{
+	TERM_CELL *back, *front;
+	int x, i, width;
+
+	back = grid_row(term, back, y);
+	front = grid_row(term, front, y);
+	for (x = 0; x < term->width; ) {
+		if (cell_equal(&back[x], &front[x])) {
+			x++;
+			continue;
 		}
 
-		ansi_move(term, term->vcx, term->vcy);
-		term->crealx = term->vcx;
-		term->crealy = term->vcy;
+		if (back[x].width == 0) {
+			/* right half changed, send the whole character */
+			if (x == 0 || back[x - 1].width == 0) {
+				front[x] = back[x];
+				x++;
+				continue;
+			}
+			x--;
+		}
+
+		grid_begin_output(term);
+
+		/* clear the rest of the line with one sequence */
+		for (i = x; i < term->width; i++) {
+			if (!cell_is_blank(&back[i]))
+				break;
+		}
+		if (i == term->width && term->width - x > 3) {
+			grid_move_real(term, x, y);
+			grid_set_pen(term, &default_pen);
+			fputs(CLEAR_TO_EOL, term->out);
+			memcpy(front + x, back + x, (term->width - x) * sizeof(TERM_CELL));
+			break;
+		}
+
+		grid_move_real(term, x, y);
+		grid_set_pen(term, &back[x].pen);
+		cell_output(term, &back[x]);
+
+		width = back[x].width;
+		memcpy(front + x, back + x, width * sizeof(TERM_CELL));
+		term->crealx += width;
+		x += width;
+	}
+}
+
+/* Send everything that has changed since the last flush */
+static void grid_flush(ANSI_TERM *term)
+{
+	int y;
+
+	for (y = 0; y < term->height; y++) {
+		if (term->lines_dirty[y]) {
+			term->lines_dirty[y] = FALSE;
+			grid_flush_line(term, y);
+		}
 	}
+	term->front_invalid = FALSE;
 }
 
+/* ========================================================================
+ * TERM API IMPLEMENTATION
+ * ======================================================================== */
+
 static void term_move_reset(int x, int y)
 {
 	ANSI_TERM *term = ansi_term;
@@ -637,8 +1046,6 @@ static void term_move_reset(int x, int y)
 
 	term->vcx = x;
 	term->vcy = y;
-	term->cforcemove = TRUE;
-	term_move_real();
 }
 
 int term_init(void)
@@ -649,8 +1056,8 @@ int term_init(void)
 	ansi_term = g_new0(ANSI_TERM, 1);
 	ansi_term->out = stdout;
 
-	ansi_term->last_fg = ansi_term->last_bg = -1;
-	ansi_term->last_attrs = 0;
+	ansi_term->pen = default_pen;
+	ansi_term->real_pen_known = FALSE;
 	ansi_term->vcx = ansi_term->vcy = 0;
 	ansi_term->crealx = ansi_term->crealy = -1;
 	ansi_term->cforcemove = TRUE;
@@ -695,7 +1102,7 @@ int term_init(void)
 	term_height = ansi_term->height;
 
 	root_window = term_window_create(0, 0, term_width, term_height);
-	ansi_term->lines_empty = g_new0(char, term_height);
+	grid_init(ansi_term);
 
 	term_set_input_type(TERM_TYPE_8BIT);
 	term_common_init();
@@ -734,7 +1141,7 @@ void term_deinit(void)
 
 		raw_mode_disable(ansi_term);
 
-		g_free(ansi_term->lines_empty);
+		grid_deinit(ansi_term);
 		g_free(root_window);
 		g_free(ansi_term);
 		ansi_term = NULL;
@@ -776,12 +1183,13 @@ void term_resize(int width, int height)
 		term_height = ansi_term->height = height;
 		term_window_move(root_window, 0, 0, term_width, term_height);
 
-		g_free(ansi_term->lines_empty);
-		ansi_term->lines_empty = g_new0(char, term_height);
-
 		/* Clear screen and reset cursor after resize */
-		ansi_set_normal(ansi_term);
+		grid_init(ansi_term);
+		grid_begin_output(ansi_term);
+		ansi_term->real_pen_known = FALSE;
+		grid_set_pen(ansi_term, &default_pen);
 		ansi_clear(ansi_term);
+		ansi_term->cforcemove = TRUE;
 	}
 
 	term_move_reset(0, 0);
@@ -842,11 +1250,29 @@ void term_force_colors(int set)
 
 void term_clear(void)
 {
+	ANSI_TERM *term = ansi_term;
+
 	term_set_color(root_window, ATTR_RESET);
-	ansi_clear(ansi_term);
+	grid_clear(term->back, term->width * term->height);
+	memset(term->lines_dirty, 1, term->height);
+
+	if (term->front_invalid) {
+		/* we don't know what's on the screen, clear it for real
+		   so only the non-blank cells need to be sent */
+		grid_begin_output(term);
+		grid_set_pen(term, &default_pen);
+		ansi_clear(term);
+		term->cforcemove = TRUE;
+		grid_clear(term->front, term->width * term->height);
+		term->front_invalid = FALSE;
+	}
+
 	term_move_reset(0, 0);
+}
 
-	memset(ansi_term->lines_empty, 1, term_height);
+void term_invalidate(void)
+{
+	grid_invalidate(ansi_term);
 }
 
 void term_beep(void)
@@ -931,7 +1357,7 @@ void term_window_clear(TERM_WINDOW *window)
 {
 	int y;
 
-	ansi_set_normal(ansi_term);
+	term_set_color(window, ATTR_RESET);
 	if (window->y == 0 && window->height == term_height && window->width == term_width) {
 		term_clear();
 	} else {
@@ -944,32 +1370,38 @@ void term_window_clear(TERM_WINDOW *window)
 
 void term_window_scroll(TERM_WINDOW *window, int count)
 {
-	int y;
+	ANSI_TERM *term = ansi_term;
+	int y, y2;
 
 	/* VT100 scroll regions affect entire rows - only safe when window
 	 * spans full terminal width. Otherwise sidepanels get corrupted. */
 	if (window->x != 0 || window->width != term_width)
 		return;
 
-	ansi_scroll(ansi_term, window->y, window->y + window->height - 1, count);
-	term_move_reset(ansi_term->vcx, ansi_term->vcy);
+	y2 = window->y + window->height - 1;
+	if (y2 >= term_height)
+		y2 = term_height - 1;
 
-	/* Set the newly scrolled area dirty */
-	for (y = 0; (window->y + y) < term_height && y < window->height; y++)
-		ansi_term->lines_empty[window->y + y] = FALSE;
+	/* scroll the screen right away, and both buffers the same way
+	   so only the new lines need to be sent */
+	grid_begin_output(term);
+	grid_set_pen(term, &default_pen);
+	ansi_scroll(term, window->y, y2, count);
+	term->cforcemove = TRUE;
+
+	grid_scroll(term, term->front, window->y, y2, count);
+	grid_scroll(term, term->back, window->y, y2, count);
+	for (y = window->y; y <= y2; y++)
+		term->lines_dirty[y] = TRUE;
 }
 
 /* ========================================================================
  * DRAWING FUNCTIONS
  * ======================================================================== */
 
-#define COLOR_RESET UINT_MAX
-#define COLOR_BLACK24 (COLOR_RESET - 1)
-
 void term_set_color2(TERM_WINDOW *window, int col, unsigned int fgcol24, unsigned int bgcol24)
 {
-	ANSI_TERM *term = ansi_term;
-	int set_normal;
+	TERM_PEN *pen = &ansi_term->pen;
 	unsigned int fg, bg;
 
 	if (col & ATTR_FGCOLOR24) {
@@ -993,75 +1425,14 @@ void term_set_color2(TERM_WINDOW *window, int col, unsigned int fgcol24, unsigne
 	if (!term_use_colors && bg > 0)
 		col |= ATTR_REVERSE;
 
-	set_normal = ((col & ATTR_RESETFG) && term->last_fg != COLOR_RESET) ||
-	             ((col & ATTR_RESETBG) && term->last_bg != COLOR_RESET);
-
-	if (((term->last_attrs & ATTR_BOLD) && (col & ATTR_BOLD) == 0) ||
-	    ((term->last_attrs & ATTR_REVERSE) && (col & ATTR_REVERSE) == 0) ||
-	    ((term->last_attrs & ATTR_BLINK) && (col & ATTR_BLINK) == 0)) {
-		set_normal = TRUE;
-	}
-
-	if (set_normal) {
-		term->last_fg = term->last_bg = COLOR_RESET;
-		term->last_attrs = 0;
-		ansi_set_normal(term);
-	}
-
-	/* Set foreground color */
-	if (fg != term->last_fg && (fg != 0 || (col & ATTR_RESETFG) == 0)) {
-		if (term_use_colors) {
-			term->last_fg = fg;
-			if (fg >> 8) {
-				unsigned int rgb = (term->last_fg == COLOR_BLACK24) ? 0 : term->last_fg >> 8;
-				ansi_set_fg_rgb(term, (rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
-			} else {
-				ansi_set_fg(term, term->last_fg);
-			}
-		}
-	}
-
-	/* Set background color */
-	if (col & ATTR_BLINK)
-		ansi_set_blink(term);
-
-	if (bg != term->last_bg && (bg != 0 || (col & ATTR_RESETBG) == 0)) {
-		if (term_use_colors) {
-			term->last_bg = bg;
-			if (bg >> 8) {
-				unsigned int rgb = (term->last_bg == COLOR_BLACK24) ? 0 : term->last_bg >> 8;
-				ansi_set_bg_rgb(term, (rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
-			} else {
-				ansi_set_bg(term, term->last_bg);
-			}
-		}
-	}
-
-	/* Reversed text */
-	if (col & ATTR_REVERSE)
-		ansi_set_reverse(term);
-
-	/* Bold */
-	if (col & ATTR_BOLD)
-		ansi_set_bold(term);
-
-	/* Underline */
-	if (col & ATTR_UNDERLINE) {
-		if ((term->last_attrs & ATTR_UNDERLINE) == 0)
-			ansi_set_underline(term, TRUE);
-	} else if (term->last_attrs & ATTR_UNDERLINE) {
-		ansi_set_underline(term, FALSE);
-	}
-
-	/* Italic */
-	if (col & ATTR_ITALIC) {
-		if ((term->last_attrs & ATTR_ITALIC) == 0)
-			ansi_set_italic(term, TRUE);
-	} else if (term->last_attrs & ATTR_ITALIC) {
-		ansi_set_italic(term, FALSE);
+	/* only remembered here, sent with the cells in term_refresh() */
+	pen->attrs = col & PEN_ATTRS;
+	if (!term_use_colors) {
+		pen->fg = pen->bg = COLOR_RESET;
+	} else {
+		pen->fg = fg == 0 && (col & ATTR_RESETFG) ? COLOR_RESET : fg;
+		pen->bg = bg == 0 && (col & ATTR_RESETBG) ? COLOR_RESET : bg;
 	}
-
-	term->last_attrs = col & ~(BG_MASK | FG_MASK);
 }
 
 void term_move(TERM_WINDOW *window, int x, int y)
@@ -1079,74 +1450,71 @@ void term_move(TERM_WINDOW *window, int x, int y)
 	}
 }
 
-static void term_printed_text(int count)
-{
-	ANSI_TERM *term = ansi_term;
-
-	term->lines_empty[term->vcy] = FALSE;
-
-	term->vcx += count;
-	while (term->vcx >= term_width) {
-		term->vcx -= term_width;
-		if (term->vcy < term_height - 1) term->vcy++;
-		if (term->vcx > 0) term->lines_empty[term->vcy] = FALSE;
-	}
-
-	term->crealx += count;
-	if (term->crealx >= term_width)
-		term->cforcemove = TRUE;
-}
-
 void term_addch(TERM_WINDOW *window, char chr)
 {
 	ANSI_TERM *term = ansi_term;
+	unsigned char c = (unsigned char) chr;
+	unichar mbchr;
+	int width;
+
+	if (term_type == TERM_TYPE_UTF8 && (c & 0x80) != 0) {
+		/* collect the bytes of a multibyte character */
+		if ((c & 0x40) != 0) {
+			term->mb_len = 0;
+			term->mb_need = g_utf8_skip[c];
+		} else if (term->mb_len == 0) {
+			grid_put_utf8(term, &chr, 1, 1);
+			return;
+		}
 
-	if (term->vcx != term->crealx || term->vcy != term->crealy || term->cforcemove)
-		term_move_real();
-
-	if (term_type != TERM_TYPE_UTF8 ||
-	    (chr & 0x80) == 0 || (chr & 0x40) == 0) {
-		term_printed_text(1);
+		term->mb_buf[term->mb_len++] = chr;
+		if (term->mb_len == term->mb_need ||
+		    term->mb_len == sizeof(term->mb_buf)) {
+			mbchr = g_utf8_get_char_validated(term->mb_buf, term->mb_len);
+			width = mbchr < (unichar) -2 && unichar_isprint(mbchr) ?
+				unichar_width(mbchr) : 1;
+			grid_put_utf8(term, term->mb_buf, term->mb_len, width);
+			term->mb_len = 0;
+		}
+		return;
 	}
 
-	fputc(chr, term->out);
-}
-
-static void term_addch_utf8(unichar chr)
-{
-	ANSI_TERM *term = ansi_term;
-	char buf[10];
-	int i, len;
+	if (term_type == TERM_TYPE_BIG5) {
+		if (term->mb_len > 0) {
+			mbchr = (unsigned char) term->mb_buf[0];
+			term->mb_len = 0;
+			if (is_big5_los(c) || is_big5_lox(c)) {
+				grid_put(term, (mbchr << 8) | c, NULL, 2);
+				return;
+			}
+			grid_put(term, mbchr, NULL, 1);
+		}
+		if (is_big5_hi(c)) {
+			term->mb_buf[0] = chr;
+			term->mb_len = 1;
+			return;
+		}
+	}
 
-	len = g_unichar_to_utf8(chr, buf);
-	for (i = 0; i < len; i++)
-		fputc(buf[i], term->out);
+	term->mb_len = 0;
+	grid_put(term, c == '\0' ? ' ' : c, NULL, 1);
 }
 
 void term_add_unichar(TERM_WINDOW *window, unichar chr)
 {
 	ANSI_TERM *term = ansi_term;
-
-	if (term->vcx != term->crealx || term->vcy != term->crealy || term->cforcemove)
-		term_move_real();
+	char buf[7];
 
 	switch (term_type) {
 	case TERM_TYPE_UTF8:
-		term_printed_text(unichar_isprint(chr) ? unichar_width(chr) : 1);
-		term_addch_utf8(chr);
+		grid_put_utf8(term, buf, g_unichar_to_utf8(chr, buf),
+			      unichar_isprint(chr) ? unichar_width(chr) : 1);
 		break;
 	case TERM_TYPE_BIG5:
-		if (chr > 0xff) {
-			term_printed_text(2);
-			fputc((chr >> 8) & 0xff, term->out);
-		} else {
-			term_printed_text(1);
-		}
-		fputc((chr & 0xff), term->out);
+		grid_put(term, chr & 0xffff, NULL, chr > 0xff ? 2 : 1);
 		break;
 	default:
-		term_printed_text(1);
-		fputc(chr, term->out);
+		grid_put(term, chr & 0xff, NULL, 1);
 		break;
 	}
 }
@@ -1154,59 +1522,42 @@ void term_add_unichar(TERM_WINDOW *window, unichar chr)
 int term_addstr(TERM_WINDOW *window, const char *str)
 {
 	ANSI_TERM *term = ansi_term;
-	int len, raw_len;
-
-	if (term->vcx != term->crealx || term->vcy != term->crealy || term->cforcemove)
-		term_move_real();
+	const char *start;
+	int len, width;
 
 	len = 0;
-	raw_len = strlen(str);
-
-	if (term_type == TERM_TYPE_UTF8) {
-		len = string_width(str, TREAT_STRING_AS_UTF8);
-	} else {
-		len = raw_len;
+	while (*str != '\0') {
+		start = str;
+		if (term_type == TERM_TYPE_UTF8) {
+			/* one grapheme cluster at a time */
+			width = string_advance(&str, TREAT_STRING_AS_UTF8);
+			grid_put_utf8(term, start, str - start, width);
+		} else {
+			width = 1;
+			grid_put(term, (unsigned char) *str++, NULL, 1);
+		}
+		len += width;
 	}
 
-	term_printed_text(len);
-	fwrite(str, 1, raw_len, term->out);
-
 	return len;
 }
 
 void term_clrtoeol(TERM_WINDOW *window)
 {
 	ANSI_TERM *term = ansi_term;
+	int end;
 
 	if (term->vcx < window->x) {
 		term->vcx += window->x;
 	}
 
-	if (window->x + window->width < term_width) {
-		/* Vertical split - fill with spaces to window boundary only */
-		if (term->vcx != term->crealx || term->vcy != term->crealy || term->cforcemove)
-			term_move_real();
-		ansi_repeat(term, ' ', window->x + window->width - term->vcx);
-		ansi_move(term, term->vcx, term->vcy);
-		term->lines_empty[term->vcy] = FALSE;
-	} else {
-		/* Clear to end of line */
-		if (term->last_fg == (unsigned int)-1 && term->last_bg == (unsigned int)-1 &&
-		    (term->last_attrs & (ATTR_UNDERLINE | ATTR_REVERSE | ATTR_ITALIC)) == 0) {
-			if (!term->lines_empty[term->vcy]) {
-				if (term->vcx != term->crealx || term->vcy != term->crealy || term->cforcemove)
-					term_move_real();
-				ansi_clear_to_eol(term);
-				if (term->vcx == 0) term->lines_empty[term->vcy] = TRUE;
-			}
-		} else if (term->vcx < term_width) {
-			if (term->vcx != term->crealx || term->vcy != term->crealy || term->cforcemove)
-				term_move_real();
-			ansi_repeat(term, ' ', term_width - term->vcx);
-			ansi_move(term, term->vcx, term->vcy);
-			term->lines_empty[term->vcy] = FALSE;
-		}
-	}
+	/* Vertical split - fill with spaces to window boundary only */
+	if (window->x + window->width < term_width)
+		end = window->x + window->width;
+	else
+		end = term_width;
+
+	grid_fill(term, term->vcx, end, term->vcy);
 }
 
 void term_window_clrtoeol(TERM_WINDOW *window, int ypos)
@@ -1248,15 +1599,25 @@ void term_refresh(TERM_WINDOW *window)
 	if (term->freeze > 0)
 		return;
 
+	grid_flush(term);
+
+	/* leave the terminal in a known state for anyone else writing to it */
+	term_set_color(window, ATTR_RESET);
+	grid_set_pen(term, &term->pen);
+
 	term_move(root_window, curs_x, curs_y);
-	term_move_real();
+	if (term->cforcemove || term->vcx != term->crealx || term->vcy != term->crealy)
+		grid_move_real(term, term->vcx, term->vcy);
 
 	if (!term->curs_visible) {
 		ansi_set_cursor_visible(term, TRUE);
 		term->curs_visible = TRUE;
 	}
 
-	term_set_color(window, ATTR_RESET);
+	if (term->in_sync) {
+		fputs(SYNC_END, term->out);
+		term->in_sync = FALSE;
+	}
 	fflush(term->out);
 }
 
@@ -1264,6 +1625,10 @@ void term_stop(void)
 {
 	ANSI_TERM *term = ansi_term;
 
+	if (term->in_sync) {
+		fputs(SYNC_END, term->out);
+		term->in_sync = FALSE;
+	}
 	ansi_mouse_disable(term);
 	ansi_bracketed_paste(term, FALSE);
 	ansi_set_normal(term);
@@ -1280,6 +1645,7 @@ void term_stop(void)
 	ansi_mouse_enable(term);
 	ansi_bracketed_paste(term, TRUE);
 
+	grid_invalidate(term);
 	irssi_redraw();
 }
 
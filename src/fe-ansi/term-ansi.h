@@ -36,6 +36,20 @@ typedef struct {
 	gboolean has_alt_screen;
 } TerminalCaps;
 
+/* Colors and attributes of a cell */
+typedef struct {
+	unsigned int fg, bg; /* UINT_MAX for default, palette index or rgb << 8 */
+	int attrs;           /* ATTR_BOLD, ATTR_UNDERLINE, ... */
+} TERM_PEN;
+
+/* One screen cell */
+typedef struct {
+	unichar chr;
+	const char *cluster; /* interned text if it's more than one character */
+	int width;           /* 0 = right half of the wide character before it */
+	TERM_PEN pen;
+} TERM_CELL;
+
 /* ANSI terminal state */
 typedef struct {
 	FILE *out;
@@ -53,12 +67,23 @@ typedef struct {
 	int cforcemove;
 	int curs_visible;
 
-	/* Current colors and attributes */
-	unsigned int last_fg, last_bg;
-	int last_attrs;
+	/* Pen used for drawing, and the one the terminal really has */
+	TERM_PEN pen, real_pen;
+	int real_pen_known;
+
+	/* Drawing goes to the back buffer, front buffer has what's on the
+	   screen. term_refresh() sends the differences. */
+	TERM_CELL *back, *front;
+	char *lines_dirty;
+	int front_invalid;
+
+	/* Wrap refreshes in synchronized output mode (DECSET 2026) */
+	int sync_output;
+	int in_sync;
 
-	/* Line tracking */
-	char *lines_empty;
+	/* Incomplete multibyte character from term_addch() */
+	char mb_buf[6];
+	int mb_len, mb_need;
 
 	/* Refresh freeze counter */
 	int freeze;
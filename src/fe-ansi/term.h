@@ -56,6 +56,9 @@ void term_force_colors(int set);
 
 /* Clear screen */
 void term_clear(void);
+/* Forget what's on the screen so the next refresh sends everything,
+   needed after writing to the terminal without the term_*() functions */
+void term_invalidate(void);
 /* Beep */
 void term_beep(void);
 
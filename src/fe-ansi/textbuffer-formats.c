@@ -32,10 +32,8 @@ static void collector_free(GSList **collector)
 	}
 }
 
-void textbuffer_format_rec_free(TEXT_BUFFER_FORMAT_REC *rec)
+void textbuffer_format_rec_release(TEXT_BUFFER_FORMAT_REC *rec)
 {
-	int n;
-
 	if (rec == NULL)
 		return;
 	if (rec == LINE_INFO_FORMAT_SET)
@@ -50,12 +48,24 @@ void textbuffer_format_rec_free(TEXT_BUFFER_FORMAT_REC *rec)
 	if (rec->nargs >= 1) {
 		i_refstr_release(rec->args[0]);
 	}
+	collector_free(&rec->expando_cache);
+}
+
+void textbuffer_format_rec_free(TEXT_BUFFER_FORMAT_REC *rec)
+{
+	int n;
+
+	if (rec == NULL)
+		return;
+	if (rec == LINE_INFO_FORMAT_SET)
+		return;
+
+	textbuffer_format_rec_release(rec);
 	for (n = 1; n < rec->nargs; n++) {
 		g_free(rec->args[n]);
 	}
 	rec->nargs = 0;
 	g_free(rec->args);
-	collector_free(&rec->expando_cache);
 	g_slice_free(TEXT_BUFFER_FORMAT_REC, rec);
 }
 
@@ -90,14 +100,22 @@ static void format_rec_set_dest(TEXT_BUFFER_FORMAT_REC *rec, const TEXT_DEST_REC
 	rec->flags = dest->flags & ~PRINT_FLAG_FORMAT;
 }
 
-void textbuffer_meta_rec_free(LINE_INFO_META_REC *rec)
+void textbuffer_meta_rec_release(LINE_INFO_META_REC *rec)
 {
 	if (rec == NULL)
 		return;
 
 	if (rec->hash != NULL)
 		g_hash_table_destroy(rec->hash);
+	rec->hash = NULL;
+}
+
+void textbuffer_meta_rec_free(LINE_INFO_META_REC *rec)
+{
+	if (rec == NULL)
+		return;
 
+	textbuffer_meta_rec_release(rec);
 	g_free(rec);
 }
 
@@ -19,6 +19,10 @@ typedef struct _TEXT_BUFFER_FORMAT_REC {
 
 void textbuffer_format_rec_free(TEXT_BUFFER_FORMAT_REC *rec);
 void textbuffer_meta_rec_free(LINE_INFO_META_REC *rec);
+/* Release the shared strings and caches of records that were packed into
+   a text chunk. The records themselves are freed with the chunk. */
+void textbuffer_format_rec_release(TEXT_BUFFER_FORMAT_REC *rec);
+void textbuffer_meta_rec_release(LINE_INFO_META_REC *rec);
 char *textbuffer_line_get_text(TEXT_BUFFER_REC *buffer, LINE_REC *line, gboolean raw);
 void textbuffer_formats_init(void);
 void textbuffer_formats_deinit(void);
@@ -0,0 +1,371 @@
+/*
+ * textbuffer-heights.c : erssi
+ *
+ * Copyright (C) 2024-2025 erssi-org team
+ * Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "module.h"
+
+#include <irssi/src/fe-ansi/textbuffer-heights.h>
+
+/* The lines of a view are kept in a treap in the same order as in the
+   buffer. Every node knows the number of lines and rows in its subtree,
+   so the row position of a line, the height of everything below it and
+   the line at a given row are all O(log n) instead of walking the whole
+   scrollback. */
+
+typedef struct _HEIGHT_NODE {
+	struct _HEIGHT_NODE *left, *right, *parent;
+	LINE_REC *line;
+	guint32 priority;
+	int height;
+
+	/* subtree totals */
+	int lines;
+	int rows; /* unknown heights counted as one row */
+	int unknown;
+} HEIGHT_NODE;
+
+struct _TEXT_BUFFER_HEIGHTS_REC {
+	HEIGHT_NODE *root;
+	GHashTable *nodes; /* LINE_REC -> HEIGHT_NODE */
+};
+
+#define node_rows(node) ((node) == NULL ? 0 : (node)->rows)
+#define node_lines(node) ((node) == NULL ? 0 : (node)->lines)
+#define node_unknown(node) ((node) == NULL ? 0 : (node)->unknown)
+#define node_own_rows(node) \
+	((node)->height == LINE_HEIGHT_UNKNOWN ? 1 : (node)->height)
+
+static void node_update(HEIGHT_NODE *node)
+{
+	node->lines = 1 + node_lines(node->left) + node_lines(node->right);
+	node->rows = node_own_rows(node) + node_rows(node->left) + node_rows(node->right);
+	node->unknown = (node->height == LINE_HEIGHT_UNKNOWN) +
+		node_unknown(node->left) + node_unknown(node->right);
+}
+
+static void node_update_path(HEIGHT_NODE *node)
+{
+	for (; node != NULL; node = node->parent)
+		node_update(node);
+}
+
+static void node_replace_child(TEXT_BUFFER_HEIGHTS_REC *heights, HEIGHT_NODE *parent,
+                               HEIGHT_NODE *old, HEIGHT_NODE *node)
+{
+	if (parent == NULL)
+		heights->root = node;
+	else if (parent->left == old)
+		parent->left = node;
+	else
+		parent->right = node;
+	if (node != NULL)
+		node->parent = parent;
+}
+
+/* rotate `node' above its parent */
+static void node_rotate_up(TEXT_BUFFER_HEIGHTS_REC *heights, HEIGHT_NODE *node)
+{
+	HEIGHT_NODE *parent, *child;
+
+	parent = node->parent;
+	node_replace_child(heights, parent->parent, parent, node);
+
+	if (parent->left == node) {
+		child = node->right;
+		parent->left = child;
+		node->right = parent;
+	} else {
+		child = node->left;
+		parent->right = child;
+		node->left = parent;
+	}
+	if (child != NULL)
+		child->parent = parent;
+	parent->parent = node;
+
+	node_update(parent);
+	node_update(node);
+}
+
+TEXT_BUFFER_HEIGHTS_REC *textbuffer_heights_create(void)
+{
+	TEXT_BUFFER_HEIGHTS_REC *heights;
+
+	heights = g_new0(TEXT_BUFFER_HEIGHTS_REC, 1);
+	heights->nodes = g_hash_table_new((GHashFunc) g_direct_hash,
+	                                  (GCompareFunc) g_direct_equal);
+	return heights;
+}
+
+static void node_free(LINE_REC *line, HEIGHT_NODE *node)
+{
+	g_slice_free(HEIGHT_NODE, node);
+}
+
+void textbuffer_heights_clear(TEXT_BUFFER_HEIGHTS_REC *heights)
+{
+	g_hash_table_foreach(heights->nodes, (GHFunc) node_free, NULL);
+	g_hash_table_remove_all(heights->nodes);
+	heights->root = NULL;
+}
+
+void textbuffer_heights_destroy(TEXT_BUFFER_HEIGHTS_REC *heights)
+{
+	textbuffer_heights_clear(heights);
+	g_hash_table_destroy(heights->nodes);
+	g_free(heights);
+}
+
+int textbuffer_heights_contains(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line)
+{
+	return g_hash_table_lookup(heights->nodes, line) != NULL;
+}
+
+void textbuffer_heights_insert(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *prev,
+                               LINE_REC *line, int height)
+{
+	HEIGHT_NODE *node, *pos;
+
+	g_return_if_fail(line != NULL);
+	g_return_if_fail(!textbuffer_heights_contains(heights, line));
+
+	node = g_slice_new0(HEIGHT_NODE);
+	node->line = line;
+	node->priority = g_random_int();
+	node->height = height;
+	node_update(node);
+	g_hash_table_insert(heights->nodes, line, node);
+
+	pos = NULL;
+	if (prev != NULL) {
+		pos = g_hash_table_lookup(heights->nodes, prev);
+		g_warn_if_fail(pos != NULL);
+	}
+
+	/* attach as a leaf right after `prev' */
+	if (heights->root == NULL) {
+		heights->root = node;
+		return;
+	}
+
+	if (pos == NULL) {
+		for (pos = heights->root; pos->left != NULL; pos = pos->left) ;
+		pos->left = node;
+	} else if (pos->right == NULL) {
+		pos->right = node;
+	} else {
+		for (pos = pos->right; pos->left != NULL; pos = pos->left) ;
+		pos->left = node;
+	}
+	node->parent = pos;
+	node_update_path(pos);
+
+	/* rotations don't change the totals of the nodes above */
+	while (node->parent != NULL && node->parent->priority < node->priority)
+		node_rotate_up(heights, node);
+}
+
+void textbuffer_heights_remove(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line)
+{
+	HEIGHT_NODE *node, *child, *parent;
+
+	node = g_hash_table_lookup(heights->nodes, line);
+	if (node == NULL)
+		return;
+
+	/* rotate it down to a leaf */
+	while (node->left != NULL || node->right != NULL) {
+		if (node->left == NULL)
+			child = node->right;
+		else if (node->right == NULL)
+			child = node->left;
+		else
+			child = node->left->priority > node->right->priority ?
+				node->left : node->right;
+		node_rotate_up(heights, child);
+	}
+
+	parent = node->parent;
+	node_replace_child(heights, parent, node, NULL);
+	node_update_path(parent);
+
+	g_hash_table_remove(heights->nodes, line);
+	node_free(line, node);
+}
+
+int textbuffer_heights_get(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line)
+{
+	HEIGHT_NODE *node;
+
+	node = g_hash_table_lookup(heights->nodes, line);
+	return node == NULL ? LINE_HEIGHT_UNKNOWN : node->height;
+}
+
+void textbuffer_heights_set(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line, int height)
+{
+	HEIGHT_NODE *node;
+
+	node = g_hash_table_lookup(heights->nodes, line);
+	if (node == NULL || node->height == height)
+		return;
+
+	node->height = height;
+	node_update_path(node);
+}
+
+static void node_reset(HEIGHT_NODE *node, LINE_HEIGHT_FUNC func, void *data)
+{
+	if (node == NULL)
+		return;
+
+	node_reset(node->left, func, data);
+	node_reset(node->right, func, data);
+	node->height = func(node->line, data);
+	node_update(node);
+}
+
+void textbuffer_heights_reset(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_HEIGHT_FUNC func,
+                              void *data)
+{
+	node_reset(heights->root, func, data);
+}
+
+int textbuffer_heights_position(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line)
+{
+	HEIGHT_NODE *node;
+	int pos;
+
+	node = g_hash_table_lookup(heights->nodes, line);
+	g_return_val_if_fail(node != NULL, -1);
+
+	pos = node_lines(node->left);
+	for (; node->parent != NULL; node = node->parent) {
+		if (node->parent->right == node)
+			pos += node_lines(node->parent->left) + 1;
+	}
+	return pos;
+}
+
+int textbuffer_heights_rows_before(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line,
+                                   int *unknown)
+{
+	HEIGHT_NODE *node, *parent;
+	int rows, unknown_count;
+
+	node = g_hash_table_lookup(heights->nodes, line);
+	g_return_val_if_fail(node != NULL, 0);
+
+	rows = node_rows(node->left);
+	unknown_count = node_unknown(node->left);
+	for (; node->parent != NULL; node = parent) {
+		parent = node->parent;
+		if (parent->right == node) {
+			rows += node_rows(parent->left) + node_own_rows(parent);
+			unknown_count += node_unknown(parent->left) +
+				(parent->height == LINE_HEIGHT_UNKNOWN);
+		}
+	}
+
+	if (unknown != NULL)
+		*unknown = unknown_count;
+	return rows;
+}
+
+int textbuffer_heights_rows_after(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line,
+                                  int *unknown)
+{
+	int rows, unknown_before;
+
+	rows = textbuffer_heights_rows_before(heights, line, &unknown_before);
+	if (unknown != NULL)
+		*unknown = node_unknown(heights->root) - unknown_before;
+	return node_rows(heights->root) - rows;
+}
+
+LINE_REC *textbuffer_heights_find_row(TEXT_BUFFER_HEIGHTS_REC *heights, int row,
+                                      int *subline)
+{
+	HEIGHT_NODE *node;
+
+	if (row < 0)
+		return NULL;
+
+	node = heights->root;
+	while (node != NULL) {
+		if (row < node_rows(node->left)) {
+			node = node->left;
+			continue;
+		}
+
+		row -= node_rows(node->left);
+		if (row < node_own_rows(node)) {
+			*subline = row;
+			return node->line;
+		}
+		row -= node_own_rows(node);
+		node = node->right;
+	}
+
+	return NULL;
+}
+
+/* first node with unknown height in the subtree */
+static HEIGHT_NODE *node_first_unknown(HEIGHT_NODE *node)
+{
+	while (node != NULL && node->unknown > 0) {
+		if (node_unknown(node->left) > 0)
+			node = node->left;
+		else if (node->height == LINE_HEIGHT_UNKNOWN)
+			return node;
+		else
+			node = node->right;
+	}
+	return NULL;
+}
+
+LINE_REC *textbuffer_heights_next_unknown(TEXT_BUFFER_HEIGHTS_REC *heights,
+                                          LINE_REC *line)
+{
+	HEIGHT_NODE *node, *found;
+
+	node = g_hash_table_lookup(heights->nodes, line);
+	if (node == NULL || heights->root->unknown == 0)
+		return NULL;
+
+	if (node->height == LINE_HEIGHT_UNKNOWN)
+		return line;
+
+	/* rest of the lines in the order: the right subtree, then going
+	   up every parent we came to from the left together with its
+	   right subtree */
+	found = node_first_unknown(node->right);
+	while (found == NULL && node->parent != NULL) {
+		if (node->parent->left == node) {
+			node = node->parent;
+			if (node->height == LINE_HEIGHT_UNKNOWN)
+				return node->line;
+			found = node_first_unknown(node->right);
+		} else {
+			node = node->parent;
+		}
+	}
+
+	return found == NULL ? NULL : found->line;
+}
@@ -0,0 +1,50 @@
+#ifndef IRSSI_FE_TEXT_TEXTBUFFER_HEIGHTS_H
+#define IRSSI_FE_TEXT_TEXTBUFFER_HEIGHTS_H
+
+#include <irssi/src/fe-ansi/textbuffer.h>
+
+/* height of a line that hasn't been wrapped for the current width yet.
+   It's counted as one row in the sums. */
+#define LINE_HEIGHT_UNKNOWN -1
+
+typedef struct _TEXT_BUFFER_HEIGHTS_REC TEXT_BUFFER_HEIGHTS_REC;
+
+typedef int (*LINE_HEIGHT_FUNC) (LINE_REC *line, void *data);
+
+TEXT_BUFFER_HEIGHTS_REC *textbuffer_heights_create(void);
+void textbuffer_heights_destroy(TEXT_BUFFER_HEIGHTS_REC *heights);
+/* Forget all lines */
+void textbuffer_heights_clear(TEXT_BUFFER_HEIGHTS_REC *heights);
+
+/* Add `line' right after `prev', or first if `prev' is NULL */
+void textbuffer_heights_insert(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *prev,
+                               LINE_REC *line, int height);
+void textbuffer_heights_remove(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line);
+int textbuffer_heights_contains(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line);
+
+/* Return the height of `line', LINE_HEIGHT_UNKNOWN if it's not known */
+int textbuffer_heights_get(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line);
+/* Change the height of `line', ignored if the line isn't indexed */
+void textbuffer_heights_set(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line, int height);
+/* Replace the height of every line with func(line, data) */
+void textbuffer_heights_reset(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_HEIGHT_FUNC func,
+                              void *data);
+
+/* Number of lines before `line' */
+int textbuffer_heights_position(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line);
+/* Number of rows before `line', `unknown' is set to the number of lines
+   with unknown height in them */
+int textbuffer_heights_rows_before(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line,
+                                   int *unknown);
+/* Number of rows from `line' to the end of the buffer */
+int textbuffer_heights_rows_after(TEXT_BUFFER_HEIGHTS_REC *heights, LINE_REC *line,
+                                  int *unknown);
+/* Return the line containing `row', counting from the first line, and
+   the row inside it in `subline'. NULL if the buffer isn't that high. */
+LINE_REC *textbuffer_heights_find_row(TEXT_BUFFER_HEIGHTS_REC *heights, int row,
+                                      int *subline);
+/* Return the first line with unknown height on or after `line' */
+LINE_REC *textbuffer_heights_next_unknown(TEXT_BUFFER_HEIGHTS_REC *heights,
+                                          LINE_REC *line);
+
+#endif
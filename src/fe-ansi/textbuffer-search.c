@@ -0,0 +1,171 @@
+/*
+ * textbuffer-search.c : erssi
+ *
+ * Copyright (C) 2024-2025 erssi-org team
+ * Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "module.h"
+#include <irssi/src/core/signals.h>
+
+#include <irssi/src/fe-ansi/textbuffer-search.h>
+
+/* Searching needs the lines as plain text, which means rendering them
+   through the theme. The rendered text is cached per line together with
+   a signature of its trigrams, so repeated searches only need to look at
+   the lines whose signature contains all of the searched trigrams. Lines
+   are added to the index the first time they are searched. */
+
+typedef struct {
+	TEXT_SEARCH_SIG_REC sig;
+	char text[1];
+} LINE_SEARCH_REC;
+
+struct _TEXT_BUFFER_SEARCH_REC {
+	GHashTable *lines; /* LINE_REC -> LINE_SEARCH_REC */
+	int generation;
+};
+
+/* bumped whenever the rendered text of the lines may have changed */
+static int search_generation;
+static GString *render_str;
+
+#define trigram_bit(a, b, c) \
+	((((guint32) (guchar) (a) << 16 | (guint32) (guchar) (b) << 8 | \
+	   (guint32) (guchar) (c)) * 2654435761U) >> 24)
+
+void textbuffer_search_signature(const char *text, TEXT_SEARCH_SIG_REC *sig)
+{
+	char a, b, c;
+	guint bit;
+
+	memset(sig, 0, sizeof(*sig));
+	if (text[0] == '\0' || text[1] == '\0')
+		return;
+
+	a = i_tolower(text[0]);
+	b = i_tolower(text[1]);
+	for (text += 2; *text != '\0'; text++) {
+		c = i_tolower(*text);
+		bit = trigram_bit(a, b, c);
+		sig->bits[bit / 32] |= 1U << (bit % 32);
+		a = b;
+		b = c;
+	}
+}
+
+static int signature_contains(const TEXT_SEARCH_SIG_REC *sig,
+			      const TEXT_SEARCH_SIG_REC *sub)
+{
+	int i;
+
+	for (i = 0; i < TEXT_SEARCH_SIG_WORDS; i++) {
+		if ((sig->bits[i] & sub->bits[i]) != sub->bits[i])
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static struct _TEXT_BUFFER_SEARCH_REC *search_get(TEXT_BUFFER_REC *buffer)
+{
+	struct _TEXT_BUFFER_SEARCH_REC *search;
+
+	search = buffer->search;
+	if (search == NULL) {
+		search = g_new0(struct _TEXT_BUFFER_SEARCH_REC, 1);
+		search->lines = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+						      NULL, (GDestroyNotify) g_free);
+		search->generation = search_generation;
+		buffer->search = search;
+	} else if (search->generation != search_generation) {
+		g_hash_table_remove_all(search->lines);
+		search->generation = search_generation;
+	}
+
+	return search;
+}
+
+const char *textbuffer_search_line_text(TEXT_BUFFER_REC *buffer, LINE_REC *line,
+                                        const TEXT_SEARCH_SIG_REC *sig)
+{
+	struct _TEXT_BUFFER_SEARCH_REC *search;
+	LINE_SEARCH_REC *rec;
+
+	g_return_val_if_fail(buffer != NULL, NULL);
+	g_return_val_if_fail(line != NULL, NULL);
+
+	search = search_get(buffer);
+	rec = g_hash_table_lookup(search->lines, line);
+	if (rec == NULL) {
+		textbuffer_line2text(buffer, line, COLORING_STRIP, render_str);
+
+		rec = g_malloc(G_STRUCT_OFFSET(LINE_SEARCH_REC, text) +
+			       render_str->len + 1);
+		memcpy(rec->text, render_str->str, render_str->len + 1);
+		textbuffer_search_signature(rec->text, &rec->sig);
+		g_hash_table_insert(search->lines, line, rec);
+	}
+
+	if (sig != NULL && !signature_contains(&rec->sig, sig))
+		return NULL;
+	return rec->text;
+}
+
+void textbuffer_search_remove_line(TEXT_BUFFER_REC *buffer, LINE_REC *line)
+{
+	if (buffer->search != NULL)
+		g_hash_table_remove(buffer->search->lines, line);
+}
+
+void textbuffer_search_reset(TEXT_BUFFER_REC *buffer)
+{
+	if (buffer->search != NULL)
+		g_hash_table_remove_all(buffer->search->lines);
+}
+
+void textbuffer_search_destroy(TEXT_BUFFER_REC *buffer)
+{
+	if (buffer->search == NULL)
+		return;
+
+	g_hash_table_destroy(buffer->search->lines);
+	g_free(buffer->search);
+	buffer->search = NULL;
+}
+
+static void sig_invalidate(void)
+{
+	search_generation++;
+}
+
+void textbuffer_search_init(void)
+{
+	search_generation = 0;
+	render_str = g_string_new(NULL);
+
+	signal_add("setup changed", (SIGNAL_FUNC) sig_invalidate);
+	signal_add("theme changed", (SIGNAL_FUNC) sig_invalidate);
+}
+
+void textbuffer_search_deinit(void)
+{
+	signal_remove("setup changed", (SIGNAL_FUNC) sig_invalidate);
+	signal_remove("theme changed", (SIGNAL_FUNC) sig_invalidate);
+
+	g_string_free(render_str, TRUE);
+	render_str = NULL;
+}
@@ -0,0 +1,30 @@
+#ifndef IRSSI_FE_TEXT_TEXTBUFFER_SEARCH_H
+#define IRSSI_FE_TEXT_TEXTBUFFER_SEARCH_H
+
+#include <irssi/src/fe-ansi/textbuffer.h>
+
+/* 256 bit trigram signature */
+#define TEXT_SEARCH_SIG_WORDS 8
+
+typedef struct {
+	guint32 bits[TEXT_SEARCH_SIG_WORDS];
+} TEXT_SEARCH_SIG_REC;
+
+/* Calculate the signature of the case-folded trigrams in `text' */
+void textbuffer_search_signature(const char *text, TEXT_SEARCH_SIG_REC *sig);
+
+/* Return the color stripped text of `line' if it may contain all the
+   trigrams in `sig', NULL if it can't. With `sig' NULL the text is always
+   returned. The text is cached until the line is removed or the theme or
+   settings are changed. */
+const char *textbuffer_search_line_text(TEXT_BUFFER_REC *buffer, LINE_REC *line,
+                                        const TEXT_SEARCH_SIG_REC *sig);
+
+void textbuffer_search_remove_line(TEXT_BUFFER_REC *buffer, LINE_REC *line);
+void textbuffer_search_reset(TEXT_BUFFER_REC *buffer);
+void textbuffer_search_destroy(TEXT_BUFFER_REC *buffer);
+
+void textbuffer_search_init(void);
+void textbuffer_search_deinit(void);
+
+#endif
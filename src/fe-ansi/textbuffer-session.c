@@ -0,0 +1,198 @@
+/*
+ * textbuffer-session.c : erssi
+ *
+ * Copyright (C) 2024-2025 erssi-org team
+ * Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "module.h"
+#include <irssi/src/core/levels.h>
+#include <irssi/src/core/servers.h>
+#include <irssi/src/core/session-snapshot.h>
+#include <irssi/src/core/settings.h>
+#include <irssi/src/core/signals.h>
+#include <irssi/src/fe-common/core/formats.h>
+#include <irssi/src/fe-common/core/window-items.h>
+
+#include <irssi/src/fe-ansi/gui-printtext.h>
+#include <irssi/src/fe-ansi/gui-windows.h>
+#include <irssi/src/fe-ansi/textbuffer-formats.h>
+
+/* Scrollback of all windows is kept over /UPGRADE in the "windows" section
+   of the session snapshot:
+
+     int window count, then for each window:
+       int refnum, str name
+       int item count, then str server tag, str name for each item
+       int line count, then int level, int64 time, str text for each line
+
+   Lines are saved as the text they were rendered to, so formatted lines
+   come back as plain text lines. */
+
+#define SNAPSHOT_WINDOWS "windows"
+
+static void session_save_window(SESSION_SNAPSHOT_REC *snap, WINDOW_REC *window)
+{
+	TEXT_BUFFER_REC *buffer;
+	LINE_REC *line;
+	GSList *tmp;
+	char *text;
+
+	session_snapshot_write_int(snap, window->refnum);
+	session_snapshot_write_str(snap, window->name);
+
+	session_snapshot_write_int(snap, g_slist_length(window->items));
+	for (tmp = window->items; tmp != NULL; tmp = tmp->next) {
+		WI_ITEM_REC *item = tmp->data;
+
+		session_snapshot_write_str(snap, item->server == NULL ? NULL :
+					   item->server->tag);
+		session_snapshot_write_str(snap, item->name);
+	}
+
+	buffer = WINDOW_GUI(window)->view->buffer;
+	session_snapshot_write_int(snap, buffer->lines_count);
+	for (line = buffer->first_line; line != NULL; line = line->next) {
+		text = textbuffer_line_get_text(buffer, line, TRUE);
+
+		session_snapshot_write_int(snap, line->info.level & ~MSGLEVEL_FORMAT);
+		session_snapshot_write_int64(snap, line->info.time);
+		session_snapshot_write_str(snap, text == NULL ? "" : text);
+		g_free(text);
+	}
+}
+
+static void sig_session_save_snapshot(SESSION_SNAPSHOT_REC *snap)
+{
+	GSList *tmp;
+
+	if (!settings_get_bool("upgrade_scrollback"))
+		return;
+
+	session_snapshot_section(snap, SNAPSHOT_WINDOWS);
+	session_snapshot_write_int(snap, g_slist_length(windows));
+	for (tmp = windows; tmp != NULL; tmp = tmp->next)
+		session_save_window(snap, tmp->data);
+}
+
+/* Find the window the saved one turned into: channels and queries were
+   restored before this, so their windows are the best match */
+static WINDOW_REC *session_find_window(int refnum, const char *name, GSList *items)
+{
+	WINDOW_REC *window;
+	WI_ITEM_REC *item;
+	SERVER_REC *server;
+	GSList *tmp;
+
+	for (tmp = items; tmp != NULL; tmp = tmp->next->next) {
+		const char *tag = tmp->data;
+		const char *item_name = tmp->next->data;
+
+		server = tag == NULL ? NULL : server_find_tag(tag);
+		if (server == NULL || item_name == NULL)
+			continue;
+
+		item = window_item_find(server, item_name);
+		if (item != NULL)
+			return window_item_window(item);
+	}
+
+	if (name != NULL) {
+		window = window_find_name(name);
+		if (window != NULL)
+			return window;
+	}
+
+	return window_find_refnum(refnum);
+}
+
+static void session_restore_lines(WINDOW_REC *window, SESSION_SNAPSHOT_READER *reader,
+				  int count)
+{
+	TEXT_DEST_REC dest;
+	LINE_REC *prev;
+	const char *text;
+	char *str;
+	gint64 time;
+	int level;
+
+	/* the lines go before anything printed since startup */
+	prev = NULL;
+	for (; count > 0 && !reader->error; count--) {
+		level = session_snapshot_read_int(reader);
+		time = session_snapshot_read_int64(reader);
+		text = session_snapshot_read_str(reader);
+		if (text == NULL || reader->error || window == NULL)
+			continue;
+
+		format_create_dest(&dest, NULL, NULL, level, window);
+		str = g_strconcat(text, "\n", NULL);
+		gui_printtext_after_time(&dest, prev, str, (time_t) time);
+		g_free(str);
+
+		prev = WINDOW_GUI(window)->insert_after;
+	}
+
+	if (window != NULL && prev != NULL)
+		textbuffer_view_redraw(WINDOW_GUI(window)->view);
+}
+
+static void sig_session_restore_snapshot(SESSION_SNAPSHOT_REC *snap)
+{
+	SESSION_SNAPSHOT_READER reader;
+	WINDOW_REC *window;
+	GSList *items;
+	const char *name;
+	int count, refnum, n;
+
+	if (!session_snapshot_find(snap, SNAPSHOT_WINDOWS, &reader))
+		return;
+
+	count = session_snapshot_read_int(&reader);
+	for (; count > 0 && !reader.error; count--) {
+		refnum = session_snapshot_read_int(&reader);
+		name = session_snapshot_read_str(&reader);
+
+		/* server tag, name pairs */
+		items = NULL;
+		n = session_snapshot_read_int(&reader);
+		for (; n > 0 && !reader.error; n--) {
+			items = g_slist_prepend(items, (char *) session_snapshot_read_str(&reader));
+			items = g_slist_prepend(items, (char *) session_snapshot_read_str(&reader));
+		}
+		items = g_slist_reverse(items);
+
+		window = session_find_window(refnum, name, items);
+		g_slist_free(items);
+
+		session_restore_lines(window, &reader, session_snapshot_read_int(&reader));
+	}
+}
+
+void textbuffer_session_init(void)
+{
+	settings_add_bool("history", "upgrade_scrollback", TRUE);
+
+	signal_add("session save snapshot", (SIGNAL_FUNC) sig_session_save_snapshot);
+	signal_add("session restore snapshot", (SIGNAL_FUNC) sig_session_restore_snapshot);
+}
+
+void textbuffer_session_deinit(void)
+{
+	signal_remove("session save snapshot", (SIGNAL_FUNC) sig_session_save_snapshot);
+	signal_remove("session restore snapshot", (SIGNAL_FUNC) sig_session_restore_snapshot);
+}
@@ -26,6 +26,7 @@
 #include <irssi/src/core/utf8.h>
 #include <irssi/src/fe-common/core/formats.h>
 #include <irssi/src/fe-ansi/textbuffer-formats.h>
+#include <irssi/src/fe-ansi/textbuffer-heights.h>
 #include <irssi/src/fe-ansi/textbuffer-view.h>
 
 typedef struct {
@@ -50,8 +51,111 @@ static GSList *views;
 #define view_line_is_hidden(view, line) \
 	(((line)->info.level & (view)->hidden_level) != 0)
 
-#define view_get_linecount(view, line) \
-	(view_line_is_hidden(view, line) ? 0 : view_get_linecount_hidden(view, line))
+/* number of real lines `line' takes in the view, wrapping it if needed.
+   The result is remembered in the view's height index. */
+static int view_get_linecount(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line)
+{
+	int linecount;
+
+	linecount = view_line_is_hidden(view, line) ? 0 :
+		view_get_linecount_hidden(view, line);
+	textbuffer_heights_set(view->heights, line, linecount);
+	return linecount;
+}
+
+/* the line count if it's known without wrapping the line */
+static int view_get_known_linecount(LINE_REC *line, TEXT_BUFFER_VIEW_REC *view)
+{
+	LINE_CACHE_REC *cache;
+
+	if (view_line_is_hidden(view, line))
+		return 0;
+
+	cache = g_hash_table_lookup(view->cache->line_cache, line);
+	return cache == NULL ? LINE_HEIGHT_UNKNOWN : cache->count;
+}
+
+/* all heights may have changed: width, indentation or hidden level */
+static void view_reset_heights(TEXT_BUFFER_VIEW_REC *view)
+{
+	textbuffer_heights_reset(view->heights,
+				 (LINE_HEIGHT_FUNC) view_get_known_linecount, view);
+}
+
+static void view_heights_insert_line(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line)
+{
+	LINE_REC *prev;
+
+	if (textbuffer_heights_contains(view->heights, line)) {
+		/* the line was changed */
+		textbuffer_heights_set(view->heights, line,
+				       view_get_known_linecount(line, view));
+		return;
+	}
+
+	prev = line->prev;
+	while (prev != NULL && !textbuffer_heights_contains(view->heights, prev))
+		prev = prev->prev;
+	textbuffer_heights_insert(view->heights, prev, line,
+				  view_get_known_linecount(line, view));
+}
+
+/* returns TRUE if `search' comes on or after `line' in the buffer */
+static int view_line_exists_after(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line,
+				  LINE_REC *search)
+{
+	if (line == NULL || search == NULL)
+		return FALSE;
+
+	if (textbuffer_heights_contains(view->heights, line) &&
+	    textbuffer_heights_contains(view->heights, search)) {
+		return textbuffer_heights_position(view->heights, search) >=
+			textbuffer_heights_position(view->heights, line);
+	}
+
+	return textbuffer_line_exists_after(line, search);
+}
+
+/* Return number of real lines from `line' to the end of the buffer.
+   Far away from the bottom the lines which haven't been wrapped since
+   the last resize are estimated to take one line, `exact' is set FALSE
+   then. Near the bottom they're wrapped to get the exact value. */
+static int view_get_lines_height_after(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line,
+				       int *exact)
+{
+	LINE_REC *unknown_line;
+	int height, unknown;
+
+	if (exact != NULL)
+		*exact = TRUE;
+
+	if (line == NULL)
+		return 0;
+
+	if (!textbuffer_heights_contains(view->heights, line)) {
+		/* not finished yet */
+		height = 0;
+		for (; line != NULL; line = line->next)
+			height += view_get_linecount(view, line);
+		return height;
+	}
+
+	for (;;) {
+		height = textbuffer_heights_rows_after(view->heights, line, &unknown);
+		if (unknown == 0)
+			return height;
+
+		if (height >= view->height * 2) {
+			if (exact != NULL)
+				*exact = FALSE;
+			return height;
+		}
+
+		while ((unknown_line = textbuffer_heights_next_unknown(view->heights,
+								       line)) != NULL)
+			view_get_linecount(view, unknown_line);
+	}
+}
 
 static GSList *textbuffer_get_views(TEXT_BUFFER_REC *buffer)
 {
@@ -444,10 +548,12 @@ void textbuffer_view_reset_cache(TEXT_BUFFER_VIEW_REC *view)
         g_slist_foreach(view->siblings, (GFunc) textbuffer_cache_unref, NULL);
 
 	view->cache = textbuffer_cache_get(view->siblings, view->width);
+	view_reset_heights(view);
 	for (tmp = view->siblings; tmp != NULL; tmp = tmp->next) {
 		TEXT_BUFFER_VIEW_REC *rec = tmp->data;
 
 		rec->cache = textbuffer_cache_get(rec->siblings, rec->width);
+		view_reset_heights(rec);
 	}
 }
 
@@ -659,15 +765,17 @@ static void textbuffer_view_init_bottom(TEXT_BUFFER_VIEW_REC *view)
 	view->empty_linecount = view->height - total;
 }
 
-static void textbuffer_view_init_ypos(TEXT_BUFFER_VIEW_REC *view)
+/* returns FALSE if ypos is only an estimate, see
+   view_get_lines_height_after() */
+static int textbuffer_view_init_ypos(TEXT_BUFFER_VIEW_REC *view)
 {
-        LINE_REC *line;
+	int exact;
 
-	g_return_if_fail(view != NULL);
+	g_return_val_if_fail(view != NULL, FALSE);
 
-	view->ypos = -view->subline-1;
-	for (line = view->startline; line != NULL; line = line->next)
-		view->ypos += view_get_linecount(view, line);
+	view->ypos = -view->subline-1 +
+		view_get_lines_height_after(view, view->startline, &exact);
+	return exact;
 }
 
 /* Create new view. */
@@ -676,6 +784,7 @@ TEXT_BUFFER_VIEW_REC *textbuffer_view_create(TEXT_BUFFER_REC *buffer,
 					     int scroll, int utf8)
 {
 	TEXT_BUFFER_VIEW_REC *view;
+	LINE_REC *line;
 
         g_return_val_if_fail(buffer != NULL, NULL);
         g_return_val_if_fail(width > 0, NULL);
@@ -690,6 +799,10 @@ TEXT_BUFFER_VIEW_REC *textbuffer_view_create(TEXT_BUFFER_REC *buffer,
         view->utf8 = utf8;
 
 	view->cache = textbuffer_cache_get(view->siblings, width);
+	view->heights = textbuffer_heights_create();
+	for (line = buffer->first_line; line != NULL; line = line->next)
+		textbuffer_heights_insert(view->heights, line->prev, line,
+					  view_get_known_linecount(line, view));
 	textbuffer_view_init_bottom(view);
 
 	view->startline = view->bottom_startline;
@@ -733,6 +846,7 @@ void textbuffer_view_destroy(TEXT_BUFFER_VIEW_REC *view)
 	g_hash_table_destroy(view->bookmarks);
 
         textbuffer_cache_unref(view->cache);
+	textbuffer_heights_destroy(view->heights);
 	g_free(view);
 }
 
@@ -787,19 +901,6 @@ void textbuffer_view_set_utf8(TEXT_BUFFER_VIEW_REC *view, int utf8)
         view->utf8 = utf8;
 }
 
-static int view_get_linecount_all(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line)
-{
-	int linecount;
-
-        linecount = 0;
-	while (line != NULL) {
-		linecount += view_get_linecount(view, line);
-                line = line->next;
-	}
-
-        return linecount;
-}
-
 static void view_draw(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line,
 		      int subline, int ypos, int lines, int fill_bottom)
 {
@@ -853,23 +954,13 @@ static void view_draw_bottom(TEXT_BUFFER_VIEW_REC *view, int lines)
         view_draw(view, line, subline, maxline, lines, TRUE);
 }
 
-/* lines: this pointer is scrolled by scrollcount screen lines
-   subline: this pointer contains the subline position
-   scrollcount: the number of lines to scroll down (negative: up)
-   draw_nonclean: whether to redraw the screen now
-
-   Returns number of lines actually scrolled */
-static int view_scroll(TEXT_BUFFER_VIEW_REC *view, LINE_REC **lines,
-		       int *subline, int scrollcount, int draw_nonclean)
+/* Scroll by walking the lines one by one, see view_scroll() */
+static int view_scroll_near(TEXT_BUFFER_VIEW_REC *view, LINE_REC **lines,
+			    int *subline, int scrollcount, int scroll_visible)
 {
-	int linecount, realcount, scroll_visible;
-
-	if (*lines == NULL)
-		return 0;
+	int linecount, realcount;
 
 	/* scroll down */
-	scroll_visible = lines == &view->startline;
-
 	realcount = -*subline;
 	scrollcount += *subline;
 	*subline = 0;
@@ -913,6 +1004,106 @@ static int view_scroll(TEXT_BUFFER_VIEW_REC *view, LINE_REC **lines,
 		}
 	}
 
+	return realcount;
+}
+
+/* Scroll more than a screenful with the height index. Returns FALSE if
+   the lines in between haven't all been wrapped for the current width,
+   they're then walked with view_scroll_near(). */
+static int view_scroll_far(TEXT_BUFFER_VIEW_REC *view, LINE_REC **lines,
+			   int *subline, int scrollcount, int scroll_visible,
+			   int *realcount)
+{
+	TEXT_BUFFER_HEIGHTS_REC *heights;
+	LINE_REC *line;
+	int row, target, unknown, bottom_row, bottom_unknown;
+	int line_subline, line_unknown;
+
+	heights = view->heights;
+	if ((scrollcount <= view->height && scrollcount >= -view->height) ||
+	    !textbuffer_heights_contains(heights, *lines))
+		return FALSE;
+
+	row = textbuffer_heights_rows_before(heights, *lines, &unknown) + *subline;
+	target = row + scrollcount;
+
+	if (scrollcount > 0 && scroll_visible) {
+		/* don't go past the bottom */
+		if (!textbuffer_heights_contains(heights, view->bottom_startline))
+			return FALSE;
+
+		bottom_row = textbuffer_heights_rows_before(heights, view->bottom_startline,
+							    &bottom_unknown);
+		bottom_unknown += textbuffer_heights_get(heights, view->bottom_startline) ==
+			LINE_HEIGHT_UNKNOWN;
+		bottom_row += view->bottom_subline;
+		if (bottom_row < row)
+			return FALSE;
+
+		if (target >= bottom_row) {
+			if (bottom_unknown != unknown)
+				return FALSE;
+
+			*lines = view->bottom_startline;
+			*subline = view->bottom_subline;
+			*realcount = bottom_row - row;
+			return TRUE;
+		}
+	}
+
+	if (target < 0) {
+		/* up to the first line */
+		if (unknown != 0 ||
+		    !textbuffer_heights_contains(heights, view->buffer->first_line))
+			return FALSE;
+
+		*lines = view->buffer->first_line;
+		*subline = 0;
+		*realcount = -row;
+		return TRUE;
+	}
+
+	line = textbuffer_heights_find_row(heights, target, &line_subline);
+	if (line == NULL)
+		return FALSE;
+
+	textbuffer_heights_rows_before(heights, line, &line_unknown);
+	if (scrollcount > 0) {
+		line_unknown += textbuffer_heights_get(heights, line) == LINE_HEIGHT_UNKNOWN;
+		if (line_unknown != unknown)
+			return FALSE;
+	} else {
+		if (unknown != line_unknown)
+			return FALSE;
+	}
+
+	*lines = line;
+	*subline = line_subline;
+	*realcount = target - row;
+	return TRUE;
+}
+
+/* lines: this pointer is scrolled by scrollcount screen lines
+   subline: this pointer contains the subline position
+   scrollcount: the number of lines to scroll down (negative: up)
+   draw_nonclean: whether to redraw the screen now
+
+   Returns number of lines actually scrolled */
+static int view_scroll(TEXT_BUFFER_VIEW_REC *view, LINE_REC **lines,
+		       int *subline, int scrollcount, int draw_nonclean)
+{
+	int realcount, scroll_visible;
+
+	if (*lines == NULL)
+		return 0;
+
+	scroll_visible = lines == &view->startline;
+	if (!view_scroll_far(view, lines, subline, scrollcount, scroll_visible,
+			     &realcount)) {
+		realcount = view_scroll_near(view, lines, subline, scrollcount,
+					     scroll_visible);
+	}
+
 	if (scroll_visible && realcount != 0 && view->window != NULL) {
 		if (realcount <= -view->height || realcount >= view->height) {
 			/* scrolled more than screenful, redraw the
@@ -954,9 +1145,11 @@ void textbuffer_view_resize(TEXT_BUFFER_VIEW_REC *view, int width, int height)
         g_return_if_fail(width > 0);
 
 	if (view->width != width) {
-                /* line cache needs to be recreated */
+                /* line cache needs to be recreated, the lines are
+		   wrapped again only when they're needed */
 		textbuffer_cache_unref(view->cache);
 		view->cache = textbuffer_cache_get(view->siblings, width);
+		view_reset_heights(view);
 	}
 
 	view->width = width > 10 ? width : 10;
@@ -970,8 +1163,8 @@ void textbuffer_view_resize(TEXT_BUFFER_VIEW_REC *view, int width, int height)
 	textbuffer_view_init_bottom(view);
 
 	/* check that we didn't scroll lower than bottom startline.. */
-	if (textbuffer_line_exists_after(view->bottom_startline->next,
-					 view->startline)) {
+	if (view_line_exists_after(view, view->bottom_startline->next,
+				   view->startline)) {
 		view->startline = view->bottom_startline;
                 view->subline = view->bottom_subline;
 	} else if (view->startline == view->bottom_startline &&
@@ -1003,7 +1196,7 @@ void textbuffer_view_resize(TEXT_BUFFER_VIEW_REC *view, int width, int height)
 	view->bottom = view_is_bottom(view);
 	if (view->bottom) {
 		/* check if we left empty space at the bottom.. */
-		linecount = view_get_linecount_all(view, view->startline) -
+		linecount = view_get_lines_height_after(view, view->startline, NULL) -
 			view->subline;
                 if (view->empty_linecount < view->height-linecount)
 			view->empty_linecount = view->height-linecount;
@@ -1041,8 +1234,7 @@ void textbuffer_view_scroll(TEXT_BUFFER_VIEW_REC *view, int lines)
 	count = view_scroll(view, &view->startline, &view->subline, lines, TRUE);
 
 	ypos = view->ypos + (lines < 0 ? count : -count);
-	textbuffer_view_init_ypos(view);
-	if (ypos != view->ypos)
+	if (textbuffer_view_init_ypos(view) && ypos != view->ypos)
 		textbuffer_view_resize(view, view->width, view->height);
 
 	view->bottom = view_is_bottom(view);
@@ -1057,7 +1249,7 @@ void textbuffer_view_scroll_line(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line)
 {
         g_return_if_fail(view != NULL);
 
-	if (textbuffer_line_exists_after(view->bottom_startline->next, line)) {
+	if (view_line_exists_after(view, view->bottom_startline->next, line)) {
 		view->startline = view->bottom_startline;
 		view->subline = view->bottom_subline;
 	} else {
@@ -1103,7 +1295,7 @@ static void view_insert_line(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line)
 	}
 
 	if (view->buffer->cur_line != line &&
-	    !textbuffer_line_exists_after(view->bottom_startline, line))
+	    !view_line_exists_after(view, view->bottom_startline, line))
 		return;
 
 	linecount = view_get_linecount(view, line);
@@ -1167,12 +1359,14 @@ void textbuffer_view_insert_line(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line)
 
         update_counter = view->cache->update_counter+1;
 	view_update_cache(view, line, update_counter);
+	view_heights_insert_line(view, line);
         view_insert_line(view, line);
 
 	for (tmp = view->siblings; tmp != NULL; tmp = tmp->next) {
 		TEXT_BUFFER_VIEW_REC *rec = tmp->data;
 
                 view_update_cache(rec, line, update_counter);
+		view_heights_insert_line(rec, line);
 		view_insert_line(rec, line);
 	}
 }
@@ -1253,10 +1447,8 @@ static void view_remove_line_update_startline(TEXT_BUFFER_VIEW_REC *view,
 		}
 	}
 
-	/* FIXME: this is slow and unnecessary, but it's easy and
-	   really works :) */
 	textbuffer_view_init_ypos(view);
-	if (textbuffer_line_exists_after(view->startline, line))
+	if (view_line_exists_after(view, view->startline, line))
 		view->ypos -= linecount;
 }
 
@@ -1305,8 +1497,7 @@ static void view_remove_line(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line,
 			view->subline = 0;
 		}
 	} else {
-		if (textbuffer_line_exists_after(view->bottom_startline,
-						 line)) {
+		if (view_line_exists_after(view, view->bottom_startline, line)) {
 			realcount = view_scroll(view, &view->bottom_startline,
 						&view->bottom_subline,
 						-linecount, FALSE);
@@ -1318,8 +1509,7 @@ static void view_remove_line(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line,
 			view->bottom_subline = 0;
 		}
 
-		if (textbuffer_line_exists_after(view->startline,
-						 line)) {
+		if (view_line_exists_after(view, view->startline, line)) {
 			view_remove_line_update_startline(view, line,
 							  linecount);
 		}
@@ -1348,12 +1538,14 @@ void textbuffer_view_remove_line(TEXT_BUFFER_VIEW_REC *view, LINE_REC *line)
 
         view_remove_line(view, line, linecount);
 	view_remove_cache(view, line, update_counter);
+	textbuffer_heights_remove(view->heights, line);
 
 	for (tmp = view->siblings; tmp != NULL; tmp = tmp->next) {
 		TEXT_BUFFER_VIEW_REC *rec = tmp->data;
 
 		view_remove_line(rec, line, linecount);
 		view_remove_cache(rec, line, update_counter);
+		textbuffer_heights_remove(rec->heights, line);
 	}
 
 	textbuffer_remove(view->buffer, line);
@@ -1385,8 +1577,16 @@ void textbuffer_view_remove_lines_by_level(TEXT_BUFFER_VIEW_REC *view, int level
 /* Remove all lines from buffer. */
 void textbuffer_view_remove_all_lines(TEXT_BUFFER_VIEW_REC *view)
 {
+	GSList *tmp;
+
 	g_return_if_fail(view != NULL);
 
+	textbuffer_heights_clear(view->heights);
+	for (tmp = view->siblings; tmp != NULL; tmp = tmp->next) {
+		TEXT_BUFFER_VIEW_REC *rec = tmp->data;
+
+		textbuffer_heights_clear(rec->heights);
+	}
 	textbuffer_remove_all_lines(view->buffer);
 
 	g_hash_table_foreach(view->bookmarks, (GHFunc) g_free, NULL);
@@ -1467,6 +1667,7 @@ void textbuffer_view_set_hidden_level(TEXT_BUFFER_VIEW_REC *view, int level)
 		} else {
 			view->hidden_level = level;
 		}
+		view_reset_heights(view);
 		textbuffer_view_resize(view, view->width, view->height);
 	}
 }
@@ -58,6 +58,8 @@ struct _TEXT_BUFFER_VIEW_REC {
         INDENT_FUNC default_indent_func;
 
 	TEXT_BUFFER_CACHE_REC *cache;
+	/* wrapped height of each line, see textbuffer-heights.c */
+	struct _TEXT_BUFFER_HEIGHTS_REC *heights;
 	/* cursor position - visible area is 0..height-1 */
 	int ypos;
 
@@ -27,10 +27,22 @@
 #include <irssi/src/core/iregex.h>
 
 #include <irssi/src/fe-ansi/textbuffer-formats.h>
+#include <irssi/src/fe-ansi/textbuffer-search.h>
 #include <irssi/src/fe-ansi/textbuffer.h>
 
 #define TEXT_CHUNK_USABLE_SIZE (LINE_TEXT_CHUNK_SIZE-2-(int)sizeof(char*))
 
+/* alignment of the records stored in text chunks */
+#define TEXT_CHUNK_ALIGN 8
+#define TEXT_CHUNK_ALIGN_SIZE(size) \
+	(((size) + TEXT_CHUNK_ALIGN - 1) & ~(TEXT_CHUNK_ALIGN - 1))
+
+static void text_chunk_unref(TEXT_CHUNK_REC *chunk)
+{
+	if (--chunk->refcount == 0)
+		g_free(chunk);
+}
+
 TEXT_BUFFER_REC *textbuffer_create(WINDOW_REC *window)
 {
 	TEXT_BUFFER_REC *buffer;
@@ -51,6 +63,9 @@ void textbuffer_destroy(TEXT_BUFFER_REC *buffer)
 	g_return_if_fail(buffer != NULL);
 
 	textbuffer_remove_all_lines(buffer);
+	textbuffer_search_destroy(buffer);
+	if (buffer->cur_chunk != NULL)
+		text_chunk_unref(buffer->cur_chunk);
 	g_string_free(buffer->cur_text, TRUE);
 	for (tmp = buffer->cur_info; tmp != NULL; tmp = tmp->next) {
 		LINE_INFO_REC *info = buffer->cur_info->data;
@@ -70,6 +85,134 @@ void textbuffer_line_info_free1(LINE_INFO_REC *info)
 	g_free(info->text);
 }
 
+/* Allocate `size' bytes from the buffer's current text chunk, starting a
+   new chunk when it's full. Returns the memory and the chunk it was
+   allocated from in `chunk_r', which gets a new reference. */
+static void *text_chunk_alloc(TEXT_BUFFER_REC *buffer, int size,
+			      TEXT_CHUNK_REC **chunk_r)
+{
+	TEXT_CHUNK_REC *chunk;
+	void *ptr;
+
+	size = TEXT_CHUNK_ALIGN_SIZE(size);
+	if (size > LINE_TEXT_CHUNK_MAX_ALLOC) {
+		/* too large to share - put it to its own chunk */
+		chunk = g_malloc(G_STRUCT_OFFSET(TEXT_CHUNK_REC, buffer) + size);
+		chunk->pos = size;
+		chunk->refcount = 1;
+		*chunk_r = chunk;
+		return chunk->buffer;
+	}
+
+	chunk = buffer->cur_chunk;
+	if (chunk == NULL || chunk->pos + size > LINE_TEXT_CHUNK_SIZE) {
+		/* the buffer keeps a reference to the chunk it's filling */
+		if (chunk != NULL)
+			text_chunk_unref(chunk);
+		chunk = g_new(TEXT_CHUNK_REC, 1);
+		chunk->pos = 0;
+		chunk->refcount = 1;
+		buffer->cur_chunk = chunk;
+	}
+
+	ptr = chunk->buffer + chunk->pos;
+	chunk->pos += size;
+	chunk->refcount++;
+
+	*chunk_r = chunk;
+	return ptr;
+}
+
+/* Move the finished line's text or format record, its arguments and the
+   meta record to a text chunk, so that lines don't need a separate
+   allocation for each of them. */
+static void text_chunk_store_line(TEXT_BUFFER_REC *buffer, LINE_REC *line,
+				  const char *text)
+{
+	TEXT_BUFFER_FORMAT_REC *format, *old_format;
+	LINE_INFO_META_REC *meta;
+	unsigned char *ptr;
+	int n, size, textsize, metasize;
+
+	old_format = line->info.format;
+	if (old_format == LINE_INFO_FORMAT_SET)
+		old_format = NULL;
+
+	textsize = 0;
+	if (old_format != NULL) {
+		textsize = TEXT_CHUNK_ALIGN_SIZE(sizeof(TEXT_BUFFER_FORMAT_REC) +
+						 old_format->nargs * sizeof(char *));
+		for (n = 1; n < old_format->nargs; n++) {
+			if (old_format->args[n] != NULL)
+				textsize += strlen(old_format->args[n]) + 1;
+		}
+	} else if (text != NULL) {
+		textsize = strlen(text) + 1;
+	}
+
+	metasize = line->info.meta == NULL ? 0 :
+		TEXT_CHUNK_ALIGN_SIZE(sizeof(LINE_INFO_META_REC));
+
+	size = metasize + textsize;
+	if (size == 0)
+		return;
+
+	ptr = text_chunk_alloc(buffer, size, &line->chunk);
+
+	if (metasize > 0) {
+		meta = (LINE_INFO_META_REC *) ptr;
+		memcpy(meta, line->info.meta, sizeof(LINE_INFO_META_REC));
+		g_free(line->info.meta);
+		line->info.meta = meta;
+		ptr += metasize;
+	}
+
+	if (old_format != NULL) {
+		format = (TEXT_BUFFER_FORMAT_REC *) ptr;
+		memcpy(format, old_format, sizeof(TEXT_BUFFER_FORMAT_REC));
+		format->args = (char **) (format + 1);
+		ptr = (unsigned char *) format +
+			TEXT_CHUNK_ALIGN_SIZE(sizeof(TEXT_BUFFER_FORMAT_REC) +
+					      format->nargs * sizeof(char *));
+
+		/* the first argument and the other strings are shared
+		   strings, only the ownership moves */
+		for (n = 0; n < format->nargs; n++) {
+			if (n == 0 || old_format->args[n] == NULL) {
+				format->args[n] = old_format->args[n];
+				continue;
+			}
+
+			size = strlen(old_format->args[n]) + 1;
+			memcpy(ptr, old_format->args[n], size);
+			format->args[n] = (char *) ptr;
+			ptr += size;
+			g_free(old_format->args[n]);
+		}
+
+		g_free(old_format->args);
+		g_slice_free(TEXT_BUFFER_FORMAT_REC, old_format);
+		line->info.format = format;
+	} else if (textsize > 0) {
+		memcpy(ptr, text, textsize);
+		line->info.text = (char *) ptr;
+	}
+}
+
+/* free line and everything it references */
+static void textbuffer_line_free(LINE_REC *line)
+{
+	if (line->chunk == NULL)
+		textbuffer_line_info_free1(&line->info);
+	else {
+		/* the records are stored in the chunk */
+		textbuffer_format_rec_release(line->info.format);
+		textbuffer_meta_rec_release(line->info.meta);
+		text_chunk_unref(line->chunk);
+	}
+	g_slice_free(LINE_REC, line);
+}
+
 static void text_chunk_append(TEXT_BUFFER_REC *buffer,
 			      const unsigned char *data, int len)
 {
@@ -160,8 +303,13 @@ LINE_REC *textbuffer_insert(TEXT_BUFFER_REC *buffer, LINE_REC *insert_after,
 	g_return_val_if_fail(buffer != NULL, NULL);
 	g_return_val_if_fail(data != NULL, NULL);
 
-	line = !buffer->last_eol ? insert_after :
-		textbuffer_line_insert(buffer, insert_after);
+	if (!buffer->last_eol) {
+		/* the line's text changes, a cached search entry is stale */
+		line = insert_after;
+		textbuffer_search_remove_line(buffer, line);
+	} else {
+		line = textbuffer_line_insert(buffer, insert_after);
+	}
 
 	if (info != NULL)
 		memcpy(&line->info, info, sizeof(line->info));
@@ -173,8 +321,10 @@ LINE_REC *textbuffer_insert(TEXT_BUFFER_REC *buffer, LINE_REC *insert_after,
 
 	if (buffer->last_eol) {
 		if (!line->info.format) {
-			line->info.text = g_strdup(buffer->cur_text->str);
+			text_chunk_store_line(buffer, line, buffer->cur_text->str);
 			g_string_truncate(buffer->cur_text, 0);
+		} else {
+			text_chunk_store_line(buffer, line, NULL);
 		}
 
 		buffer->last_fg = -1;
@@ -204,8 +354,8 @@ void textbuffer_remove(TEXT_BUFFER_REC *buffer, LINE_REC *line)
         line->prev = line->next = NULL;
 
 	buffer->lines_count--;
-	textbuffer_line_info_free1(&line->info);
-	g_slice_free(LINE_REC, line);
+	textbuffer_search_remove_line(buffer, line);
+	textbuffer_line_free(line);
 }
 
 /* Removes all lines from buffer */
@@ -217,11 +367,11 @@ void textbuffer_remove_all_lines(TEXT_BUFFER_REC *buffer)
 
 	while (buffer->first_line != NULL) {
 		line = buffer->first_line->next;
-		textbuffer_line_info_free1(&buffer->first_line->info);
-		g_slice_free(LINE_REC, buffer->first_line);
+		textbuffer_line_free(buffer->first_line);
 		buffer->first_line = line;
 	}
 	buffer->lines_count = 0;
+	textbuffer_search_reset(buffer);
 
         buffer->cur_line = NULL;
 	g_string_truncate(buffer->cur_text, 0);
@@ -261,7 +411,8 @@ GList *textbuffer_find_text(TEXT_BUFFER_REC *buffer, LINE_REC *startline,
 	Regex *preg;
         LINE_REC *line, *pre_line;
 	GList *matches;
-	GString *str;
+	TEXT_SEARCH_SIG_REC sig;
+	const char *str;
         int i, match_after, line_matched;
 	char * (*match_func)(const char *, const char *);
 
@@ -275,10 +426,12 @@ GList *textbuffer_find_text(TEXT_BUFFER_REC *buffer, LINE_REC *startline,
 
 		if (preg == NULL)
 			return NULL;
+	} else {
+		/* only lines with all the trigrams of the text can match */
+		textbuffer_search_signature(text, &sig);
 	}
 
 	matches = NULL; match_after = 0;
-        str = g_string_new(NULL);
 
 	line = startline != NULL ? startline : buffer->first_line;
 
@@ -291,13 +444,15 @@ GList *textbuffer_find_text(TEXT_BUFFER_REC *buffer, LINE_REC *startline,
 		line_matched = (line->info.level & level) != 0 &&
 			(line->info.level & nolevel) == 0;
 
-		if (*text != '\0') {
-			textbuffer_line2text(buffer, line, 0, str);
-
-			if (line_matched) {
+		if (line_matched && *text != '\0') {
+			str = textbuffer_search_line_text(buffer, line,
+							  regexp ? NULL : &sig);
+			if (str == NULL)
+				line_matched = FALSE;
+			else {
 				line_matched = regexp ?
-					i_regex_match(preg, str->str, 0, NULL)
-					: match_func(str->str, text) != NULL;
+					i_regex_match(preg, str, 0, NULL)
+					: match_func(str, text) != NULL;
 			}
 		}
 
@@ -306,8 +461,9 @@ GList *textbuffer_find_text(TEXT_BUFFER_REC *buffer, LINE_REC *startline,
 			pre_line = line;
 			for (i = 0; i < before; i++) {
 				if (pre_line->prev == NULL ||
-				    g_list_nth_data(matches, 0) == pre_line->prev ||
-				    g_list_nth_data(matches, 1) == pre_line->prev)
+				    (matches != NULL && matches->data == pre_line->prev) ||
+				    (matches != NULL && matches->next != NULL &&
+				     matches->next->data == pre_line->prev))
 					break;
                                 pre_line = pre_line->prev;
 			}
@@ -332,14 +488,15 @@ GList *textbuffer_find_text(TEXT_BUFFER_REC *buffer, LINE_REC *startline,
 
 	if (preg != NULL)
 		i_regex_unref(preg);
-        g_string_free(str, TRUE);
 	return matches;
 }
 
 void textbuffer_init(void)
 {
+	textbuffer_search_init();
 }
 
 void textbuffer_deinit(void)
 {
+	textbuffer_search_deinit();
 }
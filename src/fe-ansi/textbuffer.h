@@ -4,6 +4,8 @@
 /* Make sure TEXT_CHUNK_REC is not slightly more than a page, as that
    wastes a lot of memory. */
 #define LINE_TEXT_CHUNK_SIZE (16384 - 16)
+/* Lines needing more than this get a chunk of their own */
+#define LINE_TEXT_CHUNK_MAX_ALLOC (LINE_TEXT_CHUNK_SIZE / 4)
 
 #define LINE_INFO_FORMAT_SET (void *) 0x1
 
@@ -28,6 +30,15 @@ typedef struct {
 	struct _TEXT_BUFFER_FORMAT_REC *format;
 } LINE_INFO_REC;
 
+/* Storage for the text and format records of the lines in a buffer.
+   Each line holds a reference to the chunk its data is in, and the chunk
+   is freed once all of its lines have been removed. */
+typedef struct {
+	int pos;
+	int refcount;
+	unsigned char buffer[LINE_TEXT_CHUNK_SIZE];
+} TEXT_CHUNK_REC;
+
 typedef struct _LINE_REC {
 	struct _LINE_REC *prev, *next;
 	/* Text in the line. \0 means that the next char will be a
@@ -44,13 +55,11 @@ typedef struct _LINE_REC {
 	   DO NOT ADD BLACK WITH \0\0 - this will break things. Use
 	   LINE_CMD_COLOR0 instead. */
         LINE_INFO_REC info;
-} LINE_REC;
 
-typedef struct {
-	unsigned char buffer[LINE_TEXT_CHUNK_SIZE];
-	int pos;
-	int refcount;
-} TEXT_CHUNK_REC;
+	/* chunk where info.text or info.format (with its arguments) and
+	   info.meta are stored, NULL until the line is finished */
+	TEXT_CHUNK_REC *chunk;
+} LINE_REC;
 
 typedef struct {
 	WINDOW_REC *window;
@@ -61,6 +70,8 @@ typedef struct {
 	LINE_REC *cur_line;
 	GString *cur_text;
 	GSList *cur_info;
+	TEXT_CHUNK_REC *cur_chunk; /* chunk new lines are stored to */
+	struct _TEXT_BUFFER_SEARCH_REC *search; /* search cache, see textbuffer-search.c */
 
 	int last_fg;
 	int last_bg;
@@ -474,12 +474,10 @@ void fe_channels_nicklist(CHANNEL_REC *channel, int flags)
 	NICK_REC *nick;
 	GSList *tmp, *nicklist, *sorted;
 	int nicks, normal, voices, halfops, ops;
-	const char *nick_flags;
 
 	nicks = normal = voices = halfops = ops = 0;
-	nicklist = nicklist_getnicks(channel);
+	nicklist = nicklist_get_sorted(channel, 0, -1);
 	sorted = NULL;
-	nick_flags = channel->server->get_nick_flags(channel->server);
 
 	/* filter (for flags) and count ops, halfops, voices */
 	for (tmp = nicklist; tmp != NULL; tmp = tmp->next) {
@@ -507,9 +505,7 @@ void fe_channels_nicklist(CHANNEL_REC *channel, int flags)
 		sorted = g_slist_prepend(sorted, nick);
 	}
 	g_slist_free(nicklist);
-
-	/* sort the nicklist */
-	sorted = g_slist_sort_with_data(sorted, (GCompareDataFunc) nicklist_compare, (void *)nick_flags);
+	sorted = g_slist_reverse(sorted);
 
 	/* display the nicks */
         if ((flags & CHANNEL_NICKLIST_FLAG_COUNT) == 0) {
@@ -39,6 +39,30 @@ static char *current_nick = NULL;
 static char *current_mode = NULL;
 static gboolean nick_context_valid = FALSE;
 
+/* Nick column settings are read for every printed line. They're registered
+   by fe-messages after we're initialized, so look them up on first use. */
+static SETTINGS_REC *set_nick_column_enabled, *set_nick_column_width;
+static SETTINGS_REC *set_nick_hash_color_enabled, *set_nick_hash_colors;
+static SETTINGS_REC *set_nick_hash_reset_event;
+
+static SETTINGS_REC *nick_setting(SETTINGS_REC **rec, const char *key)
+{
+	if (*rec == NULL)
+		*rec = settings_get_record(key);
+	return *rec;
+}
+
+#define setting_nick_column_enabled() \
+	settings_rec_get_bool(nick_setting(&set_nick_column_enabled, "nick_column_enabled"))
+#define setting_nick_column_width() \
+	settings_rec_get_int(nick_setting(&set_nick_column_width, "nick_column_width"))
+#define setting_nick_hash_color_enabled() \
+	settings_rec_get_bool(nick_setting(&set_nick_hash_color_enabled, "nick_hash_color_enabled"))
+#define setting_nick_hash_colors() \
+	settings_rec_get_str(nick_setting(&set_nick_hash_colors, "nick_hash_colors"))
+#define setting_nick_hash_reset_event() \
+	settings_rec_get_str(nick_setting(&set_nick_hash_reset_event, "nick_hash_reset_event"))
+
 /* Hash-based nick coloring system */
 typedef struct {
 	char *nick;
@@ -102,7 +126,7 @@ static char *expando_nickalign(SERVER_REC *server, void *item, int *free_ret)
 	const char *mode;
 
 	/* Gdy wyłączone - zwróć pusty string */
-	if (!settings_get_bool("nick_column_enabled")) {
+	if (!setting_nick_column_enabled()) {
 		return "";
 	}
 
@@ -110,7 +134,7 @@ static char *expando_nickalign(SERVER_REC *server, void *item, int *free_ret)
 		return "";
 	}
 
-	width = settings_get_int("nick_column_width");
+	width = setting_nick_column_width();
 	mode = current_mode ? current_mode : "";
 
 	/* Zawsze 1 miejsce na mode (nawet spacja) */
@@ -136,7 +160,7 @@ static char *expando_nicktrunc(SERVER_REC *server, void *item, int *free_ret)
 	char *result;
 
 	/* Gdy wyłączone - zwróć oryginalny nick */
-	if (!settings_get_bool("nick_column_enabled")) {
+	if (!setting_nick_column_enabled()) {
 		return current_nick ? current_nick : "";
 	}
 
@@ -144,7 +168,7 @@ static char *expando_nicktrunc(SERVER_REC *server, void *item, int *free_ret)
 		return current_nick ? current_nick : "";
 	}
 
-	width = settings_get_int("nick_column_width");
+	width = setting_nick_column_width();
 	mode = current_mode ? current_mode : "";
 
 	/* Zawsze 1 miejsce na mode (nawet spacja) */
@@ -283,7 +307,7 @@ static int get_persistent_nick_color(const char *nick, void *item, SERVER_REC *s
 	server_tag = server ? server->tag : "unknown";
 	
 	/* Parse color palette */
-	palette = parse_color_palette(settings_get_str("nick_hash_colors"), &palette_size);
+	palette = parse_color_palette(setting_nick_hash_colors(), &palette_size);
 	
 	/* Create channel key */
 	channel_key = g_strdup_printf("%s:%s", server_tag, channel);
@@ -336,12 +360,12 @@ static char *expando_nickcolored(SERVER_REC *server, void *item, int *free_ret)
 	char *result;
 	char *raw_format;
 	
-	if (!settings_get_bool("nick_hash_color_enabled") || !nick_context_valid || !current_nick) {
+	if (!setting_nick_hash_color_enabled() || !nick_context_valid || !current_nick) {
 		return "";
 	}
 	
 	/* Get nick to display - use nicktrunc if nick_column_enabled */
-	if (settings_get_bool("nick_column_enabled")) {
+	if (setting_nick_column_enabled()) {
 		int temp_free = FALSE;
 		display_nick = expando_nicktrunc(server, item, &temp_free);
 		/* Handle memory correctly - always make our own copy */
@@ -359,7 +383,7 @@ static char *expando_nickcolored(SERVER_REC *server, void *item, int *free_ret)
 	}
 	
 	/* Parse color palette */
-	palette = parse_color_palette(settings_get_str("nick_hash_colors"), &palette_size);
+	palette = parse_color_palette(setting_nick_hash_colors(), &palette_size);
 	
 	/* Get persistent color index for this nick */
 	color_index = get_persistent_nick_color(current_nick, item, server);
@@ -381,7 +405,7 @@ static gboolean should_reset_on_event(const char *event)
 {
 	const char *setting;
 	
-	setting = settings_get_str("nick_hash_reset_event");
+	setting = setting_nick_hash_reset_event();
 	if (!setting || !*setting)
 		setting = "quit";
 	
@@ -414,7 +438,7 @@ static void reset_nick_color(const char *server_tag, const char *channel, const
 	}
 	
 	/* Get palette and generate new color different from current */
-	palette = parse_color_palette(settings_get_str("nick_hash_colors"), &palette_size);
+	palette = parse_color_palette(setting_nick_hash_colors(), &palette_size);
 	old_color = entry->color_index;
 	new_color = generate_random_color_index(old_color, palette_size);
 	
@@ -439,7 +463,7 @@ static void reset_nick_on_server(const char *server_tag, const char *nick)
 		return;
 		
 	/* Get palette for color generation */
-	palette = parse_color_palette(settings_get_str("nick_hash_colors"), &palette_size);
+	palette = parse_color_palette(setting_nick_hash_colors(), &palette_size);
 	server_prefix = g_strdup_printf("%s:", server_tag);
 	
 	
@@ -55,6 +55,15 @@ void clear_nick_context(void);
 
 GHashTable *printnicks;
 
+/* settings checked for every message */
+static SETTINGS_REC *set_hilight_nick_matches, *set_hilight_nick_matches_everywhere;
+static SETTINGS_REC *set_emphasis, *set_emphasis_replace, *set_emphasis_multiword;
+static SETTINGS_REC *set_emphasis_italics, *set_show_nickmode, *set_show_nickmode_empty;
+static SETTINGS_REC *set_print_active_channel, *set_show_quit_once;
+static SETTINGS_REC *set_show_own_nickchange_once, *set_away_notify_public;
+static SETTINGS_REC *set_show_extended_join, *set_show_account_notify;
+static SETTINGS_REC *set_nick_column_enabled;
+
 /* convert _underlined_, /italics/, and *bold* words (and phrases) to use real
    underlining or bolding */
 char *expand_emphasis(WI_ITEM_REC *item, const char *text)
@@ -66,7 +75,7 @@ char *expand_emphasis(WI_ITEM_REC *item, const char *text)
 
 	g_return_val_if_fail(text != NULL, NULL);
 
-	emphasis_italics = settings_get_bool("emphasis_italics");
+	emphasis_italics = settings_rec_get_bool(set_emphasis_italics);
 
 	str = g_string_new(text);
 
@@ -126,7 +135,7 @@ char *expand_emphasis(WI_ITEM_REC *item, const char *text)
 		}
 
 		/* allow only *word* emphasis, not *multiple words* */
-		if (!settings_get_bool("emphasis_multiword")) {
+		if (!settings_rec_get_bool(set_emphasis_multiword)) {
 			char *c;
 			for (c = bgn + 1; c != end; c++) {
 				if (!ishighalnum(*c))
@@ -136,7 +145,7 @@ char *expand_emphasis(WI_ITEM_REC *item, const char *text)
 				continue;
 		}
 
-		if (settings_get_bool("emphasis_replace")) {
+		if (settings_rec_get_bool(set_emphasis_replace)) {
 			*bgn = *end = type;
 			pos += (end - bgn);
 		} else {
@@ -155,10 +164,10 @@ static char *channel_get_nickmode_rec(NICK_REC *nickrec)
 	char *emptystr;
 	char *nickmode;
 
-	if (!settings_get_bool("show_nickmode"))
+	if (!settings_rec_get_bool(set_show_nickmode))
 		return g_strdup("");
 
-	emptystr = settings_get_bool("show_nickmode_empty") ? " " : "";
+	emptystr = settings_rec_get_bool(set_show_nickmode_empty) ? " " : "";
 
 	if (nickrec == NULL || nickrec->prefixes[0] == '\0')
 		nickmode = g_strdup(emptystr);
@@ -193,9 +202,9 @@ static void sig_message_public(SERVER_REC *server, const char *msg, const char *
 	if (nickrec == NULL && chanrec != NULL)
 		nickrec = nicklist_find(chanrec, nick);
 
-	for_me = !settings_get_bool("hilight_nick_matches") ?
+	for_me = !settings_rec_get_bool(set_hilight_nick_matches) ?
 	             FALSE :
-	         !settings_get_bool("hilight_nick_matches_everywhere") ?
+	         !settings_rec_get_bool(set_hilight_nick_matches_everywhere) ?
 	             nick_match_msg(chanrec, msg, server->nick) :
 	             nick_match_msg_everywhere(chanrec, msg, server->nick);
 	hilight =
@@ -203,7 +212,7 @@ static void sig_message_public(SERVER_REC *server, const char *msg, const char *
 	color = (hilight == NULL) ? NULL : hilight_get_color(hilight);
 
 	print_channel = chanrec == NULL || !window_item_is_active((WI_ITEM_REC *) chanrec);
-	if (!print_channel && settings_get_bool("print_active_channel") &&
+	if (!print_channel && settings_rec_get_bool(set_print_active_channel) &&
 	    window_item_window((WI_ITEM_REC *) chanrec)->items->next != NULL)
 		print_channel = TRUE;
 
@@ -218,7 +227,7 @@ static void sig_message_public(SERVER_REC *server, const char *msg, const char *
 		level &= ~MSGLEVEL_HILIGHT;
 	}
 
-	if (settings_get_bool("emphasis"))
+	if (settings_rec_get_bool(set_emphasis))
 		msg = freemsg = expand_emphasis((WI_ITEM_REC *) chanrec, msg);
 
 	/* get nick mode & nick what to print the msg with
@@ -229,7 +238,7 @@ static void sig_message_public(SERVER_REC *server, const char *msg, const char *
 		printnick = nick;
 
 	/* Update nick context for expandos */
-	if (settings_get_bool("nick_column_enabled")) {
+	if (settings_rec_get_bool(set_nick_column_enabled)) {
 		update_nick_context(printnick, nickmode);
 	}
 
@@ -271,7 +280,7 @@ static void sig_message_private(SERVER_REC *server, const char *msg, const char
 
 	query = query_find(server, own ? target : nick);
 
-	if (settings_get_bool("emphasis"))
+	if (settings_rec_get_bool(set_emphasis))
 		msg = freemsg = expand_emphasis((WI_ITEM_REC *) query, msg);
 
 	ignore_check_plus(server, nick, address, NULL, msg, &level, FALSE);
@@ -303,7 +312,7 @@ static void sig_message_own_public(SERVER_REC *server, const char *msg, const ch
 	nickmode = channel_get_nickmode(channel, server->nick);
 
 	/* Update nick context for expandos */
-	if (settings_get_bool("nick_column_enabled")) {
+	if (settings_rec_get_bool(set_nick_column_enabled)) {
 		update_nick_context(server->nick, nickmode);
 	}
 
@@ -311,11 +320,11 @@ static void sig_message_own_public(SERVER_REC *server, const char *msg, const ch
 
 	print_channel = window == NULL || window->active != (WI_ITEM_REC *) channel;
 
-	if (!print_channel && settings_get_bool("print_active_channel") && window != NULL &&
+	if (!print_channel && settings_rec_get_bool(set_print_active_channel) && window != NULL &&
 	    g_slist_length(window->items) > 1)
 		print_channel = TRUE;
 
-	if (settings_get_bool("emphasis"))
+	if (settings_rec_get_bool(set_emphasis))
 		msg = freemsg = expand_emphasis((WI_ITEM_REC *) channel, msg);
 
 	if (!print_channel) {
@@ -353,7 +362,7 @@ static void sig_message_own_private(SERVER_REC *server, const char *msg, const c
 
 	query = privmsg_get_query(server, target, TRUE, MSGLEVEL_MSGS);
 
-	if (settings_get_bool("emphasis"))
+	if (settings_rec_get_bool(set_emphasis))
 		msg = freemsg = expand_emphasis((WI_ITEM_REC *) query, msg);
 
 	printformat(server, target, MSGLEVEL_MSGS | MSGLEVEL_NOHILIGHT | MSGLEVEL_NO_ACT,
@@ -370,7 +379,7 @@ static void sig_message_join(SERVER_REC *server, const char *channel, const char
 
 	ignore_check_plus(server, nick, address, channel, NULL, &level, FALSE);
 
-	if (settings_get_bool("show_extended_join")) {
+	if (settings_rec_get_bool(set_show_extended_join)) {
 		int txt;
 		if (*account == '\0')
 			txt = TXT_JOIN;
@@ -469,7 +478,7 @@ static void spread_server_message_to_windows(SERVER_REC *server, gboolean once,
 static void sig_message_host_changed(SERVER_REC *server, const char *nick, const char *address,
                                      const char *old_address)
 {
-	spread_server_message_to_windows(server, settings_get_bool("show_quit_once"), TRUE,
+	spread_server_message_to_windows(server, settings_rec_get_bool(set_show_quit_once), TRUE,
 	                                 MSGLEVEL_JOINS, TXT_HOST_CHANGED, TXT_HOST_CHANGED, nick,
 	                                 address, old_address, NULL);
 }
@@ -480,13 +489,13 @@ static void sig_message_account_changed(SERVER_REC *server, const char *nick, co
 	gboolean logged_in;
 	int txt;
 
-	if (!settings_get_bool("show_account_notify"))
+	if (!settings_rec_get_bool(set_show_account_notify))
 		return;
 
 	logged_in = g_strcmp0("*", account) != 0;
 	txt = logged_in ? TXT_LOGGED_IN : TXT_LOGGED_OUT;
 
-	spread_server_message_to_windows(server, settings_get_bool("show_quit_once"), TRUE,
+	spread_server_message_to_windows(server, settings_rec_get_bool(set_show_quit_once), TRUE,
 	                                 MSGLEVEL_MODES, txt, txt, nick, address, account,
 	                                 "account");
 }
@@ -494,7 +503,7 @@ static void sig_message_account_changed(SERVER_REC *server, const char *nick, co
 static void sig_message_quit(SERVER_REC *server, const char *nick, const char *address,
                              const char *reason)
 {
-	spread_server_message_to_windows(server, settings_get_bool("show_quit_once"), TRUE,
+	spread_server_message_to_windows(server, settings_rec_get_bool(set_show_quit_once), TRUE,
 	                                 MSGLEVEL_QUITS, TXT_QUIT, TXT_QUIT_ONCE, nick, address,
 	                                 reason, reason);
 }
@@ -566,7 +575,7 @@ static void sig_message_nick(SERVER_REC *server, const char *newnick, const char
 static void sig_message_own_nick(SERVER_REC *server, const char *newnick, const char *oldnick,
                                  const char *address)
 {
-	if (!settings_get_bool("show_own_nickchange_once"))
+	if (!settings_rec_get_bool(set_show_own_nickchange_once))
 		print_nick_change(server, newnick, oldnick, address, TRUE);
 	else {
 		printformat(server, NULL, MSGLEVEL_NICKS, TXT_YOUR_NICK_CHANGED, oldnick, newnick,
@@ -613,7 +622,7 @@ static void sig_message_away_notify(SERVER_REC *server, const char *nick, const
 {
 	int txt = *awaymsg == '\0' ? TXT_NOTIFY_UNAWAY_CHANNEL : TXT_NOTIFY_AWAY_CHANNEL;
 
-	if (!settings_get_bool("away_notify_public"))
+	if (!settings_rec_get_bool(set_away_notify_public))
 		return;
 
 	spread_server_message_to_windows(server, FALSE, FALSE, MSGLEVEL_CRAP, txt, txt, nick, addr,
@@ -777,6 +786,22 @@ void fe_messages_init(void)
 	settings_add_str("lookandfeel", "nick_hash_colors", "g r b m c y G C");
 	settings_add_str("lookandfeel", "nick_hash_reset_event", "quit part");
 
+	set_hilight_nick_matches = settings_get_record("hilight_nick_matches");
+	set_hilight_nick_matches_everywhere = settings_get_record("hilight_nick_matches_everywhere");
+	set_emphasis = settings_get_record("emphasis");
+	set_emphasis_replace = settings_get_record("emphasis_replace");
+	set_emphasis_multiword = settings_get_record("emphasis_multiword");
+	set_emphasis_italics = settings_get_record("emphasis_italics");
+	set_show_nickmode = settings_get_record("show_nickmode");
+	set_show_nickmode_empty = settings_get_record("show_nickmode_empty");
+	set_print_active_channel = settings_get_record("print_active_channel");
+	set_show_quit_once = settings_get_record("show_quit_once");
+	set_show_own_nickchange_once = settings_get_record("show_own_nickchange_once");
+	set_away_notify_public = settings_get_record("away_notify_public");
+	set_show_extended_join = settings_get_record("show_extended_join");
+	set_show_account_notify = settings_get_record("show_account_notify");
+	set_nick_column_enabled = settings_get_record("nick_column_enabled");
+
 	signal_add_last("message public", (SIGNAL_FUNC) sig_message_public);
 	signal_add_last("message private", (SIGNAL_FUNC) sig_message_private);
 	signal_add_last("message own_public", (SIGNAL_FUNC) sig_message_own_public);
@@ -51,6 +51,9 @@ static int nick_formatting_depth = 0;
 static int timestamp_level;
 static int timestamp_timeout;
 
+/* registered by fe-messages, which is initialized after us */
+static SETTINGS_REC *set_nick_column_enabled, *set_nick_hash_color_enabled;
+
 static GHashTable *global_meta;
 
 int format_find_tag(const char *module, const char *tag)
@@ -945,8 +948,14 @@ char *format_get_text_theme_charargs(THEME_REC *theme, const char *module, TEXT_
 	/* Apply nick formatting if enabled and this is a message format */
 	/* Additional protection: avoid recursion during timestamp formatting */
 	if (g_strcmp0(module, "fe-common/core") == 0 && is_message_format(formatnum) && nick_formatting_depth == 0) {
-		gboolean nick_column_enabled = settings_get_bool("nick_column_enabled");
-		gboolean nick_hash_enabled = settings_get_bool("nick_hash_color_enabled");
+		gboolean nick_column_enabled, nick_hash_enabled;
+
+		if (set_nick_column_enabled == NULL) {
+			set_nick_column_enabled = settings_get_record("nick_column_enabled");
+			set_nick_hash_color_enabled = settings_get_record("nick_hash_color_enabled");
+		}
+		nick_column_enabled = settings_rec_get_bool(set_nick_column_enabled);
+		nick_hash_enabled = settings_rec_get_bool(set_nick_hash_color_enabled);
 
 		if (nick_column_enabled || nick_hash_enabled) {
 			nick_formatting_depth++;
@@ -27,6 +27,7 @@
 #include <irssi/src/lib-config/iconfig.h>
 #include <irssi/src/core/settings.h>
 #include <irssi/src/core/iregex.h>
+#include <irssi/src/core/textmatch.h>
 
 #include <irssi/src/core/servers.h>
 #include <irssi/src/core/channels.h>
@@ -39,8 +40,49 @@
 
 static NICKMATCH_REC *nickmatch;
 static int never_hilight_level, default_hilight_level;
+static SETTINGS_REC *set_hilight_color, *set_hilight_act_color;
 GSList *hilights;
 
+/* The hilights as hilight_match() uses them: all plain text hilights are
+   searched at once, and the regexps are first tried as one alternation
+   before matching them one by one. Rebuilt when hilights change. */
+typedef struct {
+	HILIGHT_REC *rec;
+	int pos; /* position in hilights */
+	unsigned int scan; /* last search which handled this */
+	unsigned int batched:1; /* included in hilight_regexps */
+} HILIGHT_MATCH_REC;
+
+typedef struct {
+	SERVER_REC *server;
+	const char *channel;
+	int level;
+
+	HILIGHT_MATCH_REC *best;
+	int match_beg, match_end;
+} HILIGHT_SEARCH_REC;
+
+static HILIGHT_MATCH_REC *hilight_entries;
+static TEXTMATCH_REC *hilight_texts;
+static GPtrArray *hilight_others; /* entries not in hilight_texts */
+static Regex *hilight_regexps;
+static unsigned int hilight_scan;
+static int hilight_compiled;
+
+static void hilight_compile_free(void)
+{
+	if (hilight_texts != NULL) textmatch_destroy(hilight_texts);
+	if (hilight_others != NULL) g_ptr_array_free(hilight_others, TRUE);
+	if (hilight_regexps != NULL) i_regex_unref(hilight_regexps);
+	g_free(hilight_entries);
+
+	hilight_texts = NULL;
+	hilight_others = NULL;
+	hilight_regexps = NULL;
+	hilight_entries = NULL;
+	hilight_compiled = FALSE;
+}
+
 static void reset_level_cache(void)
 {
 	GSList *tmp;
@@ -56,6 +98,7 @@ static void reset_level_cache(void)
 
 static void reset_cache(void)
 {
+	hilight_compiled = FALSE;
 	reset_level_cache();
 	nickmatch_rebuild(nickmatch);
 }
@@ -113,6 +156,7 @@ static void hilight_destroy(HILIGHT_REC *rec)
 
 static void hilights_destroy_all(void)
 {
+	hilight_compile_free();
 	g_slist_foreach(hilights, (GFunc) hilight_destroy, NULL);
 	g_slist_free(hilights);
 	hilights = NULL;
@@ -137,6 +181,7 @@ void hilight_create(HILIGHT_REC *rec)
 	hilight_add_config(rec);
 
 	hilight_init_rec(rec);
+	hilight_compiled = FALSE;
 
 	signal_emit("hilight created", 1, rec);
 }
@@ -147,6 +192,7 @@ void hilight_remove(HILIGHT_REC *rec)
 
 	hilight_remove_config(rec);
 	hilights = g_slist_remove(hilights, rec);
+	hilight_compiled = FALSE;
 
 	signal_emit("hilight destroyed", 1, rec);
 	hilight_destroy(rec);
@@ -190,6 +236,92 @@ static HILIGHT_REC *hilight_find(const char *text, char **channels)
 	return NULL;
 }
 
+#define isbound(c) \
+	((unsigned char) (c) < 128 && \
+	(i_isspace(c) || i_ispunct(c)))
+
+/* Regexps referring to groups or changing how the rest of the pattern is
+   parsed can't be joined with others */
+static int hilight_regexp_can_batch(const char *text)
+{
+	const char *p;
+
+	if (strchr(text, '#') != NULL)
+		return FALSE; /* comment with (?x) */
+
+	for (p = text; *p != '\0'; p++) {
+		if (*p == '\\') {
+			if (p[1] == '\0')
+				break;
+			p++;
+			if (i_isdigit(*p) || strchr("gkQE", *p) != NULL)
+				return FALSE;
+		} else if (p[0] == '(' && p[1] == '?' && p[2] != '\0') {
+			if (i_isdigit(p[2]) || strchr("PR&+-|", p[2]) != NULL)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static void hilight_compile(void)
+{
+	HILIGHT_MATCH_REC *entry;
+	GString *regexps;
+	GSList *tmp;
+	int pos, batched;
+
+	hilight_compile_free();
+
+	hilight_entries = g_new0(HILIGHT_MATCH_REC, g_slist_length(hilights));
+	hilight_texts = textmatch_create(TRUE);
+	hilight_others = g_ptr_array_new();
+	regexps = g_string_new(NULL);
+	batched = 0;
+
+	entry = hilight_entries;
+	for (tmp = hilights, pos = 0; tmp != NULL; tmp = tmp->next, pos++) {
+		HILIGHT_REC *rec = tmp->data;
+
+		/* nick masks are handled by nickmatch, negative priorities
+		   never win */
+		if (rec->nickmask || rec->priority < 0 ||
+		    (rec->regexp && rec->preg == NULL))
+			continue;
+
+		entry->rec = rec;
+		entry->pos = pos;
+
+		if (!rec->regexp && *rec->text != '\0') {
+			textmatch_add(hilight_texts, rec->text, entry);
+		} else {
+			if (rec->regexp && hilight_regexp_can_batch(rec->text)) {
+				g_string_append_printf(regexps, "%s(?:%s)",
+						       batched == 0 ? "" : "|", rec->text);
+				entry->batched = TRUE;
+				batched++;
+			}
+			g_ptr_array_add(hilight_others, entry);
+		}
+		entry++;
+	}
+
+	if (batched > 1) {
+		hilight_regexps = i_regex_new(regexps->str, G_REGEX_OPTIMIZE | G_REGEX_CASELESS,
+					      0, NULL);
+	}
+	if (hilight_regexps == NULL) {
+		/* match them one by one */
+		for (pos = 0; pos < hilight_others->len; pos++) {
+			entry = g_ptr_array_index(hilight_others, pos);
+			entry->batched = FALSE;
+		}
+	}
+
+	g_string_free(regexps, TRUE);
+	hilight_compiled = TRUE;
+}
+
 static gboolean hilight_match_text(HILIGHT_REC *rec, const char *text,
 				  int *match_beg, int *match_end)
 {
@@ -236,19 +368,66 @@ static gboolean hilight_match_text(HILIGHT_REC *rec, const char *text,
 	((rec)->channels == NULL || ((channel) != NULL && \
 		strarray_find((rec)->channels, (channel)) != -1))
 
+/* entry would replace the best match so far: higher priority wins, then
+   the one earlier in the list */
+#define hilight_match_better(entry, best) \
+	((best) == NULL || (entry)->rec->priority > (best)->rec->priority || \
+	 ((entry)->rec->priority == (best)->rec->priority && (entry)->pos < (best)->pos))
+
+static int hilight_match_filters(HILIGHT_REC *rec, HILIGHT_SEARCH_REC *search)
+{
+	int level = search->level;
+
+	return hilight_match_level(rec, level) &&
+		hilight_match_channel(rec, search->channel) &&
+		(rec->servertag == NULL ||
+		 (search->server != NULL &&
+		  g_ascii_strcasecmp(rec->servertag, search->server->tag) == 0));
+}
+
+static int hilight_text_found(const char *text, int start, int end,
+			      HILIGHT_MATCH_REC *entry, HILIGHT_SEARCH_REC *search)
+{
+	HILIGHT_REC *rec = entry->rec;
+
+	if (entry->scan == hilight_scan)
+		return TRUE; /* already handled */
+
+	if (!hilight_match_better(entry, search->best) ||
+	    !hilight_match_filters(rec, search)) {
+		entry->scan = hilight_scan;
+		return TRUE;
+	}
+
+	/* the strings were searched case insensitively */
+	if (rec->case_sensitive && strncmp(text + start, rec->text, end - start) != 0)
+		return TRUE;
+
+	if (rec->fullword &&
+	    ((start > 0 && !isbound(text[start-1])) ||
+	     (text[end] != '\0' && !isbound(text[end]))))
+		return TRUE;
+
+	/* this was the first match for the hilight */
+	entry->scan = hilight_scan;
+	search->best = entry;
+	search->match_beg = start;
+	search->match_end = end;
+	return TRUE;
+}
+
 HILIGHT_REC *hilight_match(SERVER_REC *server, const char *channel,
 			   const char *nick, const char *address,
 			   int level, const char *str,
 			   int *match_beg, int *match_end)
 {
-	GSList *tmp;
+	HILIGHT_SEARCH_REC search;
+	HILIGHT_MATCH_REC *entry;
 	CHANNEL_REC *chanrec;
 	NICK_REC *nickrec;
-	HILIGHT_REC *tmprec;
-	int priority = -1;
+	int n, beg, end, batch_checked, batch_matched;
 
 	g_return_val_if_fail(str != NULL, NULL);
-	tmprec = NULL;
 
 	if ((never_hilight_level & level) == level)
 		return NULL;
@@ -270,20 +449,57 @@ HILIGHT_REC *hilight_match(SERVER_REC *server, const char *channel,
 		}
 	}
 
-	for (tmp = hilights; tmp != NULL; tmp = tmp->next) {
-		HILIGHT_REC *rec = tmp->data;
+	/* new entries have scan 0, so skip it when the counter wraps
+	   and rebuild the entries that may still have any other value */
+	if (++hilight_scan == 0) {
+		hilight_scan = 1;
+		hilight_compiled = FALSE;
+	}
+
+	if (!hilight_compiled)
+		hilight_compile();
 
-		if (rec->priority > priority && !rec->nickmask && hilight_match_level(rec, level) &&
-		    hilight_match_channel(rec, channel) &&
-		    (rec->servertag == NULL ||
-		     (server != NULL && g_ascii_strcasecmp(rec->servertag, server->tag) == 0)) &&
-		    hilight_match_text(rec, str, match_beg, match_end)) {
-			tmprec = rec;
-			priority = rec->priority;
+	memset(&search, 0, sizeof(search));
+	search.server = server;
+	search.channel = channel;
+	search.level = level;
+
+	textmatch_search(hilight_texts, str,
+			 (TEXTMATCH_FUNC) hilight_text_found, &search);
+
+	batch_checked = batch_matched = FALSE;
+	for (n = 0; n < hilight_others->len; n++) {
+		entry = g_ptr_array_index(hilight_others, n);
+
+		if (!hilight_match_better(entry, search.best) ||
+		    !hilight_match_filters(entry->rec, &search))
+			continue;
+
+		if (entry->batched) {
+			/* none of them can match if the alternation didn't */
+			if (!batch_checked) {
+				batch_matched = i_regex_match(hilight_regexps, str, 0, NULL);
+				batch_checked = TRUE;
+			}
+			if (!batch_matched)
+				continue;
+		}
+
+		if (hilight_match_text(entry->rec, str, &beg, &end)) {
+			search.best = entry;
+			search.match_beg = beg;
+			search.match_end = end;
 		}
 	}
 
-	return tmprec;
+	if (search.best == NULL)
+		return NULL;
+
+	if (match_beg != NULL && match_end != NULL) {
+		*match_beg = search.match_beg;
+		*match_end = search.match_end;
+	}
+	return search.best->rec;
 }
 
 static char *hilight_get_act_color(HILIGHT_REC *rec)
@@ -292,7 +508,7 @@ static char *hilight_get_act_color(HILIGHT_REC *rec)
 
 	return g_strdup(rec->act_color != NULL ? rec->act_color :
 			rec->color != NULL ? rec->color :
-			settings_get_str("hilight_act_color"));
+			settings_rec_get_str(set_hilight_act_color));
 }
 
 char *hilight_get_color(HILIGHT_REC *rec)
@@ -302,7 +518,7 @@ char *hilight_get_color(HILIGHT_REC *rec)
 	g_return_val_if_fail(rec != NULL, NULL);
 
 	color = rec->color != NULL ? rec->color :
-		settings_get_str("hilight_color");
+		settings_rec_get_str(set_hilight_color);
 
 	return format_string_expand(color, NULL);
 }
@@ -338,7 +554,7 @@ static void sig_render_line_text(TEXT_DEST_REC *dest, GString *str, LINE_INFO_ME
 		tmp = strip_codes(str->str);
 
 		color = format_string_expand(
-		    color != NULL ? color : settings_get_str("hilight_color"), NULL);
+		    color != NULL ? color : settings_rec_get_str(set_hilight_color), NULL);
 
 		g_string_truncate(str, 0);
 		g_string_append(str, color);
@@ -364,7 +580,7 @@ static void sig_render_line_text(TEXT_DEST_REC *dest, GString *str, LINE_INFO_ME
 
 		/* color */
 		color = format_string_expand(
-		    color != NULL ? color : settings_get_str("hilight_color"), NULL);
+		    color != NULL ? color : settings_rec_get_str(set_hilight_color), NULL);
 		g_string_append(str2, color);
 		g_free(color);
 
@@ -789,6 +1005,8 @@ void hilight_text_init(void)
 	settings_add_str("lookandfeel", "hilight_color", "%Y");
 	settings_add_str("lookandfeel", "hilight_act_color", "%M");
 	settings_add_level("lookandfeel", "hilight_level", "PUBLIC DCCMSGS");
+	set_hilight_color = settings_get_record("hilight_color");
+	set_hilight_act_color = settings_get_record("hilight_act_color");
 
 	read_settings();
 
@@ -40,6 +40,9 @@
 #include <irssi/src/fe-common/irc/fe-irc-channels.h>
 #include <irssi/src/fe-common/irc/fe-irc-server.h>
 
+static SETTINGS_REC *set_hilight_nick_matches, *set_hilight_nick_matches_everywhere;
+static SETTINGS_REC *set_emphasis, *set_notice_channel_context;
+
 static void sig_message_own_public(SERVER_REC *server, const char *msg,
 				   const char *target, const char *origtarget)
 {
@@ -94,8 +97,8 @@ static void sig_message_irc_op_public(SERVER_REC *server, const char *msg,
 	optarget = g_strconcat(prefix, cleantarget, NULL);
 
 	/* Check for hilights */
-	for_me = !settings_get_bool("hilight_nick_matches") ? FALSE :
-		!settings_get_bool("hilight_nick_matches_everywhere") ?
+	for_me = !settings_rec_get_bool(set_hilight_nick_matches) ? FALSE :
+		!settings_rec_get_bool(set_hilight_nick_matches_everywhere) ?
 		nick_match_msg(chanrec, msg, server->nick) :
 		nick_match_msg_everywhere(chanrec, msg, server->nick);
 	hilight = for_me ? NULL :
@@ -120,7 +123,7 @@ static void sig_message_irc_op_public(SERVER_REC *server, const char *msg,
 		level &= ~MSGLEVEL_HILIGHT;
 	}
 
-	if (settings_get_bool("emphasis"))
+	if (settings_rec_get_bool(set_emphasis))
 		msg = freemsg = expand_emphasis((WI_ITEM_REC *) chanrec, msg);
 
 	if (color != NULL) {
@@ -177,7 +180,7 @@ static void sig_message_own_action(IRC_SERVER_REC *server, const char *msg,
 	else
 		item = irc_query_find(server, target);
 
-	if (settings_get_bool("emphasis"))
+	if (settings_rec_get_bool(set_emphasis))
 		msg = freemsg = expand_emphasis(item, msg);
 
 	printformat(server, target,
@@ -214,7 +217,7 @@ static void sig_message_irc_action(IRC_SERVER_REC *server, const char *msg,
 		item = privmsg_get_query(SERVER(server), own ? target : nick, FALSE, level);
 	}
 
-	if (settings_get_bool("emphasis"))
+	if (settings_rec_get_bool(set_emphasis))
 		msg = freemsg = expand_emphasis(item, msg);
 
 	if (server_ischannel(SERVER(server), target)) {
@@ -250,7 +253,7 @@ static void sig_message_irc_action(IRC_SERVER_REC *server, const char *msg,
 
 static char *notice_channel_context(SERVER_REC *server, const char *msg)
 {
-	if (!settings_get_bool("notice_channel_context"))
+	if (!settings_rec_get_bool(set_notice_channel_context))
 		return NULL;
 
 	if (*msg == '[') {
@@ -362,6 +365,11 @@ void fe_irc_messages_init(void)
 {
 	settings_add_bool("misc", "notice_channel_context", TRUE);
 
+	set_hilight_nick_matches = settings_get_record("hilight_nick_matches");
+	set_hilight_nick_matches_everywhere = settings_get_record("hilight_nick_matches_everywhere");
+	set_emphasis = settings_get_record("emphasis");
+	set_notice_channel_context = settings_get_record("notice_channel_context");
+
         signal_add_last("message own_public", (SIGNAL_FUNC) sig_message_own_public);
         signal_add_last("message irc op_public", (SIGNAL_FUNC) sig_message_irc_op_public);
         signal_add_last("message irc own_wall", (SIGNAL_FUNC) sig_message_own_wall);
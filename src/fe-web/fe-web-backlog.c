@@ -0,0 +1,670 @@
+/*
+ fe-web-backlog.c : Persistent message backlog for fe-web clients
+
+    Copyright (C) 2025
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+*/
+
+/*
+ * Messages broadcast to web clients are appended to a segment file
+ * (~/.erssi/web-backlog) as the JSON the clients received, tagged with a
+ * global sequence number. Reconnecting clients ask for everything after
+ * the last sequence number they saw and get the missing messages replayed
+ * in pages, instead of only a state dump.
+ *
+ * The file is append-only and read through mmap(). Which records are
+ * still wanted is decided by an in-memory index rebuilt at startup: each
+ * target keeps a ring of its last fe_web_backlog_lines sequence numbers,
+ * older ones are dead. Once dead records take more than half of the file,
+ * the live ones are copied to a new segment which replaces the old one.
+ */
+
+#include "module.h"
+#include "fe-web.h"
+
+#include <irssi/src/core/settings.h>
+#include <irssi/src/core/levels.h>
+#include <irssi/src/fe-common/core/printtext.h>
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BACKLOG_FILE_NAME "web-backlog"
+#define BACKLOG_FILE_MAGIC "ERSSIWB1"
+#define BACKLOG_FILE_HEADER_SIZE 8
+#define BACKLOG_RECORD_MAGIC 0x4c4b4257 /* "WBKL" */
+
+/* Don't bother compacting small files */
+#define BACKLOG_COMPACT_MIN_SIZE (4 * 1024 * 1024)
+
+/* Largest page a client can request at once */
+#define BACKLOG_MAX_PAGE 500
+
+/* On-disk record header, followed by the target key, the JSON message
+   and padding to 8 bytes */
+typedef struct {
+	guint32 magic;
+	guint32 json_len;
+	guint64 seq;
+	guint16 key_len;
+	guint16 type;
+	guint32 reserved;
+} BACKLOG_RECORD_HEADER;
+
+typedef struct {
+	char *key; /* "servertag target", target lowercased */
+	int server_len;
+
+	/* Ring of sequence numbers of stored messages, oldest first */
+	guint64 *seqs;
+	int head;
+	int count;
+	int alloc;
+} BACKLOG_TARGET_REC;
+
+typedef struct {
+	guint64 seq;
+	guint64 offset;
+	guint32 size;
+	BACKLOG_TARGET_REC *target; /* NULL if the record is dead */
+} BACKLOG_ENTRY_REC;
+
+static int backlog_fd = -1;
+static guint64 backlog_size; /* end of the last valid record */
+static guchar *backlog_map;
+static gsize backlog_map_len;
+
+static GHashTable *backlog_targets; /* key -> BACKLOG_TARGET_REC */
+static GArray *backlog_entries;     /* BACKLOG_ENTRY_REC, ordered by seq */
+static guint64 backlog_next_seq;
+static guint64 backlog_dead_size;
+static int backlog_lines;
+
+static gsize record_size(gsize key_len, gsize json_len)
+{
+	return (sizeof(BACKLOG_RECORD_HEADER) + key_len + json_len + 7) & ~(gsize) 7;
+}
+
+static char *backlog_key(const char *server_tag, const char *target)
+{
+	char *key, *p;
+
+	key = g_strconcat(server_tag, " ", target, NULL);
+	for (p = key + strlen(server_tag) + 1; *p != '\0'; p++) {
+		*p = g_ascii_tolower(*p);
+	}
+	return key;
+}
+
+static void target_free(BACKLOG_TARGET_REC *target)
+{
+	g_free(target->key);
+	g_free(target->seqs);
+	g_free(target);
+}
+
+static BACKLOG_TARGET_REC *target_get(const char *key, gsize key_len)
+{
+	BACKLOG_TARGET_REC *target;
+	char *tmp;
+
+	tmp = g_strndup(key, key_len);
+	target = g_hash_table_lookup(backlog_targets, tmp);
+	if (target != NULL) {
+		g_free(tmp);
+		return target;
+	}
+
+	target = g_new0(BACKLOG_TARGET_REC, 1);
+	target->key = tmp;
+	target->server_len = strchr(tmp, ' ') != NULL ? strchr(tmp, ' ') - tmp : key_len;
+	g_hash_table_insert(backlog_targets, target->key, target);
+	return target;
+}
+
+static guint64 target_seq(BACKLOG_TARGET_REC *target, int index)
+{
+	return target->seqs[(target->head + index) % target->alloc];
+}
+
+/* Find index of the first entry with seq > since */
+static guint entries_find_after(guint64 since)
+{
+	guint low, high, mid;
+
+	low = 0;
+	high = backlog_entries->len;
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (g_array_index(backlog_entries, BACKLOG_ENTRY_REC, mid).seq <= since) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+static BACKLOG_ENTRY_REC *entry_find(guint64 seq)
+{
+	guint pos;
+
+	pos = entries_find_after(seq - 1);
+	if (pos >= backlog_entries->len ||
+	    g_array_index(backlog_entries, BACKLOG_ENTRY_REC, pos).seq != seq) {
+		return NULL;
+	}
+	return &g_array_index(backlog_entries, BACKLOG_ENTRY_REC, pos);
+}
+
+static void entry_kill(guint64 seq)
+{
+	BACKLOG_ENTRY_REC *entry;
+
+	entry = entry_find(seq);
+	if (entry != NULL && entry->target != NULL) {
+		entry->target = NULL;
+		backlog_dead_size += entry->size;
+	}
+}
+
+/* Remember seq in target's ring, dropping the oldest one if it's full */
+static void target_add_seq(BACKLOG_TARGET_REC *target, guint64 seq)
+{
+	if (backlog_lines <= 0) {
+		entry_kill(seq);
+		return;
+	}
+
+	if (target->count == target->alloc) {
+		if (target->alloc < backlog_lines) {
+			guint64 *seqs;
+			int i, alloc;
+
+			alloc = MIN(MAX(target->alloc * 2, 16), backlog_lines);
+			seqs = g_new(guint64, alloc);
+			for (i = 0; i < target->count; i++) {
+				seqs[i] = target_seq(target, i);
+			}
+			g_free(target->seqs);
+			target->seqs = seqs;
+			target->alloc = alloc;
+			target->head = 0;
+		} else {
+			entry_kill(target->seqs[target->head]);
+			target->head = (target->head + 1) % target->alloc;
+			target->count--;
+		}
+	}
+
+	target->seqs[(target->head + target->count) % target->alloc] = seq;
+	target->count++;
+}
+
+/* Drop the oldest seqs that don't fit in fe_web_backlog_lines anymore
+   and shrink the ring to match */
+static void target_trim(BACKLOG_TARGET_REC *target)
+{
+	guint64 *seqs;
+	int i, alloc;
+
+	alloc = MAX(backlog_lines, 0);
+	if (target->alloc <= alloc) {
+		return;
+	}
+
+	for (; target->count > alloc; target->count--) {
+		entry_kill(target->seqs[target->head]);
+		target->head = (target->head + 1) % target->alloc;
+	}
+
+	seqs = alloc == 0 ? NULL : g_new(guint64, alloc);
+	for (i = 0; i < target->count; i++) {
+		seqs[i] = target_seq(target, i);
+	}
+	g_free(target->seqs);
+	target->seqs = seqs;
+	target->alloc = alloc;
+	target->head = 0;
+}
+
+static void backlog_unmap(void)
+{
+	if (backlog_map != NULL) {
+		munmap(backlog_map, backlog_map_len);
+		backlog_map = NULL;
+		backlog_map_len = 0;
+	}
+}
+
+/* Make sure the mapping covers the whole file */
+static int backlog_map_file(void)
+{
+	void *map;
+
+	if (backlog_map != NULL && backlog_map_len >= backlog_size) {
+		return TRUE;
+	}
+
+	backlog_unmap();
+	if (backlog_size == 0) {
+		return FALSE;
+	}
+
+	map = mmap(NULL, backlog_size, PROT_READ, MAP_SHARED, backlog_fd, 0);
+	if (map == MAP_FAILED) {
+		return FALSE;
+	}
+
+	backlog_map = map;
+	backlog_map_len = backlog_size;
+	return TRUE;
+}
+
+static const BACKLOG_RECORD_HEADER *record_get(guint64 offset)
+{
+	if (!backlog_map_file() || offset + sizeof(BACKLOG_RECORD_HEADER) > backlog_map_len) {
+		return NULL;
+	}
+	return (const BACKLOG_RECORD_HEADER *) (backlog_map + offset);
+}
+
+/* Rebuild the index from the segment file. A partially written record
+   at the end (crash while appending) is cut off. */
+static void backlog_load(void)
+{
+	const BACKLOG_RECORD_HEADER *rec;
+	BACKLOG_ENTRY_REC entry;
+	struct stat statbuf;
+	guint64 offset;
+	gsize size;
+
+	if (fstat(backlog_fd, &statbuf) != 0 || statbuf.st_size < BACKLOG_FILE_HEADER_SIZE) {
+		backlog_size = 0;
+		return;
+	}
+
+	backlog_size = statbuf.st_size;
+	if (!backlog_map_file() ||
+	    memcmp(backlog_map, BACKLOG_FILE_MAGIC, BACKLOG_FILE_HEADER_SIZE) != 0) {
+		backlog_unmap();
+		backlog_size = 0;
+		return;
+	}
+
+	offset = BACKLOG_FILE_HEADER_SIZE;
+	while ((rec = record_get(offset)) != NULL) {
+		size = record_size(rec->key_len, rec->json_len);
+		if (rec->magic != BACKLOG_RECORD_MAGIC || offset + size > backlog_map_len ||
+		    rec->seq < backlog_next_seq) {
+			break;
+		}
+
+		entry.seq = rec->seq;
+		entry.offset = offset;
+		entry.size = size;
+		entry.target = target_get((const char *) (rec + 1), rec->key_len);
+		g_array_append_val(backlog_entries, entry);
+		target_add_seq(entry.target, entry.seq);
+
+		backlog_next_seq = rec->seq + 1;
+		offset += size;
+	}
+
+	if (offset != backlog_size) {
+		backlog_unmap();
+		backlog_size = offset;
+		if (ftruncate(backlog_fd, backlog_size) != 0) {
+			/* we'll just overwrite the garbage */
+		}
+	}
+}
+
+static int backlog_open(void)
+{
+	char *path;
+
+	if (backlog_fd != -1) {
+		return TRUE;
+	}
+	if (backlog_lines <= 0) {
+		return FALSE;
+	}
+
+	path = g_strdup_printf("%s/" BACKLOG_FILE_NAME, get_irssi_dir());
+	backlog_fd = open(path, O_RDWR | O_CREAT, 0600);
+	if (backlog_fd == -1) {
+		printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
+		          "fe-web: Couldn't open backlog file %s: %s", path, g_strerror(errno));
+		g_free(path);
+		return FALSE;
+	}
+	g_free(path);
+
+	backlog_next_seq = 1;
+	backlog_load();
+
+	if (backlog_size == 0) {
+		if (ftruncate(backlog_fd, 0) != 0 ||
+		    pwrite(backlog_fd, BACKLOG_FILE_MAGIC, BACKLOG_FILE_HEADER_SIZE, 0) !=
+		        BACKLOG_FILE_HEADER_SIZE) {
+			close(backlog_fd);
+			backlog_fd = -1;
+			return FALSE;
+		}
+		backlog_size = BACKLOG_FILE_HEADER_SIZE;
+	}
+
+	return TRUE;
+}
+
+static void backlog_close(void)
+{
+	backlog_unmap();
+	if (backlog_fd != -1) {
+		close(backlog_fd);
+		backlog_fd = -1;
+	}
+
+	g_hash_table_remove_all(backlog_targets);
+	g_array_set_size(backlog_entries, 0);
+	backlog_size = 0;
+	backlog_dead_size = 0;
+}
+
+/* Copy the live records to a new segment and switch to it */
+static void backlog_compact(void)
+{
+	BACKLOG_ENTRY_REC *entry;
+	GArray *entries;
+	GString *buf;
+	char *path, *tmppath;
+	guint64 offset;
+	guint i;
+	int fd;
+
+	if (!backlog_map_file()) {
+		return;
+	}
+
+	path = g_strdup_printf("%s/" BACKLOG_FILE_NAME, get_irssi_dir());
+	tmppath = g_strconcat(path, ".new", NULL);
+
+	fd = open(tmppath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1) {
+		g_free(tmppath);
+		g_free(path);
+		return;
+	}
+
+	entries = g_array_sized_new(FALSE, FALSE, sizeof(BACKLOG_ENTRY_REC),
+	                            backlog_entries->len);
+	buf = g_string_sized_new(1024 * 1024);
+	g_string_append_len(buf, BACKLOG_FILE_MAGIC, BACKLOG_FILE_HEADER_SIZE);
+	offset = BACKLOG_FILE_HEADER_SIZE;
+
+	for (i = 0; i < backlog_entries->len; i++) {
+		BACKLOG_ENTRY_REC copy;
+
+		entry = &g_array_index(backlog_entries, BACKLOG_ENTRY_REC, i);
+		if (entry->target == NULL) {
+			continue;
+		}
+
+		copy = *entry;
+		copy.offset = offset;
+		g_array_append_val(entries, copy);
+
+		g_string_append_len(buf, (const char *) backlog_map + entry->offset, entry->size);
+		offset += entry->size;
+
+		if (buf->len >= 1024 * 1024) {
+			if (write(fd, buf->str, buf->len) != (ssize_t) buf->len) {
+				break;
+			}
+			g_string_truncate(buf, 0);
+		}
+	}
+
+	if (i < backlog_entries->len || write(fd, buf->str, buf->len) != (ssize_t) buf->len ||
+	    rename(tmppath, path) != 0) {
+		/* keep using the old file */
+		close(fd);
+		unlink(tmppath);
+		g_array_free(entries, TRUE);
+	} else {
+		backlog_unmap();
+		close(backlog_fd);
+		backlog_fd = fd;
+		backlog_size = offset;
+		backlog_dead_size = 0;
+		g_array_free(backlog_entries, TRUE);
+		backlog_entries = entries;
+	}
+
+	g_string_free(buf, TRUE);
+	g_free(tmppath);
+	g_free(path);
+}
+
+static void backlog_compact_check(void)
+{
+	if (backlog_size > BACKLOG_COMPACT_MIN_SIZE && backlog_dead_size > backlog_size / 2) {
+		backlog_compact();
+	}
+}
+
+/* Only messages that belong to a window are worth replaying */
+int fe_web_backlog_wants(WEB_MESSAGE_REC *msg)
+{
+	if (backlog_lines <= 0 || msg->server_tag == NULL || msg->target == NULL) {
+		return FALSE;
+	}
+
+	switch (msg->type) {
+	case WEB_MSG_MESSAGE:
+	case WEB_MSG_CHANNEL_JOIN:
+	case WEB_MSG_CHANNEL_PART:
+	case WEB_MSG_CHANNEL_KICK:
+	case WEB_MSG_TOPIC:
+	case WEB_MSG_CHANNEL_MODE:
+		return settings_get_bool("fe_web_enabled");
+	default:
+		return FALSE;
+	}
+}
+
+/* Give msg the next sequence number, returns 0 if the store isn't usable */
+guint64 fe_web_backlog_assign_seq(WEB_MESSAGE_REC *msg)
+{
+	if (!backlog_open()) {
+		return 0;
+	}
+
+	msg->seq = backlog_next_seq++;
+	return msg->seq;
+}
+
+/* Append serialized message, msg->seq must have been assigned */
+void fe_web_backlog_append(WEB_MESSAGE_REC *msg, const char *json, gsize json_len)
+{
+	BACKLOG_RECORD_HEADER *header;
+	BACKLOG_ENTRY_REC entry;
+	guchar *record;
+	char *key;
+	gsize key_len, size;
+
+	if (backlog_fd == -1 || msg->seq == 0) {
+		return;
+	}
+
+	key = backlog_key(msg->server_tag, msg->target);
+	key_len = MIN(strlen(key), G_MAXUINT16);
+	size = record_size(key_len, json_len);
+
+	record = g_malloc0(size);
+	header = (BACKLOG_RECORD_HEADER *) record;
+	header->magic = BACKLOG_RECORD_MAGIC;
+	header->json_len = json_len;
+	header->seq = msg->seq;
+	header->key_len = key_len;
+	header->type = msg->type;
+	memcpy(record + sizeof(*header), key, key_len);
+	memcpy(record + sizeof(*header) + key_len, json, json_len);
+
+	if (pwrite(backlog_fd, record, size, backlog_size) != (ssize_t) size) {
+		/* a partially written record is overwritten by the next one */
+		g_free(record);
+		g_free(key);
+		return;
+	}
+	g_free(record);
+
+	entry.seq = msg->seq;
+	entry.offset = backlog_size;
+	entry.size = size;
+	entry.target = target_get(key, key_len);
+	g_array_append_val(backlog_entries, entry);
+	target_add_seq(entry.target, entry.seq);
+	backlog_size += size;
+	g_free(key);
+
+	backlog_compact_check();
+}
+
+static void backlog_send_entry(WEB_CLIENT_REC *client, BACKLOG_ENTRY_REC *entry)
+{
+	const BACKLOG_RECORD_HEADER *rec;
+	WEB_FRAME_REC *frame;
+
+	rec = record_get(entry->offset);
+	if (rec == NULL) {
+		return;
+	}
+
+	frame = fe_web_frame_new_json(rec->type, (const char *) (rec + 1) + rec->key_len,
+	                              rec->json_len);
+	fe_web_send_frame(client, frame);
+	fe_web_frame_unref(frame);
+}
+
+/* Replay up to limit stored messages with seq > since, of one target or
+   of all targets of the server if target is NULL. The last replayed
+   sequence number is stored in last_seq. Returns TRUE if there's more. */
+int fe_web_backlog_replay(WEB_CLIENT_REC *client, const char *server_tag, const char *target,
+                          guint64 since, int limit, guint64 *last_seq)
+{
+	BACKLOG_TARGET_REC *rec;
+	BACKLOG_ENTRY_REC *entry;
+	int sent;
+
+	*last_seq = since;
+	if (server_tag == NULL || backlog_lines <= 0 || !backlog_open()) {
+		return FALSE;
+	}
+
+	limit = CLAMP(limit, 1, BACKLOG_MAX_PAGE);
+	sent = 0;
+
+	if (target != NULL) {
+		char *key;
+		int low, high, mid;
+
+		key = backlog_key(server_tag, target);
+		rec = g_hash_table_lookup(backlog_targets, key);
+		g_free(key);
+		if (rec == NULL) {
+			return FALSE;
+		}
+
+		/* first ring slot with seq > since */
+		low = 0;
+		high = rec->count;
+		while (low < high) {
+			mid = low + (high - low) / 2;
+			if (target_seq(rec, mid) <= since) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+
+		for (; low < rec->count && sent < limit; low++) {
+			entry = entry_find(target_seq(rec, low));
+			if (entry != NULL) {
+				backlog_send_entry(client, entry);
+				*last_seq = entry->seq;
+				sent++;
+			}
+		}
+		return low < rec->count;
+	} else {
+		gsize server_len;
+		guint pos;
+
+		server_len = strlen(server_tag);
+		for (pos = entries_find_after(since); pos < backlog_entries->len; pos++) {
+			entry = &g_array_index(backlog_entries, BACKLOG_ENTRY_REC, pos);
+			if (entry->target == NULL || (gsize) entry->target->server_len != server_len ||
+			    strncmp(entry->target->key, server_tag, server_len) != 0) {
+				continue;
+			}
+
+			if (sent == limit) {
+				return TRUE;
+			}
+			backlog_send_entry(client, entry);
+			*last_seq = entry->seq;
+			sent++;
+		}
+		return FALSE;
+	}
+}
+
+static void read_settings(void)
+{
+	GHashTableIter iter;
+	BACKLOG_TARGET_REC *target;
+	int old_lines;
+
+	old_lines = backlog_lines;
+	backlog_lines = settings_get_int("fe_web_backlog_lines");
+	if (backlog_lines >= old_lines || backlog_fd == -1) {
+		return;
+	}
+
+	g_hash_table_iter_init(&iter, backlog_targets);
+	while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &target)) {
+		target_trim(target);
+	}
+	backlog_compact_check();
+}
+
+void fe_web_backlog_init(void)
+{
+	settings_add_int("lookandfeel", "fe_web_backlog_lines", 1000);
+
+	backlog_targets =
+	    g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) target_free);
+	backlog_entries = g_array_new(FALSE, FALSE, sizeof(BACKLOG_ENTRY_REC));
+
+	read_settings();
+	signal_add("setup changed", (SIGNAL_FUNC) read_settings);
+}
+
+void fe_web_backlog_deinit(void)
+{
+	signal_remove("setup changed", (SIGNAL_FUNC) read_settings);
+
+	backlog_close();
+	g_hash_table_destroy(backlog_targets);
+	g_array_free(backlog_entries, TRUE);
+}
@@ -63,6 +63,7 @@ void fe_web_client_destroy(WEB_CLIENT_REC *client)
 
 	/* Remove from global list */
 	web_clients = g_slist_remove(web_clients, client);
+	fe_web_send_queue_clear(client);
 
 	/* Cleanup */
 	g_free(client->id);
@@ -81,6 +82,14 @@ void fe_web_client_destroy(WEB_CLIENT_REC *client)
 		g_byte_array_free(client->input_buffer, TRUE);
 	}
 
+	if (client->fragments != NULL) {
+		g_byte_array_free(client->fragments, TRUE);
+	}
+
+	if (client->inflate != NULL) {
+		g_object_unref(client->inflate);
+	}
+
 	if (client->pending_requests != NULL) {
 		g_hash_table_destroy(client->pending_requests);
 	}
@@ -90,31 +99,25 @@ void fe_web_client_destroy(WEB_CLIENT_REC *client)
 	g_free(client);
 }
 
-/* Handle client command (sync_server, command, etc.) */
-void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json)
+/* Handle one client request (sync_server, command, etc.) */
+static void fe_web_client_handle_request(WEB_CLIENT_REC *client, WEB_JSON_REC *req)
 {
 	char *type;
 	char *id;
 
-	if (client == NULL || json == NULL) {
-		return;
-	}
-
-	client->messages_received++;
-
 	/* Parse message type */
-	type = fe_web_json_get_string(json, "type");
+	type = fe_web_json_get_string(req, "type");
 	if (type == NULL) {
 		return;
 	}
 
 	/* Get message ID for responses */
-	id = fe_web_json_get_string(json, "id");
+	id = fe_web_json_get_string(req, "id");
 
 	/* Handle different message types */
 	if (g_strcmp0(type, "sync_server") == 0) {
 		char *server_tag;
-		server_tag = fe_web_json_get_string(json, "server");
+		server_tag = fe_web_json_get_string(req, "server");
 		if (server_tag != NULL) {
 			fe_web_client_sync_server(client, server_tag);
 			g_free(server_tag);
@@ -123,8 +126,8 @@ void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json)
 		char *command;
 		char *server_tag;
 
-		command = fe_web_json_get_string(json, "command");
-		server_tag = fe_web_json_get_string(json, "server");
+		command = fe_web_json_get_string(req, "command");
+		server_tag = fe_web_json_get_string(req, "server");
 
 		if (command != NULL) {
 			/* If server is specified, use it for this command */
@@ -158,8 +161,8 @@ void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json)
 		char *server_tag;
 		QUERY_REC *query;
 
-		nick = fe_web_json_get_string(json, "nick");
-		server_tag = fe_web_json_get_string(json, "server");
+		nick = fe_web_json_get_string(req, "nick");
+		server_tag = fe_web_json_get_string(req, "server");
 
 		if (nick != NULL && server_tag != NULL) {
 			IRC_SERVER_REC *server;
@@ -180,8 +183,8 @@ void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json)
 		IRC_SERVER_REC *server;
 		IRC_CHANNEL_REC *chanrec;
 
-		channel = fe_web_json_get_string(json, "channel");
-		server_tag = fe_web_json_get_string(json, "server");
+		channel = fe_web_json_get_string(req, "channel");
+		server_tag = fe_web_json_get_string(req, "server");
 
 		if (channel != NULL && server_tag != NULL) {
 			server = IRC_SERVER(server_find_tag(server_tag));
@@ -212,8 +215,8 @@ void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json)
 		WI_ITEM_REC *item;
 		WEB_MESSAGE_REC *msg;
 
-		target = fe_web_json_get_string(json, "target");
-		server_tag = fe_web_json_get_string(json, "server");
+		target = fe_web_json_get_string(req, "target");
+		server_tag = fe_web_json_get_string(req, "server");
 
 		if (target != NULL && server_tag != NULL) {
 			server = IRC_SERVER(server_find_tag(server_tag));
@@ -257,24 +260,80 @@ void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json)
 
 		g_free(target);
 		g_free(server_tag);
+	} else if (g_strcmp0(type, "backlog") == 0) {
+		/* Replay stored messages after the "since" cursor, one page at a
+		 * time, followed by backlog_end telling where to continue */
+		char *server_tag;
+		char *target;
+		guint64 since;
+		guint64 last_seq;
+		WEB_MESSAGE_REC *msg;
+
+		server_tag = fe_web_json_get_string(req, "server");
+		target = fe_web_json_get_string(req, "target");
+		since = fe_web_json_get_uint64(req, "since", 0);
+
+		msg = fe_web_message_new(WEB_MSG_BACKLOG_END);
+		msg->id = fe_web_generate_message_id();
+		msg->response_to = g_strdup(id);
+		msg->server_tag = g_strdup(server_tag);
+		msg->target = g_strdup(target);
+		msg->has_more = fe_web_backlog_replay(client, server_tag, target, since,
+		                                      fe_web_json_get_int(req, "limit", 100),
+		                                      &last_seq);
+		msg->seq = last_seq;
+		fe_web_send_message(client, msg);
+		fe_web_message_free(msg);
+
+		g_free(server_tag);
+		g_free(target);
 	} else if (g_strcmp0(type, "network_list") == 0) {
-		fe_web_handle_network_list(client, json);
+		fe_web_handle_network_list(client, req);
 	} else if (g_strcmp0(type, "server_list") == 0) {
-		fe_web_handle_server_list(client, json);
+		fe_web_handle_server_list(client, req);
 	} else if (g_strcmp0(type, "network_add") == 0) {
-		fe_web_handle_network_add(client, json);
+		fe_web_handle_network_add(client, req);
 	} else if (g_strcmp0(type, "network_remove") == 0) {
-		fe_web_handle_network_remove(client, json);
+		fe_web_handle_network_remove(client, req);
 	} else if (g_strcmp0(type, "server_add") == 0) {
-		fe_web_handle_server_add(client, json);
+		fe_web_handle_server_add(client, req);
 	} else if (g_strcmp0(type, "server_remove") == 0) {
-		fe_web_handle_server_remove(client, json);
+		fe_web_handle_server_remove(client, req);
 	}
 
 	g_free(type);
 	g_free(id);
 }
 
+/* Handle client message - a single request object or an array of them */
+void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json, gsize len)
+{
+	WEB_JSON_REC *root;
+	guint i;
+
+	if (client == NULL || json == NULL) {
+		return;
+	}
+
+	client->messages_received++;
+
+	/* Parse the whole message once, handlers look keys up from the tree */
+	root = fe_web_json_parse(json, len);
+	if (root == NULL) {
+		return;
+	}
+
+	if (root->type == WEB_JSON_ARRAY) {
+		for (i = 0; i < root->items->len; i++) {
+			fe_web_client_handle_request(client, g_ptr_array_index(root->items, i));
+		}
+	} else {
+		fe_web_client_handle_request(client, root);
+	}
+
+	fe_web_json_free(root);
+}
+
 /* Sync client to specific server */
 void fe_web_client_sync_server(WEB_CLIENT_REC *client, const char *server_tag)
 {
@@ -1,5 +1,5 @@
 /*
- fe-web-json.c : Simple JSON parser for fe-web
+ fe-web-json.c : JSON parser and writer for fe-web
 
     Copyright (C) 2025
 
@@ -13,439 +13,767 @@
 #include "fe-web.h"
 
 #include <string.h>
-#include <ctype.h>
 #include <stdlib.h>
+#include <limits.h>
 
-/* Helper: Unescape JSON string (\\, \", \n, \r, \t, \b, \f, \uXXXX) */
-static char *fe_web_json_unescape(const char *str)
+/* Maximum nesting of arrays/objects accepted from clients */
+#define WEB_JSON_MAX_DEPTH 32
+
+typedef struct {
+	const char *pos;
+	const char *end;
+	int depth;
+} JSON_PARSER;
+
+static WEB_JSON_REC *json_parse_value(JSON_PARSER *parser);
+
+static WEB_JSON_REC *json_value_new(WEB_JSON_TYPE type)
 {
-	GString *result;
-	const char *p;
+	WEB_JSON_REC *value;
 
-	if (str == NULL) {
-		return NULL;
+	value = g_slice_new0(WEB_JSON_REC);
+	value->type = type;
+	return value;
+}
+
+void fe_web_json_free(WEB_JSON_REC *value)
+{
+	if (value == NULL) {
+		return;
 	}
 
-	result = g_string_new("");
-	p = str;
-
-	while (*p != '\0') {
-		if (*p == '\\' && *(p + 1) != '\0') {
-			p++; /* Skip backslash */
-			switch (*p) {
-			case '"':
-				g_string_append_c(result, '"');
-				break;
-			case '\\':
-				g_string_append_c(result, '\\');
-				break;
-			case '/':
-				g_string_append_c(result, '/');
-				break;
-			case 'b':
-				g_string_append_c(result, '\b');
-				break;
-			case 'f':
-				g_string_append_c(result, '\f');
-				break;
-			case 'n':
-				g_string_append_c(result, '\n');
-				break;
-			case 'r':
-				g_string_append_c(result, '\r');
-				break;
-			case 't':
-				g_string_append_c(result, '\t');
-				break;
-			case 'u': {
-				/* Unicode escape: \uXXXX */
-				char hex[5] = { 0 };
-				unsigned int code;
-				int i;
-
-				/* Read 4 hex digits */
-				for (i = 0; i < 4 && *(p + 1 + i) != '\0'; i++) {
-					hex[i] = *(p + 1 + i);
-				}
+	g_free(value->str);
+	if (value->items != NULL) {
+		g_ptr_array_free(value->items, TRUE);
+	}
+	if (value->members != NULL) {
+		g_hash_table_destroy(value->members);
+	}
+	g_slice_free(WEB_JSON_REC, value);
+}
 
-				if (i == 4) {
-					code = (unsigned int) strtol(hex, NULL, 16);
-					/* Simple UTF-8 encoding (BMP only) */
-					if (code < 0x80) {
-						g_string_append_c(result, (char) code);
-					} else if (code < 0x800) {
-						g_string_append_c(result,
-						                  (char) (0xC0 | (code >> 6)));
-						g_string_append_c(result,
-						                  (char) (0x80 | (code & 0x3F)));
-					} else {
-						g_string_append_c(result,
-						                  (char) (0xE0 | (code >> 12)));
-						g_string_append_c(
-						    result, (char) (0x80 | ((code >> 6) & 0x3F)));
-						g_string_append_c(result,
-						                  (char) (0x80 | (code & 0x3F)));
-					}
-					p += 4; /* Skip the 4 hex digits */
-				}
-				break;
+static void json_skip_whitespace(JSON_PARSER *parser)
+{
+	while (parser->pos < parser->end &&
+	       (*parser->pos == ' ' || *parser->pos == '\t' || *parser->pos == '\n' ||
+	        *parser->pos == '\r')) {
+		parser->pos++;
+	}
+}
+
+static int json_parse_hex4(const char *str, const char *end, gunichar *code_out)
+{
+	gunichar code;
+	int i;
+
+	if (end - str < 4) {
+		return FALSE;
+	}
+
+	code = 0;
+	for (i = 0; i < 4; i++) {
+		int digit = g_ascii_xdigit_value(str[i]);
+		if (digit < 0) {
+			return FALSE;
+		}
+		code = (code << 4) | digit;
+	}
+
+	*code_out = code;
+	return TRUE;
+}
+
+/* Parse a string token, parser->pos points to the opening quote.
+   Returns the unescaped UTF-8 string or NULL if it's malformed. */
+static char *json_parse_string(JSON_PARSER *parser)
+{
+	GString *result;
+	const char *run;
+
+	result = g_string_new(NULL);
+	parser->pos++;
+
+	for (;;) {
+		/* copy unescaped runs at once */
+		run = parser->pos;
+		while (parser->pos < parser->end && *parser->pos != '"' && *parser->pos != '\\' &&
+		       (unsigned char) *parser->pos >= 0x20) {
+			parser->pos++;
+		}
+		g_string_append_len(result, run, parser->pos - run);
+
+		if (parser->pos >= parser->end || (unsigned char) *parser->pos < 0x20) {
+			break;
+		}
+
+		if (*parser->pos == '"') {
+			parser->pos++;
+			return g_string_free(result, FALSE);
+		}
+
+		/* backslash escape */
+		if (++parser->pos >= parser->end) {
+			break;
+		}
+
+		switch (*parser->pos++) {
+		case '"':
+			g_string_append_c(result, '"');
+			break;
+		case '\\':
+			g_string_append_c(result, '\\');
+			break;
+		case '/':
+			g_string_append_c(result, '/');
+			break;
+		case 'b':
+			g_string_append_c(result, '\b');
+			break;
+		case 'f':
+			g_string_append_c(result, '\f');
+			break;
+		case 'n':
+			g_string_append_c(result, '\n');
+			break;
+		case 'r':
+			g_string_append_c(result, '\r');
+			break;
+		case 't':
+			g_string_append_c(result, '\t');
+			break;
+		case 'u': {
+			gunichar code, low;
+
+			if (!json_parse_hex4(parser->pos, parser->end, &code)) {
+				goto error;
 			}
-			default:
-				/* Unknown escape - keep as-is */
-				g_string_append_c(result, *p);
-				break;
+			parser->pos += 4;
+
+			if (code >= 0xd800 && code <= 0xdbff) {
+				/* high surrogate, must be followed by \uDC00..\uDFFF */
+				if (parser->end - parser->pos >= 6 && parser->pos[0] == '\\' &&
+				    parser->pos[1] == 'u' &&
+				    json_parse_hex4(parser->pos + 2, parser->end, &low) &&
+				    low >= 0xdc00 && low <= 0xdfff) {
+					code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					parser->pos += 6;
+				} else {
+					code = 0xfffd;
+				}
+			} else if ((code >= 0xdc00 && code <= 0xdfff) || code == 0) {
+				/* lone low surrogate, or NUL which would cut the string */
+				code = 0xfffd;
 			}
-			p++;
-		} else {
-			g_string_append_c(result, *p);
-			p++;
+			g_string_append_unichar(result, code);
+			break;
+		}
+		default:
+			goto error;
 		}
 	}
 
-	return g_string_free(result, FALSE);
+error:
+	g_string_free(result, TRUE);
+	return NULL;
 }
 
-/* Simple JSON value extraction - finds "key":"value" or "key":123 */
-char *fe_web_json_get_string(const char *json, const char *key)
+static WEB_JSON_REC *json_parse_number(JSON_PARSER *parser)
 {
-	char *search_str;
-	char *pos;
-	char *start;
-	char *end;
-	char *result;
+	WEB_JSON_REC *value;
+	const char *start;
 
-	if (json == NULL || key == NULL) {
-		return NULL;
+	start = parser->pos;
+	if (parser->pos < parser->end && *parser->pos == '-') {
+		parser->pos++;
 	}
 
-	/* Build search string: "key": */
-	search_str = g_strdup_printf("\"%s\"", key);
-	pos = strstr(json, search_str);
-	g_free(search_str);
-
-	if (pos == NULL) {
+	if (parser->pos >= parser->end || !g_ascii_isdigit(*parser->pos)) {
 		return NULL;
 	}
+	if (*parser->pos == '0') {
+		parser->pos++;
+	} else {
+		while (parser->pos < parser->end && g_ascii_isdigit(*parser->pos)) {
+			parser->pos++;
+		}
+	}
 
-	/* Skip past the key and colon */
-	pos = strchr(pos + strlen(key), ':');
-	if (pos == NULL) {
-		return NULL;
+	if (parser->pos < parser->end && *parser->pos == '.') {
+		parser->pos++;
+		if (parser->pos >= parser->end || !g_ascii_isdigit(*parser->pos)) {
+			return NULL;
+		}
+		while (parser->pos < parser->end && g_ascii_isdigit(*parser->pos)) {
+			parser->pos++;
+		}
 	}
-	pos++;
 
-	/* Skip whitespace */
-	while (*pos != '\0' && isspace(*pos)) {
-		pos++;
+	if (parser->pos < parser->end && (*parser->pos == 'e' || *parser->pos == 'E')) {
+		parser->pos++;
+		if (parser->pos < parser->end && (*parser->pos == '+' || *parser->pos == '-')) {
+			parser->pos++;
+		}
+		if (parser->pos >= parser->end || !g_ascii_isdigit(*parser->pos)) {
+			return NULL;
+		}
+		while (parser->pos < parser->end && g_ascii_isdigit(*parser->pos)) {
+			parser->pos++;
+		}
 	}
 
-	/* Check if it's a string (starts with ") */
-	if (*pos != '"') {
+	value = json_value_new(WEB_JSON_NUMBER);
+	value->str = g_strndup(start, parser->pos - start);
+	return value;
+}
+
+static WEB_JSON_REC *json_parse_literal(JSON_PARSER *parser, const char *literal,
+                                        WEB_JSON_TYPE type)
+{
+	size_t len;
+
+	len = strlen(literal);
+	if ((size_t) (parser->end - parser->pos) < len ||
+	    strncmp(parser->pos, literal, len) != 0) {
 		return NULL;
 	}
 
-	start = pos + 1;
+	parser->pos += len;
+	return json_value_new(type);
+}
+
+static WEB_JSON_REC *json_parse_array(JSON_PARSER *parser)
+{
+	WEB_JSON_REC *array, *item;
+
+	array = json_value_new(WEB_JSON_ARRAY);
+	array->items = g_ptr_array_new_with_free_func((GDestroyNotify) fe_web_json_free);
+
+	parser->pos++;
+	json_skip_whitespace(parser);
+	if (parser->pos < parser->end && *parser->pos == ']') {
+		parser->pos++;
+		return array;
+	}
+
+	for (;;) {
+		item = json_parse_value(parser);
+		if (item == NULL) {
+			break;
+		}
+		g_ptr_array_add(array->items, item);
 
-	/* Find end of string (handle escaped quotes) */
-	end = start;
-	while (*end != '\0') {
-		if (*end == '\\' && *(end + 1) != '\0') {
-			end += 2;
-			continue;
+		json_skip_whitespace(parser);
+		if (parser->pos >= parser->end) {
+			break;
+		}
+		if (*parser->pos == ']') {
+			parser->pos++;
+			return array;
 		}
-		if (*end == '"') {
+		if (*parser->pos++ != ',') {
 			break;
 		}
-		end++;
 	}
 
-	if (*end != '"') {
-		return NULL;
+	fe_web_json_free(array);
+	return NULL;
+}
+
+static WEB_JSON_REC *json_parse_object(JSON_PARSER *parser)
+{
+	WEB_JSON_REC *object, *member;
+	char *key;
+
+	object = json_value_new(WEB_JSON_OBJECT);
+	object->members = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+	                                        (GDestroyNotify) fe_web_json_free);
+
+	parser->pos++;
+	json_skip_whitespace(parser);
+	if (parser->pos < parser->end && *parser->pos == '}') {
+		parser->pos++;
+		return object;
 	}
 
-	/* Extract string and unescape JSON escape sequences */
-	{
-		char *escaped_str = g_strndup(start, end - start);
-		result = fe_web_json_unescape(escaped_str);
-		g_free(escaped_str);
+	for (;;) {
+		json_skip_whitespace(parser);
+		if (parser->pos >= parser->end || *parser->pos != '"') {
+			break;
+		}
+		key = json_parse_string(parser);
+		if (key == NULL) {
+			break;
+		}
+
+		json_skip_whitespace(parser);
+		if (parser->pos >= parser->end || *parser->pos != ':') {
+			g_free(key);
+			break;
+		}
+		parser->pos++;
+
+		member = json_parse_value(parser);
+		if (member == NULL) {
+			g_free(key);
+			break;
+		}
+		/* duplicate keys: the last one wins */
+		g_hash_table_insert(object->members, key, member);
+
+		json_skip_whitespace(parser);
+		if (parser->pos >= parser->end) {
+			break;
+		}
+		if (*parser->pos == '}') {
+			parser->pos++;
+			return object;
+		}
+		if (*parser->pos++ != ',') {
+			break;
+		}
 	}
 
-	return result;
+	fe_web_json_free(object);
+	return NULL;
 }
 
-/* Get integer value from JSON */
-int fe_web_json_get_int(const char *json, const char *key, int default_value)
+static WEB_JSON_REC *json_parse_value(JSON_PARSER *parser)
 {
-	char *search_str;
-	char *pos;
-	int value;
+	WEB_JSON_REC *value;
+	char *str;
 
-	if (json == NULL || key == NULL) {
-		return default_value;
+	json_skip_whitespace(parser);
+	if (parser->pos >= parser->end) {
+		return NULL;
 	}
 
-	/* Build search string: "key": */
-	search_str = g_strdup_printf("\"%s\"", key);
-	pos = strstr(json, search_str);
-	g_free(search_str);
-
-	if (pos == NULL) {
-		return default_value;
+	switch (*parser->pos) {
+	case '{':
+	case '[':
+		if (parser->depth >= WEB_JSON_MAX_DEPTH) {
+			return NULL;
+		}
+		parser->depth++;
+		value = *parser->pos == '{' ? json_parse_object(parser) : json_parse_array(parser);
+		parser->depth--;
+		return value;
+	case '"':
+		str = json_parse_string(parser);
+		if (str == NULL) {
+			return NULL;
+		}
+		value = json_value_new(WEB_JSON_STRING);
+		value->str = str;
+		return value;
+	case 't':
+		return json_parse_literal(parser, "true", WEB_JSON_TRUE);
+	case 'f':
+		return json_parse_literal(parser, "false", WEB_JSON_FALSE);
+	case 'n':
+		return json_parse_literal(parser, "null", WEB_JSON_NULL);
+	default:
+		return json_parse_number(parser);
 	}
+}
 
-	/* Skip past the key and colon */
-	pos = strchr(pos + strlen(key), ':');
-	if (pos == NULL) {
-		return default_value;
+/* Parse a complete JSON document in a single pass. Returns NULL if the
+   document is malformed or has trailing garbage. */
+WEB_JSON_REC *fe_web_json_parse(const char *json, gsize len)
+{
+	JSON_PARSER parser;
+	WEB_JSON_REC *root;
+
+	if (json == NULL) {
+		return NULL;
 	}
-	pos++;
 
-	/* Skip whitespace */
-	while (*pos != '\0' && isspace(*pos)) {
-		pos++;
+	parser.pos = json;
+	parser.end = json + len;
+	parser.depth = 0;
+
+	root = json_parse_value(&parser);
+	if (root == NULL) {
+		return NULL;
 	}
 
-	/* Parse integer */
-	if (sscanf(pos, "%d", &value) == 1) {
-		return value;
+	json_skip_whitespace(&parser);
+	if (parser.pos != parser.end) {
+		fe_web_json_free(root);
+		return NULL;
 	}
 
-	return default_value;
+	return root;
 }
 
-/* Check if JSON has a key */
-int fe_web_json_has_key(const char *json, const char *key)
+/* Get member of an object, NULL if it doesn't exist or obj isn't an object */
+WEB_JSON_REC *fe_web_json_get(WEB_JSON_REC *obj, const char *key)
 {
-	char *search_str;
-	char *pos;
-
-	if (json == NULL || key == NULL) {
-		return 0;
+	if (obj == NULL || key == NULL || obj->type != WEB_JSON_OBJECT) {
+		return NULL;
 	}
 
-	search_str = g_strdup_printf("\"%s\"", key);
-	pos = strstr(json, search_str);
-	g_free(search_str);
-
-	return pos != NULL;
+	return g_hash_table_lookup(obj->members, key);
 }
 
-/* Build JSON string for a network (IRC_CHATNET_REC) */
-GString *fe_web_build_network_json(IRC_CHATNET_REC *rec)
+/* Get string member as newly allocated string, NULL if it's not a string */
+char *fe_web_json_get_string(WEB_JSON_REC *obj, const char *key)
 {
-	GString *json;
+	WEB_JSON_REC *value;
 
-	if (rec == NULL) {
+	value = fe_web_json_get(obj, key);
+	if (value == NULL || value->type != WEB_JSON_STRING) {
 		return NULL;
 	}
 
-	json = g_string_new("{");
+	return g_strdup(value->str);
+}
 
-	/* Required fields */
-	g_string_append_printf(json, "\"name\":\"%s\",", fe_web_escape_json(rec->name));
-	g_string_append(json, "\"chat_type\":\"IRC\",");
+/* Get integer member - booleans are returned as 1/0 */
+int fe_web_json_get_int(WEB_JSON_REC *obj, const char *key, int default_value)
+{
+	WEB_JSON_REC *value;
+	long num;
 
-	/* Optional fields */
-	if (rec->nick != NULL) {
-		g_string_append_printf(json, "\"nick\":\"%s\",", fe_web_escape_json(rec->nick));
-	} else {
-		g_string_append(json, "\"nick\":null,");
+	value = fe_web_json_get(obj, key);
+	if (value == NULL) {
+		return default_value;
 	}
 
-	if (rec->alternate_nick != NULL) {
-		g_string_append_printf(json, "\"alternate_nick\":\"%s\",",
-		                       fe_web_escape_json(rec->alternate_nick));
-	} else {
-		g_string_append(json, "\"alternate_nick\":null,");
+	switch (value->type) {
+	case WEB_JSON_TRUE:
+		return 1;
+	case WEB_JSON_FALSE:
+		return 0;
+	case WEB_JSON_NUMBER:
+		num = strtol(value->str, NULL, 10);
+		return (int) CLAMP(num, INT_MIN, INT_MAX);
+	default:
+		return default_value;
 	}
+}
 
-	if (rec->username != NULL) {
-		g_string_append_printf(json, "\"username\":\"%s\",",
-		                       fe_web_escape_json(rec->username));
-	} else {
-		g_string_append(json, "\"username\":null,");
-	}
+/* Get non-negative integer member, for values that may not fit in int */
+guint64 fe_web_json_get_uint64(WEB_JSON_REC *obj, const char *key, guint64 default_value)
+{
+	WEB_JSON_REC *value;
 
-	if (rec->realname != NULL) {
-		g_string_append_printf(json, "\"realname\":\"%s\",",
-		                       fe_web_escape_json(rec->realname));
-	} else {
-		g_string_append(json, "\"realname\":null,");
+	value = fe_web_json_get(obj, key);
+	if (value == NULL || value->type != WEB_JSON_NUMBER || value->str[0] == '-') {
+		return default_value;
 	}
 
-	if (rec->own_host != NULL) {
-		g_string_append_printf(json, "\"own_host\":\"%s\",",
-		                       fe_web_escape_json(rec->own_host));
-	} else {
-		g_string_append(json, "\"own_host\":null,");
+	return g_ascii_strtoull(value->str, NULL, 10);
+}
+
+/* Check if JSON object has a key */
+int fe_web_json_has_key(WEB_JSON_REC *obj, const char *key)
+{
+	return fe_web_json_get(obj, key) != NULL;
+}
+
+/* Append str to out with JSON escaping (without the surrounding quotes).
+ * JSON supports UTF-8 natively, so we only escape:
+ * - Special JSON characters: " \
+ * - Control characters (< 32): \b \f \n \r \t and others as \uXXXX
+ * - UTF-8 multi-byte sequences (> 127) are passed through unchanged
+ */
+void fe_web_json_append_escaped(GString *out, const char *str)
+{
+	const unsigned char *p, *run;
+
+	if (str == NULL) {
+		return;
 	}
 
-	if (rec->autosendcmd != NULL) {
-		g_string_append_printf(json, "\"autosendcmd\":\"%s\",",
-		                       fe_web_escape_json(rec->autosendcmd));
-	} else {
-		g_string_append(json, "\"autosendcmd\":null,");
+	p = (const unsigned char *) str;
+	for (;;) {
+		run = p;
+		while (*p >= 32 && *p != '"' && *p != '\\') {
+			p++;
+		}
+		g_string_append_len(out, (const char *) run, p - run);
+
+		switch (*p) {
+		case '\0':
+			return;
+		case '"':
+			g_string_append(out, "\\\"");
+			break;
+		case '\\':
+			g_string_append(out, "\\\\");
+			break;
+		case '\b':
+			g_string_append(out, "\\b");
+			break;
+		case '\f':
+			g_string_append(out, "\\f");
+			break;
+		case '\n':
+			g_string_append(out, "\\n");
+			break;
+		case '\r':
+			g_string_append(out, "\\r");
+			break;
+		case '\t':
+			g_string_append(out, "\\t");
+			break;
+		default:
+			g_string_append_printf(out, "\\u%04x", *p);
+			break;
+		}
+		p++;
 	}
+}
 
-	if (rec->usermode != NULL) {
-		g_string_append_printf(json, "\"usermode\":\"%s\",",
-		                       fe_web_escape_json(rec->usermode));
-	} else {
-		g_string_append(json, "\"usermode\":null,");
+void fe_web_json_writer_init(WEB_JSON_WRITER *writer, GString *out)
+{
+	writer->out = out;
+	writer->depth = 0;
+	writer->has_values = 0;
+	writer->after_key = FALSE;
+}
+
+/* Write the ',' needed before a new value or key */
+static void json_writer_separate(WEB_JSON_WRITER *writer)
+{
+	guint64 bit;
+
+	if (writer->after_key) {
+		writer->after_key = FALSE;
+		return;
+	}
+	if (writer->depth == 0) {
+		return;
 	}
 
-	/* SASL fields */
-	if (rec->sasl_mechanism != NULL) {
-		g_string_append_printf(json, "\"sasl_mechanism\":\"%s\",",
-		                       fe_web_escape_json(rec->sasl_mechanism));
+	bit = (guint64) 1 << (writer->depth - 1);
+	if (writer->has_values & bit) {
+		g_string_append_c(writer->out, ',');
 	} else {
-		g_string_append(json, "\"sasl_mechanism\":null,");
+		writer->has_values |= bit;
 	}
+}
 
-	if (rec->sasl_username != NULL) {
-		g_string_append_printf(json, "\"sasl_username\":\"%s\",",
-		                       fe_web_escape_json(rec->sasl_username));
-	} else {
-		g_string_append(json, "\"sasl_username\":null,");
+static void json_writer_open(WEB_JSON_WRITER *writer, char c)
+{
+	json_writer_separate(writer);
+	g_string_append_c(writer->out, c);
+
+	g_return_if_fail(writer->depth < WEB_JSON_WRITER_MAX_DEPTH);
+	writer->depth++;
+	writer->has_values &= ~((guint64) 1 << (writer->depth - 1));
+}
+
+static void json_writer_close(WEB_JSON_WRITER *writer, char c)
+{
+	g_return_if_fail(writer->depth > 0);
+	writer->depth--;
+	g_string_append_c(writer->out, c);
+}
+
+void fe_web_json_begin_object(WEB_JSON_WRITER *writer)
+{
+	json_writer_open(writer, '{');
+}
+
+void fe_web_json_end_object(WEB_JSON_WRITER *writer)
+{
+	json_writer_close(writer, '}');
+}
+
+void fe_web_json_begin_array(WEB_JSON_WRITER *writer)
+{
+	json_writer_open(writer, '[');
+}
+
+void fe_web_json_end_array(WEB_JSON_WRITER *writer)
+{
+	json_writer_close(writer, ']');
+}
+
+void fe_web_json_key(WEB_JSON_WRITER *writer, const char *key)
+{
+	json_writer_separate(writer);
+	g_string_append_c(writer->out, '"');
+	fe_web_json_append_escaped(writer->out, key);
+	g_string_append(writer->out, "\":");
+	writer->after_key = TRUE;
+}
+
+/* Write a string value, NULL is written as null */
+void fe_web_json_string(WEB_JSON_WRITER *writer, const char *value)
+{
+	json_writer_separate(writer);
+	if (value == NULL) {
+		g_string_append(writer->out, "null");
+		return;
+	}
+	g_string_append_c(writer->out, '"');
+	fe_web_json_append_escaped(writer->out, value);
+	g_string_append_c(writer->out, '"');
+}
+
+void fe_web_json_int(WEB_JSON_WRITER *writer, gint64 value)
+{
+	json_writer_separate(writer);
+	g_string_append_printf(writer->out, "%" G_GINT64_FORMAT, value);
+}
+
+void fe_web_json_bool(WEB_JSON_WRITER *writer, int value)
+{
+	json_writer_separate(writer);
+	g_string_append(writer->out, value ? "true" : "false");
+}
+
+void fe_web_json_null(WEB_JSON_WRITER *writer)
+{
+	json_writer_separate(writer);
+	g_string_append(writer->out, "null");
+}
+
+/* Write an already serialized JSON value */
+void fe_web_json_raw(WEB_JSON_WRITER *writer, const char *json)
+{
+	json_writer_separate(writer);
+	g_string_append(writer->out, json != NULL ? json : "null");
+}
+
+/* Write already serialized members ("a":1,"b":2) into the open object */
+void fe_web_json_raw_members(WEB_JSON_WRITER *writer, const char *members, gsize len)
+{
+	if (len == 0) {
+		return;
 	}
+	json_writer_separate(writer);
+	g_string_append_len(writer->out, members, len);
+}
 
-	/* Mask password - never send actual password */
-	if (rec->sasl_password != NULL) {
-		g_string_append(json, "\"sasl_password\":\"***\",");
-	} else {
-		g_string_append(json, "\"sasl_password\":null,");
+void fe_web_json_member_string(WEB_JSON_WRITER *writer, const char *key, const char *value)
+{
+	fe_web_json_key(writer, key);
+	fe_web_json_string(writer, value);
+}
+
+void fe_web_json_member_int(WEB_JSON_WRITER *writer, const char *key, gint64 value)
+{
+	fe_web_json_key(writer, key);
+	fe_web_json_int(writer, value);
+}
+
+void fe_web_json_member_bool(WEB_JSON_WRITER *writer, const char *key, int value)
+{
+	fe_web_json_key(writer, key);
+	fe_web_json_bool(writer, value);
+}
+
+/* Build JSON string for a network (IRC_CHATNET_REC) */
+GString *fe_web_build_network_json(IRC_CHATNET_REC *rec)
+{
+	WEB_JSON_WRITER writer;
+	GString *json;
+
+	if (rec == NULL) {
+		return NULL;
 	}
 
-	/* Numeric settings */
-	g_string_append_printf(json, "\"max_kicks\":%d,", rec->max_kicks);
-	g_string_append_printf(json, "\"max_msgs\":%d,", rec->max_msgs);
-	g_string_append_printf(json, "\"max_modes\":%d,", rec->max_modes);
-	g_string_append_printf(json, "\"max_whois\":%d,", rec->max_whois);
-	g_string_append_printf(json, "\"max_cmds_at_once\":%d,", rec->max_cmds_at_once);
-	g_string_append_printf(json, "\"cmd_queue_speed\":%d,", rec->cmd_queue_speed);
-	g_string_append_printf(json, "\"max_query_chans\":%d", rec->max_query_chans);
+	json = g_string_sized_new(512);
+	fe_web_json_writer_init(&writer, json);
+	fe_web_json_begin_object(&writer);
+
+	/* Required fields */
+	fe_web_json_member_string(&writer, "name", rec->name);
+	fe_web_json_member_string(&writer, "chat_type", "IRC");
+
+	/* Optional fields, null if unset */
+	fe_web_json_member_string(&writer, "nick", rec->nick);
+	fe_web_json_member_string(&writer, "alternate_nick", rec->alternate_nick);
+	fe_web_json_member_string(&writer, "username", rec->username);
+	fe_web_json_member_string(&writer, "realname", rec->realname);
+	fe_web_json_member_string(&writer, "own_host", rec->own_host);
+	fe_web_json_member_string(&writer, "autosendcmd", rec->autosendcmd);
+	fe_web_json_member_string(&writer, "usermode", rec->usermode);
+
+	/* SASL fields */
+	fe_web_json_member_string(&writer, "sasl_mechanism", rec->sasl_mechanism);
+	fe_web_json_member_string(&writer, "sasl_username", rec->sasl_username);
 
-	g_string_append(json, "}");
+	/* Mask password - never send actual password */
+	fe_web_json_member_string(&writer, "sasl_password",
+	                          rec->sasl_password != NULL ? "***" : NULL);
 
+	/* Numeric settings */
+	fe_web_json_member_int(&writer, "max_kicks", rec->max_kicks);
+	fe_web_json_member_int(&writer, "max_msgs", rec->max_msgs);
+	fe_web_json_member_int(&writer, "max_modes", rec->max_modes);
+	fe_web_json_member_int(&writer, "max_whois", rec->max_whois);
+	fe_web_json_member_int(&writer, "max_cmds_at_once", rec->max_cmds_at_once);
+	fe_web_json_member_int(&writer, "cmd_queue_speed", rec->cmd_queue_speed);
+	fe_web_json_member_int(&writer, "max_query_chans", rec->max_query_chans);
+
+	fe_web_json_end_object(&writer);
 	return json;
 }
 
 /* Build JSON string for a server (IRC_SERVER_SETUP_REC) */
 GString *fe_web_build_server_json(IRC_SERVER_SETUP_REC *rec)
 {
+	WEB_JSON_WRITER writer;
 	GString *json;
 
 	if (rec == NULL) {
 		return NULL;
 	}
 
-	json = g_string_new("{");
+	json = g_string_sized_new(512);
+	fe_web_json_writer_init(&writer, json);
+	fe_web_json_begin_object(&writer);
 
 	/* Required fields */
-	g_string_append_printf(json, "\"address\":\"%s\",", fe_web_escape_json(rec->address));
-	g_string_append_printf(json, "\"port\":%d,", rec->port);
+	fe_web_json_member_string(&writer, "address", rec->address);
+	fe_web_json_member_int(&writer, "port", rec->port);
 
 	/* Optional fields */
-	if (rec->chatnet != NULL) {
-		g_string_append_printf(json, "\"chatnet\":\"%s\",",
-		                       fe_web_escape_json(rec->chatnet));
-	} else {
-		g_string_append(json, "\"chatnet\":null,");
-	}
+	fe_web_json_member_string(&writer, "chatnet", rec->chatnet);
 
 	/* Password - never send actual password */
-	if (rec->password != NULL) {
-		g_string_append(json, "\"password\":\"***\",");
-	} else {
-		g_string_append(json, "\"password\":null,");
-	}
+	fe_web_json_member_string(&writer, "password", rec->password != NULL ? "***" : NULL);
 
 	/* Boolean flags */
-	g_string_append_printf(json, "\"autoconnect\":%s,", rec->autoconnect ? "true" : "false");
-	g_string_append_printf(json, "\"use_tls\":%s,", rec->use_tls ? "true" : "false");
-	g_string_append_printf(json, "\"tls_verify\":%s,", rec->tls_verify ? "true" : "false");
+	fe_web_json_member_bool(&writer, "autoconnect", rec->autoconnect);
+	fe_web_json_member_bool(&writer, "use_tls", rec->use_tls);
+	fe_web_json_member_bool(&writer, "tls_verify", rec->tls_verify);
 
 	/* TLS certificate fields */
-	if (rec->tls_cert != NULL) {
-		g_string_append_printf(json, "\"tls_cert\":\"%s\",",
-		                       fe_web_escape_json(rec->tls_cert));
-	} else {
-		g_string_append(json, "\"tls_cert\":null,");
-	}
-
-	if (rec->tls_pkey != NULL) {
-		g_string_append_printf(json, "\"tls_pkey\":\"%s\",",
-		                       fe_web_escape_json(rec->tls_pkey));
-	} else {
-		g_string_append(json, "\"tls_pkey\":null,");
-	}
+	fe_web_json_member_string(&writer, "tls_cert", rec->tls_cert);
+	fe_web_json_member_string(&writer, "tls_pkey", rec->tls_pkey);
 
 	/* Mask TLS password */
-	if (rec->tls_pass != NULL) {
-		g_string_append(json, "\"tls_pass\":\"***\",");
-	} else {
-		g_string_append(json, "\"tls_pass\":null,");
-	}
-
-	if (rec->tls_cafile != NULL) {
-		g_string_append_printf(json, "\"tls_cafile\":\"%s\",",
-		                       fe_web_escape_json(rec->tls_cafile));
-	} else {
-		g_string_append(json, "\"tls_cafile\":null,");
-	}
-
-	if (rec->tls_capath != NULL) {
-		g_string_append_printf(json, "\"tls_capath\":\"%s\",",
-		                       fe_web_escape_json(rec->tls_capath));
-	} else {
-		g_string_append(json, "\"tls_capath\":null,");
-	}
-
-	if (rec->tls_ciphers != NULL) {
-		g_string_append_printf(json, "\"tls_ciphers\":\"%s\",",
-		                       fe_web_escape_json(rec->tls_ciphers));
-	} else {
-		g_string_append(json, "\"tls_ciphers\":null,");
-	}
+	fe_web_json_member_string(&writer, "tls_pass", rec->tls_pass != NULL ? "***" : NULL);
 
-	if (rec->tls_pinned_cert != NULL) {
-		g_string_append_printf(json, "\"tls_pinned_cert\":\"%s\",",
-		                       fe_web_escape_json(rec->tls_pinned_cert));
-	} else {
-		g_string_append(json, "\"tls_pinned_cert\":null,");
-	}
-
-	if (rec->tls_pinned_pubkey != NULL) {
-		g_string_append_printf(json, "\"tls_pinned_pubkey\":\"%s\",",
-		                       fe_web_escape_json(rec->tls_pinned_pubkey));
-	} else {
-		g_string_append(json, "\"tls_pinned_pubkey\":null,");
-	}
+	fe_web_json_member_string(&writer, "tls_cafile", rec->tls_cafile);
+	fe_web_json_member_string(&writer, "tls_capath", rec->tls_capath);
+	fe_web_json_member_string(&writer, "tls_ciphers", rec->tls_ciphers);
+	fe_web_json_member_string(&writer, "tls_pinned_cert", rec->tls_pinned_cert);
+	fe_web_json_member_string(&writer, "tls_pinned_pubkey", rec->tls_pinned_pubkey);
 
 	/* Network binding */
-	if (rec->own_host != NULL) {
-		g_string_append_printf(json, "\"own_host\":\"%s\",",
-		                       fe_web_escape_json(rec->own_host));
-	} else {
-		g_string_append(json, "\"own_host\":null,");
-	}
+	fe_web_json_member_string(&writer, "own_host", rec->own_host);
 
 	/* Numeric settings */
-	g_string_append_printf(json, "\"family\":%d,", rec->family);
-	g_string_append_printf(json, "\"max_cmds_at_once\":%d,", rec->max_cmds_at_once);
-	g_string_append_printf(json, "\"cmd_queue_speed\":%d,", rec->cmd_queue_speed);
-	g_string_append_printf(json, "\"max_query_chans\":%d,", rec->max_query_chans);
-	g_string_append_printf(json, "\"starttls\":%d,", rec->starttls);
+	fe_web_json_member_int(&writer, "family", rec->family);
+	fe_web_json_member_int(&writer, "max_cmds_at_once", rec->max_cmds_at_once);
+	fe_web_json_member_int(&writer, "cmd_queue_speed", rec->cmd_queue_speed);
+	fe_web_json_member_int(&writer, "max_query_chans", rec->max_query_chans);
+	fe_web_json_member_int(&writer, "starttls", rec->starttls);
 
 	/* More boolean flags */
-	g_string_append_printf(json, "\"no_cap\":%s,", rec->no_cap ? "true" : "false");
-	g_string_append_printf(json, "\"no_proxy\":%s,", rec->no_proxy ? "true" : "false");
-	g_string_append_printf(json, "\"last_failed\":%s,", rec->last_failed ? "true" : "false");
-	g_string_append_printf(json, "\"banned\":%s,", rec->banned ? "true" : "false");
-	g_string_append_printf(json, "\"dns_error\":%s", rec->dns_error ? "true" : "false");
-
-	g_string_append(json, "}");
+	fe_web_json_member_bool(&writer, "no_cap", rec->no_cap);
+	fe_web_json_member_bool(&writer, "no_proxy", rec->no_proxy);
+	fe_web_json_member_bool(&writer, "last_failed", rec->last_failed);
+	fe_web_json_member_bool(&writer, "banned", rec->banned);
+	fe_web_json_member_bool(&writer, "dns_error", rec->dns_error);
 
+	fe_web_json_end_object(&writer);
 	return json;
 }
 
@@ -453,28 +781,16 @@ GString *fe_web_build_server_json(IRC_SERVER_SETUP_REC *rec)
 GString *fe_web_build_command_result_json(gboolean success, const char *message,
                                           const char *error_code)
 {
+	WEB_JSON_WRITER writer;
 	GString *json;
-	char *escaped_msg;
-
-	json = g_string_new("{");
-	g_string_append_printf(json, "\"success\":%s,", success ? "true" : "false");
-
-	if (message != NULL) {
-		escaped_msg = fe_web_escape_json(message);
-		g_string_append_printf(json, "\"message\":\"%s\",", escaped_msg);
-		g_free(escaped_msg);
-	} else {
-		g_string_append(json, "\"message\":null,");
-	}
-
-	if (error_code != NULL) {
-		g_string_append_printf(json, "\"error_code\":\"%s\"",
-		                       fe_web_escape_json(error_code));
-	} else {
-		g_string_append(json, "\"error_code\":null");
-	}
 
-	g_string_append(json, "}");
+	json = g_string_new(NULL);
+	fe_web_json_writer_init(&writer, json);
+	fe_web_json_begin_object(&writer);
+	fe_web_json_member_bool(&writer, "success", success);
+	fe_web_json_member_string(&writer, "message", message);
+	fe_web_json_member_string(&writer, "error_code", error_code);
+	fe_web_json_end_object(&writer);
 
 	return json;
 }
@@ -56,7 +56,7 @@ static void send_command_result(WEB_CLIENT_REC *client, const char *request_id,
 }
 
 /* Handle network_list request */
-void fe_web_handle_network_list(WEB_CLIENT_REC *client, const char *json_str)
+void fe_web_handle_network_list(WEB_CLIENT_REC *client, WEB_JSON_REC *req)
 {
 	WEB_MESSAGE_REC *msg;
 	GString *networks_array;
@@ -64,7 +64,7 @@ void fe_web_handle_network_list(WEB_CLIENT_REC *client, const char *json_str)
 	gboolean first;
 	char *request_id;
 
-	request_id = fe_web_json_get_string(json_str, "id");
+	request_id = fe_web_json_get_string(req, "id");
 
 	/* Build networks JSON array */
 	networks_array = g_string_new("[");
@@ -111,7 +111,7 @@ void fe_web_handle_network_list(WEB_CLIENT_REC *client, const char *json_str)
 }
 
 /* Handle server_list request */
-void fe_web_handle_server_list(WEB_CLIENT_REC *client, const char *json_str)
+void fe_web_handle_server_list(WEB_CLIENT_REC *client, WEB_JSON_REC *req)
 {
 	WEB_MESSAGE_REC *msg;
 	GString *servers_array;
@@ -120,8 +120,8 @@ void fe_web_handle_server_list(WEB_CLIENT_REC *client, const char *json_str)
 	char *request_id;
 	char *filter_network;
 
-	request_id = fe_web_json_get_string(json_str, "id");
-	filter_network = fe_web_json_get_string(json_str, "network");
+	request_id = fe_web_json_get_string(req, "id");
+	filter_network = fe_web_json_get_string(req, "network");
 
 	/* Build servers JSON array */
 	servers_array = g_string_new("[");
@@ -177,7 +177,7 @@ void fe_web_handle_server_list(WEB_CLIENT_REC *client, const char *json_str)
 }
 
 /* Handle network_add request */
-void fe_web_handle_network_add(WEB_CLIENT_REC *client, const char *json_str)
+void fe_web_handle_network_add(WEB_CLIENT_REC *client, WEB_JSON_REC *req)
 {
 	char *request_id;
 	char *name;
@@ -195,12 +195,16 @@ void fe_web_handle_network_add(WEB_CLIENT_REC *client, const char *json_str)
 	char *sasl_username;
 	char *sasl_password;
 	char *msg;
+	WEB_JSON_REC *fields;
 
-	request_id = fe_web_json_get_string(json_str, "id");
+	request_id = fe_web_json_get_string(req, "id");
 
-	/* Extract network name from nested "network" object */
-	/* Simplified JSON parsing - looking for "network":{"name":"..." */
-	name = fe_web_json_get_string(json_str, "name");
+	/* Fields are either in a nested "network" object or at top level */
+	fields = fe_web_json_get(req, "network");
+	if (fields == NULL || fields->type != WEB_JSON_OBJECT) {
+		fields = req;
+	}
+	name = fe_web_json_get_string(fields, "name");
 	
 	if (name == NULL || *name == '\0') {
 		send_command_result(client, request_id, FALSE,
@@ -221,38 +225,37 @@ void fe_web_handle_network_add(WEB_CLIENT_REC *client, const char *json_str)
 		rec = existing;
 	}
 
-	/* Parse and update all fields from JSON */
-	/* Note: This is simplified - real implementation would parse nested "network" object */
-	
-	nick = fe_web_json_get_string(json_str, "nick");
+	/* Update all fields present in the request */
+
+	nick = fe_web_json_get_string(fields, "nick");
 	if (nick != NULL) {
 		g_free_not_null(rec->nick);
 		rec->nick = g_strdup(nick);
 		g_free(nick);
 	}
 	
-	alternate_nick = fe_web_json_get_string(json_str, "alternate_nick");
+	alternate_nick = fe_web_json_get_string(fields, "alternate_nick");
 	if (alternate_nick != NULL) {
 		g_free_not_null(rec->alternate_nick);
 		rec->alternate_nick = g_strdup(alternate_nick);
 		g_free(alternate_nick);
 	}
 	
-	username = fe_web_json_get_string(json_str, "username");
+	username = fe_web_json_get_string(fields, "username");
 	if (username != NULL) {
 		g_free_not_null(rec->username);
 		rec->username = g_strdup(username);
 		g_free(username);
 	}
 	
-	realname = fe_web_json_get_string(json_str, "realname");
+	realname = fe_web_json_get_string(fields, "realname");
 	if (realname != NULL) {
 		g_free_not_null(rec->realname);
 		rec->realname = g_strdup(realname);
 		g_free(realname);
 	}
 	
-	own_host = fe_web_json_get_string(json_str, "own_host");
+	own_host = fe_web_json_get_string(fields, "own_host");
 	if (own_host != NULL) {
 		g_free_not_null(rec->own_host);
 		rec->own_host = g_strdup(own_host);
@@ -260,35 +263,35 @@ void fe_web_handle_network_add(WEB_CLIENT_REC *client, const char *json_str)
 		g_free(own_host);
 	}
 	
-	autosendcmd = fe_web_json_get_string(json_str, "autosendcmd");
+	autosendcmd = fe_web_json_get_string(fields, "autosendcmd");
 	if (autosendcmd != NULL) {
 		g_free_not_null(rec->autosendcmd);
 		rec->autosendcmd = g_strdup(autosendcmd);
 		g_free(autosendcmd);
 	}
 	
-	usermode = fe_web_json_get_string(json_str, "usermode");
+	usermode = fe_web_json_get_string(fields, "usermode");
 	if (usermode != NULL) {
 		g_free_not_null(rec->usermode);
 		rec->usermode = g_strdup(usermode);
 		g_free(usermode);
 	}
 	
-	sasl_mechanism = fe_web_json_get_string(json_str, "sasl_mechanism");
+	sasl_mechanism = fe_web_json_get_string(fields, "sasl_mechanism");
 	if (sasl_mechanism != NULL) {
 		g_free_not_null(rec->sasl_mechanism);
 		rec->sasl_mechanism = g_strdup(sasl_mechanism);
 		g_free(sasl_mechanism);
 	}
 	
-	sasl_username = fe_web_json_get_string(json_str, "sasl_username");
+	sasl_username = fe_web_json_get_string(fields, "sasl_username");
 	if (sasl_username != NULL) {
 		g_free_not_null(rec->sasl_username);
 		rec->sasl_username = g_strdup(sasl_username);
 		g_free(sasl_username);
 	}
 	
-	sasl_password = fe_web_json_get_string(json_str, "sasl_password");
+	sasl_password = fe_web_json_get_string(fields, "sasl_password");
 	if (sasl_password != NULL) {
 		g_free_not_null(rec->sasl_password);
 		rec->sasl_password = g_strdup(sasl_password);
@@ -296,26 +299,26 @@ void fe_web_handle_network_add(WEB_CLIENT_REC *client, const char *json_str)
 	}
 	
 	/* Numeric fields */
-	if (fe_web_json_has_key(json_str, "max_kicks")) {
-		rec->max_kicks = fe_web_json_get_int(json_str, "max_kicks", 0);
+	if (fe_web_json_has_key(fields, "max_kicks")) {
+		rec->max_kicks = fe_web_json_get_int(fields, "max_kicks", 0);
 	}
-	if (fe_web_json_has_key(json_str, "max_msgs")) {
-		rec->max_msgs = fe_web_json_get_int(json_str, "max_msgs", 0);
+	if (fe_web_json_has_key(fields, "max_msgs")) {
+		rec->max_msgs = fe_web_json_get_int(fields, "max_msgs", 0);
 	}
-	if (fe_web_json_has_key(json_str, "max_modes")) {
-		rec->max_modes = fe_web_json_get_int(json_str, "max_modes", 0);
+	if (fe_web_json_has_key(fields, "max_modes")) {
+		rec->max_modes = fe_web_json_get_int(fields, "max_modes", 0);
 	}
-	if (fe_web_json_has_key(json_str, "max_whois")) {
-		rec->max_whois = fe_web_json_get_int(json_str, "max_whois", 0);
+	if (fe_web_json_has_key(fields, "max_whois")) {
+		rec->max_whois = fe_web_json_get_int(fields, "max_whois", 0);
 	}
-	if (fe_web_json_has_key(json_str, "max_cmds_at_once")) {
-		rec->max_cmds_at_once = fe_web_json_get_int(json_str, "max_cmds_at_once", 0);
+	if (fe_web_json_has_key(fields, "max_cmds_at_once")) {
+		rec->max_cmds_at_once = fe_web_json_get_int(fields, "max_cmds_at_once", 0);
 	}
-	if (fe_web_json_has_key(json_str, "cmd_queue_speed")) {
-		rec->cmd_queue_speed = fe_web_json_get_int(json_str, "cmd_queue_speed", 0);
+	if (fe_web_json_has_key(fields, "cmd_queue_speed")) {
+		rec->cmd_queue_speed = fe_web_json_get_int(fields, "cmd_queue_speed", 0);
 	}
-	if (fe_web_json_has_key(json_str, "max_query_chans")) {
-		rec->max_query_chans = fe_web_json_get_int(json_str, "max_query_chans", 0);
+	if (fe_web_json_has_key(fields, "max_query_chans")) {
+		rec->max_query_chans = fe_web_json_get_int(fields, "max_query_chans", 0);
 	}
 
 	/* Create/update network */
@@ -334,15 +337,15 @@ void fe_web_handle_network_add(WEB_CLIENT_REC *client, const char *json_str)
 }
 
 /* Handle network_remove request */
-void fe_web_handle_network_remove(WEB_CLIENT_REC *client, const char *json_str)
+void fe_web_handle_network_remove(WEB_CLIENT_REC *client, WEB_JSON_REC *req)
 {
 	char *request_id;
 	char *name;
 	IRC_CHATNET_REC *rec;
 	char *msg;
 
-	request_id = fe_web_json_get_string(json_str, "id");
-	name = fe_web_json_get_string(json_str, "name");
+	request_id = fe_web_json_get_string(req, "id");
+	name = fe_web_json_get_string(req, "name");
 	
 	if (name == NULL || *name == '\0') {
 		send_command_result(client, request_id, FALSE,
@@ -381,7 +384,7 @@ void fe_web_handle_network_remove(WEB_CLIENT_REC *client, const char *json_str)
 }
 
 /* Handle server_add request */
-void fe_web_handle_server_add(WEB_CLIENT_REC *client, const char *json_str)
+void fe_web_handle_server_add(WEB_CLIENT_REC *client, WEB_JSON_REC *req)
 {
 	char *request_id;
 	char *address;
@@ -395,12 +398,19 @@ void fe_web_handle_server_add(WEB_CLIENT_REC *client, const char *json_str)
 	char *tls_pkey;
 	char *tls_cafile;
 	char *msg;
+	WEB_JSON_REC *fields;
 
-	request_id = fe_web_json_get_string(json_str, "id");
+	request_id = fe_web_json_get_string(req, "id");
+
+	/* Fields are either in a nested "server" object or at top level */
+	fields = fe_web_json_get(req, "server");
+	if (fields == NULL || fields->type != WEB_JSON_OBJECT) {
+		fields = req;
+	}
 
 	/* Extract required fields */
-	address = fe_web_json_get_string(json_str, "address");
-	port = fe_web_json_get_int(json_str, "port", 6667);
+	address = fe_web_json_get_string(fields, "address");
+	port = fe_web_json_get_int(fields, "port", 6667);
 	
 	if (address == NULL || *address == '\0') {
 		send_command_result(client, request_id, FALSE,
@@ -411,7 +421,7 @@ void fe_web_handle_server_add(WEB_CLIENT_REC *client, const char *json_str)
 	}
 
 	/* Check if server already exists */
-	chatnet = fe_web_json_get_string(json_str, "chatnet");
+	chatnet = fe_web_json_get_string(fields, "chatnet");
 	existing = IRC_SERVER_SETUP(server_setup_find(address, port, chatnet));
 	is_new = (existing == NULL);
 	
@@ -424,40 +434,40 @@ void fe_web_handle_server_add(WEB_CLIENT_REC *client, const char *json_str)
 		rec = existing;
 	}
 
-	/* Update fields from JSON (simplified parsing) */
-	password = fe_web_json_get_string(json_str, "password");
+	/* Update fields present in the request */
+	password = fe_web_json_get_string(fields, "password");
 	if (password != NULL && g_strcmp0(password, "***") != 0) {
 		g_free_not_null(rec->password);
 		rec->password = g_strdup(password);
 		g_free(password);
 	}
 	
-	if (fe_web_json_has_key(json_str, "autoconnect")) {
-		rec->autoconnect = fe_web_json_get_int(json_str, "autoconnect", 0);
+	if (fe_web_json_has_key(fields, "autoconnect")) {
+		rec->autoconnect = fe_web_json_get_int(fields, "autoconnect", 0);
 	}
-	if (fe_web_json_has_key(json_str, "use_tls")) {
-		rec->use_tls = fe_web_json_get_int(json_str, "use_tls", 0);
+	if (fe_web_json_has_key(fields, "use_tls")) {
+		rec->use_tls = fe_web_json_get_int(fields, "use_tls", 0);
 	}
-	if (fe_web_json_has_key(json_str, "tls_verify")) {
-		rec->tls_verify = fe_web_json_get_int(json_str, "tls_verify", 0);
+	if (fe_web_json_has_key(fields, "tls_verify")) {
+		rec->tls_verify = fe_web_json_get_int(fields, "tls_verify", 0);
 	}
 	
 	/* TLS certificate fields */
-	tls_cert = fe_web_json_get_string(json_str, "tls_cert");
+	tls_cert = fe_web_json_get_string(fields, "tls_cert");
 	if (tls_cert != NULL) {
 		g_free_not_null(rec->tls_cert);
 		rec->tls_cert = g_strdup(tls_cert);
 		g_free(tls_cert);
 	}
 	
-	tls_pkey = fe_web_json_get_string(json_str, "tls_pkey");
+	tls_pkey = fe_web_json_get_string(fields, "tls_pkey");
 	if (tls_pkey != NULL) {
 		g_free_not_null(rec->tls_pkey);
 		rec->tls_pkey = g_strdup(tls_pkey);
 		g_free(tls_pkey);
 	}
 	
-	tls_cafile = fe_web_json_get_string(json_str, "tls_cafile");
+	tls_cafile = fe_web_json_get_string(fields, "tls_cafile");
 	if (tls_cafile != NULL) {
 		g_free_not_null(rec->tls_cafile);
 		rec->tls_cafile = g_strdup(tls_cafile);
@@ -465,17 +475,17 @@ void fe_web_handle_server_add(WEB_CLIENT_REC *client, const char *json_str)
 	}
 	
 	/* Numeric settings */
-	if (fe_web_json_has_key(json_str, "max_cmds_at_once")) {
-		rec->max_cmds_at_once = fe_web_json_get_int(json_str, "max_cmds_at_once", 0);
+	if (fe_web_json_has_key(fields, "max_cmds_at_once")) {
+		rec->max_cmds_at_once = fe_web_json_get_int(fields, "max_cmds_at_once", 0);
 	}
-	if (fe_web_json_has_key(json_str, "cmd_queue_speed")) {
-		rec->cmd_queue_speed = fe_web_json_get_int(json_str, "cmd_queue_speed", 0);
+	if (fe_web_json_has_key(fields, "cmd_queue_speed")) {
+		rec->cmd_queue_speed = fe_web_json_get_int(fields, "cmd_queue_speed", 0);
 	}
-	if (fe_web_json_has_key(json_str, "starttls")) {
-		rec->starttls = fe_web_json_get_int(json_str, "starttls", 0);
+	if (fe_web_json_has_key(fields, "starttls")) {
+		rec->starttls = fe_web_json_get_int(fields, "starttls", 0);
 	}
-	if (fe_web_json_has_key(json_str, "no_cap")) {
-		rec->no_cap = fe_web_json_get_int(json_str, "no_cap", 0);
+	if (fe_web_json_has_key(fields, "no_cap")) {
+		rec->no_cap = fe_web_json_get_int(fields, "no_cap", 0);
 	}
 
 	/* Add/modify server */
@@ -497,7 +507,7 @@ void fe_web_handle_server_add(WEB_CLIENT_REC *client, const char *json_str)
 }
 
 /* Handle server_remove request */
-void fe_web_handle_server_remove(WEB_CLIENT_REC *client, const char *json_str)
+void fe_web_handle_server_remove(WEB_CLIENT_REC *client, WEB_JSON_REC *req)
 {
 	char *request_id;
 	char *address;
@@ -506,10 +516,10 @@ void fe_web_handle_server_remove(WEB_CLIENT_REC *client, const char *json_str)
 	SERVER_SETUP_REC *rec;
 	char *msg;
 
-	request_id = fe_web_json_get_string(json_str, "id");
-	address = fe_web_json_get_string(json_str, "address");
-	port = fe_web_json_get_int(json_str, "port", 6667);
-	chatnet = fe_web_json_get_string(json_str, "chatnet");
+	request_id = fe_web_json_get_string(req, "id");
+	address = fe_web_json_get_string(req, "address");
+	port = fe_web_json_get_int(req, "port", 6667);
+	chatnet = fe_web_json_get_string(req, "chatnet");
 	
 	if (address == NULL || *address == '\0') {
 		send_command_result(client, request_id, FALSE,
@@ -114,6 +114,34 @@ static int fe_web_verify_password(const char *data)
 	return result;
 }
 
+/* Accept the FE_WEB_PROTOCOL_DEFLATE subprotocol if the client offers it
+   and add our answer to response */
+static void fe_web_negotiate_deflate(WEB_CLIENT_REC *client, const char *data, GString *response)
+{
+	const char *line;
+	const char *end;
+	char *protocols;
+
+	if (!settings_get_bool("fe_web_compression")) {
+		return;
+	}
+
+	line = strcasestr(data, "\nSec-WebSocket-Protocol:");
+	if (line == NULL) {
+		return;
+	}
+	line += strlen("\nSec-WebSocket-Protocol:");
+	end = strpbrk(line, "\r\n");
+	protocols = end != NULL ? g_strndup(line, end - line) : g_strdup(line);
+
+	if (fe_web_websocket_has_protocol(protocols, FE_WEB_PROTOCOL_DEFLATE)) {
+		client->inflate = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW));
+
+		g_string_append(response, "Sec-WebSocket-Protocol: " FE_WEB_PROTOCOL_DEFLATE "\r\n");
+	}
+	g_free(protocols);
+}
+
 /* Handle WebSocket handshake (RFC 6455) */
 static int fe_web_handle_handshake(WEB_CLIENT_REC *client, const char *data)
 {
@@ -197,6 +225,7 @@ static int fe_web_handle_handshake(WEB_CLIENT_REC *client, const char *data)
 	g_string_append(response, "Upgrade: websocket\r\n");
 	g_string_append(response, "Connection: Upgrade\r\n");
 	g_string_append_printf(response, "Sec-WebSocket-Accept: %s\r\n", accept_key);
+	fe_web_negotiate_deflate(client, data, response);
 	g_string_append(response, "\r\n");
 
 	/* Send response - MUST use SSL if enabled! */
@@ -230,6 +259,74 @@ static int fe_web_handle_handshake(WEB_CLIENT_REC *client, const char *data)
 	return 1;
 }
 
+/* Handle a complete, possibly reassembled, data message.
+   Returns FALSE if the client was closed. */
+static int fe_web_handle_websocket_message(WEB_CLIENT_REC *client, int opcode,
+                                           const guchar *payload, gsize payload_len)
+{
+	/* Binary frame = encrypted data */
+	if (opcode == 0x2) {
+		unsigned char *decrypted;
+		int decrypted_len;
+		const unsigned char *key;
+		GByteArray *inflated;
+
+		if (!client->encryption_enabled) {
+			printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
+			          "fe-web: [%s] Received encrypted data but encryption not enabled", client->id);
+			fe_web_close_client(client);
+			return FALSE;
+		}
+
+		key = fe_web_crypto_get_key();
+		if (key == NULL) {
+			printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
+			          "fe-web: [%s] Encryption key not available", client->id);
+			fe_web_close_client(client);
+			return FALSE;
+		}
+
+		/* Allocate buffer for decrypted data */
+		decrypted = g_malloc(payload_len + 1);
+
+		/* Decrypt */
+		if (!fe_web_crypto_decrypt(payload, payload_len, key, decrypted, &decrypted_len)) {
+			printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
+			          "fe-web: [%s] Decryption failed - wrong password or tampered data", client->id);
+			g_free(decrypted);
+			fe_web_close_client(client);
+			return FALSE;
+		}
+
+		/* Compressed JSON (FE_WEB_PROTOCOL_DEFLATE) */
+		if (client->inflate != NULL && decrypted_len > 0 &&
+		    decrypted[0] == FE_WEB_DEFLATE_MARKER) {
+			inflated = fe_web_websocket_inflate(client->inflate, decrypted + 1,
+			                                    decrypted_len - 1);
+			g_free(decrypted);
+			if (inflated == NULL) {
+				printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
+				          "fe-web: [%s] Invalid or oversized compressed message",
+				          client->id);
+				fe_web_close_client(client);
+				return FALSE;
+			}
+
+			decrypted_len = inflated->len;
+			decrypted = g_byte_array_free(inflated, FALSE);
+		}
+
+		/* Handle JSON message */
+		fe_web_client_handle_message(client, (const char *)decrypted, decrypted_len);
+		g_free(decrypted);
+	} else {
+		/* Handle JSON message */
+		fe_web_client_handle_message(client, (const char *)payload, payload_len);
+	}
+
+	return TRUE;
+}
+
 /* Handle WebSocket data */
 static void fe_web_handle_websocket_data(WEB_CLIENT_REC *client)
 {
@@ -240,7 +337,6 @@ static void fe_web_handle_websocket_data(WEB_CLIENT_REC *client)
 	guchar mask_key[4];
 	const guchar *payload;
 	int ret;
-	guchar *unmasked_payload;
 	gsize frame_total_len;
 
 	while (client->input_buffer->len > 0) {
@@ -255,7 +351,9 @@ static void fe_web_handle_websocket_data(WEB_CLIENT_REC *client)
 			break;
 		}
 
-		if (ret < 0) {
+		/* Client frames must be masked, control frames can't be
+		   fragmented (RFC 6455 5.1, 5.5) */
+		if (ret < 0 || !masked || ((opcode & 0x8) && (!fin || payload_len > 125))) {
 			/* Invalid frame - close connection */
 			fe_web_close_client(client);
 			return;
@@ -264,62 +362,47 @@ static void fe_web_handle_websocket_data(WEB_CLIENT_REC *client)
 		/* Calculate total frame length */
 		frame_total_len = (payload - client->input_buffer->data) + payload_len;
 
+		/* Unmask payload in place */
+		fe_web_websocket_unmask((guchar *)payload, payload_len, mask_key);
+
 		/* Handle different opcodes */
 		if (opcode == 0x1 || opcode == 0x2) { /* Text frame or Binary frame (encrypted) */
-			/* Unmask payload if needed */
-			if (masked) {
-				unmasked_payload = g_malloc(payload_len + 1);
-				memcpy(unmasked_payload, payload, payload_len);
-				fe_web_websocket_unmask(unmasked_payload, payload_len, mask_key);
-				unmasked_payload[payload_len] = '\0';
-
-				/* Binary frame = encrypted data */
-				if (opcode == 0x2) {
-					unsigned char *decrypted;
-					int decrypted_len;
-					const unsigned char *key;
-
-					if (!client->encryption_enabled) {
-						printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
-						          "fe-web: [%s] Received encrypted data but encryption not enabled", client->id);
-						g_free(unmasked_payload);
-						fe_web_close_client(client);
-						return;
-					}
-
-					key = fe_web_crypto_get_key();
-					if (key == NULL) {
-						printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
-						          "fe-web: [%s] Encryption key not available", client->id);
-						g_free(unmasked_payload);
-						fe_web_close_client(client);
-						return;
-					}
-
-					/* Allocate buffer for decrypted data */
-					decrypted = g_malloc(payload_len);
-
-					/* Decrypt */
-					if (!fe_web_crypto_decrypt(unmasked_payload, payload_len, key, decrypted, &decrypted_len)) {
-						printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
-						          "fe-web: [%s] Decryption failed - wrong password or tampered data", client->id);
-						g_free(unmasked_payload);
-						g_free(decrypted);
-						fe_web_close_client(client);
-						return;
-					}
-
-					/* Null-terminate decrypted JSON */
-					g_free(unmasked_payload);
-					unmasked_payload = g_malloc(decrypted_len + 1);
-					memcpy(unmasked_payload, decrypted, decrypted_len);
-					unmasked_payload[decrypted_len] = '\0';
-					g_free(decrypted);
+			if (client->fragments != NULL) {
+				/* Previous message wasn't finished */
+				fe_web_close_client(client);
+				return;
+			}
+
+			if (fin) {
+				if (!fe_web_handle_websocket_message(client, opcode, payload,
+				                                     payload_len)) {
+					return;
 				}
+			} else {
+				/* First fragment of a message */
+				client->fragments = g_byte_array_sized_new(payload_len * 2);
+				client->fragments_opcode = opcode;
+				g_byte_array_append(client->fragments, payload, payload_len);
+			}
+		} else if (opcode == 0x0) { /* Continuation frame */
+			if (client->fragments == NULL ||
+			    client->fragments->len + payload_len > FE_WEB_MAX_MESSAGE_SIZE) {
+				fe_web_close_client(client);
+				return;
+			}
 
-				/* Handle JSON message */
-				fe_web_client_handle_message(client, (const char *)unmasked_payload);
-				g_free(unmasked_payload);
+			g_byte_array_append(client->fragments, payload, payload_len);
+
+			if (fin) {
+				GByteArray *message = client->fragments;
+
+				client->fragments = NULL;
+				ret = fe_web_handle_websocket_message(client, client->fragments_opcode,
+				                                      message->data, message->len);
+				g_byte_array_free(message, TRUE);
+				if (!ret) {
+					return;
+				}
 			}
 		} else if (opcode == 0x8) { /* Close frame */
 			fe_web_close_client(client);
@@ -339,8 +422,10 @@ static void fe_web_handle_websocket_data(WEB_CLIENT_REC *client)
 			}
 
 			g_free(pong_frame);
+		} else if (opcode != 0xA) { /* Pong is ignored, anything else is an error */
+			fe_web_close_client(client);
+			return;
 		}
-		/* Opcode 0xA (pong) - ignore */
 
 		/* Remove processed frame from buffer */
 		g_byte_array_remove_range(client->input_buffer, 0, frame_total_len);
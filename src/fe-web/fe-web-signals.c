@@ -144,7 +144,7 @@ void fe_web_send_nicklist_for_channel(IRC_SERVER_REC *server, IRC_CHANNEL_REC *c
 
 	/* Build nicklist JSON */
 	nicklist = g_string_new("[");
-	nicks = nicklist_getnicks(CHANNEL(channel));
+	nicks = nicklist_get_sorted(CHANNEL(channel), 0, -1);
 	for (nick_tmp = nicks; nick_tmp != NULL; nick_tmp = nick_tmp->next) {
 		NICK_REC *nick = nick_tmp->data;
 		char *escaped_nick;
@@ -855,7 +855,7 @@ static void sig_channel_joined(IRC_CHANNEL_REC *channel)
 		GSList *nicks;
 		GSList *nick_tmp;
 
-		nicks = nicklist_getnicks(CHANNEL(channel));
+		nicks = nicklist_get_sorted(CHANNEL(channel), 0, -1);
 		for (nick_tmp = nicks; nick_tmp != NULL; nick_tmp = nick_tmp->next) {
 			NICK_REC *nick = nick_tmp->data;
 			char *escaped_nick;
@@ -1714,7 +1714,7 @@ static void fe_web_dump_server_state(WEB_CLIENT_REC *client, IRC_SERVER_REC *ser
 			GSList *nicks;
 			GSList *nick_tmp;
 
-			nicks = nicklist_getnicks(CHANNEL(channel));
+			nicks = nicklist_get_sorted(CHANNEL(channel), 0, -1);
 			for (nick_tmp = nicks; nick_tmp != NULL; nick_tmp = nick_tmp->next) {
 				NICK_REC *nick = nick_tmp->data;
 				char *escaped_nick;
@@ -39,60 +39,17 @@ char *fe_web_generate_message_id(void)
 	return id;
 }
 
-/* Escape JSON string - handles UTF-8 correctly
- * JSON supports UTF-8 natively, so we only escape:
- * - Special JSON characters: " \
- * - Control characters (< 32): \b \f \n \r \t and others as \uXXXX
- * - UTF-8 multi-byte sequences (> 127) are passed through unchanged
- */
+/* Escape JSON string - handles UTF-8 correctly */
 char *fe_web_escape_json(const char *str)
 {
 	GString *result;
-	const unsigned char *p;
 
 	if (str == NULL) {
 		return g_strdup("");
 	}
 
-	result = g_string_new("");
-
-	for (p = (const unsigned char *) str; *p != '\0'; p++) {
-		switch (*p) {
-		case '"':
-			g_string_append(result, "\\\"");
-			break;
-		case '\\':
-			g_string_append(result, "\\\\");
-			break;
-		case '\b':
-			g_string_append(result, "\\b");
-			break;
-		case '\f':
-			g_string_append(result, "\\f");
-			break;
-		case '\n':
-			g_string_append(result, "\\n");
-			break;
-		case '\r':
-			g_string_append(result, "\\r");
-			break;
-		case '\t':
-			g_string_append(result, "\\t");
-			break;
-		default:
-			/* Only escape control characters (< 32)
-			 * UTF-8 bytes (>= 128) and regular ASCII (>= 32 && < 128)
-			 * are passed through unchanged */
-			if (*p < 32) {
-				g_string_append_printf(result, "\\u%04x", *p);
-			} else {
-				/* Pass through: regular ASCII and UTF-8 bytes */
-				g_string_append_c(result, *p);
-			}
-			break;
-		}
-	}
-
+	result = g_string_sized_new(strlen(str) + 16);
+	fe_web_json_append_escaped(result, str);
 	return g_string_free(result, FALSE);
 }
 
@@ -164,6 +121,8 @@ static const char *fe_web_type_to_string(WEB_MESSAGE_TYPE type)
 		return "server_remove";
 	case WEB_MSG_COMMAND_RESULT:
 		return "command_result";
+	case WEB_MSG_BACKLOG_END:
+		return "backlog_end";
 	default:
 		return "unknown";
 	}
@@ -208,96 +167,86 @@ void fe_web_message_free(WEB_MESSAGE_REC *msg)
 /* Serialize message to JSON */
 char *fe_web_message_to_json(WEB_MESSAGE_REC *msg)
 {
+	WEB_JSON_WRITER writer;
 	GString *json;
-	char *escaped;
 
-	json = g_string_new("{");
+	json = g_string_sized_new(256);
+	fe_web_json_writer_init(&writer, json);
+	fe_web_json_begin_object(&writer);
 
 	/* id */
 	if (msg->id != NULL) {
-		escaped = fe_web_escape_json(msg->id);
-		g_string_append_printf(json, "\"id\":\"%s\",", escaped);
-		g_free(escaped);
+		fe_web_json_member_string(&writer, "id", msg->id);
 	}
 
 	/* type */
-	g_string_append_printf(json, "\"type\":\"%s\"", fe_web_type_to_string(msg->type));
+	fe_web_json_member_string(&writer, "type", fe_web_type_to_string(msg->type));
 
 	/* response_to (for WHOIS, channel_list) */
 	if (msg->response_to != NULL) {
-		escaped = fe_web_escape_json(msg->response_to);
-		g_string_append_printf(json, ",\"response_to\":\"%s\"", escaped);
-		g_free(escaped);
+		fe_web_json_member_string(&writer, "response_to", msg->response_to);
 	}
 
 	/* server */
 	if (msg->server_tag != NULL) {
-		escaped = fe_web_escape_json(msg->server_tag);
-		g_string_append_printf(json, ",\"server\":\"%s\"", escaped);
-		g_free(escaped);
+		fe_web_json_member_string(&writer, "server", msg->server_tag);
 	}
 
 	/* channel/target */
 	if (msg->target != NULL) {
-		escaped = fe_web_escape_json(msg->target);
-		g_string_append_printf(json, ",\"channel\":\"%s\"", escaped);
-		g_free(escaped);
+		fe_web_json_member_string(&writer, "channel", msg->target);
 	}
 
 	/* nick */
 	if (msg->nick != NULL) {
-		escaped = fe_web_escape_json(msg->nick);
-		g_string_append_printf(json, ",\"nick\":\"%s\"", escaped);
-		g_free(escaped);
+		fe_web_json_member_string(&writer, "nick", msg->nick);
 	}
 
 	/* text (or "task" for nicklist_update, or raw JSON for network_list/server_list) */
 	if (msg->text != NULL) {
 		if (msg->type == WEB_MSG_NICKLIST_UPDATE) {
 			/* For nicklist_update, serialize text field as "task" */
-			escaped = fe_web_escape_json(msg->text);
-			g_string_append_printf(json, ",\"task\":\"%s\"", escaped);
-			g_free(escaped);
+			fe_web_json_member_string(&writer, "task", msg->text);
 		} else if (msg->type == WEB_MSG_NETWORK_LIST_RESPONSE) {
 			/* For network_list_response, text contains JSON array - insert raw */
-			g_string_append_printf(json, ",\"networks\":%s", msg->text);
+			fe_web_json_key(&writer, "networks");
+			fe_web_json_raw(&writer, msg->text);
 		} else if (msg->type == WEB_MSG_SERVER_LIST_RESPONSE) {
 			/* For server_list_response, text contains JSON array - insert raw */
-			g_string_append_printf(json, ",\"servers\":%s", msg->text);
+			fe_web_json_key(&writer, "servers");
+			fe_web_json_raw(&writer, msg->text);
 		} else if (msg->type == WEB_MSG_COMMAND_RESULT) {
-			/* For command_result, text contains JSON object - insert raw (without outer
-			 * braces) */
-			if (msg->text[0] == '{' && msg->text[strlen(msg->text) - 1] == '}') {
-				/* Skip outer braces and insert content */
-				char *content = g_strndup(msg->text + 1, strlen(msg->text) - 2);
-				g_string_append_printf(json, ",%s", content);
-				g_free(content);
+			/* For command_result, text contains JSON object - insert its
+			 * members raw (without outer braces) */
+			gsize len = strlen(msg->text);
+			if (len >= 2 && msg->text[0] == '{' && msg->text[len - 1] == '}') {
+				fe_web_json_raw_members(&writer, msg->text + 1, len - 2);
 			}
 		} else {
-			escaped = fe_web_escape_json(msg->text);
-			g_string_append_printf(json, ",\"text\":\"%s\"", escaped);
-			g_free(escaped);
+			fe_web_json_member_string(&writer, "text", msg->text);
 		}
 	}
 
 	/* timestamp */
-	g_string_append_printf(json, ",\"timestamp\":%ld", (long) msg->timestamp);
+	fe_web_json_member_int(&writer, "timestamp", msg->timestamp);
+
+	/* seq - backlog cursor of stored messages, or where backlog_end stopped */
+	if (msg->seq != 0 || msg->type == WEB_MSG_BACKLOG_END) {
+		fe_web_json_member_int(&writer, "seq", msg->seq);
+	}
+	if (msg->type == WEB_MSG_BACKLOG_END) {
+		fe_web_json_member_bool(&writer, "more", msg->has_more);
+	}
 
 	/* level (for message types and activity_update) */
 	/* IMPORTANT: For activity_update, level=0 means "read", so we MUST send it! */
 	if (msg->level != 0 || msg->type == WEB_MSG_ACTIVITY_UPDATE) {
-		g_string_append_printf(json, ",\"level\":%d", msg->level);
+		fe_web_json_member_int(&writer, "level", msg->level);
 	}
 
-	/* is_own */
 	if (msg->type == WEB_MSG_MESSAGE) {
-		g_string_append_printf(json, ",\"is_own\":%s", msg->is_own ? "true" : "false");
-	}
-
-	/* is_highlight */
-	if (msg->type == WEB_MSG_MESSAGE) {
-		g_string_append_printf(json, ",\"is_highlight\":%s",
-		                       msg->is_highlight ? "true" : "false");
+		fe_web_json_member_bool(&writer, "is_own", msg->is_own);
+		fe_web_json_member_bool(&writer, "is_highlight", msg->is_highlight);
 	}
 
 	/* extra_data - serialize hash table if not empty */
@@ -305,57 +254,328 @@ char *fe_web_message_to_json(WEB_MESSAGE_REC *msg)
 		GHashTableIter iter;
 		gpointer key;
 		gpointer value;
-		int first;
 
-		g_string_append(json, ",\"extra\":{");
+		fe_web_json_key(&writer, "extra");
+		fe_web_json_begin_object(&writer);
 
-		first = 1;
 		g_hash_table_iter_init(&iter, msg->extra_data);
 		while (g_hash_table_iter_next(&iter, &key, &value)) {
-			char *escaped_key;
 			const char *key_str = (const char *) key;
 			const char *value_str = (const char *) value;
 
-			if (!first) {
-				g_string_append_c(json, ',');
-			}
-			first = 0;
-
-			escaped_key = fe_web_escape_json(key_str);
+			fe_web_json_key(&writer, key_str);
 
 			/* Special handling for "params" field - it's already JSON array */
 			if (g_strcmp0(key_str, "params") == 0 && value_str != NULL &&
 			    value_str[0] == '[') {
-				/* Raw JSON array - don't escape */
-				g_string_append_printf(json, "\"%s\":%s", escaped_key, value_str);
+				fe_web_json_raw(&writer, value_str);
 			} else {
-				/* Regular string value - escape it */
-				char *escaped_value = fe_web_escape_json(value_str);
-				g_string_append_printf(json, "\"%s\":\"%s\"", escaped_key,
-				                       escaped_value);
-				g_free(escaped_value);
+				/* escaped as before: NULL values become "" */
+				fe_web_json_string(&writer, value_str != NULL ? value_str : "");
 			}
-
-			g_free(escaped_key);
 		}
 
-		g_string_append_c(json, '}');
+		fe_web_json_end_object(&writer);
 	}
 
-	g_string_append_c(json, '}');
+	fe_web_json_end_object(&writer);
 
 	return g_string_free(json, FALSE);
 }
 
-/* Send message to specific client */
-void fe_web_send_message(WEB_CLIENT_REC *client, WEB_MESSAGE_REC *msg)
-{
+/* Encoded form of one message, shared by every client it is sent to.
+   The JSON is serialized when the frame is created, the text and
+   encrypted binary WebSocket frames are built the first time a client
+   needs them. All encrypting clients share the same key and the IV is
+   generated per encryption, so handing the same ciphertext to several
+   clients never reuses a nonce with different plaintext. Clients that
+   negotiated FE_WEB_PROTOCOL_DEFLATE share the compressed binary frame,
+   which doesn't depend on any earlier message. */
+struct _WEB_FRAME_REC {
+	int refcount;
+	WEB_MESSAGE_TYPE type;
+
 	char *json;
-	guchar *frame;
-	gsize frame_len;
+	gsize json_len;
+
+	guchar *text_frame;
+	gsize text_frame_len;
+
+	guchar *binary_frame;
+	gsize binary_frame_len;
+	unsigned int encrypt_failed : 1;
+
+	guchar *deflated_frame;
+	gsize deflated_frame_len;
+	unsigned int deflate_done : 1;
+};
+
+/* Compresses the messages of all clients, reset for every message */
+static GConverter *frame_compressor;
+
+/* Message of several frames being sent to a client. Only one frame of
+   it is written per main loop iteration, so other clients' messages and
+   this client's control frames don't wait for all of it. */
+typedef struct {
+	WEB_FRAME_REC *frame; /* keeps data alive */
+	const guchar *data;
+	gsize len;
+	gsize pos;
+} WEB_SEND_REC;
+
+static guint send_tag;
+
+WEB_FRAME_REC *fe_web_frame_new(WEB_MESSAGE_REC *msg)
+{
+	WEB_FRAME_REC *frame;
+
+	g_return_val_if_fail(msg != NULL, NULL);
+
+	frame = g_new0(WEB_FRAME_REC, 1);
+	frame->refcount = 1;
+	frame->type = msg->type;
+	frame->json = fe_web_message_to_json(msg);
+	frame->json_len = strlen(frame->json);
+	return frame;
+}
+
+/* Frame for a message that was serialized earlier (backlog replay) */
+WEB_FRAME_REC *fe_web_frame_new_json(WEB_MESSAGE_TYPE type, const char *json, gsize len)
+{
+	WEB_FRAME_REC *frame;
+
+	frame = g_new0(WEB_FRAME_REC, 1);
+	frame->refcount = 1;
+	frame->type = type;
+	frame->json = g_strndup(json, len);
+	frame->json_len = len;
+	return frame;
+}
+
+const char *fe_web_frame_get_json(WEB_FRAME_REC *frame, gsize *len)
+{
+	*len = frame->json_len;
+	return frame->json;
+}
+
+WEB_FRAME_REC *fe_web_frame_ref(WEB_FRAME_REC *frame)
+{
+	frame->refcount++;
+	return frame;
+}
+
+void fe_web_frame_unref(WEB_FRAME_REC *frame)
+{
+	if (frame == NULL || --frame->refcount > 0)
+		return;
+
+	g_free(frame->deflated_frame);
+	g_free(frame->binary_frame);
+	g_free(frame->text_frame);
+	g_free(frame->json);
+	g_free(frame);
+}
+
+static const guchar *web_frame_get_text(WEB_FRAME_REC *frame, gsize *len)
+{
+	if (frame->text_frame == NULL) {
+		frame->text_frame =
+		    fe_web_websocket_create_message(0x1, (const guchar *) frame->json,
+		                                    frame->json_len, &frame->text_frame_len);
+	}
+
+	*len = frame->text_frame_len;
+	return frame->text_frame;
+}
+
+/* Encrypt plaintext into a binary WebSocket message. Returns NULL if
+   encryption failed, it isn't retried (and reported) for every client. */
+static guchar *web_frame_encrypt(WEB_FRAME_REC *frame, WEB_CLIENT_REC *client,
+                                 const guchar *plaintext, gsize plaintext_len, gsize *len)
+{
+	const unsigned char *key;
+	unsigned char *encrypted;
+	int encrypted_len;
+	guchar *data;
+
+	if (frame->encrypt_failed)
+		return NULL;
+
+	key = fe_web_crypto_get_key();
+	if (key == NULL) {
+		printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
+		          "fe-web: [%s] Encryption key not available for %s", client->id,
+		          fe_web_type_to_string(frame->type));
+		frame->encrypt_failed = TRUE;
+		return NULL;
+	}
+
+	/* Allocate buffer for encrypted data (plaintext + IV + tag) */
+	encrypted = g_malloc(plaintext_len + FE_WEB_CRYPTO_IV_SIZE + FE_WEB_CRYPTO_TAG_SIZE);
+
+	if (!fe_web_crypto_encrypt(plaintext, plaintext_len, key, encrypted, &encrypted_len)) {
+		printtext(NULL, NULL, MSGLEVEL_CLIENTERROR, "fe-web: [%s] Encryption failed for %s",
+		          client->id, fe_web_type_to_string(frame->type));
+		g_free(encrypted);
+		frame->encrypt_failed = TRUE;
+		return NULL;
+	}
+
+	data = fe_web_websocket_create_message(0x2, encrypted, encrypted_len, len);
+	g_free(encrypted);
+	return data;
+}
+
+static const guchar *web_frame_get_binary(WEB_FRAME_REC *frame, WEB_CLIENT_REC *client,
+                                          gsize *len)
+{
+	if (frame->binary_frame == NULL) {
+		frame->binary_frame =
+		    web_frame_encrypt(frame, client, (const guchar *) frame->json, frame->json_len,
+		                      &frame->binary_frame_len);
+		if (frame->binary_frame == NULL)
+			return NULL;
+	}
+
+	*len = frame->binary_frame_len;
+	return frame->binary_frame;
+}
+
+/* Binary frame of the compressed message for FE_WEB_PROTOCOL_DEFLATE
+   clients. Compression happens before encryption, since ciphertext
+   doesn't compress. Falls back to the uncompressed binary frame if the
+   message is too small or doesn't get any smaller. */
+static const guchar *web_frame_get_deflated(WEB_FRAME_REC *frame, WEB_CLIENT_REC *client,
+                                            gsize *len)
+{
+	static const guchar marker = FE_WEB_DEFLATE_MARKER;
+	GByteArray *deflated;
+
+	if (!frame->deflate_done && frame->json_len >= FE_WEB_DEFLATE_MIN_SIZE) {
+		frame->deflate_done = TRUE;
+
+		if (frame_compressor == NULL) {
+			frame_compressor =
+			    G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW, -1));
+		}
+
+		deflated = fe_web_websocket_deflate(frame_compressor, (const guchar *) frame->json,
+		                                    frame->json_len);
+		if (deflated != NULL && deflated->len + 1 < frame->json_len) {
+			g_byte_array_prepend(deflated, &marker, 1);
+			frame->deflated_frame =
+			    web_frame_encrypt(frame, client, deflated->data, deflated->len,
+			                      &frame->deflated_frame_len);
+		}
+		if (deflated != NULL)
+			g_byte_array_free(deflated, TRUE);
+	}
+
+	if (frame->deflated_frame == NULL)
+		return web_frame_get_binary(frame, client, len);
+
+	*len = frame->deflated_frame_len;
+	return frame->deflated_frame;
+}
+
+void fe_web_frames_deinit(void)
+{
+	if (send_tag != 0) {
+		g_source_remove(send_tag);
+		send_tag = 0;
+	}
+
+	if (frame_compressor != NULL) {
+		g_object_unref(frame_compressor);
+		frame_compressor = NULL;
+	}
+}
+
+static int web_client_write(WEB_CLIENT_REC *client, const guchar *data, gsize len,
+                            WEB_MESSAGE_TYPE type)
+{
+	/* Send frame - use SSL if enabled */
+	if (client->use_ssl && client->ssl_channel != NULL) {
+		if (fe_web_ssl_write(client->ssl_channel, (const char *) data, len) < 0) {
+			printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
+			          "fe-web: [%s] SSL write failed for %s", client->id,
+			          fe_web_type_to_string(type));
+			return FALSE;
+		}
+	} else {
+		/* Plain connection */
+		net_sendbuffer_send(client->handle, (const char *) data, len);
+	}
+	return TRUE;
+}
+
+static void web_send_free(WEB_SEND_REC *rec)
+{
+	fe_web_frame_unref(rec->frame);
+	g_free(rec);
+}
+
+void fe_web_send_queue_clear(WEB_CLIENT_REC *client)
+{
+	g_queue_foreach(&client->send_queue, (GFunc) web_send_free, NULL);
+	g_queue_clear(&client->send_queue);
+}
+
+/* Write the next frame of the client's first queued message */
+static void web_client_send_next(WEB_CLIENT_REC *client)
+{
+	WEB_SEND_REC *rec;
+	gsize len;
+
+	rec = g_queue_peek_head(&client->send_queue);
+	len = fe_web_websocket_frame_len(rec->data + rec->pos, rec->len - rec->pos);
+	if (len == 0 || !web_client_write(client, rec->data + rec->pos, len, rec->frame->type)) {
+		/* the rest of the message can't be sent either */
+		fe_web_send_queue_clear(client);
+		return;
+	}
+
+	rec->pos += len;
+	if (rec->pos == rec->len) {
+		g_queue_pop_head(&client->send_queue);
+		web_send_free(rec);
+		client->messages_sent++;
+	}
+}
+
+static int web_send_queued(void)
+{
+	GSList *tmp;
+	int pending;
+
+	pending = FALSE;
+	for (tmp = web_clients; tmp != NULL; tmp = tmp->next) {
+		WEB_CLIENT_REC *client = tmp->data;
+
+		if (g_queue_is_empty(&client->send_queue))
+			continue;
+
+		web_client_send_next(client);
+		if (!g_queue_is_empty(&client->send_queue))
+			pending = TRUE;
+	}
+
+	if (!pending)
+		send_tag = 0;
+	return pending;
+}
+
+/* Send an already encoded message to specific client */
+void fe_web_send_frame(WEB_CLIENT_REC *client, WEB_FRAME_REC *frame)
+{
+	WEB_SEND_REC *rec;
+	const guchar *data;
+	gsize data_len;
 	const char *type_str;
 
-	type_str = fe_web_type_to_string(msg->type);
+	g_return_if_fail(frame != NULL);
+
+	type_str = fe_web_type_to_string(frame->type);
 
 	if (client == NULL) {
 		printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
@@ -364,7 +584,7 @@ void fe_web_send_message(WEB_CLIENT_REC *client, WEB_MESSAGE_REC *msg)
 	}
 
 	/* auth_ok is special - can be sent before authenticated flag is set */
-	if (msg->type != WEB_MSG_AUTH_OK) {
+	if (frame->type != WEB_MSG_AUTH_OK) {
 		if (!client->authenticated || !client->handshake_done) {
 			return;
 		}
@@ -385,97 +605,103 @@ void fe_web_send_message(WEB_CLIENT_REC *client, WEB_MESSAGE_REC *msg)
 		return;
 	}
 
-	/* Serialize to JSON */
-	json = fe_web_message_to_json(msg);
-
-	/* Encrypt if encryption is enabled */
+	/* Encrypted clients get a binary frame, others plain JSON text */
 	if (client->encryption_enabled) {
-		unsigned char *encrypted;
-		int encrypted_len;
-		const unsigned char *key;
-
-		key = fe_web_crypto_get_key();
-		if (key == NULL) {
-			printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
-			          "fe-web: [%s] Encryption key not available for %s", client->id,
-			          type_str);
-			g_free(json);
+		data = client->inflate != NULL ?
+		    web_frame_get_deflated(frame, client, &data_len) :
+		    web_frame_get_binary(frame, client, &data_len);
+		if (data == NULL) {
 			return;
 		}
-
-		/* Allocate buffer for encrypted data (plaintext + IV + tag) */
-		encrypted = g_malloc(strlen(json) + FE_WEB_CRYPTO_IV_SIZE + FE_WEB_CRYPTO_TAG_SIZE);
-
-		/* Encrypt JSON */
-		if (!fe_web_crypto_encrypt((const unsigned char *) json, strlen(json), key,
-		                           encrypted, &encrypted_len)) {
-			printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
-			          "fe-web: [%s] Encryption failed for %s", client->id, type_str);
-			g_free(encrypted);
-			g_free(json);
-			return;
-		}
-
-		/* Create WebSocket binary frame with encrypted data */
-		frame = fe_web_websocket_create_frame(0x2, encrypted, encrypted_len, &frame_len);
-		g_free(encrypted);
 	} else {
-		/* Create WebSocket text frame with plain JSON */
-		frame = fe_web_websocket_create_frame(0x1, (const guchar *) json, strlen(json),
-		                                      &frame_len);
+		data = web_frame_get_text(frame, &data_len);
 	}
 
-	/* Send frame - use SSL if enabled */
-	if (client->use_ssl && client->ssl_channel != NULL) {
-		int ssl_ret;
-		ssl_ret = fe_web_ssl_write(client->ssl_channel, (const char *) frame, frame_len);
-		if (ssl_ret < 0) {
-			printtext(NULL, NULL, MSGLEVEL_CLIENTERROR,
-			          "fe-web: [%s] SSL write failed for %s", client->id, type_str);
-			g_free(frame);
-			g_free(json);
-			return;
+	/* A single frame can go out right away unless it would end up in
+	   the middle of a fragmented message */
+	if (g_queue_is_empty(&client->send_queue) &&
+	    fe_web_websocket_frame_len(data, data_len) == data_len) {
+		if (web_client_write(client, data, data_len, frame->type)) {
+			client->messages_sent++;
 		}
-	} else {
-		/* Plain connection */
-		net_sendbuffer_send(client->handle, (const char *) frame, frame_len);
+		return;
 	}
 
-	g_free(frame);
-	g_free(json);
-	client->messages_sent++;
+	rec = g_new0(WEB_SEND_REC, 1);
+	rec->frame = fe_web_frame_ref(frame);
+	rec->data = data;
+	rec->len = data_len;
+	g_queue_push_tail(&client->send_queue, rec);
+
+	if (send_tag == 0) {
+		send_tag = g_idle_add((GSourceFunc) web_send_queued, NULL);
+	}
+}
+
+/* Send message to specific client */
+void fe_web_send_message(WEB_CLIENT_REC *client, WEB_MESSAGE_REC *msg)
+{
+	WEB_FRAME_REC *frame;
+
+	frame = fe_web_frame_new(msg);
+	fe_web_send_frame(client, frame);
+	fe_web_frame_unref(frame);
 }
 
 /* Send message to all clients synced with specific server */
 void fe_web_send_to_server_clients(IRC_SERVER_REC *server, WEB_MESSAGE_REC *msg)
 {
+	WEB_FRAME_REC *frame;
 	GSList *tmp;
 
 	if (server == NULL) {
 		return;
 	}
 
+	/* Messages kept for backlog replay are stored even when no client
+	   is connected, everything else is encoded lazily so events nobody
+	   is listening to cost nothing */
+	frame = NULL;
+	if (fe_web_backlog_wants(msg) && fe_web_backlog_assign_seq(msg) != 0) {
+		const char *json;
+		gsize json_len;
+
+		frame = fe_web_frame_new(msg);
+		json = fe_web_frame_get_json(frame, &json_len);
+		fe_web_backlog_append(msg, json, json_len);
+	}
+
 	for (tmp = web_clients; tmp != NULL; tmp = tmp->next) {
 		WEB_CLIENT_REC *client = tmp->data;
 
 		/* Send ONLY to clients synced with this server or all servers */
 		if (client->authenticated &&
 		    (client->server == server || client->wants_all_servers)) {
-			fe_web_send_message(client, msg);
+			if (frame == NULL)
+				frame = fe_web_frame_new(msg);
+			fe_web_send_frame(client, frame);
 		}
 	}
+
+	fe_web_frame_unref(frame);
 }
 
 /* Send message to all authenticated clients */
 void fe_web_send_to_all_clients(WEB_MESSAGE_REC *msg)
 {
+	WEB_FRAME_REC *frame;
 	GSList *tmp;
 
+	frame = NULL;
 	for (tmp = web_clients; tmp != NULL; tmp = tmp->next) {
 		WEB_CLIENT_REC *client = tmp->data;
 
 		if (client->authenticated) {
-			fe_web_send_message(client, msg);
+			if (frame == NULL)
+				frame = fe_web_frame_new(msg);
+			fe_web_send_frame(client, frame);
 		}
 	}
+
+	fe_web_frame_unref(frame);
 }
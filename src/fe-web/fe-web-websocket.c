@@ -13,6 +13,7 @@
 #include "fe-web.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include <glib.h>
 
 /* WebSocket magic GUID for handshake */
@@ -66,13 +67,20 @@ int fe_web_websocket_parse_frame(const guchar *data, gsize data_len,
 	guint64 len;
 	const guchar *p;
 
-	if (data == NULL || data_len < 2) {
+	if (data == NULL) {
 		return -1;
 	}
+	if (data_len < 2) {
+		return 0; /* Incomplete header */
+	}
 
 	p = data;
 
-	/* First byte: FIN, RSV, opcode */
+	/* First byte: FIN, RSV, opcode. No extensions are negotiated, so
+	   the RSV bits must be clear. */
+	if (*p & 0x70) {
+		return -1;
+	}
 	*fin = (*p & 0x80) ? 1 : 0;
 	*opcode = *p & 0x0F;
 	p++;
@@ -85,13 +93,13 @@ int fe_web_websocket_parse_frame(const guchar *data, gsize data_len,
 	/* Extended payload length */
 	if (len == 126) {
 		if (data_len < 4) {
-			return -1;
+			return 0;
 		}
 		len = (p[0] << 8) | p[1];
 		p += 2;
 	} else if (len == 127) {
 		if (data_len < 10) {
-			return -1;
+			return 0;
 		}
 		len = ((guint64)p[0] << 56) | ((guint64)p[1] << 48) |
 		      ((guint64)p[2] << 40) | ((guint64)p[3] << 32) |
@@ -100,12 +108,17 @@ int fe_web_websocket_parse_frame(const guchar *data, gsize data_len,
 		p += 8;
 	}
 
+	/* Refuse frames we would never accept as a message anyway */
+	if (len > FE_WEB_MAX_MESSAGE_SIZE) {
+		return -1;
+	}
+
 	*payload_len = len;
 
 	/* Masking key */
 	if (*masked) {
 		if (p + 4 > data + data_len) {
-			return -1;
+			return 0;
 		}
 		memcpy(mask_key, p, 4);
 		p += 4;
@@ -133,35 +146,14 @@ void fe_web_websocket_unmask(guchar *payload, guint64 payload_len,
 	}
 }
 
-/* Create WebSocket frame (server->client, unmasked) */
-guchar *fe_web_websocket_create_frame(int opcode, const guchar *payload,
-                                       guint64 payload_len, gsize *frame_len)
+/* Write frame header, returns pointer to where the payload goes */
+static guchar *websocket_write_header(guchar *p, guchar first_byte, guint64 payload_len)
 {
-	guchar *frame;
-	gsize header_len;
-	guchar *p;
-
-	/* Calculate header length */
-	header_len = 2;
-	if (payload_len > 65535) {
-		header_len += 8;
-	} else if (payload_len > 125) {
-		header_len += 2;
-	}
-
-	/* Allocate frame */
-	*frame_len = header_len + payload_len;
-	frame = g_malloc(*frame_len);
-	p = frame;
-
-	/* First byte: FIN=1, opcode */
-	*p = 0x80 | (opcode & 0x0F);
-	p++;
+	*p++ = first_byte;
 
 	/* Second byte: MASK=0, payload length */
 	if (payload_len > 65535) {
-		*p = 127;
-		p++;
+		*p++ = 127;
 		*p++ = (payload_len >> 56) & 0xFF;
 		*p++ = (payload_len >> 48) & 0xFF;
 		*p++ = (payload_len >> 40) & 0xFF;
@@ -171,15 +163,40 @@ guchar *fe_web_websocket_create_frame(int opcode, const guchar *payload,
 		*p++ = (payload_len >> 8) & 0xFF;
 		*p++ = payload_len & 0xFF;
 	} else if (payload_len > 125) {
-		*p = 126;
-		p++;
+		*p++ = 126;
 		*p++ = (payload_len >> 8) & 0xFF;
 		*p++ = payload_len & 0xFF;
 	} else {
-		*p = payload_len & 0x7F;
-		p++;
+		*p++ = payload_len & 0x7F;
 	}
 
+	return p;
+}
+
+static gsize websocket_header_len(guint64 payload_len)
+{
+	if (payload_len > 65535) {
+		return 10;
+	} else if (payload_len > 125) {
+		return 4;
+	}
+	return 2;
+}
+
+/* Create WebSocket frame (server->client, unmasked) */
+guchar *fe_web_websocket_create_frame(int opcode, const guchar *payload,
+                                       guint64 payload_len, gsize *frame_len)
+{
+	guchar *frame;
+	guchar *p;
+
+	/* Allocate frame */
+	*frame_len = websocket_header_len(payload_len) + payload_len;
+	frame = g_malloc(*frame_len);
+
+	/* First byte: FIN=1, opcode */
+	p = websocket_write_header(frame, 0x80 | (opcode & 0x0F), payload_len);
+
 	/* Copy payload */
 	if (payload_len > 0 && payload != NULL) {
 		memcpy(p, payload, payload_len);
@@ -187,3 +204,149 @@ guchar *fe_web_websocket_create_frame(int opcode, const guchar *payload,
 
 	return frame;
 }
+
+/* Create a data message, split into FE_WEB_FRAGMENT_SIZE frames. The
+   frames are built into one buffer, but sent one at a time (see
+   fe_web_websocket_frame_len()) so that other data can go out between
+   them. */
+guchar *fe_web_websocket_create_message(int opcode, const guchar *payload,
+                                         gsize payload_len, gsize *frame_len)
+{
+	guchar *frame;
+	guchar *p;
+	gsize pos, len, total;
+	guchar first_byte;
+
+	if (payload_len <= FE_WEB_FRAGMENT_SIZE) {
+		return fe_web_websocket_create_frame(opcode, payload, payload_len, frame_len);
+	}
+
+	/* All fragments except maybe the last are full sized */
+	total = 0;
+	for (pos = 0; pos < payload_len; pos += len) {
+		len = MIN(payload_len - pos, FE_WEB_FRAGMENT_SIZE);
+		total += websocket_header_len(len) + len;
+	}
+
+	frame = g_malloc(total);
+	p = frame;
+	for (pos = 0; pos < payload_len; pos += len) {
+		len = MIN(payload_len - pos, FE_WEB_FRAGMENT_SIZE);
+
+		first_byte = pos == 0 ? (opcode & 0x0F) : WS_OPCODE_CONTINUATION;
+		if (pos + len == payload_len) {
+			first_byte |= 0x80; /* FIN */
+		}
+
+		p = websocket_write_header(p, first_byte, len);
+		memcpy(p, payload + pos, len);
+		p += len;
+	}
+
+	*frame_len = total;
+	return frame;
+}
+
+/* Length of the complete frame at the start of data, 0 if there isn't one */
+gsize fe_web_websocket_frame_len(const guchar *data, gsize data_len)
+{
+	int fin, opcode, masked;
+	guint64 payload_len;
+	guchar mask_key[4];
+	const guchar *payload;
+
+	if (fe_web_websocket_parse_frame(data, data_len, &fin, &opcode, &masked, &payload_len,
+	                                 mask_key, &payload) <= 0) {
+		return 0;
+	}
+	return (payload - data) + payload_len;
+}
+
+/* Check if protocol is in the comma separated list of a client's
+   Sec-WebSocket-Protocol header */
+int fe_web_websocket_has_protocol(const char *protocols, const char *protocol)
+{
+	char **list;
+	int i, found;
+
+	if (protocols == NULL) {
+		return FALSE;
+	}
+
+	found = FALSE;
+	list = g_strsplit(protocols, ",", -1);
+	for (i = 0; list[i] != NULL && !found; i++) {
+		found = strcmp(g_strstrip(list[i]), protocol) == 0;
+	}
+	g_strfreev(list);
+
+	return found;
+}
+
+/* Run a whole message through a freshly reset converter, appending the
+   output to out. Fails on corrupted data, if the stream ends before or
+   after the input does, or if out would grow beyond max_len. */
+static int websocket_convert(GConverter *converter, const guchar *data, gsize len,
+                             GConverterFlags flags, GByteArray *out, gsize max_len)
+{
+	guchar buf[16384];
+	GConverterResult res;
+	GError *error;
+	gsize pos, bytes_read, bytes_written;
+
+	g_converter_reset(converter);
+
+	pos = 0;
+	do {
+		error = NULL;
+		res = g_converter_convert(converter, data + pos, len - pos, buf, sizeof(buf), flags,
+		                          &bytes_read, &bytes_written, &error);
+		if (res == G_CONVERTER_ERROR) {
+			g_error_free(error);
+			return FALSE;
+		}
+
+		pos += bytes_read;
+		g_byte_array_append(out, buf, bytes_written);
+		if (out->len > max_len) {
+			return FALSE;
+		}
+	} while (res != G_CONVERTER_FINISHED);
+
+	return pos == len;
+}
+
+/* Compress one message into a complete raw deflate stream, so that it
+   can be inflated without any state from earlier messages. Returns NULL
+   on failure. */
+GByteArray *fe_web_websocket_deflate(GConverter *compressor, const guchar *data, gsize len)
+{
+	GByteArray *out;
+
+	out = g_byte_array_sized_new(len / 2 + 64);
+	if (!websocket_convert(compressor, data, len, G_CONVERTER_INPUT_AT_END, out, G_MAXSIZE)) {
+		g_byte_array_free(out, TRUE);
+		return NULL;
+	}
+
+	return out;
+}
+
+/* Decompress one message. The output is NUL terminated (not included in
+   len). Returns NULL on corrupted or truncated data or if the result
+   would be larger than FE_WEB_MAX_MESSAGE_SIZE. */
+GByteArray *fe_web_websocket_inflate(GConverter *decompressor, const guchar *data, gsize len)
+{
+	GByteArray *out;
+
+	out = g_byte_array_sized_new(len * 3 + 64);
+	if (!websocket_convert(decompressor, data, len, G_CONVERTER_INPUT_AT_END, out,
+	                       FE_WEB_MAX_MESSAGE_SIZE)) {
+		g_byte_array_free(out, TRUE);
+		return NULL;
+	}
+
+	g_byte_array_append(out, (const guchar *) "", 1);
+	g_byte_array_set_size(out, out->len - 1);
+	return out;
+}
@@ -114,6 +114,7 @@ void fe_web_init(void)
 	settings_add_int("lookandfeel", "fe_web_port", 9001);
 	settings_add_str("lookandfeel", "fe_web_bind", "127.0.0.1");
 	settings_add_str("lookandfeel", "fe_web_password", "");
+	settings_add_bool("lookandfeel", "fe_web_compression", TRUE);
 
 	/* Register commands */
 	command_bind("fe_web", NULL, (SIGNAL_FUNC) cmd_fe_web);
@@ -121,6 +122,7 @@ void fe_web_init(void)
 
 	/* Initialize subsystems */
 	fe_web_signals_init();
+	fe_web_backlog_init();
 
 	/* SSL and encryption are ALWAYS enabled - no option to disable */
 	fe_web_ssl_init();
@@ -146,6 +148,8 @@ void fe_web_deinit(void)
 	command_unbind("fe_web status", (SIGNAL_FUNC) cmd_fe_web_status);
 
 	fe_web_server_deinit();
+	fe_web_frames_deinit();
+	fe_web_backlog_deinit();
 	fe_web_signals_deinit();
 	fe_web_ssl_deinit();
 	fe_web_crypto_deinit();
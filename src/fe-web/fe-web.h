@@ -10,6 +10,20 @@
 #include <irssi/src/core/servers-setup.h>
 #include <irssi/src/core/chatnets.h>
 
+/* Largest (reassembled or decompressed) message accepted from a client */
+#define FE_WEB_MAX_MESSAGE_SIZE (16 * 1024 * 1024)
+/* Outgoing messages larger than this are sent as several frames */
+#define FE_WEB_FRAGMENT_SIZE (64 * 1024)
+/* Smaller messages aren't worth compressing */
+#define FE_WEB_DEFLATE_MIN_SIZE 256
+
+/* WebSocket subprotocol a client offers to exchange compressed messages.
+   Compression happens before encryption: a decrypted message starting
+   with FE_WEB_DEFLATE_MARKER is a raw deflate stream of the JSON, anything
+   else is the JSON itself. */
+#define FE_WEB_PROTOCOL_DEFLATE "erssi-deflate"
+#define FE_WEB_DEFLATE_MARKER 0x00
+
 /* Forward declaration for SSL channel */
 typedef struct _FE_WEB_SSL_CHANNEL FE_WEB_SSL_CHANNEL;
 
@@ -46,7 +60,8 @@ typedef enum {
 	WEB_MSG_NETWORK_REMOVE,        /* Request: remove network */
 	WEB_MSG_SERVER_ADD,            /* Request: add/modify server */
 	WEB_MSG_SERVER_REMOVE,         /* Request: remove server */
-	WEB_MSG_COMMAND_RESULT         /* Response: operation result */
+	WEB_MSG_COMMAND_RESULT,        /* Response: operation result */
+	WEB_MSG_BACKLOG_END            /* Response: end of a backlog page */
 } WEB_MESSAGE_TYPE;
 
 /* WebSocket client connection record */
@@ -72,6 +87,16 @@ typedef struct {
 	GByteArray *input_buffer; /* For incomplete WebSocket frames */
 	int recv_tag;
 
+	/* Fragmented message being received */
+	GByteArray *fragments;
+	int fragments_opcode;
+
+	/* FE_WEB_PROTOCOL_DEFLATE negotiated, NULL otherwise */
+	GConverter *inflate;
+
+	/* Fragmented messages waiting for their next frame (fe-web-utils.c) */
+	GQueue send_queue;
+
 	/* SSL/TLS */
 	FE_WEB_SSL_CHANNEL *ssl_channel; /* SSL wrapper (if SSL enabled) */
 	unsigned int use_ssl : 1;        /* Whether this connection uses SSL */
@@ -117,6 +142,8 @@ typedef struct {
 	time_t timestamp;
 	unsigned int is_own : 1;
 	unsigned int is_highlight : 1; /* Message is a highlight (mentions user) */
+	unsigned int has_more : 1;     /* backlog_end: more messages are available */
+	guint64 seq;                   /* Backlog sequence number, 0 if not stored */
 
 	/* Additional data (for complex messages like WHOIS, channel_list) */
 	GHashTable *extra_data; /* key -> value string pairs */
@@ -125,6 +152,38 @@ typedef struct {
 	char *response_to; /* Request ID this responds to */
 } WEB_MESSAGE_REC;
 
+/* Parsed JSON document (fe-web-json.c) */
+typedef enum {
+	WEB_JSON_NULL,
+	WEB_JSON_FALSE,
+	WEB_JSON_TRUE,
+	WEB_JSON_NUMBER,
+	WEB_JSON_STRING,
+	WEB_JSON_ARRAY,
+	WEB_JSON_OBJECT
+} WEB_JSON_TYPE;
+
+typedef struct _WEB_JSON_REC WEB_JSON_REC;
+struct _WEB_JSON_REC {
+	WEB_JSON_TYPE type;
+	char *str;           /* Unescaped string, or number as written */
+	GPtrArray *items;    /* Array elements (WEB_JSON_REC *) */
+	GHashTable *members; /* Object members: key -> WEB_JSON_REC * */
+};
+
+/* Streaming JSON writer appending to a GString */
+#define WEB_JSON_WRITER_MAX_DEPTH 64
+
+typedef struct {
+	GString *out;
+	int depth;
+	guint64 has_values; /* Bit per nesting level: container isn't empty */
+	unsigned int after_key : 1;
+} WEB_JSON_WRITER;
+
+/* Message encoded once and shared by all recipients (fe-web-utils.c) */
+typedef struct _WEB_FRAME_REC WEB_FRAME_REC;
+
 /* Global clients list */
 extern GSList *web_clients;
 
@@ -139,7 +198,7 @@ void fe_web_server_deinit(void);
 /* Client functions */
 WEB_CLIENT_REC *fe_web_client_create(int fd, const char *addr);
 void fe_web_client_destroy(WEB_CLIENT_REC *client);
-void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json);
+void fe_web_client_handle_message(WEB_CLIENT_REC *client, const char *json, gsize len);
 void fe_web_client_sync_server(WEB_CLIENT_REC *client, const char *server_tag);
 void fe_web_client_execute_command(WEB_CLIENT_REC *client, const char *command);
 
@@ -154,8 +213,18 @@ void fe_web_send_nicklist_for_channel(IRC_SERVER_REC *server, IRC_CHANNEL_REC *c
 WEB_MESSAGE_REC *fe_web_message_new(WEB_MESSAGE_TYPE type);
 void fe_web_message_free(WEB_MESSAGE_REC *msg);
 
+/* Encoded frames */
+WEB_FRAME_REC *fe_web_frame_new(WEB_MESSAGE_REC *msg);
+WEB_FRAME_REC *fe_web_frame_ref(WEB_FRAME_REC *frame);
+void fe_web_frame_unref(WEB_FRAME_REC *frame);
+WEB_FRAME_REC *fe_web_frame_new_json(WEB_MESSAGE_TYPE type, const char *json, gsize len);
+const char *fe_web_frame_get_json(WEB_FRAME_REC *frame, gsize *len);
+void fe_web_frames_deinit(void);
+
 /* Message sending */
 void fe_web_send_message(WEB_CLIENT_REC *client, WEB_MESSAGE_REC *msg);
+void fe_web_send_frame(WEB_CLIENT_REC *client, WEB_FRAME_REC *frame);
+void fe_web_send_queue_clear(WEB_CLIENT_REC *client);
 void fe_web_send_to_server_clients(IRC_SERVER_REC *server, WEB_MESSAGE_REC *msg);
 void fe_web_send_to_all_clients(WEB_MESSAGE_REC *msg);
 
@@ -165,9 +234,31 @@ char *fe_web_escape_json(const char *str);
 char *fe_web_generate_message_id(void);
 
 /* JSON parsing */
-char *fe_web_json_get_string(const char *json, const char *key);
-int fe_web_json_get_int(const char *json, const char *key, int default_value);
-int fe_web_json_has_key(const char *json, const char *key);
+WEB_JSON_REC *fe_web_json_parse(const char *json, gsize len);
+void fe_web_json_free(WEB_JSON_REC *value);
+WEB_JSON_REC *fe_web_json_get(WEB_JSON_REC *obj, const char *key);
+char *fe_web_json_get_string(WEB_JSON_REC *obj, const char *key);
+int fe_web_json_get_int(WEB_JSON_REC *obj, const char *key, int default_value);
+guint64 fe_web_json_get_uint64(WEB_JSON_REC *obj, const char *key, guint64 default_value);
+int fe_web_json_has_key(WEB_JSON_REC *obj, const char *key);
+
+/* JSON writing */
+void fe_web_json_append_escaped(GString *out, const char *str);
+void fe_web_json_writer_init(WEB_JSON_WRITER *writer, GString *out);
+void fe_web_json_begin_object(WEB_JSON_WRITER *writer);
+void fe_web_json_end_object(WEB_JSON_WRITER *writer);
+void fe_web_json_begin_array(WEB_JSON_WRITER *writer);
+void fe_web_json_end_array(WEB_JSON_WRITER *writer);
+void fe_web_json_key(WEB_JSON_WRITER *writer, const char *key);
+void fe_web_json_string(WEB_JSON_WRITER *writer, const char *value);
+void fe_web_json_int(WEB_JSON_WRITER *writer, gint64 value);
+void fe_web_json_bool(WEB_JSON_WRITER *writer, int value);
+void fe_web_json_null(WEB_JSON_WRITER *writer);
+void fe_web_json_raw(WEB_JSON_WRITER *writer, const char *json);
+void fe_web_json_raw_members(WEB_JSON_WRITER *writer, const char *members, gsize len);
+void fe_web_json_member_string(WEB_JSON_WRITER *writer, const char *key, const char *value);
+void fe_web_json_member_int(WEB_JSON_WRITER *writer, const char *key, gint64 value);
+void fe_web_json_member_bool(WEB_JSON_WRITER *writer, const char *key, int value);
 
 /* JSON building for network/server management */
 GString *fe_web_build_network_json(IRC_CHATNET_REC *rec);
@@ -176,12 +267,21 @@ GString *fe_web_build_command_result_json(gboolean success, const char *message,
                                           const char *error_code);
 
 /* Network/Server management handlers */
-void fe_web_handle_network_list(WEB_CLIENT_REC *client, const char *json);
-void fe_web_handle_server_list(WEB_CLIENT_REC *client, const char *json);
-void fe_web_handle_network_add(WEB_CLIENT_REC *client, const char *json);
-void fe_web_handle_network_remove(WEB_CLIENT_REC *client, const char *json);
-void fe_web_handle_server_add(WEB_CLIENT_REC *client, const char *json);
-void fe_web_handle_server_remove(WEB_CLIENT_REC *client, const char *json);
+void fe_web_handle_network_list(WEB_CLIENT_REC *client, WEB_JSON_REC *req);
+void fe_web_handle_server_list(WEB_CLIENT_REC *client, WEB_JSON_REC *req);
+void fe_web_handle_network_add(WEB_CLIENT_REC *client, WEB_JSON_REC *req);
+void fe_web_handle_network_remove(WEB_CLIENT_REC *client, WEB_JSON_REC *req);
+void fe_web_handle_server_add(WEB_CLIENT_REC *client, WEB_JSON_REC *req);
+void fe_web_handle_server_remove(WEB_CLIENT_REC *client, WEB_JSON_REC *req);
+
+/* Persistent backlog (fe-web-backlog.c) */
+void fe_web_backlog_init(void);
+void fe_web_backlog_deinit(void);
+int fe_web_backlog_wants(WEB_MESSAGE_REC *msg);
+guint64 fe_web_backlog_assign_seq(WEB_MESSAGE_REC *msg);
+void fe_web_backlog_append(WEB_MESSAGE_REC *msg, const char *json, gsize json_len);
+int fe_web_backlog_replay(WEB_CLIENT_REC *client, const char *server_tag, const char *target,
+                          guint64 since, int limit, guint64 *last_seq);
 
 /* State dump */
 void fe_web_dump_state(WEB_CLIENT_REC *client);
@@ -194,5 +294,13 @@ int fe_web_websocket_parse_frame(const guchar *data, gsize data_len, int *fin, i
 void fe_web_websocket_unmask(guchar *payload, guint64 payload_len, const guchar mask_key[4]);
 guchar *fe_web_websocket_create_frame(int opcode, const guchar *payload, guint64 payload_len,
                                       gsize *frame_len);
+guchar *fe_web_websocket_create_message(int opcode, const guchar *payload, gsize payload_len,
+                                        gsize *frame_len);
+gsize fe_web_websocket_frame_len(const guchar *data, gsize data_len);
+
+/* Message compression */
+int fe_web_websocket_has_protocol(const char *protocols, const char *protocol);
+GByteArray *fe_web_websocket_deflate(GConverter *compressor, const guchar *data, gsize len);
+GByteArray *fe_web_websocket_inflate(GConverter *decompressor, const guchar *data, gsize len);
 
 #endif /* IRSSI_FE_WEB_FE_WEB_H */
@@ -40,6 +40,36 @@ static struct {
 /* Minimum file size for a valid image (100 bytes - magic + some data) */
 #define MIN_IMAGE_SIZE 100
 
+/* Entries not used for this long are removed by the cleanup */
+#define CACHE_MAX_AGE (7 * 24 * 60 * 60)
+
+/* Journal of the index, kept inside the cache directory. The dot keeps it
+ * out of the way of the directory walks which skip hidden files. */
+#define CACHE_INDEX_FILE ".index"
+#define CACHE_INDEX_HEADER "erssi image cache 1"
+
+/* Rewrite the journal when it has this many more records than entries */
+#define CACHE_INDEX_SLACK 1024
+
+/* In-memory index of the cache directory. Lookups only consult this,
+ * the directory itself is read once at startup. */
+typedef struct {
+	char *hash;        /* SHA256 of the URL, index key */
+	char *name;        /* file name inside cache_dir: hash + extension */
+	gint64 size;
+	time_t mtime;
+	time_t atime;      /* last lookup */
+	int width, height; /* decoded dimensions, 0 if not decoded yet */
+	GList *link;       /* position in cache_lru */
+	unsigned int validated:1; /* magic bytes checked */
+} CACHE_ENTRY;
+
+static GHashTable *cache_index = NULL; /* hash -> CACHE_ENTRY */
+static GQueue cache_lru = G_QUEUE_INIT; /* most recently used first */
+
+static FILE *journal = NULL;
+static int journal_records = 0;
+
 /* Validate that a file contains an actual image (not HTML or other garbage) */
 static gboolean validate_image_file(const char *path)
 {
@@ -167,70 +197,443 @@ static char *generate_cache_path(const char *url)
 	return path;
 }
 
-/* Check if URL is cached (and valid) */
-gboolean image_cache_has(const char *url)
+static char *cache_entry_path(CACHE_ENTRY *entry)
 {
-	char *path;
-	struct stat st;
-	gboolean valid;
+	return g_strdup_printf("%s/%s", cache_dir, entry->name);
+}
 
-	if (url == NULL)
-		return FALSE;
+/* Find the entry of a cache file. The file name is looked up by its hash
+ * part only, the extension depends on who picked the path. */
+static CACHE_ENTRY *cache_entry_find_name(const char *name)
+{
+	CACHE_ENTRY *entry;
+	char *hash;
 
-	path = generate_cache_path(url);
-	if (path == NULL)
-		return FALSE;
+	if (cache_index == NULL)
+		return NULL;
+
+	hash = g_strndup(name, strcspn(name, "."));
+	entry = g_hash_table_lookup(cache_index, hash);
+	g_free(hash);
+	return entry;
+}
+
+static CACHE_ENTRY *cache_entry_find_path(const char *path)
+{
+	const char *name;
+
+	name = strrchr(path, '/');
+	return cache_entry_find_name(name == NULL ? path : name + 1);
+}
+
+/* Journal records: "A name size mtime atime width height validated" adds
+ * or updates an entry and makes it the most recently used one, "D name"
+ * removes it. */
+static void journal_write_entry(FILE *fp, CACHE_ENTRY *entry)
+{
+	fprintf(fp, "A %s %" G_GINT64_FORMAT " %ld %ld %d %d %d\n",
+	        entry->name, entry->size, (long)entry->mtime, (long)entry->atime,
+	        entry->width, entry->height, entry->validated ? 1 : 0);
+}
+
+static void journal_compact(void);
 
-	valid = FALSE;
-	if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
-		/* Also validate the file content */
-		if (validate_image_file(path)) {
-			valid = TRUE;
-			cache_stats.hits++;
+static void journal_flush(void)
+{
+	fflush(journal);
+	if (++journal_records > cache_stats.entry_count + CACHE_INDEX_SLACK)
+		journal_compact();
+}
+
+static void journal_append_entry(CACHE_ENTRY *entry)
+{
+	if (journal == NULL)
+		return;
+
+	journal_write_entry(journal, entry);
+	journal_flush();
+}
+
+static void journal_append_remove(const char *name)
+{
+	if (journal == NULL)
+		return;
+
+	fprintf(journal, "D %s\n", name);
+	journal_flush();
+}
+
+/* Rewrite the journal with one record per entry, least recently used first
+ * so replaying it restores the LRU order */
+static void journal_compact(void)
+{
+	GList *tmp;
+	FILE *fp;
+	char *path, *tmp_path;
+	gboolean ok;
+
+	if (cache_dir == NULL || cache_index == NULL)
+		return;
+
+	path = g_strdup_printf("%s/%s", cache_dir, CACHE_INDEX_FILE);
+	tmp_path = g_strconcat(path, ".tmp", NULL);
+
+	if (journal != NULL) {
+		fclose(journal);
+		journal = NULL;
+	}
+
+	fp = fopen(tmp_path, "w");
+	if (fp != NULL) {
+		fprintf(fp, "%s\n", CACHE_INDEX_HEADER);
+		for (tmp = cache_lru.tail; tmp != NULL; tmp = tmp->prev)
+			journal_write_entry(fp, tmp->data);
+
+		ok = fflush(fp) == 0 && !ferror(fp);
+		ok = fclose(fp) == 0 && ok;
+		if (ok && rename(tmp_path, path) == 0) {
+			journal_records = cache_stats.entry_count;
 		} else {
-			/* Invalid file - remove it */
-			image_preview_debug_print("CACHE: has() removing invalid file: %s", path);
-			unlink(path);
-			cache_stats.misses++;
+			g_warning("image-cache: Failed to write %s: %s", path, strerror(errno));
+			unlink(tmp_path);
 		}
-	} else {
-		cache_stats.misses++;
 	}
 
+	journal = fopen(path, "a");
+	g_free(tmp_path);
 	g_free(path);
-	return valid;
 }
 
-/* Get cached file path (or NULL if not cached) */
-char *image_cache_get(const char *url)
+static void cache_entry_free(CACHE_ENTRY *entry)
+{
+	g_free(entry->hash);
+	g_free(entry->name);
+	g_free(entry);
+}
+
+/* Make entry the most recently used one */
+static void cache_entry_touch(CACHE_ENTRY *entry)
+{
+	entry->atime = time(NULL);
+	g_queue_unlink(&cache_lru, entry->link);
+	g_queue_push_head_link(&cache_lru, entry->link);
+}
+
+/* Add file `name' to index or update its entry */
+static CACHE_ENTRY *cache_entry_set(const char *name, gint64 size, time_t mtime)
+{
+	CACHE_ENTRY *entry;
+
+	entry = cache_entry_find_name(name);
+	if (entry != NULL && strcmp(entry->name, name) != 0) {
+		g_free(entry->name);
+		entry->name = g_strdup(name);
+	}
+
+	if (entry == NULL) {
+		entry = g_new0(CACHE_ENTRY, 1);
+		entry->hash = g_strndup(name, strcspn(name, "."));
+		entry->name = g_strdup(name);
+		entry->link = g_list_alloc();
+		entry->link->data = entry;
+		g_queue_push_head_link(&cache_lru, entry->link);
+		g_hash_table_insert(cache_index, entry->hash, entry);
+		cache_stats.entry_count++;
+	} else {
+		cache_stats.total_size -= entry->size;
+		g_queue_unlink(&cache_lru, entry->link);
+		g_queue_push_head_link(&cache_lru, entry->link);
+	}
+
+	if (entry->mtime != mtime || entry->size != size) {
+		/* new file contents */
+		entry->validated = FALSE;
+		entry->width = entry->height = 0;
+	}
+	entry->size = size;
+	entry->mtime = mtime;
+	entry->atime = time(NULL);
+	cache_stats.total_size += size;
+	return entry;
+}
+
+/* Drop entry from the index, and its file from the disk if `unlink_file'.
+ * Nothing is journaled while the index is being loaded. */
+static void cache_entry_remove(CACHE_ENTRY *entry, gboolean unlink_file)
 {
 	char *path;
+
+	path = cache_entry_path(entry);
+	if (unlink_file)
+		unlink(path);
+	image_render_forget(path);
+	g_free(path);
+
+	g_hash_table_remove(cache_index, entry->hash);
+	g_queue_delete_link(&cache_lru, entry->link);
+	cache_stats.total_size -= entry->size;
+	cache_stats.entry_count--;
+
+	journal_append_remove(entry->name);
+	cache_entry_free(entry);
+}
+
+/* Remove least recently used entries until the cache fits in max_size.
+ * The most recently used entry is always kept. */
+static void cache_evict(gint64 max_size)
+{
+	CACHE_ENTRY *entry;
+
+	while (cache_stats.total_size > max_size && cache_lru.length > 1) {
+		entry = g_queue_peek_tail(&cache_lru);
+		image_preview_debug_print("CACHE: evicting %s (%" G_GINT64_FORMAT " bytes)",
+		                          entry->name, entry->size);
+		cache_entry_remove(entry, TRUE);
+	}
+}
+
+static void journal_replay(const char *line)
+{
+	CACHE_ENTRY *entry;
+	char name[128];
+	gint64 size;
+	long mtime, atime;
+	int width, height, validated;
+
+	if (sscanf(line, "A %127s %" G_GINT64_FORMAT " %ld %ld %d %d %d", name, &size,
+	           &mtime, &atime, &width, &height, &validated) == 7) {
+		if (strchr(name, '/') != NULL || name[0] == '.')
+			return;
+		entry = cache_entry_set(name, size, (time_t)mtime);
+		entry->atime = (time_t)atime;
+		entry->width = width;
+		entry->height = height;
+		entry->validated = validated != 0;
+	} else if (sscanf(line, "D %127s", name) == 1) {
+		entry = cache_entry_find_name(name);
+		if (entry != NULL && strcmp(entry->name, name) == 0)
+			cache_entry_remove(entry, FALSE);
+	}
+	journal_records++;
+}
+
+/* Load the index from the journal */
+static void cache_index_load(void)
+{
+	char *path, *contents, *line, *next;
+
+	path = g_strdup_printf("%s/%s", cache_dir, CACHE_INDEX_FILE);
+	if (!g_file_get_contents(path, &contents, NULL, NULL)) {
+		g_free(path);
+		return;
+	}
+
+	line = contents;
+	next = strchr(line, '\n');
+	if (next != NULL) {
+		*next = '\0';
+		if (strcmp(line, CACHE_INDEX_HEADER) != 0)
+			next = NULL;
+	}
+
+	/* a partial last record is ignored */
+	while (next != NULL) {
+		line = next + 1;
+		next = strchr(line, '\n');
+		if (next != NULL) {
+			*next = '\0';
+			journal_replay(line);
+		}
+	}
+
+	g_free(contents);
+	g_free(path);
+}
+
+/* Reconcile the index with the directory: forget entries whose files are
+ * gone and index files the journal doesn't know about (a lost journal, or
+ * an interrupted download). New files are only stat()ed here, their
+ * contents are validated on first use. */
+static void cache_index_sync(void)
+{
+	GHashTable *seen;
+	GList *tmp, *next;
+	CACHE_ENTRY *entry;
+	DIR *dir;
+	struct dirent *dirent;
 	struct stat st;
+	char *path;
+
+	dir = opendir(cache_dir);
+	if (dir == NULL)
+		return;
+
+	seen = g_hash_table_new(g_direct_hash, g_direct_equal);
+	while ((dirent = readdir(dir)) != NULL) {
+		if (dirent->d_name[0] == '.')
+			continue;
+
+		entry = cache_entry_find_name(dirent->d_name);
+		if (entry != NULL && strcmp(entry->name, dirent->d_name) == 0) {
+			g_hash_table_add(seen, entry);
+			continue;
+		}
+
+		path = g_strdup_printf("%s/%s", cache_dir, dirent->d_name);
+		if (entry != NULL) {
+			/* same URL under another extension */
+			unlink(path);
+		} else if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+			entry = cache_entry_set(dirent->d_name, st.st_size, st.st_mtime);
+			entry->atime = st.st_mtime;
+			/* unknown use, so the first one to go */
+			g_queue_unlink(&cache_lru, entry->link);
+			g_queue_push_tail_link(&cache_lru, entry->link);
+			g_hash_table_add(seen, entry);
+		}
+		g_free(path);
+	}
+	closedir(dir);
+
+	for (tmp = cache_lru.head; tmp != NULL; tmp = next) {
+		next = tmp->next;
+		entry = tmp->data;
+		if (!g_hash_table_contains(seen, entry)) {
+			image_preview_debug_print("CACHE: %s is gone, dropping from index",
+			                          entry->name);
+			cache_entry_remove(entry, FALSE);
+		}
+	}
+	g_hash_table_destroy(seen);
+}
+
+/* Look up a usable entry for URL, validating it the first time */
+static CACHE_ENTRY *cache_lookup(const char *url)
+{
+	CACHE_ENTRY *entry;
+	char *hash, *path;
 
-	if (url == NULL)
+	if (url == NULL || cache_index == NULL)
 		return NULL;
 
-	path = generate_cache_path(url);
-	if (path == NULL)
+	hash = g_compute_checksum_for_string(G_CHECKSUM_SHA256, url, -1);
+	entry = g_hash_table_lookup(cache_index, hash);
+	g_free(hash);
+
+	if (entry == NULL) {
+		cache_stats.misses++;
 		return NULL;
+	}
 
-	if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
-		/* Validate that the cached file is actually an image */
+	if (!entry->validated) {
+		path = cache_entry_path(entry);
 		if (!validate_image_file(path)) {
 			/* Corrupted cache entry (HTML, empty, etc.) - remove it */
 			image_preview_debug_print("CACHE: removing invalid cached file: %s", path);
-			unlink(path);
+			cache_entry_remove(entry, TRUE);
 			g_free(path);
 			cache_stats.misses++;
 			return NULL;
 		}
-		cache_stats.hits++;
-		return path;
+		g_free(path);
+		entry->validated = TRUE;
+		journal_append_entry(entry);
 	}
 
-	cache_stats.misses++;
-	g_free(path);
-	return NULL;
+	cache_entry_touch(entry);
+	cache_stats.hits++;
+	return entry;
+}
+
+/* Check if URL is cached (and valid) */
+gboolean image_cache_has(const char *url)
+{
+	return cache_lookup(url) != NULL;
+}
+
+/* Get cached file path (or NULL if not cached) */
+char *image_cache_get(const char *url)
+{
+	CACHE_ENTRY *entry;
+
+	entry = cache_lookup(url);
+	return entry == NULL ? NULL : cache_entry_path(entry);
+}
+
+/* Add a file written into the cache directory to the index */
+gboolean image_cache_add(const char *path)
+{
+	CACHE_ENTRY *entry;
+	struct stat st;
+	const char *name;
+
+	if (path == NULL || cache_index == NULL)
+		return FALSE;
+
+	if (!validate_image_file(path)) {
+		image_preview_debug_print("CACHE: not adding invalid file: %s", path);
+		image_cache_remove(path);
+		return FALSE;
+	}
+
+	if (stat(path, &st) != 0)
+		return FALSE;
+
+	name = strrchr(path, '/');
+	entry = cache_entry_set(name == NULL ? path : name + 1, st.st_size, st.st_mtime);
+	entry->validated = TRUE;
+	journal_append_entry(entry);
+
+	cache_evict(settings_get_size(IMAGE_PREVIEW_CACHE_SIZE));
+	return TRUE;
+}
+
+/* Remove a cached file and its index entry */
+void image_cache_remove(const char *path)
+{
+	CACHE_ENTRY *entry;
+	const char *name;
+
+	if (path == NULL)
+		return;
+
+	name = strrchr(path, '/');
+	name = name == NULL ? path : name + 1;
+
+	entry = cache_entry_find_name(name);
+	if (entry != NULL && strcmp(entry->name, name) == 0)
+		cache_entry_remove(entry, FALSE);
+	unlink(path);
+}
+
+/* Remember the decoded dimensions of a cached image */
+void image_cache_set_dimensions(const char *path, int width, int height)
+{
+	CACHE_ENTRY *entry;
+
+	if (path == NULL || (entry = cache_entry_find_path(path)) == NULL)
+		return;
+
+	if (entry->width == width && entry->height == height)
+		return;
+
+	entry->width = width;
+	entry->height = height;
+	journal_append_entry(entry);
+}
+
+/* Get the decoded dimensions of a cached image, FALSE if not known */
+gboolean image_cache_get_dimensions(const char *path, int *width, int *height)
+{
+	CACHE_ENTRY *entry;
+
+	if (path == NULL || (entry = cache_entry_find_path(path)) == NULL ||
+	    entry->width <= 0 || entry->height <= 0)
+		return FALSE;
+
+	*width = entry->width;
+	*height = entry->height;
+	return TRUE;
 }
 
 /* Store image in cache (by moving/copying source file) */
@@ -241,6 +644,7 @@ gboolean image_cache_store(const char *url, const char *source_path)
 	gchar *contents = NULL;
 	gsize length = 0;
 	GError *error = NULL;
+	gboolean ret;
 
 	if (url == NULL || source_path == NULL)
 		return FALSE;
@@ -255,20 +659,13 @@ gboolean image_cache_store(const char *url, const char *source_path)
 		return FALSE;
 	}
 
-	/* If source and cache paths are the same, we're done */
-	if (g_strcmp0(source_path, cache_path) == 0) {
-		g_free(cache_path);
-		cache_stats.total_size += st.st_size;
-		cache_stats.entry_count++;
-		return TRUE;
-	}
-
-	/* Try to rename (move) first */
-	if (rename(source_path, cache_path) == 0) {
-		cache_stats.total_size += st.st_size;
-		cache_stats.entry_count++;
+	/* If source and cache paths are the same, just index it.
+	   Otherwise try to rename (move) first */
+	if (g_strcmp0(source_path, cache_path) == 0 ||
+	    rename(source_path, cache_path) == 0) {
+		ret = image_cache_add(cache_path);
 		g_free(cache_path);
-		return TRUE;
+		return ret;
 	}
 
 	/* Rename failed, try copy */
@@ -288,12 +685,10 @@ gboolean image_cache_store(const char *url, const char *source_path)
 	}
 
 	g_free(contents);
+	ret = image_cache_add(cache_path);
 	g_free(cache_path);
 
-	cache_stats.total_size += length;
-	cache_stats.entry_count++;
-
-	return TRUE;
+	return ret;
 }
 
 /* Clear all cached images */
@@ -321,77 +716,37 @@ void image_cache_clear_all(void)
 
 	closedir(dir);
 
+	if (cache_index != NULL) {
+		g_hash_table_remove_all(cache_index);
+		g_queue_clear_full(&cache_lru, (GDestroyNotify) cache_entry_free);
+	}
+
 	cache_stats.total_size = 0;
 	cache_stats.entry_count = 0;
+	journal_compact();
 }
 
 /* Cleanup old cache entries */
 void image_cache_cleanup(void)
 {
-	DIR *dir;
-	struct dirent *entry;
-	struct stat st;
-	char *path;
+	CACHE_ENTRY *entry;
 	time_t now;
-	int max_age_seconds;
-	gint64 max_size_bytes;
-	GSList *files = NULL;
-	GSList *l;
 
-	if (cache_dir == NULL || !ensure_cache_dir())
+	if (cache_index == NULL)
 		return;
 
 	now = time(NULL);
-	max_age_seconds = 7 * 24 * 60 * 60;  /* 7 days default */
-	max_size_bytes = settings_get_size(IMAGE_PREVIEW_CACHE_SIZE);
 
-	dir = opendir(cache_dir);
-	if (dir == NULL)
-		return;
-
-	/* Collect all files with their stats */
-	while ((entry = readdir(dir)) != NULL) {
-		if (entry->d_name[0] == '.')
-			continue;
-
-		path = g_strdup_printf("%s/%s", cache_dir, entry->d_name);
-		if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
-			/* Check age - remove if too old */
-			if ((now - st.st_mtime) > max_age_seconds) {
-				unlink(path);
-				g_free(path);
-				continue;
-			}
-
-			files = g_slist_prepend(files, path);
-		} else {
-			g_free(path);
-		}
-	}
+	/* Remove entries that haven't been used for a while */
+	while ((entry = g_queue_peek_tail(&cache_lru)) != NULL &&
+	       now - entry->atime > CACHE_MAX_AGE)
+		cache_entry_remove(entry, TRUE);
 
-	closedir(dir);
+	/* Then the least recently used ones until under the size limit */
+	cache_evict(settings_get_size(IMAGE_PREVIEW_CACHE_SIZE));
 
-	/* Recalculate cache size */
-	cache_stats.total_size = 0;
-	cache_stats.entry_count = 0;
-
-	for (l = files; l != NULL; l = l->next) {
-		path = l->data;
-		if (stat(path, &st) == 0) {
-			cache_stats.total_size += st.st_size;
-			cache_stats.entry_count++;
-		}
-	}
-
-	/* If still over size limit, remove oldest files */
-	if (cache_stats.total_size > max_size_bytes) {
-		/* TODO: Sort by mtime and remove oldest until under limit */
-		/* For now, just warn */
-		g_warning("image-cache: Cache size (%" G_GINT64_FORMAT " bytes) exceeds limit (%" G_GINT64_FORMAT " bytes)",
-		          cache_stats.total_size, max_size_bytes);
-	}
-
-	g_slist_free_full(files, g_free);
+	/* Persist the lookup times */
+	journal_compact();
 }
 
 /* Periodic cleanup callback */
@@ -438,7 +793,11 @@ void image_cache_init(void)
 		return;
 	}
 
-	/* Initial cleanup */
+	cache_index = g_hash_table_new(g_str_hash, g_str_equal);
+	cache_index_load();
+	cache_index_sync();
+
+	/* Initial cleanup, also opens the journal */
 	image_cache_cleanup();
 
 	/* Start periodic cleanup timer (every 30 minutes) */
@@ -453,6 +812,19 @@ void image_cache_deinit(void)
 		cleanup_timer_tag = 0;
 	}
 
+	if (cache_index != NULL) {
+		journal_compact();
+		if (journal != NULL) {
+			fclose(journal);
+			journal = NULL;
+		}
+		g_hash_table_destroy(cache_index);
+		cache_index = NULL;
+		g_queue_clear_full(&cache_lru, (GDestroyNotify) cache_entry_free);
+	}
+	cache_stats.total_size = 0;
+	cache_stats.entry_count = 0;
+
 	g_free(cache_dir);
 	cache_dir = NULL;
 }
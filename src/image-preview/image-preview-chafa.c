@@ -277,65 +277,174 @@ static ChafaPixelMode parse_blitter_setting(void)
 
 #endif /* HAVE_CHAFA */
 
-/*
- * Render an image file using Chafa
- * Returns GString with escape sequences, caller must free with g_string_free()
- * out_rows is set to the number of terminal rows the image will occupy
- */
-GString *image_render_chafa(const char *image_path,
-                            int max_cols,
-                            int max_rows,
-                            int *out_rows)
+/* Terminal cell size in pixels assumed for graphics protocols. Most
+ * terminal fonts use approximately 8x16 pixel cells (2:1 height:width). */
+#define RENDER_CELL_WIDTH 8
+#define RENDER_CELL_HEIGHT 16
+
+/* Decoding and rendering threads */
+#define RENDER_THREADS 2
+
+/* Rendered outputs kept for reopening the same popup */
+#define RENDER_CACHE_MAX 8
+
+struct _IMAGE_RENDER_JOB_REC {
+	/* Input, everything the worker needs is resolved on the main thread
+	 * since settings and terminal detection aren't thread safe */
+	char *image_path;
+	char *key;
+	int max_cols, max_rows;
+	int max_bytes;
+	int pixel_mode;
+
+	IMAGE_RENDER_FUNC func;
+	void *data;
+	gint cancelled;
+
+	/* Output from the worker */
+	GString *output;
+	int rows;
+	int img_width, img_height;
+	const char *error;
+};
+
+typedef struct {
+	char *key;
+	char *image_path;
+	GString *output;
+	int rows;
+} RENDER_CACHE_REC;
+
+static GThreadPool *render_pool = NULL;
+static GSList *render_jobs = NULL; /* jobs not returned to main thread */
+
+static GHashTable *render_cache = NULL; /* key -> RENDER_CACHE_REC */
+static GQueue render_cache_lru = G_QUEUE_INIT;
+
+static IMAGE_RENDER_JOB_REC *render_job_new(const char *image_path, int max_cols, int max_rows)
 {
+	IMAGE_RENDER_JOB_REC *job;
+
+	job = g_new0(IMAGE_RENDER_JOB_REC, 1);
+	job->image_path = g_strdup(image_path);
+	job->max_cols = max_cols;
+	job->max_rows = max_rows;
+
+	job->max_bytes = settings_get_int(IMAGE_PREVIEW_MAX_BYTES);
+	if (job->max_bytes <= 0) job->max_bytes = IMAGE_PREVIEW_DEFAULT_MAX_BYTES;
+
 #ifdef HAVE_CHAFA
-	ChafaTermDb *term_db = NULL;
-	ChafaCanvasConfig *config = NULL;
-	ChafaCanvas *canvas = NULL;
-	ChafaTermInfo *term_info = NULL;
-	ChafaPixelMode pixel_mode;
-	GString *output = NULL;
-	unsigned char *pixels = NULL;
-	int img_width, img_height, img_channels;
-	int target_cols, target_rows;
-	float aspect_ratio;
-	int max_bytes, source_w, source_h, estimated_bytes;
-	float scale;
+	/* Get pixel mode from our detection (uses terminal query in tmux) */
+	job->pixel_mode = parse_blitter_setting();
+#endif
 
-	if (image_path == NULL) {
-		image_preview_debug_print("CHAFA: NULL image path");
-		return NULL;
+	job->key = g_strdup_printf("%s/%dx%d/%dx%d/%d/%d", image_path, max_cols, max_rows,
+	                           RENDER_CELL_WIDTH, RENDER_CELL_HEIGHT,
+	                           job->pixel_mode, job->max_bytes);
+	return job;
+}
+
+static void render_job_free(IMAGE_RENDER_JOB_REC *job)
+{
+	if (job->output != NULL)
+		g_string_free(job->output, TRUE);
+	g_free(job->image_path);
+	g_free(job->key);
+	g_free(job);
+}
+
+#ifdef HAVE_CHAFA
+/* Create term_info with appropriate escape sequences for our detected terminal.
+ * We can't rely on Chafa's env-based detection in tmux because env vars show
+ * the terminal where tmux was started, not the current terminal.
+ * Solution: Manually set the graphics protocol sequences based on our detection.
+ * These sequences are from Chafa source code - no env detection needed. */
+static ChafaTermInfo *render_term_info_new(ChafaPixelMode pixel_mode)
+{
+	ChafaTermDb *term_db;
+	ChafaTermInfo *term_info;
+
+	term_db = chafa_term_db_get_default();
+	term_info = chafa_term_info_new();
+
+	/* Supplement with default sequences first (cursor movement, colors, etc.) */
+	chafa_term_info_supplement(term_info, chafa_term_db_get_fallback_info(term_db));
+
+	if (pixel_mode == CHAFA_PIXEL_MODE_ITERM2) {
+		/* iTerm2 inline image protocol:
+		 * ESC ] 1337 ; File = inline=1;width=W;height=H;preserveAspectRatio=0 : base64 BEL */
+		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_BEGIN_ITERM2_IMAGE,
+		                        "\033]1337;File=inline=1;width=%1;height=%2;preserveAspectRatio=0:",
+		                        NULL);
+		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_END_ITERM2_IMAGE, "\a", NULL);
+	} else if (pixel_mode == CHAFA_PIXEL_MODE_KITTY) {
+		/* Kitty graphics protocol:
+		 * ESC _ G a=T,f=BPP,s=W,v=H,c=COLS,r=ROWS,m=1 ESC \ ... ESC _ G m=0 ESC \ */
+		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_BEGIN_KITTY_IMMEDIATE_IMAGE_V1,
+		                        "\033_Ga=T,f=%1,s=%2,v=%3,c=%4,r=%5,m=1\033\\", NULL);
+		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_END_KITTY_IMAGE,
+		                        "\033_Gm=0\033\\", NULL);
+		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_BEGIN_KITTY_IMAGE_CHUNK,
+		                        "\033_Gm=1;", NULL);
+		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_END_KITTY_IMAGE_CHUNK,
+		                        "\033\\", NULL);
+	} else if (pixel_mode == CHAFA_PIXEL_MODE_SIXELS) {
+		/* Sixel graphics protocol:
+		 * ESC P p1;p2;p3 q <sixel_data> ESC \ */
+		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_BEGIN_SIXELS,
+		                        "\033P%1;%2;%3q", NULL);
+		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_END_SIXELS, "\033\\", NULL);
 	}
 
-	image_preview_debug_print("CHAFA: Rendering %s (max %dx%d)",
-	                          image_path, max_cols, max_rows);
+	return term_info;
+}
+#endif
+
+/* Decode and render the image. Runs in a worker thread, so it only
+ * touches the job. */
+static void render_job_run(IMAGE_RENDER_JOB_REC *job)
+{
+#ifdef HAVE_CHAFA
+	ChafaCanvasConfig *config;
+	ChafaCanvas *canvas;
+	ChafaTermInfo *term_info;
+	unsigned char *pixels;
+	int img_channels;
+	int target_cols, target_rows;
+	float aspect_ratio;
+	int source_w, source_h, estimated_bytes;
+	float scale;
 
 	/* Load image using stb_image */
-	pixels = stbi_load(image_path, &img_width, &img_height, &img_channels, 4);
+	pixels = stbi_load(job->image_path, &job->img_width, &job->img_height, &img_channels, 4);
 	if (pixels == NULL) {
-		image_preview_debug_print("CHAFA: Failed to load image: %s",
-		                          stbi_failure_reason());
-		return NULL;
+		/* The failure reason is a global unless stb_image could make
+		 * it thread-local, then concurrent decodes would report each
+		 * other's errors. */
+#ifdef STBI_THREAD_LOCAL
+		job->error = stbi_failure_reason();
+#else
+		job->error = "Failed to decode image";
+#endif
+		return;
 	}
 
-	image_preview_debug_print("CHAFA: Image loaded: %dx%d, %d channels",
-	                          img_width, img_height, img_channels);
-
 	/* Calculate target dimensions preserving aspect ratio.
 	 * Terminal cells are ~8x16 pixels (2:1 height:width), so we multiply
 	 * aspect ratio by 2 to get correct number of columns.
 	 * We also set cell_geometry(8,16) below so Chafa generates correct
 	 * source pixels for the Kitty protocol. */
-	aspect_ratio = (float)img_width / (float)img_height;
-	aspect_ratio *= 2.0f;  /* Adjust for 2:1 cell aspect ratio */
+	aspect_ratio = (float)job->img_width / (float)job->img_height;
+	aspect_ratio *= (float)RENDER_CELL_HEIGHT / RENDER_CELL_WIDTH;
 
-	if (aspect_ratio > (float)max_cols / (float)max_rows) {
+	if (aspect_ratio > (float)job->max_cols / (float)job->max_rows) {
 		/* Width limited */
-		target_cols = max_cols;
-		target_rows = (int)((float)max_cols / aspect_ratio);
+		target_cols = job->max_cols;
+		target_rows = (int)((float)job->max_cols / aspect_ratio);
 	} else {
 		/* Height limited */
-		target_rows = max_rows;
-		target_cols = (int)((float)max_rows * aspect_ratio);
+		target_rows = job->max_rows;
+		target_cols = (int)((float)job->max_rows * aspect_ratio);
 	}
 
 	if (target_cols < 1) target_cols = 1;
@@ -344,127 +453,30 @@ GString *image_render_chafa(const char *image_path,
 	/* Auto-scale down if estimated output exceeds byte limit (for tmux DCS passthrough).
 	 * Estimated size: source_pixels * 4 bytes RGBA * 1.4 (base64 + overhead)
 	 * Source pixels with cell_geometry(8,16): cols*8 * rows*16 */
-	max_bytes = settings_get_int(IMAGE_PREVIEW_MAX_BYTES);
-	if (max_bytes <= 0) max_bytes = IMAGE_PREVIEW_DEFAULT_MAX_BYTES;
-
-	source_w = target_cols * 8;
-	source_h = target_rows * 16;
+	source_w = target_cols * RENDER_CELL_WIDTH;
+	source_h = target_rows * RENDER_CELL_HEIGHT;
 	estimated_bytes = (int)((float)(source_w * source_h * 4) * 1.4f);
 
-	if (estimated_bytes > max_bytes) {
+	if (estimated_bytes > job->max_bytes) {
 		/* Scale down to fit byte limit */
-		scale = sqrtf((float)max_bytes / (float)estimated_bytes);
+		scale = sqrtf((float)job->max_bytes / (float)estimated_bytes);
 		target_cols = (int)((float)target_cols * scale);
 		target_rows = (int)((float)target_rows * scale);
 		if (target_cols < 1) target_cols = 1;
 		if (target_rows < 1) target_rows = 1;
-
-		source_w = target_cols * 8;
-		source_h = target_rows * 16;
-		estimated_bytes = (int)((float)(source_w * source_h * 4) * 1.4f);
-
-		image_preview_debug_print("CHAFA: Scaled down to fit %d bytes limit (est: %d)",
-		                          max_bytes, estimated_bytes);
 	}
 
-	image_preview_debug_print("CHAFA: Target size: %dx%d cells", target_cols, target_rows);
-
-	/* Get pixel mode from our detection (uses terminal query in tmux) */
-	pixel_mode = parse_blitter_setting();
-	image_preview_debug_print("CHAFA: Using pixel mode: %d (%s)", pixel_mode,
-	                          pixel_mode == CHAFA_PIXEL_MODE_ITERM2 ? "iTerm2" :
-	                          pixel_mode == CHAFA_PIXEL_MODE_KITTY ? "Kitty" :
-	                          pixel_mode == CHAFA_PIXEL_MODE_SIXELS ? "Sixel" : "Symbols");
-
-	/* Create term_info with appropriate escape sequences for our detected terminal.
-	 * We can't rely on Chafa's env-based detection in tmux because env vars show
-	 * the terminal where tmux was started, not the current terminal.
-	 * Solution: Manually set the graphics protocol sequences based on our detection. */
-	term_db = chafa_term_db_get_default();
-	term_info = chafa_term_info_new();
-
-	/* Supplement with default sequences first (cursor movement, colors, etc.) */
-	chafa_term_info_supplement(term_info, chafa_term_db_get_fallback_info(term_db));
-
-	/* Now manually set the graphics protocol sequences based on detected pixel mode.
-	 * These sequences are from Chafa source code - no env detection needed. */
-	if (pixel_mode == CHAFA_PIXEL_MODE_ITERM2) {
-		/* iTerm2 inline image protocol:
-		 * ESC ] 1337 ; File = inline=1;width=W;height=H;preserveAspectRatio=0 : base64 BEL */
-		GError *err = NULL;
-		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_BEGIN_ITERM2_IMAGE,
-		                        "\033]1337;File=inline=1;width=%1;height=%2;preserveAspectRatio=0:",
-		                        &err);
-		if (err) {
-			image_preview_debug_print("CHAFA: Failed to set BEGIN_ITERM2: %s", err->message);
-			g_error_free(err);
-		}
-		err = NULL;
-		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_END_ITERM2_IMAGE, "\a", &err);
-		if (err) {
-			image_preview_debug_print("CHAFA: Failed to set END_ITERM2: %s", err->message);
-			g_error_free(err);
-		}
-		image_preview_debug_print("CHAFA: Set iTerm2 sequences directly");
-	} else if (pixel_mode == CHAFA_PIXEL_MODE_KITTY) {
-		/* Kitty graphics protocol:
-		 * ESC _ G a=T,f=BPP,s=W,v=H,c=COLS,r=ROWS,m=1 ESC \ ... ESC _ G m=0 ESC \ */
-		GError *err = NULL;
-		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_BEGIN_KITTY_IMMEDIATE_IMAGE_V1,
-		                        "\033_Ga=T,f=%1,s=%2,v=%3,c=%4,r=%5,m=1\033\\",
-		                        &err);
-		if (err) {
-			image_preview_debug_print("CHAFA: Failed to set BEGIN_KITTY: %s", err->message);
-			g_error_free(err);
-		}
-		err = NULL;
-		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_END_KITTY_IMAGE, "\033_Gm=0\033\\", &err);
-		if (err) {
-			image_preview_debug_print("CHAFA: Failed to set END_KITTY: %s", err->message);
-			g_error_free(err);
-		}
-		err = NULL;
-		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_BEGIN_KITTY_IMAGE_CHUNK, "\033_Gm=1;", &err);
-		if (err) {
-			image_preview_debug_print("CHAFA: Failed to set CHUNK_BEGIN: %s", err->message);
-			g_error_free(err);
-		}
-		err = NULL;
-		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_END_KITTY_IMAGE_CHUNK, "\033\\", &err);
-		if (err) {
-			image_preview_debug_print("CHAFA: Failed to set CHUNK_END: %s", err->message);
-			g_error_free(err);
-		}
-		image_preview_debug_print("CHAFA: Set Kitty sequences directly");
-	} else if (pixel_mode == CHAFA_PIXEL_MODE_SIXELS) {
-		/* Sixel graphics protocol:
-		 * ESC P p1;p2;p3 q <sixel_data> ESC \ */
-		GError *err = NULL;
-		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_BEGIN_SIXELS,
-		                        "\033P%1;%2;%3q", &err);
-		if (err) {
-			image_preview_debug_print("CHAFA: Failed to set BEGIN_SIXELS: %s", err->message);
-			g_error_free(err);
-		}
-		err = NULL;
-		chafa_term_info_set_seq(term_info, CHAFA_TERM_SEQ_END_SIXELS, "\033\\", &err);
-		if (err) {
-			image_preview_debug_print("CHAFA: Failed to set END_SIXELS: %s", err->message);
-			g_error_free(err);
-		}
-		image_preview_debug_print("CHAFA: Set Sixel sequences directly");
-	}
+	term_info = render_term_info_new(job->pixel_mode);
 
 	/* Create canvas config */
 	config = chafa_canvas_config_new();
 	chafa_canvas_config_set_geometry(config, target_cols, target_rows);
-	chafa_canvas_config_set_pixel_mode(config, pixel_mode);
+	chafa_canvas_config_set_pixel_mode(config, job->pixel_mode);
 
 	/* Tell Chafa about actual terminal cell dimensions (width x height in pixels).
-	 * Most terminal fonts use approximately 8x16 pixel cells (2:1 height:width).
 	 * This ensures Chafa generates source pixels with correct aspect ratio
 	 * so images display correctly without manual aspect adjustment hacks. */
-	chafa_canvas_config_set_cell_geometry(config, 8, 16);
+	chafa_canvas_config_set_cell_geometry(config, RENDER_CELL_WIDTH, RENDER_CELL_HEIGHT);
 
 	/* Set canvas mode based on terminal colors */
 	chafa_canvas_config_set_canvas_mode(config, CHAFA_CANVAS_MODE_TRUECOLOR);
@@ -472,63 +484,249 @@ GString *image_render_chafa(const char *image_path,
 	/* Create canvas */
 	canvas = chafa_canvas_new(config);
 	if (canvas == NULL) {
-		image_preview_debug_print("CHAFA: Failed to create canvas");
+		job->error = "Failed to create canvas";
 		stbi_image_free(pixels);
 		chafa_canvas_config_unref(config);
 		chafa_term_info_unref(term_info);
-		return NULL;
+		return;
 	}
 
 	/* Draw image pixels */
 	chafa_canvas_draw_all_pixels(canvas,
 	                             CHAFA_PIXEL_RGBA8_UNASSOCIATED,
 	                             pixels,
-	                             img_width, img_height,
-	                             img_width * 4);
+	                             job->img_width, job->img_height,
+	                             job->img_width * 4);
 
 	/* Print canvas to string using detected term_info */
-	output = chafa_canvas_print(canvas, term_info);
-
-	if (output != NULL && output->len > 0) {
-		/* Log first 80 bytes as hex for debugging escape sequences */
-		GString *hex = g_string_new(NULL);
-		size_t i, limit = output->len < 80 ? output->len : 80;
-		for (i = 0; i < limit; i++) {
-			unsigned char c = (unsigned char)output->str[i];
-			if (c == 0x1b)
-				g_string_append(hex, "<ESC>");
-			else if (c >= 32 && c < 127)
-				g_string_append_c(hex, c);
-			else
-				g_string_append_printf(hex, "<%02x>", c);
-		}
-		image_preview_debug_print("CHAFA: Rendered %zu bytes, first: %s", output->len, hex->str);
-		g_string_free(hex, TRUE);
-	} else {
-		image_preview_debug_print("CHAFA: Rendered %zu bytes", output ? output->len : 0);
-	}
-
-	/* Set output rows */
-	if (out_rows != NULL)
-		*out_rows = target_rows;
+	job->output = chafa_canvas_print(canvas, term_info);
+	job->rows = target_rows;
 
 	/* Cleanup */
 	stbi_image_free(pixels);
 	chafa_term_info_unref(term_info);
 	chafa_canvas_unref(canvas);
 	chafa_canvas_config_unref(config);
+#else
+	job->error = "Not compiled with Chafa support";
+#endif
+}
 
-	return output;
+static void render_cache_rec_free(RENDER_CACHE_REC *rec)
+{
+	g_string_free(rec->output, TRUE);
+	g_free(rec->image_path);
+	g_free(rec->key);
+	g_free(rec);
+}
+
+static void render_cache_remove(RENDER_CACHE_REC *rec)
+{
+	g_hash_table_remove(render_cache, rec->key);
+	g_queue_remove(&render_cache_lru, rec);
+	render_cache_rec_free(rec);
+}
+
+static RENDER_CACHE_REC *render_cache_find(const char *key)
+{
+	RENDER_CACHE_REC *rec;
+
+	if (render_cache == NULL)
+		return NULL;
+
+	rec = g_hash_table_lookup(render_cache, key);
+	if (rec != NULL) {
+		g_queue_remove(&render_cache_lru, rec);
+		g_queue_push_head(&render_cache_lru, rec);
+	}
+	return rec;
+}
+
+static void render_cache_add(IMAGE_RENDER_JOB_REC *job)
+{
+	RENDER_CACHE_REC *rec;
+
+	if (render_cache == NULL)
+		render_cache = g_hash_table_new(g_str_hash, g_str_equal);
+
+	rec = g_hash_table_lookup(render_cache, job->key);
+	if (rec != NULL)
+		render_cache_remove(rec);
+
+	rec = g_new0(RENDER_CACHE_REC, 1);
+	rec->key = g_strdup(job->key);
+	rec->image_path = g_strdup(job->image_path);
+	rec->output = g_string_new_len(job->output->str, job->output->len);
+	rec->rows = job->rows;
+	g_hash_table_insert(render_cache, rec->key, rec);
+	g_queue_push_head(&render_cache_lru, rec);
+
+	while (render_cache_lru.length > RENDER_CACHE_MAX)
+		render_cache_remove(g_queue_peek_tail(&render_cache_lru));
+}
+
+/* Forget rendered outputs of an image file */
+void image_render_forget(const char *image_path)
+{
+	GList *tmp, *next;
+	RENDER_CACHE_REC *rec;
+
+	for (tmp = render_cache_lru.head; tmp != NULL; tmp = next) {
+		next = tmp->next;
+		rec = tmp->data;
+		if (strcmp(rec->image_path, image_path) == 0)
+			render_cache_remove(rec);
+	}
+}
+
+/* Back on the main thread after rendering: log, remember the result and
+ * the image size */
+static void render_job_finish(IMAGE_RENDER_JOB_REC *job)
+{
+	if (job->output == NULL) {
+		image_preview_debug_print("CHAFA: Failed to render %s: %s", job->image_path,
+		                          job->error != NULL ? job->error : "unknown error");
+		return;
+	}
+
+	image_preview_debug_print("CHAFA: Rendered %s: %dx%d image, %d rows, %zu bytes, pixel mode %d",
+	                          job->image_path, job->img_width, job->img_height,
+	                          job->rows, job->output->len, job->pixel_mode);
+
+	image_cache_set_dimensions(job->image_path, job->img_width, job->img_height);
+	render_cache_add(job);
+}
+
+static gboolean render_job_done(IMAGE_RENDER_JOB_REC *job)
+{
+	GString *output;
+
+	render_jobs = g_slist_remove(render_jobs, job);
+	render_job_finish(job);
+
+	if (!g_atomic_int_get(&job->cancelled)) {
+		output = job->output;
+		job->output = NULL;
+		job->func(job->image_path, output, job->rows, job->data);
+	}
+
+	render_job_free(job);
+	return FALSE;
+}
+
+static void render_worker(IMAGE_RENDER_JOB_REC *job, void *user_data)
+{
+	if (!g_atomic_int_get(&job->cancelled))
+		render_job_run(job);
+
+	g_idle_add((GSourceFunc) render_job_done, job);
+}
+
+/*
+ * Render an image file using Chafa
+ * Returns GString with escape sequences, caller must free with g_string_free()
+ * out_rows is set to the number of terminal rows the image will occupy
+ */
+GString *image_render_chafa(const char *image_path,
+                            int max_cols,
+                            int max_rows,
+                            int *out_rows)
+{
+	IMAGE_RENDER_JOB_REC *job;
+	RENDER_CACHE_REC *rec;
+	GString *output;
+
+	if (image_path == NULL) {
+		image_preview_debug_print("CHAFA: NULL image path");
+		return NULL;
+	}
+
+	job = render_job_new(image_path, max_cols, max_rows);
+	rec = render_cache_find(job->key);
+	if (rec != NULL) {
+		output = g_string_new_len(rec->output->str, rec->output->len);
+		job->rows = rec->rows;
+	} else {
+		render_job_run(job);
+		render_job_finish(job);
+		output = job->output;
+		job->output = NULL;
+	}
 
-#else /* !HAVE_CHAFA */
-	(void)image_path;
-	(void)max_cols;
-	(void)max_rows;
 	if (out_rows != NULL)
-		*out_rows = 0;
-	image_preview_debug_print("CHAFA: Not compiled with Chafa support");
-	return NULL;
-#endif
+		*out_rows = output == NULL ? 0 : job->rows;
+
+	render_job_free(job);
+	return output;
+}
+
+/*
+ * Render an image file in a worker thread. func is called from the main
+ * loop with the output (or NULL on failure), which it must free. Returns
+ * NULL if the result was already known and func has been called.
+ */
+IMAGE_RENDER_JOB_REC *image_render_chafa_async(const char *image_path,
+                                               int max_cols, int max_rows,
+                                               IMAGE_RENDER_FUNC func, void *data)
+{
+	IMAGE_RENDER_JOB_REC *job;
+	RENDER_CACHE_REC *rec;
+
+	g_return_val_if_fail(image_path != NULL, NULL);
+	g_return_val_if_fail(func != NULL, NULL);
+
+	job = render_job_new(image_path, max_cols, max_rows);
+	rec = render_cache_find(job->key);
+	if (rec != NULL) {
+		image_preview_debug_print("CHAFA: %s already rendered", image_path);
+		render_job_free(job);
+		func(image_path, g_string_new_len(rec->output->str, rec->output->len),
+		     rec->rows, data);
+		return NULL;
+	}
+
+	job->func = func;
+	job->data = data;
+
+	if (render_pool == NULL) {
+		render_pool = g_thread_pool_new((GFunc) render_worker, NULL,
+		                                RENDER_THREADS, FALSE, NULL);
+	}
+
+	image_preview_debug_print("CHAFA: Queued %s (max %dx%d)", image_path, max_cols, max_rows);
+	render_jobs = g_slist_prepend(render_jobs, job);
+	g_thread_pool_push(render_pool, job, NULL);
+	return job;
+}
+
+/* Don't call the render callback. The job still finishes in the background. */
+void image_render_cancel(IMAGE_RENDER_JOB_REC *job)
+{
+	g_atomic_int_set(&job->cancelled, TRUE);
+}
+
+void image_render_deinit(void)
+{
+	GSList *tmp;
+
+	/* Wait for the running jobs, drop the queued ones */
+	if (render_pool != NULL) {
+		g_thread_pool_free(render_pool, TRUE, TRUE);
+		render_pool = NULL;
+	}
+
+	for (tmp = render_jobs; tmp != NULL; tmp = tmp->next) {
+		g_idle_remove_by_data(tmp->data);
+		render_job_free(tmp->data);
+	}
+	g_slist_free(render_jobs);
+	render_jobs = NULL;
+
+	if (render_cache != NULL) {
+		g_queue_clear_full(&render_cache_lru, (GDestroyNotify) render_cache_rec_free);
+		g_hash_table_destroy(render_cache);
+		render_cache = NULL;
+	}
 }
 
 /*
@@ -614,6 +812,7 @@ void image_render_clear_graphics(void)
 		/* iTerm2/Sixel/Symbols: redraw mainwindow to overwrite image with text.
 		 * Only mainwindow needs redraw since popup is displayed within it. */
 		image_preview_debug_print("CLEAR: Non-Kitty (%d) - redrawing mainwindow", pixel_mode);
+		term_invalidate();
 		mainwindows_redraw();
 	}
 #endif
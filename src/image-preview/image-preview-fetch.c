@@ -12,6 +12,7 @@
 #include "module.h"
 #include "image-preview.h"
 
+#include <irssi/src/core/misc.h>
 #include <irssi/src/core/settings.h>
 #include <irssi/src/core/signals.h>
 
@@ -47,8 +48,17 @@ static CURLM *curl_multi = NULL;
 /* Active fetches: url -> IMAGE_FETCH_REC */
 static GHashTable *active_fetches = NULL;
 
-/* GMainLoop timer for processing */
+/* Socket watched for curl */
+typedef struct {
+	curl_socket_t fd;
+	int tag;
+} CURL_SOCKET_REC;
+
+/* curl drives the transfers through socket watches and one timer, so
+ * nothing runs while there are no transfers and nothing blocks */
+static GSList *curl_sockets = NULL;
 static guint curl_timer_tag = 0;
+static int curl_running = 0;
 
 /* Maximum concurrent fetches */
 #define MAX_CONCURRENT_FETCHES 3
@@ -107,7 +117,6 @@ gboolean image_fetch_is_active(const char *url)
 	IMAGE_FETCH_REC *fetch;
 	GHashTableIter iter;
 	gpointer key, value;
-	int still_running = 0;
 	gboolean active;
 
 	if (active_fetches == NULL || url == NULL)
@@ -133,15 +142,10 @@ gboolean image_fetch_is_active(const char *url)
 		return FALSE;
 	}
 
-	/* Check if curl actually has active transfers */
-	if (curl_multi != NULL) {
-		curl_multi_perform(curl_multi, &still_running);
-	}
-
-	/* Active means: in hash table AND (timer running OR curl has active transfers) */
-	active = (curl_timer_tag != 0 || still_running > 0);
-	image_preview_debug_print("FETCH_IS_ACTIVE: %s found, timer=%u still_running=%d -> %s",
-	                          url, curl_timer_tag, still_running, active ? "ACTIVE" : "STUCK");
+	/* Active means: in hash table AND (timer pending OR curl has active transfers) */
+	active = (curl_timer_tag != 0 || curl_running > 0);
+	image_preview_debug_print("FETCH_IS_ACTIVE: %s found, timer=%u running=%d -> %s",
+	                          url, curl_timer_tag, curl_running, active ? "ACTIVE" : "STUCK");
 	return active;
 }
 
@@ -176,13 +180,8 @@ void image_fetch_debug_dump(void)
 		                          count++, fetch->url, stage_str, fetch->cancelled);
 	}
 
-	/* Check curl multi status */
-	if (curl_multi != NULL) {
-		int still_running;
-		CURLMcode mc = curl_multi_perform(curl_multi, &still_running);
-		image_preview_debug_print("FETCH_DUMP: curl_multi_perform: mc=%d still_running=%d",
-		                          mc, still_running);
-	}
+	image_preview_debug_print("FETCH_DUMP: running=%d sockets=%u",
+	                          curl_running, g_slist_length(curl_sockets));
 }
 
 /* Track bytes written for debug */
@@ -400,59 +399,12 @@ static char *extract_og_image(const char *html)
 	return og_image;
 }
 
-/* Process curl events - called from GMainLoop */
-static gboolean curl_process(gpointer data)
+/* Handle the finished transfers */
+static void curl_check_done(void)
 {
-	int still_running;
-	CURLMcode mc;
 	CURLMsg *msg;
 	int msgs_left;
-	static int call_count = 0;
-	int numfds;
-	int max_loops = 10;  /* Prevent infinite loops */
-
-	if (curl_multi == NULL)
-		return FALSE;
 
-	call_count++;
-
-	/* First perform to drive any pending work */
-	mc = curl_multi_perform(curl_multi, &still_running);
-	if (mc != CURLM_OK) {
-		image_preview_debug_print("FETCH: curl_multi_perform failed: %s",
-		                          curl_multi_strerror(mc));
-	}
-
-	/* Keep polling and performing while there's activity */
-	while (still_running > 0 && max_loops-- > 0) {
-		/* Wait for activity (up to 50ms) - gives curl time to receive data */
-		mc = curl_multi_poll(curl_multi, NULL, 0, 50, &numfds);
-		if (mc != CURLM_OK) {
-			image_preview_debug_print("FETCH: curl_multi_poll failed: %s",
-			                          curl_multi_strerror(mc));
-			break;
-		}
-
-		/* If no file descriptors had activity and no timeout, break */
-		if (numfds == 0) {
-			/* Still do one more perform in case data arrived */
-			mc = curl_multi_perform(curl_multi, &still_running);
-			break;
-		}
-
-		/* Perform transfers after poll detected activity */
-		mc = curl_multi_perform(curl_multi, &still_running);
-		if (mc != CURLM_OK) {
-			break;
-		}
-	}
-
-	/* Log periodically to confirm timer is running */
-	if (call_count % 100 == 0 && still_running > 0) {
-		image_preview_debug_print("FETCH: timer tick #%d, still_running=%d", call_count, still_running);
-	}
-
-	/* Check for completed transfers */
 	while ((msg = curl_multi_info_read(curl_multi, &msgs_left)) != NULL) {
 		if (msg->msg == CURLMSG_DONE) {
 			CURL *easy = msg->easy_handle;
@@ -476,101 +428,95 @@ static gboolean curl_process(gpointer data)
 			}
 		}
 	}
+}
 
-	/* Re-check still_running in case new transfers were added during
-	 * completion handling (e.g., stage 2 of a two-stage fetch).
-	 * The fetch_complete() -> image_fetch_start_stage2() path may have
-	 * added new handles that we need to continue processing. */
-	mc = curl_multi_perform(curl_multi, &still_running);
+/* Let curl handle activity on a socket, or its timeout */
+static void curl_socket_action(curl_socket_t fd, int ev_bitmask)
+{
+	CURLMcode mc;
 
-	/* CRITICAL: Check for completed messages again!
-	 * If stage 2 started and completed quickly (e.g., network error),
-	 * the completion message will be waiting but we haven't checked it.
-	 * Without this, the fetch stays "pending" forever. */
-	while ((msg = curl_multi_info_read(curl_multi, &msgs_left)) != NULL) {
-		if (msg->msg == CURLMSG_DONE) {
-			CURL *easy = msg->easy_handle;
-			CURLcode result = msg->data.result;
-			IMAGE_FETCH_REC *fetch = NULL;
+	if (curl_multi == NULL)
+		return;
 
-			curl_easy_getinfo(easy, CURLINFO_PRIVATE, &fetch);
+	mc = curl_multi_socket_action(curl_multi, fd, ev_bitmask, &curl_running);
+	if (mc != CURLM_OK) {
+		image_preview_debug_print("FETCH: curl_multi_socket_action failed: %s",
+		                          curl_multi_strerror(mc));
+	}
 
-			image_preview_debug_print("FETCH: (post-recheck) transfer done, result=%d (%s)",
-			                          result, curl_easy_strerror(result));
+	/* Completion handlers may start stage 2 fetches, that's fine here
+	 * since we're no longer inside curl */
+	curl_check_done();
+}
 
-			if (fetch != NULL) {
-				if (result == CURLE_OK && !fetch->cancelled) {
-					fetch_complete(fetch, TRUE, NULL);
-				} else if (fetch->cancelled) {
-					fetch_complete(fetch, FALSE, "Cancelled or file too large");
-				} else {
-					fetch_complete(fetch, FALSE, curl_easy_strerror(result));
-				}
-			}
-		}
-	}
+static void curl_socket_input(CURL_SOCKET_REC *rec, GIOChannel *source, int condition)
+{
+	int ev_bitmask = 0;
 
-	/* Final check after processing any remaining messages */
-	mc = curl_multi_perform(curl_multi, &still_running);
+	if (condition & I_INPUT_READ)
+		ev_bitmask |= CURL_CSELECT_IN;
+	if (condition & I_INPUT_WRITE)
+		ev_bitmask |= CURL_CSELECT_OUT;
 
-	/* Third check for completion messages - covers edge case where
-	 * stage 2 data arrived between perform calls */
-	while ((msg = curl_multi_info_read(curl_multi, &msgs_left)) != NULL) {
-		if (msg->msg == CURLMSG_DONE) {
-			CURL *easy = msg->easy_handle;
-			CURLcode result = msg->data.result;
-			IMAGE_FETCH_REC *fetch = NULL;
+	curl_socket_action(rec->fd, ev_bitmask);
+}
 
-			curl_easy_getinfo(easy, CURLINFO_PRIVATE, &fetch);
+/* CURLMOPT_SOCKETFUNCTION: curl tells which sockets to watch */
+static int socket_callback(CURL *easy, curl_socket_t fd, int what,
+                                void *userp, void *socketp)
+{
+	CURL_SOCKET_REC *rec = socketp;
+	int condition;
 
-			image_preview_debug_print("FETCH: (final-check) transfer done, result=%d (%s)",
-			                          result, curl_easy_strerror(result));
+	if (rec != NULL) {
+		g_source_remove(rec->tag);
+		rec->tag = 0;
+	}
 
-			if (fetch != NULL) {
-				if (result == CURLE_OK && !fetch->cancelled) {
-					fetch_complete(fetch, TRUE, NULL);
-				} else if (fetch->cancelled) {
-					fetch_complete(fetch, FALSE, "Cancelled or file too large");
-				} else {
-					fetch_complete(fetch, FALSE, curl_easy_strerror(result));
-				}
-			}
+	if (what == CURL_POLL_REMOVE) {
+		if (rec != NULL) {
+			curl_sockets = g_slist_remove(curl_sockets, rec);
+			g_free(rec);
 		}
+		return 0;
 	}
 
-	/* Re-check still_running after processing any final messages */
-	curl_multi_perform(curl_multi, &still_running);
-
-	/* Continue if there are active transfers */
-	if (still_running > 0) {
-		return TRUE;
+	if (rec == NULL) {
+		rec = g_new0(CURL_SOCKET_REC, 1);
+		rec->fd = fd;
+		curl_sockets = g_slist_prepend(curl_sockets, rec);
+		curl_multi_assign(curl_multi, fd, rec);
 	}
 
-	/* Also continue if we have active fetches in hash table that haven't
-	 * been cleaned up yet - this covers race conditions where curl says
-	 * 0 active but we haven't processed completion yet */
-	if (active_fetches != NULL && g_hash_table_size(active_fetches) > 0) {
-		image_preview_debug_print("FETCH: still_running=0 but %u active in hash table, continuing",
-		                          g_hash_table_size(active_fetches));
-		return TRUE;
-	}
+	condition = 0;
+	if (what & CURL_POLL_IN)
+		condition |= I_INPUT_READ;
+	if (what & CURL_POLL_OUT)
+		condition |= I_INPUT_WRITE;
+
+	rec->tag = i_input_add_poll(fd, G_PRIORITY_DEFAULT, condition,
+	                            (GInputFunction) curl_socket_input, rec);
+	return 0;
+}
 
-	/* No more transfers - stop timer */
-	image_preview_debug_print("FETCH: timer STOPPING - no active transfers");
+static gboolean curl_timeout(gpointer data)
+{
 	curl_timer_tag = 0;
+	curl_socket_action(CURL_SOCKET_TIMEOUT, 0);
 	return FALSE;
 }
 
-/* Start processing timer if not already running */
-static void ensure_processing_timer(void)
+/* CURLMOPT_TIMERFUNCTION: curl wants to be called after timeout_ms */
+static int timer_callback(CURLM *multi, long timeout_ms, void *userp)
 {
-	if (curl_timer_tag == 0) {
-		/* Poll every 50ms - each tick does multiple poll/perform cycles */
-		curl_timer_tag = g_timeout_add(50, curl_process, NULL);
-		image_preview_debug_print("FETCH: timer STARTED, tag=%u", curl_timer_tag);
-	} else {
-		image_preview_debug_print("FETCH: timer already running, tag=%u", curl_timer_tag);
+	if (curl_timer_tag != 0) {
+		g_source_remove(curl_timer_tag);
+		curl_timer_tag = 0;
 	}
+
+	if (timeout_ms >= 0)
+		curl_timer_tag = g_timeout_add(timeout_ms, curl_timeout, NULL);
+	return 0;
 }
 
 /* Retry timer callback - starts a new fetch after 3 second delay */
@@ -741,6 +687,12 @@ static void fetch_complete(IMAGE_FETCH_REC *fetch, gboolean success, const char
 		}
 	}
 
+	/* Index the download, this also checks it really is an image */
+	if (success && !image_cache_add(fetch->cache_path)) {
+		success = FALSE;
+		error = "Not an image";
+	}
+
 	/* Remove from curl multi */
 	if (fetch->curl_handle != NULL) {
 		curl_multi_remove_handle(curl_multi, fetch->curl_handle);
@@ -914,21 +866,7 @@ static void image_fetch_start_stage2(IMAGE_FETCH_REC *fetch, const char *og_imag
 		return;
 	}
 
-	/* CRITICAL: Kick curl immediately after adding stage 2!
-	 * We're likely being called from inside curl_process() callback where
-	 * still_running was already set to 0 (from stage 1 completion).
-	 * If we don't call curl_multi_perform() now, the callback will return
-	 * FALSE and stop the timer before stage 2 can be processed.
-	 * This call updates still_running so the timer continues. */
-	{
-		int still_running;
-		curl_multi_perform(curl_multi, &still_running);
-		image_preview_debug_print("FETCH: stage2 kicked curl, still_running=%d", still_running);
-	}
-
-	/* Also ensure timer is running (in case we weren't called from callback) */
-	ensure_processing_timer();
-
+	/* Adding the handle set curl's timer, it starts the transfer */
 	image_preview_debug_print("FETCH: stage2 started successfully");
 }
 
@@ -1045,10 +983,7 @@ gboolean image_fetch_start(const char *url, const char *cache_path,
 	/* Track active fetch - use original_url for page URLs so we can find it later */
 	g_hash_table_insert(active_fetches, fetch->original_url ? fetch->original_url : fetch->url, fetch);
 
-	/* Start processing timer */
-	ensure_processing_timer();
-
-	image_preview_debug_print("FETCH: started successfully, stage=%d timer running", fetch->stage);
+	image_preview_debug_print("FETCH: started successfully, stage=%d", fetch->stage);
 	return TRUE;
 }
 
@@ -1100,6 +1035,9 @@ void image_fetch_init(void)
 	curl_multi_setopt(curl_multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, 4L);
 	/* Enable HTTP/2 multiplexing */
 	curl_multi_setopt(curl_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	/* Event driven from the main loop */
+	curl_multi_setopt(curl_multi, CURLMOPT_SOCKETFUNCTION, socket_callback);
+	curl_multi_setopt(curl_multi, CURLMOPT_TIMERFUNCTION, timer_callback);
 
 	/* Create active fetches hash table */
 	active_fetches = g_hash_table_new_full(g_str_hash, g_str_equal,
@@ -1111,11 +1049,7 @@ void image_fetch_init(void)
 /* Deinitialize fetch system */
 void image_fetch_deinit(void)
 {
-	/* Stop processing timer */
-	if (curl_timer_tag != 0) {
-		g_source_remove(curl_timer_tag);
-		curl_timer_tag = 0;
-	}
+	GSList *tmp;
 
 	/* Clear active fetches */
 	if (active_fetches != NULL) {
@@ -1129,6 +1063,23 @@ void image_fetch_deinit(void)
 		curl_multi = NULL;
 	}
 
+	/* Remove the watches curl didn't remove itself */
+	for (tmp = curl_sockets; tmp != NULL; tmp = tmp->next) {
+		CURL_SOCKET_REC *rec = tmp->data;
+
+		if (rec->tag != 0)
+			g_source_remove(rec->tag);
+		g_free(rec);
+	}
+	g_slist_free(curl_sockets);
+	curl_sockets = NULL;
+
+	if (curl_timer_tag != 0) {
+		g_source_remove(curl_timer_tag);
+		curl_timer_tag = 0;
+	}
+	curl_running = 0;
+
 	/* Global curl cleanup */
 	curl_global_cleanup();
 }
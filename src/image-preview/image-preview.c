@@ -51,9 +51,13 @@ static GString *popup_content = NULL;
 static int popup_x = 0, popup_y = 0;
 static int popup_width = 0, popup_height = 0;
 static LINE_REC *popup_current_line = NULL;  /* Line whose image is currently displayed */
+static IMAGE_RENDER_JOB_REC *popup_render_job = NULL; /* Popup image being rendered */
+static LINE_REC *popup_render_line = NULL;
+static int popup_render_width = 0;
 
 /* Forward declarations */
 static void popup_preview_show_for_line(const char *image_path, LINE_REC *line);
+static void popup_render_done(const char *image_path, GString *output, int rows, void *data);
 static void popup_preview_dismiss(void);
 static gboolean cache_cleanup_callback(gpointer user_data);
 
@@ -462,19 +466,13 @@ gboolean image_preview_queue_fetch(const char *url, LINE_REC *line, WINDOW_REC *
 
 	cache_path = image_cache_get(url);
 	if (cache_path != NULL) {
-		/* Double-check file exists (image_cache_get validates magic bytes) */
-		if (access(cache_path, R_OK) == 0) {
-			debug_print("queue_fetch: CACHED at %s", cache_path);
-			rec->cache_path = cache_path;
-			rec->fetch_pending = FALSE;
-			rec->fetch_failed = FALSE;
-			signal_emit("image preview ready", 2, line, window);
-			return TRUE;
-		} else {
-			debug_print("queue_fetch: cache_get returned path but file missing: %s", cache_path);
-			g_free(cache_path);
-			/* Continue to fetch */
-		}
+		debug_print("queue_fetch: CACHED at %s", cache_path);
+		g_free(rec->cache_path);
+		rec->cache_path = cache_path;
+		rec->fetch_pending = FALSE;
+		rec->fetch_failed = FALSE;
+		signal_emit("image preview ready", 2, line, window);
+		return TRUE;
 	}
 
 	if (rec->cache_path == NULL) {
@@ -625,7 +623,7 @@ static gboolean cache_cleanup_callback(gpointer user_data)
 	/* Delete the cached file */
 	if (preview->cache_path != NULL) {
 		debug_print("CACHE_CLEANUP: deleting %s", preview->cache_path);
-		unlink(preview->cache_path);
+		image_cache_remove(preview->cache_path);
 		g_free(preview->cache_path);
 		preview->cache_path = NULL;
 	}
@@ -646,9 +644,22 @@ static gboolean cache_cleanup_callback(gpointer user_data)
 	return FALSE;  /* Don't repeat timer */
 }
 
+/* Forget the popup being rendered */
+static void popup_render_cancel(void)
+{
+	if (popup_render_job != NULL) {
+		debug_print("POPUP: cancelling pending render");
+		image_render_cancel(popup_render_job);
+		popup_render_job = NULL;
+	}
+	popup_render_line = NULL;
+}
+
 /* Dismiss popup preview */
 static void popup_preview_dismiss(void)
 {
+	popup_render_cancel();
+
 	if (!popup_preview_showing)
 		return;
 
@@ -787,33 +798,39 @@ void image_preview_show_error_popup(void)
 	}
 }
 
-/* Show centered popup preview for an image with optional LINE_REC for cache tracking */
-static void popup_preview_show_for_line(const char *image_path, LINE_REC *line)
+/* Get the text area of the active main window */
+static void popup_get_area(int *top, int *left, int *height, int *width)
 {
 	MAIN_WINDOW_REC *mainwin;
-	IMAGE_PREVIEW_REC *preview;
-	int max_width, max_height;
-	int mw_top, mw_left, mw_height, mw_width;
-	int rows = 0;
-
-	debug_print("POPUP: showing preview for %s (line=%p)", image_path, (void*)line);
 
-	/* Get main window dimensions for centering */
 	mainwin = WINDOW_MAIN(active_win);
 	if (mainwin != NULL) {
-		mw_top = mainwin->first_line + mainwin->statusbar_lines_top;
-		mw_left = mainwin->first_column;
-		mw_height = mainwin->height - mainwin->statusbar_lines;
-		mw_width = mainwin->width;
+		*top = mainwin->first_line + mainwin->statusbar_lines_top;
+		*left = mainwin->first_column;
+		*height = mainwin->height - mainwin->statusbar_lines;
+		*width = mainwin->width;
 		debug_print("POPUP: main window: top=%d left=%d height=%d width=%d",
-		            mw_top, mw_left, mw_height, mw_width);
+		            *top, *left, *height, *width);
 	} else {
-		mw_top = 0;
-		mw_left = 0;
-		mw_height = term_height;
-		mw_width = term_width;
+		*top = 0;
+		*left = 0;
+		*height = term_height;
+		*width = term_width;
 		debug_print("POPUP: no mainwin, using terminal size");
 	}
+}
+
+/* Show centered popup preview for an image with optional LINE_REC for cache tracking.
+ * The image is rendered in the background, the popup appears when it's done. */
+static void popup_preview_show_for_line(const char *image_path, LINE_REC *line)
+{
+	int max_width, max_height;
+	int mw_top, mw_left, mw_height, mw_width;
+
+	debug_print("POPUP: showing preview for %s (line=%p)", image_path, (void*)line);
+
+	/* Get main window dimensions */
+	popup_get_area(&mw_top, &mw_left, &mw_height, &mw_width);
 
 	/* Dismiss any existing popup first */
 	popup_preview_dismiss();
@@ -835,9 +852,30 @@ static void popup_preview_show_for_line(const char *image_path, LINE_REC *line)
 	if (max_width > mw_width - 4) max_width = mw_width - 4;
 	if (max_height > mw_height - 4) max_height = mw_height - 4;
 
-	/* Render using Chafa */
-	popup_content = image_render_chafa(image_path, max_width, max_height, &rows);
-	if (popup_content == NULL) {
+	/* Render using Chafa, popup_render_done() is called right away
+	 * if this size was rendered before */
+	popup_render_line = line;
+	popup_render_width = max_width;
+	popup_render_job = image_render_chafa_async(image_path, max_width, max_height,
+	                                            popup_render_done, NULL);
+}
+
+/* Image for the popup rendered */
+static void popup_render_done(const char *image_path, GString *output, int rows, void *data)
+{
+	IMAGE_PREVIEW_REC *preview;
+	LINE_REC *line;
+	int mw_top, mw_left, mw_height, mw_width;
+	int max_width;
+
+	(void)data;
+
+	line = popup_render_line;
+	max_width = popup_render_width;
+	popup_render_job = NULL;
+	popup_render_line = NULL;
+
+	if (output == NULL) {
 		debug_print("POPUP: failed to render image - invalidating cache");
 
 		/* Render failed - cache file is likely corrupt or incomplete */
@@ -846,7 +884,7 @@ static void popup_preview_show_for_line(const char *image_path, LINE_REC *line)
 			preview = image_preview_get(line);
 			if (preview != NULL && preview->cache_path != NULL) {
 				debug_print("POPUP: deleting corrupt cache file: %s", preview->cache_path);
-				unlink(preview->cache_path);
+				image_cache_remove(preview->cache_path);
 				g_free(preview->cache_path);
 				preview->cache_path = NULL;
 				/* Reset state so next click can retry */
@@ -860,6 +898,12 @@ static void popup_preview_show_for_line(const char *image_path, LINE_REC *line)
 		return;
 	}
 
+	debug_print("POPUP: rendered %s", image_path);
+	popup_content = output;
+
+	/* The window may have changed size while rendering */
+	popup_get_area(&mw_top, &mw_left, &mw_height, &mw_width);
+
 	/* Center position within main window */
 	popup_y = mw_top + (mw_height - rows) / 2;
 	popup_x = mw_left + (mw_width - max_width) / 2;
@@ -1238,6 +1282,9 @@ static void sig_textbuffer_line_removed(TEXT_BUFFER_VIEW_REC *view,
 	if (image_previews == NULL || line == NULL)
 		return;
 
+	if (line == popup_render_line)
+		popup_render_cancel();
+
 	if (g_hash_table_remove(image_previews, line)) {
 		debug_print("LINE_REMOVED: cleaned up preview for line %p", line);
 	}
@@ -1350,6 +1397,7 @@ void image_preview_deinit(void)
 	signal_remove("window changed", (SIGNAL_FUNC)sig_window_changed);
 
 	image_fetch_deinit();
+	image_render_deinit();
 	image_cache_deinit();
 
 	if (image_previews != NULL) {
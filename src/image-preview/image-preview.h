@@ -95,6 +95,13 @@ void image_cache_deinit(void);
 gboolean image_cache_has(const char *url);
 char *image_cache_get(const char *url);
 gboolean image_cache_store(const char *url, const char *source_path);
+/* Index a file downloaded into the cache directory, FALSE if it's not
+   an image (the file is removed then) */
+gboolean image_cache_add(const char *path);
+/* Delete a cached file */
+void image_cache_remove(const char *path);
+void image_cache_set_dimensions(const char *path, int width, int height);
+gboolean image_cache_get_dimensions(const char *path, int *width, int *height);
 void image_cache_clear_all(void);
 void image_cache_cleanup(void);
 void image_cache_print_stats(void);
@@ -115,10 +122,21 @@ void image_fetch_cleanup_stuck(const char *url);
 ImageUrlType image_preview_classify_url(const char *url);
 
 /* Chafa rendering */
+typedef struct _IMAGE_RENDER_JOB_REC IMAGE_RENDER_JOB_REC;
+/* output is NULL if rendering failed, otherwise the callee owns it */
+typedef void (*IMAGE_RENDER_FUNC) (const char *image_path, GString *output,
+                                   int rows, void *data);
+
 GString *image_render_chafa(const char *image_path,
                             int max_cols,
                             int max_rows,
                             int *out_rows);
+IMAGE_RENDER_JOB_REC *image_render_chafa_async(const char *image_path,
+                                               int max_cols, int max_rows,
+                                               IMAGE_RENDER_FUNC func, void *data);
+void image_render_cancel(IMAGE_RENDER_JOB_REC *job);
+void image_render_forget(const char *image_path);
+void image_render_deinit(void);
 GString *image_render_error_icon(int max_cols, int max_rows, int *out_rows);
 void image_render_popup(const char *image_path, int x, int y);
 void image_render_popup_close(void);
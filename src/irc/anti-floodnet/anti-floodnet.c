@@ -31,6 +31,9 @@ void nick_flood_deinit(void);
 
 ANTI_FLOODNET_REC *floodnet = NULL;
 
+static void message_window_resize(void);
+static void update_duplicate_texts(void);
+
 /* Read settings from irssi configuration */
 static void read_settings(void)
 {
@@ -41,6 +44,8 @@ static void read_settings(void)
     floodnet->duplicate_threshold = settings_get_int("anti_floodnet_duplicate_threshold");
     if (floodnet->duplicate_threshold == 0)
         floodnet->duplicate_threshold = DEFAULT_DUPLICATE_THRESHOLD;
+    else if (floodnet->duplicate_threshold < 1)
+        floodnet->duplicate_threshold = 1;
 
     floodnet->ctcp_threshold = settings_get_int("anti_floodnet_ctcp_threshold");
     if (floodnet->ctcp_threshold == 0)
@@ -57,6 +62,8 @@ static void read_settings(void)
     floodnet->time_window = settings_get_int("anti_floodnet_time_window");
     if (floodnet->time_window == 0)
         floodnet->time_window = DEFAULT_TIME_WINDOW;
+    else
+        floodnet->time_window = CLAMP(floodnet->time_window, 1, MAX_TIME_WINDOW);
 
     floodnet->nickchange_window = settings_get_int("anti_floodnet_nickchange_window");
     if (floodnet->nickchange_window == 0)
@@ -65,6 +72,9 @@ static void read_settings(void)
     floodnet->protection_notice_interval = settings_get_int("anti_floodnet_notice_interval");
     if (floodnet->protection_notice_interval == 0)
         floodnet->protection_notice_interval = 60;  /* Default: 60s */
+
+    message_window_resize();
+    update_duplicate_texts();
 }
 
 /* Settings changed signal */
@@ -91,102 +101,156 @@ gboolean check_tilde_ident(const char *userhost)
     return (tilde != NULL && tilde < strchr(excl_mark, '@'));
 }
 
-/* Add message to tracking window */
-static void add_message_to_window(const char *nick, const char *userhost,
-                                  const char *text, time_t timestamp)
+/* Drop one reference to a window text */
+static void message_text_unref(FLOODTEXT_REC *rec)
 {
-    FLOODMSG_REC *rec = g_new0(FLOODMSG_REC, 1);
+    rec->count--;
+    if (rec->count < floodnet->duplicate_threshold)
+        g_hash_table_remove(floodnet->duplicate_texts, rec);
+
+    if (rec->count == 0) {
+        g_hash_table_remove(floodnet->duplicate_texts, rec);
+        g_hash_table_remove(floodnet->message_texts, rec->text);
+        g_free(rec->text);
+        g_free(rec);
+    }
+}
 
-    rec->timestamp = timestamp;
-    rec->nick = g_strdup(nick);
-    rec->userhost = g_strdup(userhost);
-    rec->text = g_strdup(text);
-    rec->has_tilde = check_tilde_ident(userhost);
+/* Expire all messages of a bucket */
+static void bucket_clear(FLOODBUCKET_REC *bucket)
+{
+    guint i;
 
-    floodnet->message_window = g_slist_prepend(floodnet->message_window, rec);
-    floodnet->message_count++;
+    for (i = 0; i < bucket->texts->len; i++)
+        message_text_unref(g_ptr_array_index(bucket->texts, i));
+
+    floodnet->message_count -= bucket->texts->len;
+    floodnet->tilde_count -= bucket->tilde_count;
+
+    g_ptr_array_set_size(bucket->texts, 0);
+    bucket->tilde_count = 0;
+    bucket->second = 0;
 }
 
-/* Free message record */
-static void free_floodmsg_rec(FLOODMSG_REC *rec)
+/* (Re)create the bucket ring for current time_window, dropping old messages */
+static void message_window_resize(void)
 {
-    if (!rec)
+    int i, count;
+
+    count = floodnet->time_window + 1;
+    if (floodnet->buckets != NULL && floodnet->bucket_count == count)
         return;
 
-    g_free(rec->nick);
-    g_free(rec->userhost);
-    g_free(rec->text);
-    g_free(rec);
+    for (i = 0; i < floodnet->bucket_count; i++) {
+        bucket_clear(&floodnet->buckets[i]);
+        g_ptr_array_free(floodnet->buckets[i].texts, TRUE);
+    }
+    g_free(floodnet->buckets);
+
+    floodnet->buckets = g_new0(FLOODBUCKET_REC, count);
+    floodnet->bucket_count = count;
+    floodnet->last_cleanup = 0;
+    for (i = 0; i < count; i++)
+        floodnet->buckets[i].texts = g_ptr_array_new();
 }
 
-/* Clean up old messages outside the time window */
-void cleanup_old_messages(time_t now)
+/* Rebuild duplicate_texts after duplicate_threshold changed */
+static void update_duplicate_texts(void)
 {
-    GSList *tmp, *next;
-    time_t cutoff = now - floodnet->time_window;
+    GHashTableIter iter;
+    FLOODTEXT_REC *rec;
 
-    for (tmp = floodnet->message_window; tmp != NULL; tmp = next) {
-        FLOODMSG_REC *rec = tmp->data;
-        next = tmp->next;
+    g_hash_table_remove_all(floodnet->duplicate_texts);
 
-        if (rec->timestamp < cutoff) {
-            floodnet->message_window = g_slist_remove(floodnet->message_window, rec);
-            floodnet->message_count--;
-            free_floodmsg_rec(rec);
-        }
+    g_hash_table_iter_init(&iter, floodnet->message_texts);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &rec)) {
+        if (rec->count >= floodnet->duplicate_threshold)
+            g_hash_table_add(floodnet->duplicate_texts, rec);
     }
 }
 
-/* Count tilde ident users in current window */
-static int count_tilde_users(void)
+/* Add message to tracking window */
+static FLOODTEXT_REC *add_message_to_window(const char *text, gboolean has_tilde,
+                                            time_t timestamp)
 {
-    GSList *tmp;
-    int count = 0;
+    FLOODBUCKET_REC *bucket;
+    FLOODTEXT_REC *rec;
 
-    for (tmp = floodnet->message_window; tmp != NULL; tmp = tmp->next) {
-        FLOODMSG_REC *rec = tmp->data;
-        if (rec->has_tilde)
-            count++;
+    bucket = &floodnet->buckets[timestamp % floodnet->bucket_count];
+    if (bucket->second != timestamp) {
+        bucket_clear(bucket);
+        bucket->second = timestamp;
     }
 
-    return count;
+    rec = g_hash_table_lookup(floodnet->message_texts, text);
+    if (rec == NULL) {
+        rec = g_new0(FLOODTEXT_REC, 1);
+        rec->text = g_strdup(text);
+        g_hash_table_insert(floodnet->message_texts, rec->text, rec);
+    }
+
+    rec->count++;
+    if (rec->count >= floodnet->duplicate_threshold)
+        g_hash_table_add(floodnet->duplicate_texts, rec);
+
+    g_ptr_array_add(bucket->texts, rec);
+    if (has_tilde)
+        bucket->tilde_count++;
+
+    floodnet->message_count++;
+    if (has_tilde)
+        floodnet->tilde_count++;
+    return rec;
 }
 
-/* Find most common message and its count */
-static char *find_most_common_message(int *count)
+/* Clean up old messages outside the time window */
+void cleanup_old_messages(time_t now)
 {
-    GHashTable *freqs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-    GSList *tmp;
-    char *most_common = NULL;
-    int max_count = 0;
-    FLOODMSG_REC *rec;
-    int current_count;
-    GHashTableIter iter;
-    gpointer key, value;
-    int cnt;
+    time_t cutoff = now - floodnet->time_window;
+    time_t second;
+    int i;
 
-    /* Count message frequencies */
-    for (tmp = floodnet->message_window; tmp != NULL; tmp = tmp->next) {
-        rec = tmp->data;
-        current_count = GPOINTER_TO_INT(g_hash_table_lookup(freqs, rec->text));
+    if (now == floodnet->last_cleanup)
+        return;
 
-        g_hash_table_insert(freqs, g_strdup(rec->text),
-                           GINT_TO_POINTER(current_count + 1));
-    }
+    if (floodnet->last_cleanup != 0 && now > floodnet->last_cleanup &&
+        now - floodnet->last_cleanup < floodnet->bucket_count) {
+        /* bucket_count is time_window+1, so each second that passed
+           expires exactly the bucket it maps to. This is constant work
+           per message no matter how long the window is. */
+        for (second = floodnet->last_cleanup + 1; second <= now; second++) {
+            FLOODBUCKET_REC *bucket = &floodnet->buckets[second % floodnet->bucket_count];
 
-    /* Find most frequent message */
-    g_hash_table_iter_init(&iter, freqs);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        cnt = GPOINTER_TO_INT(value);
-        if (cnt > max_count) {
-            max_count = cnt;
-            most_common = g_strdup(key);
+            if (bucket->second != 0 && bucket->second != second)
+                bucket_clear(bucket);
         }
+        floodnet->last_cleanup = now;
+        return;
     }
 
-    g_hash_table_destroy(freqs);
-    *count = max_count;
-    return most_common;
+    /* First run, long idle time or the clock jumped backwards: check
+       every bucket, dropping the ones from the future as well */
+    for (i = 0; i < floodnet->bucket_count; i++) {
+        FLOODBUCKET_REC *bucket = &floodnet->buckets[i];
+
+        if (bucket->second != 0 &&
+            (bucket->second < cutoff || bucket->second > now))
+            bucket_clear(bucket);
+    }
+    floodnet->last_cleanup = now;
+}
+
+/* Check for ~ident in nick!user@host or user@host without copying it */
+static gboolean address_has_tilde(const char *address)
+{
+    const char *user, *tilde, *at;
+
+    user = strchr(address, '!');
+    user = user != NULL ? user + 1 : address;
+
+    tilde = strchr(user, '~');
+    at = strchr(user, '@');
+    return tilde != NULL && at != NULL && tilde < at;
 }
 
 /* Check if message is currently blocked */
@@ -296,98 +360,95 @@ void check_message_flood(IRC_SERVER_REC *server, const char *nick,
                          const char *address, const char *text)
 {
     time_t now = time(NULL);
-    char *userhost;
-    GSList *tmp;
-    FLOODMSG_REC *rec;
+    gboolean has_tilde;
+    FLOODTEXT_REC *current;
+    GHashTableIter iter;
+    FLOODTEXT_REC *rec;
 
-    if (!settings_get_bool("anti_floodnet_enabled"))
+    if (!anti_floodnet_enabled())
         return;
 
     /* Check protection status first */
     check_protection_status();
 
-    /* Build full userhost if only address is provided */
-    if (strchr(address, '!') != NULL) {
-        userhost = g_strdup(address);
-    } else {
-        userhost = g_strdup_printf("%s!%s", nick, address);
-    }
+    has_tilde = address != NULL && address_has_tilde(address);
 
     /* Clean up old messages first */
     cleanup_old_messages(now);
 
     /* If in protection mode, check if message is blocked */
     if (floodnet->in_protection_mode) {
-        if (is_message_blocked(text) || check_tilde_ident(userhost)) {
+        if (is_message_blocked(text) || has_tilde) {
             /* Extend block - flood still happening */
             block_duplicate_message(text, floodnet->block_duration);
             
             floodnet->total_messages_blocked++;
             floodnet->blocked_since_notice++;
-            g_free(userhost);
             signal_stop();
             return;
         }
     }
 
     /* Add current message */
-    add_message_to_window(nick, userhost, text, now);
-
-    /* Check if we have enough messages to analyze */
-    if (floodnet->message_count >= floodnet->tilde_threshold) {
-        int tilde_count = count_tilde_users();
-
-        /* Pattern A: ~ident flood detection */
-        if (tilde_count >= floodnet->tilde_threshold) {
+    current = add_message_to_window(text, has_tilde, now);
+
+    /* Pattern A: ~ident flood detection */
+    if (floodnet->message_count >= floodnet->tilde_threshold &&
+        floodnet->tilde_count >= floodnet->tilde_threshold) {
+        if (!floodnet->in_protection_mode) {
+            /* Flood just started: block every distinct text in the
+               current window once */
             enter_protection_mode();
-            
             floodnet->flood_attempts_today++;
-            floodnet->total_messages_blocked++;
-            floodnet->blocked_since_notice++;
 
-            /* Block/extend all messages in current window */
-            for (tmp = floodnet->message_window; tmp != NULL; tmp = tmp->next) {
-                rec = tmp->data;
-                /* Always call to extend if already blocked */
+            g_hash_table_iter_init(&iter, floodnet->message_texts);
+            while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &rec))
                 block_duplicate_message(rec->text, floodnet->block_duration);
-            }
-
-            g_free(userhost);
-            signal_stop();
-            return;
+        } else {
+            /* The rest of the window was blocked already */
+            block_duplicate_message(current->text, floodnet->block_duration);
         }
+
+        floodnet->total_messages_blocked++;
+        floodnet->blocked_since_notice++;
+        signal_stop();
+        return;
     }
 
     /* Pattern B: Duplicate message detection */
-    if (floodnet->message_count >= 5) {
-        int duplicate_count;
-        char *most_common = find_most_common_message(&duplicate_count);
-
-        if (duplicate_count >= floodnet->duplicate_threshold) {
-            gboolean was_blocked = is_message_blocked(most_common);
-            
+    if (floodnet->message_count >= 5 &&
+        g_hash_table_size(floodnet->duplicate_texts) > 0) {
+        if (!floodnet->in_protection_mode) {
+            /* Texts that became duplicates before there were enough
+               messages in the window */
             enter_protection_mode();
-            /* Always block/extend - flood is happening */
-            block_duplicate_message(most_common, floodnet->block_duration);
-            
-            if (!was_blocked) {
+
+            g_hash_table_iter_init(&iter, floodnet->duplicate_texts);
+            while (g_hash_table_iter_next(&iter, (gpointer *) &rec, NULL)) {
+                if (rec != current) {
+                    block_duplicate_message(rec->text, floodnet->block_duration);
+                    floodnet->flood_attempts_today++;
+                }
+            }
+        }
+
+        /* After that, the current text is the only one whose count
+           can have crossed duplicate_threshold */
+        if (current->count >= floodnet->duplicate_threshold) {
+            if (!is_message_blocked(current->text)) {
                 /* First time detecting this pattern */
                 floodnet->flood_attempts_today++;
             }
 
-            if (strcmp(text, most_common) == 0) {
-                floodnet->total_messages_blocked++;
-                floodnet->blocked_since_notice++;
-                g_free(most_common);
-                g_free(userhost);
-                signal_stop();
-                return;
-            }
+            /* Always block/extend - flood is happening */
+            block_duplicate_message(current->text, floodnet->block_duration);
+
+            floodnet->total_messages_blocked++;
+            floodnet->blocked_since_notice++;
+            signal_stop();
+            return;
         }
-        g_free(most_common);
     }
-
-    g_free(userhost);
 }
 
 /* Signal handlers for PRIVMSG */
@@ -424,6 +485,8 @@ void irc_anti_floodnet_init(void)
                                                         NULL, g_free);
     floodnet->nick_blocked_channels = g_hash_table_new_full(g_str_hash, g_str_equal,
                                                            g_free, g_free);
+    floodnet->message_texts = g_hash_table_new(g_str_hash, g_str_equal);
+    floodnet->duplicate_texts = g_hash_table_new(g_direct_hash, g_direct_equal);
 
     /* Initialize statistics */
     floodnet->last_reset_date = time(NULL);
@@ -446,6 +509,7 @@ void irc_anti_floodnet_init(void)
     settings_add_int("anti_floodnet", "anti_floodnet_time_window", DEFAULT_TIME_WINDOW);
     settings_add_int("anti_floodnet", "anti_floodnet_nickchange_window", DEFAULT_NICKCHANGE_WINDOW);
     settings_add_int("anti_floodnet", "anti_floodnet_notice_interval", 60);
+    floodnet->enabled_setting = settings_get_record("anti_floodnet_enabled");
 
     /* Read settings AFTER they are registered */
     read_settings();
@@ -467,6 +531,8 @@ void irc_anti_floodnet_init(void)
 /* Cleanup anti-floodnet module */
 void irc_anti_floodnet_deinit(void)
 {
+    int i;
+
     if (!floodnet)
         return;
 
@@ -482,7 +548,13 @@ void irc_anti_floodnet_deinit(void)
     command_unbind("floodnet", (SIGNAL_FUNC) cmd_floodnet_status);
 
     /* Free message window */
-    g_slist_free_full(floodnet->message_window, (GDestroyNotify) free_floodmsg_rec);
+    for (i = 0; i < floodnet->bucket_count; i++) {
+        bucket_clear(&floodnet->buckets[i]);
+        g_ptr_array_free(floodnet->buckets[i].texts, TRUE);
+    }
+    g_free(floodnet->buckets);
+    g_hash_table_destroy(floodnet->message_texts);
+    g_hash_table_destroy(floodnet->duplicate_texts);
 
     /* Free hash tables */
     g_hash_table_destroy(floodnet->channel_nick_changes);
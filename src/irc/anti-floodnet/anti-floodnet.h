@@ -22,14 +22,21 @@
 #define DEFAULT_TIME_WINDOW 5
 #define DEFAULT_NICKCHANGE_WINDOW 3
 
-/* Message record for flood detection */
+/* Longest message window, there's a bucket for every second of it */
+#define MAX_TIME_WINDOW 3600
+
+/* Distinct message text seen in the current window */
 typedef struct {
-    time_t timestamp;
-    char *nick;          /* Nick without !user@host */
-    char *userhost;      /* Full nick!user@host */
-    char *text;          /* Message text */
-    gboolean has_tilde;  /* Contains ~ident */
-} FLOODMSG_REC;
+    char *text;
+    int count;           /* Messages in window with this text */
+} FLOODTEXT_REC;
+
+/* Messages received during one second of the window */
+typedef struct {
+    time_t second;       /* 0 = unused */
+    GPtrArray *texts;    /* FLOODTEXT_REC of each message */
+    int tilde_count;     /* Messages with ~ident */
+} FLOODBUCKET_REC;
 
 /* Channel nick change tracking */
 typedef struct {
@@ -46,9 +53,16 @@ typedef struct {
 
 /* Main anti-floodnet structure */
 typedef struct {
-    /* Message flood detection */
-    GSList *message_window;        /* List of FLOODMSG_REC */
+    /* Message flood detection: ring of per-second buckets indexed by
+       timestamp % bucket_count, with counters kept up to date as
+       messages enter and expire */
+    FLOODBUCKET_REC *buckets;
+    int bucket_count;
+    time_t last_cleanup;           /* Buckets are expired up to this second */
+    GHashTable *message_texts;     /* text -> FLOODTEXT_REC */
+    GHashTable *duplicate_texts;   /* FLOODTEXT_REC set, count >= duplicate_threshold */
     int message_count;
+    int tilde_count;
 
     /* Nick change flood detection */
     GHashTable *channel_nick_changes; /* channel -> CHANNEL_NICKFLOOD_REC */
@@ -71,6 +85,7 @@ typedef struct {
     int blocked_since_notice;          /* Messages blocked since last notice */
 
     /* Settings cache */
+    SETTINGS_REC *enabled_setting;      /* checked for every message */
     int tilde_threshold;
     int duplicate_threshold;
     int ctcp_threshold;
@@ -81,6 +96,8 @@ typedef struct {
 
 } ANTI_FLOODNET_REC;
 
+#define anti_floodnet_enabled() settings_rec_get_bool(floodnet->enabled_setting)
+
 /* Function prototypes */
 void irc_anti_floodnet_init(void);
 void irc_anti_floodnet_deinit(void);
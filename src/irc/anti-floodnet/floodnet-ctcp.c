@@ -89,7 +89,7 @@ void check_ctcp_flood(IRC_SERVER_REC *server, const char *nick,
     time_t now;
     time_t *timestamp;
 
-    if (!settings_get_bool("anti_floodnet_enabled"))
+    if (!anti_floodnet_enabled())
         return;
 
     if (!IS_IRC_SERVER(server))
@@ -127,7 +127,7 @@ static void sig_message_nick(IRC_SERVER_REC *server, const char *newnick,
 {
     GSList *tmp;
 
-    if (!settings_get_bool("anti_floodnet_enabled"))
+    if (!anti_floodnet_enabled())
         return;
 
     if (!IS_IRC_SERVER(server))
@@ -162,7 +162,7 @@ static void sig_nicklist_changed(CHANNEL_REC *channel, NICK_REC *nick, const cha
     NICKCHANGE_REC *change;
     time_t now;
 
-    if (!settings_get_bool("anti_floodnet_enabled"))
+    if (!anti_floodnet_enabled())
         return;
 
     if (!channel || !nick || !oldnick)
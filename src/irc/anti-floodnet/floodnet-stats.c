@@ -145,9 +145,9 @@ void cmd_floodnet_status(const char *data)
                  "Anti-floodnet Status:");
         printtext(NULL, NULL, MSGLEVEL_CRAP,
                  "  Enabled: %s",
-                 settings_get_bool("anti_floodnet_enabled") ? "YES" : "NO");
+                 anti_floodnet_enabled() ? "YES" : "NO");
 
-        if (settings_get_bool("anti_floodnet_enabled")) {
+        if (anti_floodnet_enabled()) {
             printtext(NULL, NULL, MSGLEVEL_CRAP,
                      "  Flood attempts today: %d", floodnet->flood_attempts_today);
             printtext(NULL, NULL, MSGLEVEL_CRAP,
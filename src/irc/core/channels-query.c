@@ -405,10 +405,11 @@ static void channel_got_query(IRC_CHANNEL_REC *chanrec, int query_type)
 
 void irc_channels_query_purge_accountquery(IRC_SERVER_REC *server, const char *nick)
 {
-	GSList *tmp, *next, *prev;
-	REDIRECT_REC *redirect;
-	char *cmd, *target_cmd;
+	IRC_SERVER_CMD_REC *rec;
+	GList *tmp, *next;
+	char *target_cmd;
 	gboolean was_removed;
+	int lane;
 
 	/* remove the marker */
 	was_removed = g_hash_table_remove(server->chanqueries->accountqueries, nick);
@@ -418,33 +419,18 @@ void irc_channels_query_purge_accountquery(IRC_SERVER_REC *server, const char *n
 		target_cmd = g_strdup_printf(WHOX_USERACCOUNT_CMD "\r\n", nick);
 
 		/* remove queued WHO command */
-		prev = NULL;
-		for (tmp = server->cmdqueue; tmp != NULL; tmp = next) {
-			next = tmp->next->next;
-			cmd = tmp->data;
-			redirect = tmp->next->data;
-
-			if (g_strcmp0(cmd, target_cmd) == 0) {
-				if (prev != NULL)
-					prev->next = next;
-				else
-					server->cmdqueue = next;
-
-				/* remove the redirection */
-				g_slist_free_1(tmp->next);
-				if (redirect != NULL)
-					server_redirect_destroy(redirect);
-
-				/* remove the command */
-				g_slist_free_1(tmp);
-				g_free(cmd);
-
-				server->cmdcount--;
-				server->cmdlater--;
-			} else {
-				prev = tmp->next;
+		for (lane = 0; lane < IRC_CMD_LANES; lane++) {
+			for (tmp = server->cmdqueue[lane].head; tmp != NULL; tmp = next) {
+				next = tmp->next;
+				rec = tmp->data;
+
+				if (g_strcmp0(rec->cmd, target_cmd) == 0) {
+					g_queue_delete_link(&server->cmdqueue[lane], tmp);
+					irc_server_cmd_free(rec);
+				}
 			}
 		}
+		irc_server_cmd_schedule(server);
 
 		g_free(target_cmd);
 	}
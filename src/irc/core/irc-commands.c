@@ -624,6 +624,7 @@ static void cmd_wait(const char *data, IRC_SERVER_REC *server)
 	if (server != NULL && n > 0) {
 		server->wait_cmd = g_get_real_time();
 		server->wait_cmd += n * G_TIME_SPAN_MILLISECOND;
+		irc_server_cmd_schedule(server);
 	}
 	cmd_params_free(free_arg);
 }
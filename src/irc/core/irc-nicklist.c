@@ -49,6 +49,7 @@ static void nicklist_set_modes(IRC_CHANNEL_REC *channel, NICK_REC *rec, gboolean
 
 	if (prefixes != NULL && g_strcmp0(rec->prefixes, prefixes) != 0) {
 		g_strlcpy(rec->prefixes, prefixes, sizeof(rec->prefixes));
+		nicklist_update_sort(CHANNEL(channel), rec);
 		changed = TRUE;
 	}
 
@@ -56,11 +56,12 @@
 #define DEFAULT_CMDS_MAX_AT_ONCE 5
 #define DEFAULT_MAX_QUERY_CHANS 1 /* more and more IRC networks are using stupid ircds.. */
 
+/* server->cmdqueue index for IRC_SEND_NEXT, _NORMAL and _LATER */
+#define CMD_LANE(irc_send_when) ((irc_send_when) - IRC_SEND_NEXT)
+
 void irc_servers_reconnect_init(void);
 void irc_servers_reconnect_deinit(void);
 
-static int cmd_tag;
-
 static int isnickflag_func(SERVER_REC *server, char flag)
 {
 	IRC_SERVER_REC *irc_server = (IRC_SERVER_REC *) server;
@@ -530,36 +531,26 @@ static int command_has_target(const char *cmd, const char *target)
 /* Purge server output, either all or for specified target */
 void irc_server_purge_output(IRC_SERVER_REC *server, const char *target)
 {
-	GSList *tmp, *next, *link;
-        REDIRECT_REC *redirect;
-	char *cmd;
+	IRC_SERVER_CMD_REC *rec;
+	GList *tmp, *next;
+	int lane;
 
 	if (target != NULL && *target == '\0')
                 target = NULL;
 
-	for (tmp = server->cmdqueue; tmp != NULL; tmp = next) {
-		next = tmp->next->next;
-		cmd = tmp->data;
-                redirect = tmp->next->data;
-
-		if ((target == NULL || command_has_target(cmd, target)) &&
-		    g_ascii_strncasecmp(cmd, "PONG ", 5) != 0) {
-                        /* remove the redirection */
-                        link = tmp->next;
-			server->cmdqueue =
-				g_slist_remove_link(server->cmdqueue, link);
-                        g_slist_free_1(link);
-
-			if (redirect != NULL)
-                                server_redirect_destroy(redirect);
-
-                        /* remove the command */
-			server->cmdqueue =
-				g_slist_remove(server->cmdqueue, cmd);
-                        g_free(cmd);
-                        server->cmdcount--;
+	for (lane = 0; lane < IRC_CMD_LANES; lane++) {
+		for (tmp = server->cmdqueue[lane].head; tmp != NULL; tmp = next) {
+			next = tmp->next;
+			rec = tmp->data;
+
+			if ((target == NULL || command_has_target(rec->cmd, target)) &&
+			    g_ascii_strncasecmp(rec->cmd, "PONG ", 5) != 0) {
+				g_queue_delete_link(&server->cmdqueue[lane], tmp);
+				irc_server_cmd_free(rec);
+			}
 		}
 	}
+	irc_server_cmd_schedule(server);
 }
 
 static void sig_connected(IRC_SERVER_REC *server)
@@ -579,6 +570,22 @@ static void isupport_destroy_hash(void *key, void *value)
 	g_free(value);
 }
 
+/* Drop the queued commands and stop the command timer */
+static void server_cmd_clear(IRC_SERVER_REC *server)
+{
+	int lane;
+
+	if (server->cmd_timeout_tag != 0) {
+		g_source_remove(server->cmd_timeout_tag);
+		server->cmd_timeout_tag = 0;
+	}
+	for (lane = 0; lane < IRC_CMD_LANES; lane++) {
+		g_queue_foreach(&server->cmdqueue[lane], (GFunc) irc_server_cmd_free, NULL);
+		g_queue_clear(&server->cmdqueue[lane]);
+	}
+	server->cmdcount = 0;
+}
+
 static void sig_disconnected(IRC_SERVER_REC *server)
 {
 	if (!IS_IRC_SERVER(server))
@@ -588,22 +595,17 @@ static void sig_disconnected(IRC_SERVER_REC *server)
 		g_source_remove(server->starttls_tag);
 		server->starttls_tag = 0;
 	}
+
+	/* nothing can be sent anymore */
+	server_cmd_clear(server);
 }
 
 static void sig_destroyed(IRC_SERVER_REC *server)
 {
-	GSList *tmp;
-
 	if (!IS_IRC_SERVER(server))
 		return;
 
-	for (tmp = server->cmdqueue; tmp != NULL; tmp = tmp->next->next) {
-		g_free(tmp->data);
-		if (tmp->next->data != NULL)
-                        server_redirect_destroy(tmp->next->data);
-	}
-	g_slist_free(server->cmdqueue);
-	server->cmdqueue = NULL;
+	server_cmd_clear(server);
 
 	i_slist_free_full(server->cap_active, (GDestroyNotify) g_free);
 	server->cap_active = NULL;
@@ -703,6 +705,13 @@ void irc_server_send_data(IRC_SERVER_REC *server, const char *data, int len)
 
 	server->last_cmd = g_get_real_time();
 
+	/* Every message takes one token from the flood control bucket:
+	   max_cmds_at_once of them, one refilled per cmd_queue_speed. */
+	if (server->cmd_queue_speed > 0) {
+		server->cmd_tat = MAX(server->cmd_tat, server->last_cmd) +
+			server->cmd_queue_speed * G_TIME_SPAN_MILLISECOND;
+	}
+
 	/* A bit kludgy way to do the flood protection. In ircnet, there
 	   actually is 1sec / 100 bytes penalty, but we rather want to deal
 	   with the max. 1000 bytes input buffer problem. If we send more
@@ -749,74 +758,152 @@ void irc_server_send_and_redirect(IRC_SERVER_REC *server, GString *str, REDIRECT
 	}
 }
 
-static int server_cmd_timeout(IRC_SERVER_REC *server, gint64 now)
+void irc_server_cmd_free(IRC_SERVER_CMD_REC *rec)
 {
-	REDIRECT_REC *redirect;
-	GSList *link;
-	GString *str;
-	long usecs;
-	char *cmd;
+	if (rec->redirect != NULL)
+		server_redirect_destroy(rec->redirect);
+	g_free(rec->cmd);
+	g_free(rec);
+}
 
-	if (!IS_IRC_SERVER(server))
-		return 0;
+static int server_cmd_queued(IRC_SERVER_REC *server)
+{
+	int lane, count;
 
-	if (server->cmdcount == 0 && server->cmdqueue == NULL)
-		return 0;
+	count = 0;
+	for (lane = 0; lane < IRC_CMD_LANES; lane++)
+		count += server->cmdqueue[lane].length;
+	return count;
+}
 
-	if (now < server->wait_cmd)
-		return 1;
+/* Earliest time when the flood control lets the next command out */
+static gint64 server_cmd_next_send(IRC_SERVER_REC *server)
+{
+	gint64 burst;
 
-	usecs = (now - server->last_cmd) / G_TIME_SPAN_MILLISECOND;
-	if (usecs < server->cmd_queue_speed)
-		return 1;
+	if (server->cmd_queue_speed <= 0)
+		return server->wait_cmd;
 
-	server->cmdcount--;
-	if (server->cmdqueue == NULL)
-		return 1;
+	/* the bucket must have at least one token left */
+	burst = (gint64) (MAX(server->max_cmds_at_once, 1) - 1) *
+		server->cmd_queue_speed * G_TIME_SPAN_MILLISECOND;
+	return MAX(server->wait_cmd, server->cmd_tat - burst);
+}
 
-	/* get command */
-	cmd = server->cmdqueue->data;
-	redirect = server->cmdqueue->next->data;
+int irc_server_cmd_can_send(IRC_SERVER_REC *server, gint64 now)
+{
+	/* don't overtake commands already waiting in the queue, except
+	   the ones that asked to be sent later */
+	if (server->cmdqueue[CMD_LANE(IRC_SEND_NEXT)].length > 0 ||
+	    server->cmdqueue[CMD_LANE(IRC_SEND_NORMAL)].length > 0)
+		return FALSE;
 
-	/* send command */
-	str = g_string_new(cmd);
-	irc_server_send_and_redirect(server, str, redirect);
-	g_string_free(str, TRUE);
+	return now >= server_cmd_next_send(server);
+}
 
-	/* remove from queue */
-	server->cmdqueue = g_slist_remove(server->cmdqueue, cmd);
-	g_free(cmd);
+void irc_server_cmd_queue(IRC_SERVER_REC *server, char *cmd, REDIRECT_REC *redirect,
+                          int irc_send_when)
+{
+	IRC_SERVER_CMD_REC *rec;
+	GQueue *queue;
 
-        link = server->cmdqueue;
-	server->cmdqueue = g_slist_remove_link(server->cmdqueue, link);
-        g_slist_free_1(link);
-	return 1;
+	g_return_if_fail(irc_send_when >= IRC_SEND_NEXT &&
+			 irc_send_when <= IRC_SEND_LATER);
+
+	rec = g_new0(IRC_SERVER_CMD_REC, 1);
+	rec->cmd = cmd;
+	rec->redirect = redirect;
+
+	queue = &server->cmdqueue[CMD_LANE(irc_send_when)];
+	if (irc_send_when == IRC_SEND_NEXT)
+		g_queue_push_head(queue, rec);
+	else
+		g_queue_push_tail(queue, rec);
+
+	irc_server_cmd_schedule(server);
 }
 
-/* check every now and then if there's data to be sent in command buffer */
-static int servers_cmd_timeout(void)
+static IRC_SERVER_CMD_REC *server_cmd_pop(IRC_SERVER_REC *server)
 {
-	gint64 now;
-	GSList *tmp;
-	int keep = 0;
+	int lane;
 
-	now = g_get_real_time();
-	for (tmp = servers; tmp != NULL; tmp = tmp->next) {
-		keep |= server_cmd_timeout(tmp->data, now);
+	for (lane = 0; lane < IRC_CMD_LANES; lane++) {
+		if (server->cmdqueue[lane].length > 0)
+			return g_queue_pop_head(&server->cmdqueue[lane]);
 	}
-	if (keep)
-		return 1;
-	else {
-		cmd_tag = -1;
-		return 0;
+	return NULL;
+}
+
+static int server_cmd_timeout(IRC_SERVER_REC *server)
+{
+	IRC_SERVER_CMD_REC *rec;
+	GString *str;
+
+	server->cmd_timeout_tag = 0;
+
+	/* send everything the flood control allows right now */
+	while (!server->connection_lost && !server->disconnected &&
+	       server_cmd_queued(server) > 0 &&
+	       g_get_real_time() >= server_cmd_next_send(server)) {
+		rec = server_cmd_pop(server);
+
+		str = g_string_new(rec->cmd);
+		irc_server_send_and_redirect(server, str, rec->redirect);
+		g_string_free(str, TRUE);
+
+		rec->redirect = NULL;
+		irc_server_cmd_free(rec);
 	}
+
+	irc_server_cmd_schedule(server);
+	return FALSE;
 }
 
-/* Start the timeout for sending data later and decreasing cmdcount again */
-void irc_servers_start_cmd_timeout(void)
+/* Update cmdcount and arm a timer for exactly the moment the next queued
+   command may be sent, or when the burst has refilled so that cmdcount
+   drops back to 0. */
+void irc_server_cmd_schedule(IRC_SERVER_REC *server)
 {
-	if (cmd_tag == -1)
-		cmd_tag = g_timeout_add(500, (GSourceFunc) servers_cmd_timeout, NULL);
+	gint64 now, when, interval;
+	int queued, debt;
+
+	g_return_if_fail(IS_IRC_SERVER(server));
+
+	now = g_get_real_time();
+	queued = server_cmd_queued(server);
+
+	debt = 0;
+	if (server->cmd_queue_speed > 0 && server->cmd_tat > now) {
+		interval = server->cmd_queue_speed * G_TIME_SPAN_MILLISECOND;
+		debt = (server->cmd_tat - now + interval - 1) / interval;
+	}
+	server->cmdcount = queued + debt;
+
+	if (server->connection_lost || server->disconnected)
+		when = 0;
+	else if (queued > 0)
+		when = server_cmd_next_send(server);
+	else if (debt > 0)
+		when = server->cmd_tat;
+	else
+		when = 0;
+
+	if (server->cmd_timeout_tag != 0) {
+		if (when == server->cmd_timeout_at)
+			return;
+		g_source_remove(server->cmd_timeout_tag);
+		server->cmd_timeout_tag = 0;
+	}
+
+	if (when == 0)
+		return;
+
+	server->cmd_timeout_at = when;
+	server->cmd_timeout_tag =
+		g_timeout_add(when <= now ? 0 :
+			      (guint) ((when - now + G_TIME_SPAN_MILLISECOND - 1) /
+				       G_TIME_SPAN_MILLISECOND),
+			      (GSourceFunc) server_cmd_timeout, server);
 }
 
 /* Return a string of all channels (and keys, if any have them) in server,
@@ -906,6 +993,7 @@ static void event_connected(IRC_SERVER_REC *server, const char *data, const char
 
 	/* let the queue send now that we are identified */
 	server->wait_cmd = g_get_real_time();
+	irc_server_cmd_schedule(server);
 
 	if (server->connrec->usermode != NULL) {
 		/* Send the user mode, before the autosendcmd.
@@ -1237,8 +1325,6 @@ void irc_servers_init(void)
 	settings_add_time("flood", "cmd_queue_speed", DEFAULT_CMD_QUEUE_SPEED);
 	settings_add_int("flood", "cmds_max_at_once", DEFAULT_CMDS_MAX_AT_ONCE);
 
-	cmd_tag = -1;
-
 	signal_add_first("server connected", (SIGNAL_FUNC) sig_connected);
 	signal_add_first("server disconnected", (SIGNAL_FUNC) sig_disconnected);
 	signal_add_last("server destroyed", (SIGNAL_FUNC) sig_destroyed);
@@ -1267,9 +1353,6 @@ void irc_servers_init(void)
 
 void irc_servers_deinit(void)
 {
-	if (cmd_tag != -1)
-		g_source_remove(cmd_tag);
-
 	signal_remove("server connected", (SIGNAL_FUNC) sig_connected);
 	signal_remove("server disconnected", (SIGNAL_FUNC) sig_disconnected);
 	signal_remove("server destroyed", (SIGNAL_FUNC) sig_destroyed);
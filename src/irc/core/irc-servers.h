@@ -15,6 +15,10 @@
 #define MAX_IRC_TAGS_LEN (8191 - 2) /* (2 bytes for `@' and SPACE) */
 #define MAX_IRC_USER_TAGS_LEN 4094
 
+/* Send queue lanes, in priority order: IRC_SEND_NEXT, IRC_SEND_NORMAL
+   and IRC_SEND_LATER. IRC_SEND_NOW bypasses the queue. */
+#define IRC_CMD_LANES 3
+
 #define CAP_LS_VERSION "302"
 #define CAP_MESSAGE_TAGS "message-tags"
 #define CAP_SASL "sasl"
@@ -43,6 +47,12 @@
 #define IS_IRC_SERVER_CONNECT(conn) \
 	(IRC_SERVER_CONNECT(conn) ? TRUE : FALSE)
 
+/* Queued command and the redirection to use for its reply */
+typedef struct {
+	char *cmd;
+	REDIRECT_REC *redirect;
+} IRC_SERVER_CMD_REC;
+
 /* all strings should be either NULL or dynamically allocated */
 /* address and nick are mandatory, rest are optional */
 struct _IRC_SERVER_CONNECT_REC {
@@ -118,10 +128,13 @@ struct _IRC_SERVER_REC {
 	                 there actually is, to make flood control remember
 			 how many messages can be sent before starting the
 			 flood control */
-	int cmdlater; /* number of commands in queue to be sent later */
-	GSList *cmdqueue; /* command, redirection, ... */
+	GQueue cmdqueue[IRC_CMD_LANES]; /* IRC_SERVER_CMD_REC, highest priority lane first */
 	gint64 wait_cmd; /* don't send anything to server before this */
 	gint64 last_cmd; /* last time command was sent to server */
+	gint64 cmd_tat; /* flood control: when the whole max_cmds_at_once
+			   burst is available again */
+	guint cmd_timeout_tag; /* one-shot timer for the next queued command */
+	gint64 cmd_timeout_at; /* when cmd_timeout_tag fires */
 
 	int max_cmds_at_once; /* How many messages can be sent immediately before timeouting starts */
 	int cmd_queue_speed; /* Timeout between sending commands */
@@ -179,7 +192,14 @@ void irc_server_send_data(IRC_SERVER_REC *server, const char *data, int len);
 void irc_server_send_and_redirect(IRC_SERVER_REC *server, GString *str, REDIRECT_REC *redirect);
 void irc_server_init_isupport(IRC_SERVER_REC *server);
 
-void irc_servers_start_cmd_timeout(void);
+/* Queue command to lane IRC_SEND_NEXT, _NORMAL or _LATER */
+void irc_server_cmd_queue(IRC_SERVER_REC *server, char *cmd, REDIRECT_REC *redirect,
+                          int irc_send_when);
+/* TRUE if a flood controlled command can be sent right now */
+int irc_server_cmd_can_send(IRC_SERVER_REC *server, gint64 now);
+/* (Re)arm the send timer, call after wait_cmd or the queue changed */
+void irc_server_cmd_schedule(IRC_SERVER_REC *server);
+void irc_server_cmd_free(IRC_SERVER_CMD_REC *rec);
 
 void irc_servers_init(void);
 void irc_servers_deinit(void);
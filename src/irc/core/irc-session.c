@@ -24,6 +24,8 @@
 #include <irssi/src/lib-config/iconfig.h>
 #include <irssi/src/core/misc.h>
 #include <irssi/src/core/network.h>
+#include <irssi/src/core/session.h>
+#include <irssi/src/core/session-snapshot.h>
 
 #include <irssi/src/irc/core/irc-servers.h>
 #include <irssi/src/irc/core/irc-servers-setup.h>
@@ -42,22 +44,22 @@ static void session_isupport_foreach(char *key, char *value, struct _isupport_da
 static void sig_session_save_server(IRC_SERVER_REC *server, CONFIG_REC *config,
 				    CONFIG_NODE *node)
 {
-        GSList *tmp;
+        GList *tmp;
 	CONFIG_NODE *isupport;
 	struct _isupport_data isupport_data;
-	int tls_disconnect;
+	int tls_disconnect, lane;
 
 	if (!IS_IRC_SERVER(server))
 		return;
 
         /* send all non-redirected commands to server immediately */
-	for (tmp = server->cmdqueue; tmp != NULL; tmp = tmp->next->next) {
-		const char *cmd = tmp->data;
-                void *redirect = tmp->next->data;
+	for (lane = 0; lane < IRC_CMD_LANES; lane++) {
+		for (tmp = server->cmdqueue[lane].head; tmp != NULL; tmp = tmp->next) {
+			IRC_SERVER_CMD_REC *rec = tmp->data;
 
-		if (redirect == NULL) {
-			if (net_sendbuffer_send(server->handle, cmd,
-						strlen(cmd)) == -1)
+			if (rec->redirect == NULL &&
+			    net_sendbuffer_send(server->handle, rec->cmd,
+						strlen(rec->cmd)) == -1)
 				break;
 		}
 	}
@@ -157,25 +159,12 @@ static void sig_session_restore_server(IRC_SERVER_REC *server,
 	/* we will reconnect in irc_server_connect if the connection was TLS */
 }
 
-static void sig_session_restore_nick(IRC_CHANNEL_REC *channel,
-				     CONFIG_NODE *node)
+static void session_restore_nick(IRC_CHANNEL_REC *channel, const char *nick,
+				 int op, int halfop, int voice, const char *prefixes)
 {
-	const char *nick, *prefixes;
-        int op, halfop, voice;
 	char newprefixes[MAX_USER_PREFIXES + 1];
 	int i;
 
-	if (!IS_IRC_CHANNEL(channel))
-		return;
-
-	nick = config_node_get_str(node, "nick", NULL);
-	if (nick == NULL)
-                return;
-
-	op = config_node_get_bool(node, "op", FALSE);
-        voice = config_node_get_bool(node, "voice", FALSE);
-        halfop = config_node_get_bool(node, "halfop", FALSE);
-	prefixes = config_node_get_str(node, "prefixes", NULL);
 	if (prefixes == NULL || *prefixes == '\0') {
 		/* upgrading from old irssi or from an in-between
 		 * version that did not imply non-present prefixes from
@@ -194,6 +183,50 @@ static void sig_session_restore_nick(IRC_CHANNEL_REC *channel,
 	irc_nicklist_insert(channel, nick, op, halfop, voice, FALSE, prefixes);
 }
 
+static void sig_session_restore_nick(IRC_CHANNEL_REC *channel,
+				     CONFIG_NODE *node)
+{
+	const char *nick;
+
+	if (!IS_IRC_CHANNEL(channel))
+		return;
+
+	nick = config_node_get_str(node, "nick", NULL);
+	if (nick == NULL)
+                return;
+
+	session_restore_nick(channel, nick,
+			     config_node_get_bool(node, "op", FALSE),
+			     config_node_get_bool(node, "halfop", FALSE),
+			     config_node_get_bool(node, "voice", FALSE),
+			     config_node_get_str(node, "prefixes", NULL));
+}
+
+static void sig_session_restore_nicklist(IRC_CHANNEL_REC *channel,
+					 SESSION_SNAPSHOT_READER *reader)
+{
+	const char *nick, *prefixes;
+	int count, flags;
+
+	if (!IS_IRC_CHANNEL(channel))
+		return;
+
+	count = session_snapshot_read_int(reader);
+	for (; count > 0 && !reader->error; count--) {
+		nick = session_snapshot_read_str(reader);
+		flags = session_snapshot_read_int(reader);
+		prefixes = session_snapshot_read_str(reader);
+		if (nick == NULL || reader->error)
+			break;
+
+		session_restore_nick(channel, nick,
+				     (flags & SESSION_NICK_OP) != 0,
+				     (flags & SESSION_NICK_HALFOP) != 0,
+				     (flags & SESSION_NICK_VOICE) != 0,
+				     prefixes);
+	}
+}
+
 static void session_restore_channel(IRC_CHANNEL_REC *channel)
 {
 	char *data;
@@ -201,6 +234,13 @@ static void session_restore_channel(IRC_CHANNEL_REC *channel)
 	signal_emit("event join", 4, channel->server, channel->name,
 		    channel->server->nick, channel->server->userhost);
 
+	if (channel->session_names) {
+		/* the NAMES reply fills the nicklist and finishes the
+		   join like after a real one */
+		irc_send_cmdv(channel->server, "NAMES %s", channel->name);
+		return;
+	}
+
 	data = g_strconcat(channel->server->nick, " ", channel->name, NULL);
 	signal_emit("event 366", 2, channel->server, data);
 	g_free(data);
@@ -237,6 +277,7 @@ void irc_session_init(void)
 	signal_add("session save server", (SIGNAL_FUNC) sig_session_save_server);
 	signal_add("session restore server", (SIGNAL_FUNC) sig_session_restore_server);
 	signal_add("session restore nick", (SIGNAL_FUNC) sig_session_restore_nick);
+	signal_add("session restore nicklist", (SIGNAL_FUNC) sig_session_restore_nicklist);
 
 	signal_add("server connected", (SIGNAL_FUNC) sig_connected);
 }
@@ -246,6 +287,7 @@ void irc_session_deinit(void)
 	signal_remove("session save server", (SIGNAL_FUNC) sig_session_save_server);
 	signal_remove("session restore server", (SIGNAL_FUNC) sig_session_restore_server);
 	signal_remove("session restore nick", (SIGNAL_FUNC) sig_session_restore_nick);
+	signal_remove("session restore nicklist", (SIGNAL_FUNC) sig_session_restore_nicklist);
 
 	signal_remove("server connected", (SIGNAL_FUNC) sig_connected);
 }
@@ -36,6 +36,15 @@ static int signal_server_event;
 static int signal_server_event_tags;
 static int signal_server_incoming;
 
+/* "event <command>" signal ids, resolved once per command. Numerics
+   index numeric_event_ids directly (id+1, 0 = not resolved yet), other
+   commands are cached by their lowercased signal name. */
+static int numeric_event_ids[1000];
+static GHashTable *event_ids;
+
+/* longest command we resolve without allocating */
+#define MAX_EVENT_NAME_LEN 64
+
 #ifdef BLOCKING_SOCKETS
 #  define MAX_SOCKET_READS 1
 #else
@@ -51,7 +60,6 @@ void irc_send_cmd_full(IRC_SERVER_REC *server, const char *cmd, int irc_send_whe
 {
 	GString *str;
 	int len;
-	guint pos;
 	gboolean server_supports_tag;
 
 	g_return_if_fail(server != NULL);
@@ -63,18 +71,6 @@ void irc_send_cmd_full(IRC_SERVER_REC *server, const char *cmd, int irc_send_whe
 	str = g_string_sized_new(MAX_IRC_USER_TAGS_LEN + 2 /* `@'+SPACE */ +
 				 server->max_message_len + 2 /* CR+LF */ + 1 /* `\0' */);
 
-	if (server->cmdcount == 0)
-		irc_servers_start_cmd_timeout();
-	server->cmdcount++;
-
-	pos = g_slist_length(server->cmdqueue);
-	if (server->cmdlater > pos / 2) {
-		server->cmdlater = pos / 2;
-		pos = 0;
-	} else {
-		pos -= 2 * server->cmdlater;
-	}
-
 	if (!raw) {
 		const char *tmp = cmd;
 
@@ -121,18 +117,15 @@ void irc_send_cmd_full(IRC_SERVER_REC *server, const char *cmd, int irc_send_whe
 	if (irc_send_when == IRC_SEND_NOW) {
 		irc_server_send_and_redirect(server, str, server->redirect_next);
 		g_string_free(str, TRUE);
-	} else if (irc_send_when == IRC_SEND_NEXT) {
-		/* add to queue */
-		server->cmdqueue = g_slist_prepend(server->cmdqueue, server->redirect_next);
-		server->cmdqueue = g_slist_prepend(server->cmdqueue, g_string_free(str, FALSE));
-	} else if (irc_send_when == IRC_SEND_NORMAL) {
-		server->cmdqueue = g_slist_insert(server->cmdqueue, server->redirect_next, pos);
-		server->cmdqueue = g_slist_insert(server->cmdqueue, g_string_free(str, FALSE), pos);
-	} else if (irc_send_when == IRC_SEND_LATER) {
-		server->cmdqueue = g_slist_append(server->cmdqueue, g_string_free(str, FALSE));
-		server->cmdqueue = g_slist_append(server->cmdqueue, server->redirect_next);
-		server->cmdlater++;
+		/* the command still counts against the flood control burst */
+		irc_server_cmd_schedule(server);
+	} else if (irc_send_when == IRC_SEND_NEXT ||
+		   irc_send_when == IRC_SEND_NORMAL ||
+		   irc_send_when == IRC_SEND_LATER) {
+		irc_server_cmd_queue(server, g_string_free(str, FALSE),
+				     server->redirect_next, irc_send_when);
 	} else {
+		g_string_free(str, TRUE);
 		g_warn_if_reached();
 	}
 
@@ -142,13 +135,9 @@ void irc_send_cmd_full(IRC_SERVER_REC *server, const char *cmd, int irc_send_whe
 /* Send command to IRC server */
 void irc_send_cmd(IRC_SERVER_REC *server, const char *cmd)
 {
-	gint64 now;
 	int send_now;
 
-	now = g_get_real_time();
-	send_now = now >= server->wait_cmd &&
-	           (server->cmdcount < server->max_cmds_at_once ||
-		    server->cmd_queue_speed <= 0);
+	send_now = irc_server_cmd_can_send(server, g_get_real_time());
 
 	irc_send_cmd_full(server, cmd, send_now ? IRC_SEND_NOW : IRC_SEND_NORMAL, FALSE);
 }
@@ -362,35 +351,71 @@ static void strip_params_colon(char *const params)
 	}
 }
 
+/* return signal id for "event <command>", `event' must be lowercased */
+static int irc_event_get_id(const char *event)
+{
+	const char *cmd;
+	gpointer id;
+	int num;
+
+	cmd = event+6;
+	if (i_isdigit(cmd[0]) && i_isdigit(cmd[1]) && i_isdigit(cmd[2]) &&
+	    cmd[3] == '\0') {
+		num = (cmd[0]-'0')*100 + (cmd[1]-'0')*10 + (cmd[2]-'0');
+		if (numeric_event_ids[num] == 0)
+			numeric_event_ids[num] = signal_get_uniq_id(event)+1;
+		return numeric_event_ids[num]-1;
+	}
+
+	if (!g_hash_table_lookup_extended(event_ids, event, NULL, &id)) {
+		id = GINT_TO_POINTER(signal_get_uniq_id(event));
+		g_hash_table_insert(event_ids, g_strdup(event), id);
+	}
+	return GPOINTER_TO_INT(id);
+}
+
 static void irc_server_event(IRC_SERVER_REC *server, const char *line,
 			     const char *nick, const char *address)
 {
-        const char *signal;
-	char *event, *args;
+        const char *signal, *args;
+	char buf[MAX_EVENT_NAME_LEN + 7], *event;
+	size_t len;
+	int emitted;
 
 	g_return_if_fail(line != NULL);
 
 	/* split event / args */
-	event = g_strconcat("event ", line, NULL);
-	args = strchr(event+6, ' ');
-	if (args != NULL) *args++ = '\0'; else args = "";
+	args = strchr(line, ' ');
+	len = args != NULL ? (size_t) (args-line) : strlen(line);
+	if (args == NULL) args = "";
 	while (*args == ' ') args++;
-	ascii_strdown(event);
+
+	/* almost every command fits to the stack buffer */
+	event = len <= MAX_EVENT_NAME_LEN ? buf : g_malloc(len + 7);
+	memcpy(event, "event ", 6);
+	memcpy(event+6, line, len);
+	event[len+6] = '\0';
+	ascii_strdown(event+6);
 
         /* check if event needs to be redirected */
 	signal = server_redirect_get_signal(server, nick, event, args);
-	if (signal == NULL)
-		signal = event;
-        else
+	if (signal != NULL)
 		rawlog_redirect(server->rawlog, signal);
 
         /* emit it */
 	current_server_event = event+6;
-	if (!signal_emit(signal, 4, server, args, nick, address))
+	if (signal != NULL)
+		emitted = signal_emit(signal, 4, server, args, nick, address);
+	else {
+		emitted = signal_emit_id(irc_event_get_id(event), 4,
+					 server, args, nick, address);
+	}
+	if (!emitted)
 		signal_emit_id(signal_default_event, 4, server, line, nick, address);
 	current_server_event = NULL;
 
-	g_free(event);
+	if (event != buf)
+		g_free(event);
 }
 
 static void unescape_tag(char *tag)
@@ -550,7 +575,9 @@ static void irc_parse_incoming(SERVER_REC *server)
 
 	/* Some commands can send huge replies and irssi might handle them
 	   too slowly, so read only a few times from the socket before
-	   letting other tasks to run. */
+	   letting other tasks to run. The socket is read only when the
+	   buffer has no complete lines left, so every line of the data that
+	   was read gets handled before returning to the main loop. */
 	count = 0;
 	ret = 0;
 	server_ref(server);
@@ -592,6 +619,10 @@ void irc_irc_init(void)
 	signal_add("server incoming", (SIGNAL_FUNC) irc_parse_incoming_line);
 
 	current_server_event = NULL;
+	memset(numeric_event_ids, 0, sizeof(numeric_event_ids));
+	event_ids = g_hash_table_new_full((GHashFunc) g_str_hash,
+					  (GEqualFunc) g_str_equal,
+					  (GDestroyNotify) g_free, NULL);
 	signal_default_event = signal_get_uniq_id("default event");
 	signal_server_event = signal_get_uniq_id("server event");
 	signal_server_event_tags = signal_get_uniq_id("server event tags");
@@ -605,4 +636,7 @@ void irc_irc_deinit(void)
 	signal_remove("server connected", (SIGNAL_FUNC) irc_init_server);
 	signal_remove("server connection switched", (SIGNAL_FUNC) irc_init_server);
 	signal_remove("server incoming", (SIGNAL_FUNC) irc_parse_incoming_line);
+
+	g_hash_table_destroy(event_ids);
+	event_ids = NULL;
 }
@@ -22,12 +22,15 @@
 #include <irssi/src/core/signals.h>
 #include <irssi/src/core/misc.h>
 #include <irssi/src/core/settings.h>
+#include <irssi/src/core/timers.h>
 
 #include <irssi/src/irc/core/irc-servers.h>
 #include <irssi/src/irc/core/servers-redirect.h>
 
 static int timeout_tag;
 
+static void lag_schedule(void);
+
 static void lag_get(IRC_SERVER_REC *server)
 {
 	server->lag_sent = g_get_real_time();
@@ -43,6 +46,7 @@ static void lag_get(IRC_SERVER_REC *server)
 static void lag_ping_error(IRC_SERVER_REC *server)
 {
 	lag_get(server);
+	lag_schedule();
 }
 
 static void lag_event_pong(IRC_SERVER_REC *server, const char *data,
@@ -62,6 +66,7 @@ static void lag_event_pong(IRC_SERVER_REC *server, const char *data,
 	server->lag_sent = 0;
 
 	signal_emit("server lag", 1, server);
+	lag_schedule();
 }
 
 static void sig_unknown_command(IRC_SERVER_REC *server, const char *data)
@@ -78,21 +83,24 @@ static void sig_unknown_command(IRC_SERVER_REC *server, const char *data)
 		server->disable_lag = TRUE;
 		server->lag_sent = 0;
 		server->lag = 0;
+		lag_schedule();
 	}
 	g_free(params);
 }
 
-static int sig_check_lag(void)
+static void sig_check_lag(void *data)
 {
 	GSList *tmp, *next;
 	time_t now;
 	int lag_check_time, max_lag;
 
+	timeout_tag = 0;
+
 	lag_check_time = settings_get_time("lag_check_time")/1000;
 	max_lag = settings_get_time("lag_max_before_disconnect")/1000;
 
 	if (lag_check_time <= 0)
-		return 1;
+		return;
 
 	now = time(NULL);
 	for (tmp = servers; tmp != NULL; tmp = next) {
@@ -117,7 +125,54 @@ static int sig_check_lag(void)
 		}
 	}
 
-	return 1;
+	lag_schedule();
+}
+
+/* Wake up when the next server is due for a lag check or has waited
+   too long for its PONG. A server with commands still queued is due but
+   can't be checked yet, so it gets polled once a second until it's idle. */
+static void lag_schedule(void)
+{
+	GSList *tmp;
+	time_t now, due, next;
+	int lag_check_time, max_lag;
+
+	timer_remove(timeout_tag);
+	timeout_tag = 0;
+
+	lag_check_time = settings_get_time("lag_check_time")/1000;
+	max_lag = settings_get_time("lag_max_before_disconnect")/1000;
+
+	if (lag_check_time <= 0)
+		return;
+
+	now = time(NULL);
+	next = 0;
+	for (tmp = servers; tmp != NULL; tmp = tmp->next) {
+		IRC_SERVER_REC *rec = tmp->data;
+
+		if (!IS_IRC_SERVER(rec) || rec->disable_lag)
+			continue;
+
+		if (rec->lag_sent != 0) {
+			if (max_lag <= 1)
+				continue;
+			due = rec->lag_sent / G_TIME_SPAN_SECOND + max_lag + 1;
+		} else {
+			if (!rec->connected)
+				continue;
+			due = rec->lag_last_check + lag_check_time + 1;
+			if (due <= now && rec->cmdcount != 0)
+				due = now + 1;
+		}
+
+		if (next == 0 || due < next)
+			next = due;
+	}
+
+	if (next != 0)
+		timeout_tag = timer_add_seconds(next <= now ? 0 : next - now,
+						sig_check_lag, NULL);
 }
 
 void lag_init(void)
@@ -125,16 +180,20 @@ void lag_init(void)
 	settings_add_time("misc", "lag_check_time", "1min");
 	settings_add_time("misc", "lag_max_before_disconnect", "5min");
 
-	timeout_tag = g_timeout_add(1000, (GSourceFunc) sig_check_lag, NULL);
+	timeout_tag = 0;
 	signal_add_first("lag pong", (SIGNAL_FUNC) lag_event_pong);
         signal_add("lag ping error", (SIGNAL_FUNC) lag_ping_error);
         signal_add("event 421", (SIGNAL_FUNC) sig_unknown_command);
+	signal_add_last("event connected", (SIGNAL_FUNC) lag_schedule);
+	signal_add("setup changed", (SIGNAL_FUNC) lag_schedule);
 }
 
 void lag_deinit(void)
 {
-	g_source_remove(timeout_tag);
+	timer_remove(timeout_tag);
 	signal_remove("lag pong", (SIGNAL_FUNC) lag_event_pong);
         signal_remove("lag ping error", (SIGNAL_FUNC) lag_ping_error);
         signal_remove("event 421", (SIGNAL_FUNC) sig_unknown_command);
+	signal_remove("event connected", (SIGNAL_FUNC) lag_schedule);
+	signal_remove("setup changed", (SIGNAL_FUNC) lag_schedule);
 }
@@ -21,6 +21,7 @@
 #include "module.h"
 #include <irssi/src/core/signals.h>
 #include <irssi/src/core/settings.h>
+#include <irssi/src/core/timers.h>
 
 #include <irssi/src/irc/core/irc-servers.h>
 #include <irssi/src/irc/core/irc-channels.h>
@@ -29,6 +30,8 @@
 static int massjoin_tag;
 static int massjoin_max_joins;
 
+static void massjoin_start_timeout(void);
+
 /* Massjoin support - really useful when trying to do things (like op/deop)
    to people after netjoins. It sends
    "massjoin #channel nick!user@host nick2!user@host ..." signals */
@@ -120,6 +123,7 @@ static void event_join(IRC_SERVER_REC *server, const char *data,
 
 	if (send_massjoin) {
 		chanrec->massjoins++;
+		massjoin_start_timeout();
 	}
 	g_free(params);
 }
@@ -292,9 +296,11 @@ static void massjoin_send(IRC_CHANNEL_REC *channel)
 	g_slist_free(list);
 }
 
-static void server_check_massjoins(IRC_SERVER_REC *server, time_t max)
+/* Returns TRUE if some channel is still waiting for more joins */
+static int server_check_massjoins(IRC_SERVER_REC *server, time_t max)
 {
 	GSList *tmp;
+	int pending;
 
 	/*
 	   1) First time always save massjoin count to last_massjoins
@@ -309,6 +315,7 @@ static void server_check_massjoins(IRC_SERVER_REC *server, time_t max)
 	*/
 
 	/* Scan all channels through for massjoins */
+	pending = FALSE;
 	for (tmp = server->channels; tmp != NULL; tmp = tmp->next) {
 		IRC_CHANNEL_REC *rec = tmp->data;
 
@@ -323,25 +330,40 @@ static void server_check_massjoins(IRC_SERVER_REC *server, time_t max)
 		} else {
 			/* Wait for some more.. */
 			rec->last_massjoins = rec->massjoins;
+			pending = TRUE;
 		}
 	}
 
+	return pending;
 }
 
-static int sig_massjoin_timeout(void)
+static void sig_massjoin_timeout(void *data)
 {
 	GSList *tmp;
 	time_t max;
+	int pending;
+
+	massjoin_tag = 0;
 
 	max = time(NULL)-settings_get_int("massjoin_max_wait");
+	pending = FALSE;
 	for (tmp = servers; tmp != NULL; tmp = tmp->next) {
 		IRC_SERVER_REC *server = tmp->data;
 
-                if (IS_IRC_SERVER(server))
-			server_check_massjoins(server, max);
+                if (IS_IRC_SERVER(server) &&
+		    server_check_massjoins(server, max))
+			pending = TRUE;
 	}
 
-	return 1;
+	if (pending)
+		massjoin_start_timeout();
+}
+
+/* The check runs once a second, but only while some joins are queued */
+static void massjoin_start_timeout(void)
+{
+	if (massjoin_tag == 0)
+		massjoin_tag = timer_add_seconds(1, sig_massjoin_timeout, NULL);
 }
 
 static void read_settings(void)
@@ -353,7 +375,7 @@ void massjoin_init(void)
 {
         settings_add_int("misc", "massjoin_max_wait", 5000);
         settings_add_int("misc", "massjoin_max_joins", 3);
-	massjoin_tag = g_timeout_add(1000, (GSourceFunc) sig_massjoin_timeout, NULL);
+	massjoin_tag = 0;
 
 	read_settings();
 	signal_add_first("event join", (SIGNAL_FUNC) event_join);
@@ -367,7 +389,7 @@ void massjoin_init(void)
 
 void massjoin_deinit(void)
 {
-	g_source_remove(massjoin_tag);
+	timer_remove(massjoin_tag);
 
 	signal_remove("event join", (SIGNAL_FUNC) event_join);
 	signal_remove("event chghost", (SIGNAL_FUNC) event_chghost);
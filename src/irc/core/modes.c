@@ -52,6 +52,7 @@ static void nick_mode_change(IRC_CHANNEL_REC *channel, const char *nick,
 			prefix_add(nickrec->prefixes, mode, (SERVER_REC *) channel->server);
 		else
 			prefix_del(nickrec->prefixes, mode);
+		nicklist_update_sort(CHANNEL(channel), nickrec);
 	}
 
 	modestr[0] = mode; modestr[1] = '\0';
@@ -22,6 +22,7 @@
 #include <irssi/src/core/signals.h>
 #include <irssi/src/core/commands.h>
 #include <irssi/src/core/misc.h>
+#include <irssi/src/core/timers.h>
 
 #include <irssi/src/irc/core/irc-servers.h>
 #include <irssi/src/irc/core/irc-channels.h>
@@ -31,6 +32,24 @@
 #define NETSPLIT_MAX_REMEMBER (60*60)
 
 static int split_tag;
+static time_t split_next; /* when split_tag fires */
+
+static void split_check_old(void *data);
+
+/* Make sure we wake up by the time `destroy' is reached */
+static void split_schedule(time_t destroy)
+{
+	time_t now;
+
+	if (split_tag != 0 && split_next <= destroy)
+		return;
+
+	timer_remove(split_tag);
+	now = time(NULL);
+	split_next = destroy;
+	split_tag = timer_add_seconds(destroy <= now ? 0 : destroy - now,
+				      split_check_old, NULL);
+}
 
 static NETSPLIT_SERVER_REC *netsplit_server_find(IRC_SERVER_REC *server,
 						 const char *servername,
@@ -144,6 +163,7 @@ static NETSPLIT_REC *netsplit_add(IRC_SERVER_REC *server, const char *nick,
 		g_warning("netsplit_add(): nick '%s' not in any channels", nick);
 
 	g_hash_table_insert(server->splits, rec->nick, rec);
+	split_schedule(rec->destroy);
 
 	signal_emit("netsplit new", 1, rec);
 	return rec;
@@ -301,8 +321,10 @@ int quitmsg_is_split(const char *msg)
 static void split_set_timeout(void *key, NETSPLIT_REC *rec, NETSPLIT_REC *orig)
 {
 	/* same servers -> split over -> destroy old records sooner.. */
-	if (rec->server == orig->server)
+	if (rec->server == orig->server) {
 		rec->destroy = time(NULL)+60;
+		split_schedule(rec->destroy);
+	}
 }
 
 static void event_join(IRC_SERVER_REC *server, const char *data,
@@ -395,21 +417,27 @@ static int split_server_check(void *key, NETSPLIT_REC *rec,
 			      IRC_SERVER_REC *server)
 {
 	/* Check if this split record is too old.. */
-	if (rec->destroy > time(NULL))
+	if (rec->destroy > time(NULL)) {
+		if (split_next == 0 || rec->destroy < split_next)
+			split_next = rec->destroy;
 		return FALSE;
+	}
 
 	netsplit_destroy(server, rec);
 	return TRUE;
 }
 
-static int split_check_old(void)
+static void split_check_old(void *data)
 {
 	GSList *tmp;
 
+	split_tag = 0;
+	split_next = 0;
+
 	for (tmp = servers; tmp != NULL; tmp = tmp->next) {
 		IRC_SERVER_REC *server = tmp->data;
 
-		if (!IS_IRC_SERVER(server))
+		if (!IS_IRC_SERVER(server) || server->splits == NULL)
 			continue;
 
 		g_hash_table_foreach_remove(server->splits,
@@ -417,12 +445,15 @@ static int split_check_old(void)
 					    server);
 	}
 
-	return 1;
+	/* split_next is now the oldest remaining split */
+	if (split_next != 0)
+		split_schedule(split_next);
 }
 
 void netsplit_init(void)
 {
-	split_tag = g_timeout_add(1000, (GSourceFunc) split_check_old, NULL);
+	split_tag = 0;
+	split_next = 0;
 	signal_add_first("event join", (SIGNAL_FUNC) event_join);
 	signal_add_last("event join", (SIGNAL_FUNC) event_join_last);
 	signal_add_first("event quit", (SIGNAL_FUNC) event_quit);
@@ -432,7 +463,7 @@ void netsplit_init(void)
 
 void netsplit_deinit(void)
 {
-	g_source_remove(split_tag);
+	timer_remove(split_tag);
 	signal_remove("event join", (SIGNAL_FUNC) event_join);
 	signal_remove("event join", (SIGNAL_FUNC) event_join_last);
 	signal_remove("event quit", (SIGNAL_FUNC) event_quit);
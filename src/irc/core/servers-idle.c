@@ -20,6 +20,7 @@
 
 #include "module.h"
 #include <irssi/src/core/signals.h>
+#include <irssi/src/core/timers.h>
 
 #include <irssi/src/irc/core/irc-servers.h>
 #include <irssi/src/irc/core/servers-idle.h>
@@ -39,6 +40,16 @@ typedef struct {
 
 static int idle_tag, idlepos;
 
+static void sig_idle_timeout(void *data);
+
+/* Idle queues are checked once a second, but only while there's
+   something queued */
+static void idle_start_timeout(void)
+{
+	if (idle_tag == 0)
+		idle_tag = timer_add_seconds(1, sig_idle_timeout, NULL);
+}
+
 /* Add new idle command to queue */
 static SERVER_IDLE_REC *
 server_idle_create(const char *cmd, const char *redirect_cmd, int count,
@@ -110,6 +121,7 @@ int server_idle_add_redir(IRC_SERVER_REC *server, const char *cmd,
 	server->idles = g_slist_append(server->idles, rec);
 	va_end(va);
 
+	idle_start_timeout();
 	return rec->tag;
 }
 
@@ -130,6 +142,7 @@ int server_idle_add_first_redir(IRC_SERVER_REC *server, const char *cmd,
 	server->idles = g_slist_prepend(server->idles, rec);
 	va_end(va);
 
+	idle_start_timeout();
 	return rec->tag;
 }
 
@@ -158,6 +171,7 @@ int server_idle_insert_redir(IRC_SERVER_REC *server, const char *cmd, int tag,
 		g_slist_insert(server->idles, rec, pos);
 	va_end(va);
 
+	idle_start_timeout();
 	return rec->tag;
 }
 
@@ -232,33 +246,43 @@ static void sig_disconnected(IRC_SERVER_REC *server)
 		server_idle_destroy(server, server->idles->data);
 }
 
-static int sig_idle_timeout(void)
+static void sig_idle_timeout(void *data)
 {
 	GSList *tmp;
+	int pending;
+
+	idle_tag = 0;
 
 	/* Scan through every server */
+	pending = FALSE;
 	for (tmp = servers; tmp != NULL; tmp = tmp->next) {
 		IRC_SERVER_REC *rec = tmp->data;
 
-		if (IS_IRC_SERVER(rec) &&
-		    rec->idles != NULL && rec->cmdcount == 0) {
+		if (!IS_IRC_SERVER(rec) || rec->idles == NULL)
+			continue;
+
+		if (rec->cmdcount == 0) {
 			/* We're idling and we have idle commands to run! */
 			server_idle_next(rec);
 		}
+		if (rec->idles != NULL)
+			pending = TRUE;
 	}
-	return 1;
+
+	if (pending)
+		idle_start_timeout();
 }
 
 void servers_idle_init(void)
 {
 	idlepos = 0;
-	idle_tag = g_timeout_add(1000, (GSourceFunc) sig_idle_timeout, NULL);
+	idle_tag = 0;
 
 	signal_add("server disconnected", (SIGNAL_FUNC) sig_disconnected);
 }
 
 void servers_idle_deinit(void)
 {
-	g_source_remove(idle_tag);
+	timer_remove(idle_tag);
 	signal_remove("server disconnected", (SIGNAL_FUNC) sig_disconnected);
 }
@@ -7,3 +7,5 @@ int queue; /* queue number */
 /* counter buffer */
 char count_buf[4];
 int count_pos;
+
+gint64 last_update; /* when "dcc transfer update" was last sent */
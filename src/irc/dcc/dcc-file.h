@@ -7,4 +7,11 @@ typedef struct {
 #include <irssi/src/irc/dcc/dcc-file-rec.h>
 } FILE_DCC_REC;
 
+#define FILE_DCC(dcc) ((FILE_DCC_REC *) (dcc))
+
+/* Send "dcc transfer update" signal, but not more often than
+   DCC_TRANSFER_UPDATE_MSECS unless `force' is TRUE */
+#define DCC_TRANSFER_UPDATE_MSECS 500
+void dcc_file_transfer_update(FILE_DCC_REC *dcc, int force);
+
 #endif
@@ -27,10 +27,14 @@
 #include <irssi/src/core/net-sendbuffer.h>
 #include <irssi/src/irc/core/irc-servers.h>
 
+#include <irssi/src/irc/dcc/dcc-file.h>
 #include <irssi/src/irc/dcc/dcc-get.h>
 #include <irssi/src/irc/dcc/dcc-send.h>
 
-static char *dcc_get_recv_buffer;
+/* received data is written to the file in blocks of this size */
+#define DCC_GET_BUFFER_SIZE (256*1024)
+
+static int dcc_get_flush(GET_DCC_REC *dcc);
 
 GET_DCC_REC *dcc_get_create(IRC_SERVER_REC *server, CHAT_DCC_REC *chat,
 				   const char *nick, const char *arg)
@@ -56,7 +60,13 @@ static void sig_dcc_destroyed(GET_DCC_REC *dcc)
 {
 	if (!IS_DCC_GET(dcc)) return;
 
+	if (dcc->fhandle != -1 && !dcc_get_flush(dcc)) {
+		signal_emit("dcc error write", 2,
+			    dcc, g_strerror(errno));
+	}
+
 	g_free_not_null(dcc->file);
+	g_free_not_null(dcc->buffer);
 	if (dcc->fhandle != -1) close(dcc->fhandle);
 }
 
@@ -145,45 +155,71 @@ static void sig_dccget_send(GET_DCC_REC *dcc)
                 dcc_get_send_received(dcc);
 }
 
-#define DCC_GET_RECV_BUFFER_SIZE 32768
+/* Write the buffered data to file. Returns FALSE if it failed, the data
+   is dropped then. */
+static int dcc_get_flush(GET_DCC_REC *dcc)
+{
+	int pos, ret;
+
+	for (pos = 0; pos < dcc->buffer_len; pos += ret) {
+		ret = write(dcc->fhandle, dcc->buffer + pos,
+			    dcc->buffer_len - pos);
+		if (ret <= 0) {
+			dcc->buffer_len = 0;
+			return FALSE;
+		}
+	}
+
+	dcc->buffer_len = 0;
+	return TRUE;
+}
 
 /* input function: DCC GET received data */
 static void sig_dccget_receive(GET_DCC_REC *dcc)
 {
-	int ret;
+	int ret, received;
 
-	if (dcc_get_recv_buffer == NULL) {
-		dcc_get_recv_buffer = g_malloc(DCC_GET_RECV_BUFFER_SIZE);
-	}
+	if (dcc->buffer == NULL)
+		dcc->buffer = g_malloc(DCC_GET_BUFFER_SIZE);
 
-	for (;;) {
-		ret = net_receive(dcc->handle, dcc_get_recv_buffer,
-				  DCC_GET_RECV_BUFFER_SIZE);
+	/* read everything available, up to one buffer's worth */
+	for (received = 0; received < DCC_GET_BUFFER_SIZE; received += ret) {
+		ret = net_receive(dcc->handle, dcc->buffer + dcc->buffer_len,
+				  DCC_GET_BUFFER_SIZE - dcc->buffer_len);
 		if (ret == 0) break;
 
 		if (ret < 0) {
 			/* socket closed - transmit complete,
 			   or other side died.. */
+			if (!dcc_get_flush(dcc)) {
+				signal_emit("dcc error write", 2,
+					    dcc, g_strerror(errno));
+			} else {
+				dcc_file_transfer_update(FILE_DCC(dcc), TRUE);
+			}
 			dcc_close(DCC(dcc));
 			return;
 		}
 
-		if (write(dcc->fhandle, dcc_get_recv_buffer, ret) != ret) {
+		dcc->buffer_len += ret;
+		dcc->transfd += ret;
+
+		/* write when the buffer is full or the whole file is here */
+		if ((dcc->buffer_len == DCC_GET_BUFFER_SIZE ||
+		     dcc->transfd >= dcc->size) && !dcc_get_flush(dcc)) {
 			/* most probably out of disk space */
 			signal_emit("dcc error write", 2,
 				    dcc, g_strerror(errno));
 			dcc_close(DCC(dcc));
-                        return;
+			return;
 		}
-		dcc->transfd += ret;
-		break;
 	}
 
 	/* send number of total bytes received */
 	if (dcc->count_pos <= 0)
 		dcc_get_send_received(dcc);
 
-	signal_emit("dcc transfer update", 1, dcc);
+	dcc_file_transfer_update(FILE_DCC(dcc), FALSE);
 }
 
 /* callback: net_connect() finished for DCC GET */
@@ -621,5 +657,4 @@ void dcc_get_deinit(void)
 	signal_remove("dcc destroyed", (SIGNAL_FUNC) sig_dcc_destroyed);
 	signal_remove("ctcp msg dcc send", (SIGNAL_FUNC) ctcp_msg_dcc_send);
 	command_unbind("dcc get", (SIGNAL_FUNC) cmd_dcc_get);
-	g_free_and_null(dcc_get_recv_buffer);
 }
@@ -23,6 +23,9 @@ typedef struct {
 	int get_type; /* what to do if file exists? */
 	char *file; /* file name we're really moving, arg is just the reference */
 
+	char *buffer; /* received data not yet written to file */
+	int buffer_len;
+
 	unsigned int file_quoted:1; /* file name was received quoted ("file name") */
 	unsigned int from_dccserver:1; /* get is using dccserver method */
 } GET_DCC_REC;
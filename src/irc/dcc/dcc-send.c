@@ -30,9 +30,13 @@
 
 #include <irssi/src/irc/dcc/dcc-send.h>
 #include <irssi/src/irc/dcc/dcc-chat.h>
+#include <irssi/src/irc/dcc/dcc-file.h>
 #include <irssi/src/irc/dcc/dcc-queue.h>
 
 #include <glob.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#  include <sys/sendfile.h>
+#endif
 
 #ifndef GLOB_TILDE
 #  define GLOB_TILDE 0 /* unsupported */
@@ -256,53 +260,101 @@ static void sig_dcc_destroyed(SEND_DCC_REC *dcc)
 	dcc_queue_send_next(dcc->queue);
 }
 
-/* input function: DCC SEND - we're ready to send more data */
-static void dcc_send_data(SEND_DCC_REC *dcc)
+/* max. bytes to send in one go before letting other I/O run */
+#define DCC_SEND_BATCH_SIZE (1024*1024)
+#define DCC_SEND_BUFFER_SIZE 65536
+
+static char *dcc_send_buffer;
+
+/* Send file data from position dcc->transfd. Returns number of bytes
+   sent, 0 at end of file and -1 if no more can be sent now. */
+static int dcc_send_chunk(SEND_DCC_REC *dcc, int len)
 {
-        char buffer[512];
 	int ret;
 
-	ret = read(dcc->fhandle, buffer, sizeof(buffer));
-	if (ret <= 0) {
-		/* no need to call this function anymore..
-		   in fact it just eats all the cpu.. */
-		dcc->waitforend = TRUE;
-		g_source_remove(dcc->tagwrite);
-		dcc->tagwrite = -1;
-		return;
+#ifdef HAVE_SYS_SENDFILE_H
+	if (!irssi_ssl_is_channel(dcc->handle)) {
+		off_t offset = dcc->transfd;
+
+		/* let the kernel copy the file directly to the socket */
+		ret = sendfile(g_io_channel_unix_get_fd(dcc->handle),
+			       dcc->fhandle, &offset, len);
+		if (ret >= 0)
+			return ret;
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return -1;
+		/* file can't be sent this way, or some error that the
+		   code below handles the same way as before */
 	}
+#endif
 
-	ret = net_transmit(dcc->handle, buffer, ret);
-	if (ret > 0) dcc->transfd += ret;
-	dcc->gotalldata = FALSE;
+	if (dcc_send_buffer == NULL)
+		dcc_send_buffer = g_malloc(DCC_SEND_BUFFER_SIZE);
 
-	lseek(dcc->fhandle, dcc->transfd, SEEK_SET);
+	ret = pread(dcc->fhandle, dcc_send_buffer,
+		    MIN(len, DCC_SEND_BUFFER_SIZE), dcc->transfd);
+	if (ret <= 0)
+		return 0;
 
-	signal_emit("dcc transfer update", 1, dcc);
+	ret = net_transmit(dcc->handle, dcc_send_buffer, ret);
+	return ret > 0 ? ret : -1;
+}
+
+/* input function: DCC SEND - we're ready to send more data */
+static void dcc_send_data(SEND_DCC_REC *dcc)
+{
+	int ret, sent;
+
+	for (sent = 0; sent < DCC_SEND_BATCH_SIZE; sent += ret) {
+		ret = dcc_send_chunk(dcc, DCC_SEND_BATCH_SIZE - sent);
+		if (ret == 0) {
+			/* no need to call this function anymore..
+			   in fact it just eats all the cpu.. */
+			dcc->waitforend = TRUE;
+			g_source_remove(dcc->tagwrite);
+			dcc->tagwrite = -1;
+			dcc_file_transfer_update(FILE_DCC(dcc), TRUE);
+			return;
+		}
+		if (ret < 0)
+			break;
+
+		dcc->transfd += ret;
+		dcc->gotalldata = FALSE;
+	}
+
+	if (sent > 0)
+		dcc_file_transfer_update(FILE_DCC(dcc), FALSE);
 }
 
 /* input function: DCC SEND - received some data */
 static void dcc_send_read_size(SEND_DCC_REC *dcc)
 {
+	char buffer[512];
 	guint32 bytes;
-	int ret;
+	int ret, pos, acked;
 
-	ret = net_receive(dcc->handle, dcc->count_buf+dcc->count_pos,
-			  4-dcc->count_pos);
+	ret = net_receive(dcc->handle, buffer, sizeof(buffer));
 	if (ret == -1) {
 		dcc_close(DCC(dcc));
 		return;
 	}
 
-	dcc->count_pos += ret;
+	/* the replies are byte counters, only the latest one matters */
+	acked = FALSE; bytes = 0;
+	for (pos = 0; pos < ret; pos++) {
+		dcc->count_buf[dcc->count_pos++] = buffer[pos];
+		if (dcc->count_pos == 4) {
+			memcpy(&bytes, dcc->count_buf, sizeof(bytes));
+			dcc->count_pos = 0;
+			acked = TRUE;
+		}
+	}
 
-	if (dcc->count_pos != 4)
+	if (!acked)
 		return;
 
-	memcpy(&bytes, dcc->count_buf, sizeof(bytes));
 	bytes = ntohl(bytes);
-	dcc->count_pos = 0;
-
 	if (dcc->waitforend && bytes == (dcc->transfd & 0xffffffff)) {
 		/* file is sent */
 		dcc->gotalldata = TRUE;
@@ -484,4 +536,5 @@ void dcc_send_deinit(void)
 	signal_remove("dcc destroyed", (SIGNAL_FUNC) sig_dcc_destroyed);
 	signal_remove("dcc reply send pasv", (SIGNAL_FUNC) dcc_send_connect);
 	command_unbind("dcc send", (SIGNAL_FUNC) cmd_dcc_send);
+	g_free_and_null(dcc_send_buffer);
 }
@@ -26,11 +26,13 @@
 #include <irssi/src/core/settings.h>
 #include <irssi/src/core/ignore.h>
 #include <irssi/src/core/levels.h>
+#include <irssi/src/core/timers.h>
 
 #include <irssi/src/irc/core/irc-servers.h>
 #include <irssi/src/core/servers-setup.h>
 
 #include <irssi/src/irc/dcc/dcc-chat.h>
+#include <irssi/src/irc/dcc/dcc-file.h>
 #include <irssi/src/irc/dcc/dcc-get.h>
 #include <irssi/src/irc/dcc/dcc-send.h>
 #include <irssi/src/irc/dcc/dcc-server.h>
@@ -422,6 +424,18 @@ void dcc_close(DCC_REC *dcc)
         dcc_destroy(dcc);
 }
 
+void dcc_file_transfer_update(FILE_DCC_REC *dcc, int force)
+{
+	gint64 now;
+
+	now = g_get_monotonic_time();
+	if (!force && now - dcc->last_update < DCC_TRANSFER_UPDATE_MSECS * 1000)
+		return;
+
+	dcc->last_update = now;
+	signal_emit("dcc transfer update", 1, dcc);
+}
+
 /* Reject a DCC request */
 void dcc_reject(DCC_REC *dcc, IRC_SERVER_REC *server)
 {
@@ -441,11 +455,15 @@ void dcc_reject(DCC_REC *dcc, IRC_SERVER_REC *server)
 	dcc_close(dcc);
 }
 
-static int dcc_timeout_func(void)
+static void dcc_timeout_schedule(void);
+
+static void dcc_timeout_func(void *data)
 {
 	GSList *tmp, *next;
 	time_t now;
 
+	dcc_timeouttag = 0;
+
 	now = time(NULL)-settings_get_time("dcc_timeout")/1000;
 	for (tmp = dcc_conns; tmp != NULL; tmp = next) {
 		DCC_REC *dcc = tmp->data;
@@ -462,7 +480,38 @@ static int dcc_timeout_func(void)
 		}
 	}
 
-	return 1;
+	dcc_timeout_schedule();
+}
+
+/* Wake up when the oldest unconnected DCC times out */
+static void dcc_timeout_schedule(void)
+{
+	GSList *tmp;
+	time_t now, next, expire;
+	int timeout;
+
+	timer_remove(dcc_timeouttag);
+	dcc_timeouttag = 0;
+
+	timeout = settings_get_time("dcc_timeout")/1000;
+	next = 0;
+	for (tmp = dcc_conns; tmp != NULL; tmp = tmp->next) {
+		DCC_REC *dcc = tmp->data;
+
+		if (dcc->tagread != -1 || IS_DCC_SERVER(dcc))
+			continue;
+
+		expire = dcc->created + timeout + 1;
+		if (next == 0 || expire < next)
+			next = expire;
+	}
+
+	if (next == 0)
+		return;
+
+	now = time(NULL);
+	dcc_timeouttag = timer_add_seconds(next <= now ? 0 : next - now,
+					   dcc_timeout_func, NULL);
 }
 
 static void event_no_such_nick(IRC_SERVER_REC *server, char *data)
@@ -541,7 +590,7 @@ static void cmd_dcc(const char *data, IRC_SERVER_REC *server, void *item)
 void irc_dcc_init(void)
 {
 	dcc_conns = NULL;
-	dcc_timeouttag = g_timeout_add(1000, (GSourceFunc) dcc_timeout_func, NULL);
+	dcc_timeouttag = 0;
 
 	settings_add_str("dcc", "dcc_port", "0");
 	settings_add_time("dcc", "dcc_timeout", "5min");
@@ -556,6 +605,8 @@ void irc_dcc_init(void)
 	signal_add("ctcp reply dcc", (SIGNAL_FUNC) ctcp_reply_dcc);
 	signal_add("ctcp reply dcc reject", (SIGNAL_FUNC) ctcp_reply_dcc_reject);
 	signal_add("event 401", (SIGNAL_FUNC) event_no_such_nick);
+	signal_add_last("dcc created", (SIGNAL_FUNC) dcc_timeout_schedule);
+	signal_add("setup changed", (SIGNAL_FUNC) dcc_timeout_schedule);
 	command_bind("dcc", NULL, (SIGNAL_FUNC) cmd_dcc);
 	command_bind("dcc close", NULL, (SIGNAL_FUNC) cmd_dcc_close);
 
@@ -591,10 +642,12 @@ void irc_dcc_deinit(void)
 	signal_remove("ctcp reply dcc", (SIGNAL_FUNC) ctcp_reply_dcc);
 	signal_remove("ctcp reply dcc reject", (SIGNAL_FUNC) ctcp_reply_dcc_reject);
 	signal_remove("event 401", (SIGNAL_FUNC) event_no_such_nick);
+	signal_remove("dcc created", (SIGNAL_FUNC) dcc_timeout_schedule);
+	signal_remove("setup changed", (SIGNAL_FUNC) dcc_timeout_schedule);
 	command_unbind("dcc", (SIGNAL_FUNC) cmd_dcc);
 	command_unbind("dcc close", (SIGNAL_FUNC) cmd_dcc_close);
 
-	g_source_remove(dcc_timeouttag);
+	timer_remove(dcc_timeouttag);
 }
 
 MODULE_ABICHECK(irc_dcc)
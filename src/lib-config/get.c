@@ -20,22 +20,98 @@
 
 #include "module.h"
 
+/* blocks whose lookups scan at least this many nodes get a key index */
+#define CONFIG_INDEX_MIN_NODES 16
+
+static void config_node_index_build(CONFIG_NODE *node)
+{
+	GSList *tmp;
+
+	node->index = g_hash_table_new((GHashFunc) config_istr_hash,
+				       (GEqualFunc) config_istr_equal);
+	for (tmp = node->value; tmp != NULL; tmp = tmp->next) {
+		CONFIG_NODE *child = tmp->data;
+
+		/* with duplicate keys the first one wins, like in the scan */
+		if (child->key != NULL &&
+		    !g_hash_table_contains(node->index, child->key))
+			g_hash_table_insert(node->index, child->key, child);
+	}
+}
+
+void config_node_index_drop(CONFIG_NODE *node)
+{
+	if (node->index != NULL) {
+		g_hash_table_destroy(node->index);
+		node->index = NULL;
+	}
+}
+
+void config_node_append(CONFIG_NODE *parent, CONFIG_NODE *node)
+{
+	if (parent->value == NULL) {
+		parent->value = parent->last = g_slist_append(NULL, node);
+	} else {
+		if (parent->last == NULL)
+			parent->last = g_slist_last(parent->value);
+		g_slist_append(parent->last, node);
+		parent->last = parent->last->next;
+	}
+
+	if (parent->index != NULL && node->key != NULL &&
+	    !g_hash_table_contains(parent->index, node->key))
+		g_hash_table_insert(parent->index, node->key, node);
+}
+
+/* `link' is about to be removed from `parent' */
+void config_node_index_remove(CONFIG_NODE *parent, GSList *link)
+{
+	CONFIG_NODE *node = link->data;
+	GSList *tmp;
+
+	if (parent->index == NULL || node->key == NULL ||
+	    g_hash_table_lookup(parent->index, node->key) != node)
+		return;
+
+	g_hash_table_remove(parent->index, node->key);
+
+	/* a later duplicate becomes the visible one */
+	for (tmp = link->next; tmp != NULL; tmp = tmp->next) {
+		CONFIG_NODE *child = tmp->data;
+
+		if (child->key != NULL && g_ascii_strcasecmp(child->key, node->key) == 0) {
+			g_hash_table_insert(parent->index, child->key, child);
+			break;
+		}
+	}
+}
+
 CONFIG_NODE *config_node_find(CONFIG_NODE *node, const char *key)
 {
+	CONFIG_NODE *found;
 	GSList *tmp;
+	int count;
 
 	g_return_val_if_fail(node != NULL, NULL);
 	g_return_val_if_fail(key != NULL, NULL);
 	g_return_val_if_fail(is_node_list(node), NULL);
 
-	for (tmp = node->value; tmp != NULL; tmp = tmp->next) {
-		CONFIG_NODE *node = tmp->data;
+	if (node->index != NULL)
+		return g_hash_table_lookup(node->index, key);
 
-		if (node->key != NULL && g_ascii_strcasecmp(node->key, key) == 0)
-			return node;
+	found = NULL; count = 0;
+	for (tmp = node->value; tmp != NULL; tmp = tmp->next, count++) {
+		CONFIG_NODE *child = tmp->data;
+
+		if (child->key != NULL && g_ascii_strcasecmp(child->key, key) == 0) {
+			found = child;
+			break;
+		}
 	}
 
-	return NULL;
+	if (count >= CONFIG_INDEX_MIN_NODES && node->type == NODE_TYPE_BLOCK)
+		config_node_index_build(node);
+	return found;
 }
 
 CONFIG_NODE *config_node_section(CONFIG_REC *rec, CONFIG_NODE *parent, const char *key, int new_type)
@@ -60,6 +136,9 @@ CONFIG_NODE *config_node_section_index(CONFIG_REC *rec, CONFIG_NODE *parent, con
 			/* move it to wanted position */
 			parent->value = g_slist_remove(parent->value, node);
 			parent->value = g_slist_insert(parent->value, node, index);
+			parent->last = NULL;
+			/* may change which duplicate comes first */
+			config_node_index_drop(parent);
 		}
 		if (!is_node_list(node)) {
 			int error = 0;
@@ -87,12 +166,17 @@ CONFIG_NODE *config_node_section_index(CONFIG_REC *rec, CONFIG_NODE *parent, con
 		return NULL;
 
 	node = g_new0(CONFIG_NODE, 1);
-	parent->value = index < 0 ? g_slist_append(parent->value, node) :
-		g_slist_insert(parent->value, node, index);
-
 	node->type = new_type;
 	node->key = key == NULL ? NULL : g_strdup(key);
 
+	if (index < 0)
+		config_node_append(parent, node);
+	else {
+		parent->value = g_slist_insert(parent->value, node, index);
+		parent->last = NULL;
+		config_node_index_drop(parent);
+	}
+
 	return node;
 }
 
@@ -21,6 +21,9 @@ struct _CONFIG_NODE {
 	int type;
         char *key;
 	void *value;
+	GHashTable *index; /* key -> first child with that key, built lazily
+			      for big blocks by config_node_find() */
+	GSList *last; /* last link of value list, NULL if not known */
 };
 
 /* a = { x=y; y=z; }
@@ -56,7 +59,7 @@ struct _CONFIG_REC {
 	GHashTable *cache; /* path -> node (for querying) */
 	GHashTable *cache_nodes; /* node -> path (for removing) */
 
-	GScanner *scanner;
+	struct _CONFIG_SCANNER *scanner; /* only valid while parsing */
 
 	/* while writing to configuration file.. */
 	GIOChannel *handle;
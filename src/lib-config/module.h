@@ -4,3 +4,12 @@
 /* private */
 int config_error(CONFIG_REC *rec, const char *msg);
 
+int config_istr_equal(gconstpointer v, gconstpointer v2);
+unsigned int config_istr_hash(gconstpointer v);
+
+/* append `node' to the end of `parent' in O(1) */
+void config_node_append(CONFIG_NODE *parent, CONFIG_NODE *node);
+
+/* keep the lazily built key index of `parent' in sync with its list */
+void config_node_index_remove(CONFIG_NODE *parent, GSList *link);
+void config_node_index_drop(CONFIG_NODE *node);
@@ -20,13 +20,31 @@
 
 #include "module.h"
 
-static int i_istr_equal(gconstpointer v, gconstpointer v2)
+struct _CONFIG_SCANNER {
+	CONFIG_REC *rec;
+	const char *input_name;
+	const char *pos;
+	int scan_line; /* line at `pos' */
+
+	GTokenType token;
+	char *value;
+	int line;
+
+	GTokenType next_token;
+	char *next_value;
+	int next_line;
+	int have_next;
+};
+
+typedef struct _CONFIG_SCANNER CONFIG_SCANNER;
+
+int config_istr_equal(gconstpointer v, gconstpointer v2)
 {
 	return g_ascii_strcasecmp((const char *) v, (const char *) v2) == 0;
 }
 
 /* a char* hash function from ASU */
-static unsigned int i_istr_hash(gconstpointer v)
+unsigned int config_istr_hash(gconstpointer v)
 {
 	const char *s = (const char *) v;
 	unsigned int h = 0, g;
@@ -50,7 +68,231 @@ int config_error(CONFIG_REC *rec, const char *msg)
 	return -1;
 }
 
-static int node_add_comment(CONFIG_NODE *parent, const char *str)
+static void config_parse_message(CONFIG_SCANNER *scanner, int is_error,
+				 const char *format, ...) G_GNUC_PRINTF (3, 4);
+
+static void config_parse_message(CONFIG_SCANNER *scanner, int is_error,
+				 const char *format, ...)
+{
+	CONFIG_REC *rec = scanner->rec;
+	va_list va;
+	char *message, *old;
+
+	va_start(va, format);
+	message = g_strdup_vprintf(format, va);
+	va_end(va);
+
+	old = rec->last_error;
+	rec->last_error = g_strdup_printf("%s%s:%d: %s%s\n",
+					  old == NULL ? "" : old,
+					  scanner->input_name, scanner->line,
+					  is_error ? "error: " : "",
+					  message);
+	g_free_not_null(old);
+	g_free(message);
+}
+
+#define config_is_word_char(c) \
+	(i_isalnum(c) || (c) == '_' || (unsigned char) (c) >= 0x80)
+
+/* "..." string with the escapes written by config_escape_string() */
+static GTokenType config_scan_string_dq(CONFIG_SCANNER *scanner, const char *p,
+					char **value)
+{
+	GString *str;
+	const char *start;
+	int chr, n;
+
+	str = g_string_new(NULL);
+	for (p++;;) {
+		for (start = p; *p != '"' && *p != '\\' && *p != '\0'; p++) {
+			if (*p == '\n')
+				scanner->scan_line++;
+		}
+		g_string_append_len(str, start, p - start);
+
+		if (*p == '"' || *p == '\0')
+			break;
+
+		/* backslash */
+		p++;
+		switch (*p) {
+		case '\0':
+			break;
+		case '\\':
+		case '"':
+			g_string_append_c(str, *p++);
+			break;
+		case 'n':
+			g_string_append_c(str, '\n'); p++;
+			break;
+		case 't':
+			g_string_append_c(str, '\t'); p++;
+			break;
+		case 'r':
+			g_string_append_c(str, '\r'); p++;
+			break;
+		case 'b':
+			g_string_append_c(str, '\b'); p++;
+			break;
+		case 'f':
+			g_string_append_c(str, '\f'); p++;
+			break;
+		case '0': case '1': case '2': case '3':
+		case '4': case '5': case '6': case '7':
+			chr = 0;
+			for (n = 0; n < 3 && *p >= '0' && *p <= '7'; n++, p++)
+				chr = chr * 8 + (*p - '0');
+			g_string_append_c(str, (char) chr);
+			break;
+		default:
+			if (*p == '\n')
+				scanner->scan_line++;
+			g_string_append_c(str, '\\');
+			g_string_append_c(str, *p++);
+			break;
+		}
+	}
+
+	if (*p == '\0') {
+		g_string_free(str, TRUE);
+		scanner->pos = p;
+		*value = g_strdup("unterminated string constant");
+		return G_TOKEN_ERROR;
+	}
+
+	scanner->pos = p + 1;
+	*value = g_string_free(str, FALSE);
+	return G_TOKEN_STRING;
+}
+
+/* '...' string, no escapes */
+static GTokenType config_scan_string_sq(CONFIG_SCANNER *scanner, const char *p,
+					char **value)
+{
+	const char *start;
+
+	for (start = ++p; *p != '\'' && *p != '\0'; p++) {
+		if (*p == '\n')
+			scanner->scan_line++;
+	}
+
+	if (*p == '\0') {
+		scanner->pos = p;
+		*value = g_strdup("unterminated string constant");
+		return G_TOKEN_ERROR;
+	}
+
+	scanner->pos = p + 1;
+	*value = g_strndup(start, p - start);
+	return G_TOKEN_STRING;
+}
+
+/* Read the next token at `scanner->pos'. Returns the character itself for
+   punctuation and line feeds, G_TOKEN_STRING for both quoted strings and
+   bare words, and G_TOKEN_COMMENT_SINGLE for # comments (which swallow
+   their line feed). */
+static GTokenType config_scan_token(CONFIG_SCANNER *scanner, char **value)
+{
+	const char *p, *start;
+
+	*value = NULL;
+
+	p = scanner->pos;
+	while (*p == ' ' || *p == '\t' || *p == '\r')
+		p++;
+
+	switch (*p) {
+	case '\0':
+		scanner->pos = p;
+		return G_TOKEN_EOF;
+	case '\n':
+		scanner->pos = p + 1;
+		scanner->scan_line++;
+		return (GTokenType) '\n';
+	case '#':
+		start = ++p;
+		p = strchr(p, '\n');
+		if (p == NULL)
+			p = start + strlen(start);
+		*value = g_strndup(start, p - start);
+		if (*p == '\n') {
+			scanner->scan_line++;
+			p++;
+		}
+		scanner->pos = p;
+		return G_TOKEN_COMMENT_SINGLE;
+	case '"':
+		return config_scan_string_dq(scanner, p, value);
+	case '\'':
+		return config_scan_string_sq(scanner, p, value);
+	}
+
+	if (!config_is_word_char(*p)) {
+		scanner->pos = p + 1;
+		return (GTokenType) (unsigned char) *p;
+	}
+
+	for (start = p; config_is_word_char(*p); p++) ;
+	*value = g_strndup(start, p - start);
+	scanner->pos = p;
+	return G_TOKEN_STRING;
+}
+
+static GTokenType config_scanner_peek(CONFIG_SCANNER *scanner)
+{
+	if (!scanner->have_next) {
+		scanner->next_token = config_scan_token(scanner, &scanner->next_value);
+		scanner->next_line = scanner->scan_line;
+		scanner->have_next = TRUE;
+	}
+	return scanner->next_token;
+}
+
+static GTokenType config_scanner_get(CONFIG_SCANNER *scanner)
+{
+	config_scanner_peek(scanner);
+
+	g_free(scanner->value);
+	scanner->token = scanner->next_token;
+	scanner->value = scanner->next_value;
+	scanner->line = scanner->next_line;
+
+	scanner->next_value = NULL;
+	scanner->have_next = FALSE;
+	return scanner->token;
+}
+
+static void config_parse_unexp_token(CONFIG_SCANNER *scanner, GTokenType expected)
+{
+	char *token, *expect;
+
+	if (scanner->token == G_TOKEN_ERROR) {
+		/* the scanner already told what went wrong */
+		config_parse_message(scanner, TRUE, "%s", scanner->value);
+		return;
+	}
+
+	if (scanner->token == G_TOKEN_EOF)
+		token = g_strdup("end of file");
+	else if (scanner->token == G_TOKEN_STRING)
+		token = g_strdup_printf("string constant \"%s\"", scanner->value);
+	else
+		token = g_strdup_printf("character `%c'", (int) scanner->token);
+
+	if (expected == G_TOKEN_NONE)
+		expect = g_strdup("");
+	else if (expected == G_TOKEN_STRING)
+		expect = g_strdup(", expected string constant");
+	else
+		expect = g_strdup_printf(", expected character `%c'", (int) expected);
+
+	config_parse_message(scanner, TRUE, "unexpected %s%s", token, expect);
+	g_free(token);
+	g_free(expect);
+}
+
+static int node_add_comment(CONFIG_NODE *parent, char *str)
 {
 	CONFIG_NODE *node;
 
@@ -61,53 +303,50 @@ static int node_add_comment(CONFIG_NODE *parent, const char *str)
 
 	node = g_new0(CONFIG_NODE, 1);
 	node->type = NODE_TYPE_COMMENT;
-	node->value = str == NULL ? NULL : g_strdup(str);
+	node->value = str;
 
-	parent->value = g_slist_append(parent->value, node);
+	config_node_append(parent, node);
 	return 0;
 }
 
-/* same as g_scanner_get_next_token() except skips and reads the comments */
-static void config_parse_get_token(GScanner *scanner, CONFIG_NODE *node)
+/* get the next token, skipping and storing the comments and empty lines */
+static void config_parse_get_token(CONFIG_SCANNER *scanner, CONFIG_NODE *node)
 {
 	int prev_empty = FALSE;
 
 	for (;;) {
-		g_scanner_get_next_token(scanner);
+		config_scanner_get(scanner);
 
-		if (scanner->token == G_TOKEN_COMMENT_SINGLE)
-			node_add_comment(node, scanner->value.v_string);
-		else if (scanner->token == '\n') {
+		if (scanner->token == G_TOKEN_COMMENT_SINGLE) {
+			if (node_add_comment(node, scanner->value) == 0)
+				scanner->value = NULL;
+		} else if (scanner->token == '\n') {
 			if (prev_empty) node_add_comment(node, NULL);
-		} else {
-			if (scanner->token == G_TOKEN_INT) {
-				scanner->token = G_TOKEN_STRING;
-				scanner->value.v_string = g_strdup_printf("%lu", scanner->value.v_int);
-			}
+		} else
 			break;
-		}
 
 		prev_empty = TRUE;
 	}
 }
 
-/* same as g_scanner_peek_next_token() except skips and reads the comments */
-static void config_parse_peek_token(GScanner *scanner, CONFIG_NODE *node)
+/* peek at the next token, skipping and storing the comments and empty lines */
+static void config_parse_peek_token(CONFIG_SCANNER *scanner, CONFIG_NODE *node)
 {
 	int prev_empty = FALSE;
 
 	for (;;) {
-		g_scanner_peek_next_token(scanner);
+		config_scanner_peek(scanner);
 
-		if (scanner->next_token == G_TOKEN_COMMENT_SINGLE)
-			node_add_comment(node, scanner->next_value.v_string);
-		else if (scanner->next_token == '\n') {
+		if (scanner->next_token == G_TOKEN_COMMENT_SINGLE) {
+			if (node_add_comment(node, scanner->next_value) == 0)
+				scanner->next_value = NULL;
+		} else if (scanner->next_token == '\n') {
 			if (prev_empty) node_add_comment(node, NULL);
 		} else
 			break;
 
 		prev_empty = TRUE;
-		g_scanner_get_next_token(scanner);
+		config_scanner_get(scanner);
 	}
 }
 
@@ -117,12 +356,12 @@ static void config_parse_warn_missing(CONFIG_REC *rec, CONFIG_NODE *node,
 {
 	config_parse_peek_token(rec->scanner, node);
 	if (rec->scanner->next_token == expected_token) {
-		g_scanner_get_next_token(rec->scanner);
+		config_scanner_get(rec->scanner);
 		return;
 	}
 
         if (print_warning)
-		g_scanner_warn(rec->scanner, "Warning: missing '%c'", expected_token);
+		config_parse_message(rec->scanner, FALSE, "Warning: missing '%c'", expected_token);
 }
 
 static void config_parse_loop(CONFIG_REC *rec, CONFIG_NODE *node, GTokenType expect);
@@ -145,7 +384,8 @@ static GTokenType config_parse_symbol(CONFIG_REC *rec, CONFIG_NODE *node)
 	key = NULL;
 	if (node->type != NODE_TYPE_LIST &&
 	    (rec->scanner->token == G_TOKEN_STRING)) {
-		key = g_strdup(rec->scanner->value.v_string);
+		key = rec->scanner->value;
+		rec->scanner->value = NULL;
 
                 config_parse_warn_missing(rec, node, '=', TRUE);
 		config_parse_get_token(rec->scanner, node);
@@ -154,7 +394,7 @@ static GTokenType config_parse_symbol(CONFIG_REC *rec, CONFIG_NODE *node)
  	switch (rec->scanner->token) {
 	case G_TOKEN_STRING:
 		/* value */
-		config_node_set_str(rec, node, key, rec->scanner->value.v_string);
+		config_node_set_str(rec, node, key, rec->scanner->value);
 		g_free_not_null(key);
 
 		print_warning = TRUE;
@@ -171,7 +411,7 @@ static GTokenType config_parse_symbol(CONFIG_REC *rec, CONFIG_NODE *node)
 	case '{':
 		/* block */
 		if (key == NULL && node->type != NODE_TYPE_LIST) {
-			g_scanner_error(rec->scanner, "Missing key");
+			config_parse_message(rec->scanner, TRUE, "Missing key");
 			return G_TOKEN_ERROR;
 		}
 
@@ -189,7 +429,7 @@ static GTokenType config_parse_symbol(CONFIG_REC *rec, CONFIG_NODE *node)
 	case '(':
 		/* list */
 		if (key == NULL && !rec->list_of_lists) {
-			g_scanner_error(rec->scanner, "List of lists not allowed");
+			config_parse_message(rec->scanner, TRUE, "List of lists not allowed");
 			return G_TOKEN_ERROR;
 		}
 
@@ -229,51 +469,57 @@ static void config_parse_loop(CONFIG_REC *rec, CONFIG_NODE *node, GTokenType exp
 		if (expected_token != G_TOKEN_NONE) {
 			if (expected_token == G_TOKEN_ERROR)
 				expected_token = G_TOKEN_NONE;
-			g_scanner_unexp_token(rec->scanner, expected_token, NULL, "symbol", NULL, NULL, TRUE);
+			config_parse_unexp_token(rec->scanner, expected_token);
 		}
 	}
 }
 
-static void config_parse_error_func(GScanner *scanner, char *message, int is_error)
+static void config_parse_text(CONFIG_REC *rec, const char *text, const char *name)
 {
-	CONFIG_REC *rec = scanner->user_data;
-	char *old;
+	CONFIG_SCANNER scanner;
 
-	old = rec->last_error;
-	rec->last_error = g_strdup_printf("%s%s:%d: %s%s\n",
-					  old == NULL ? "" : old,
-					  scanner->input_name, scanner->line,
-					  is_error ? "error: " : "",
-					  message);
-        g_free_not_null(old);
+	g_free_and_null(rec->last_error);
+	config_nodes_remove_all(rec);
+
+	memset(&scanner, 0, sizeof(scanner));
+	scanner.rec = rec;
+	scanner.input_name = name;
+	scanner.pos = text;
+	scanner.scan_line = scanner.line = 1;
+
+	rec->scanner = &scanner;
+	config_parse_loop(rec, rec->mainnode, G_TOKEN_EOF);
+	rec->scanner = NULL;
+
+	g_free(scanner.value);
+	g_free(scanner.next_value);
 }
 
-void config_parse_init(CONFIG_REC *rec, const char *name)
+/* read the whole file, the parser works on a NUL terminated buffer */
+static char *config_read_fd(int fd)
 {
-	GScanner *scanner;
-
-	g_free_and_null(rec->last_error);
-	config_nodes_remove_all(rec);
+	struct stat statbuf;
+	GString *str;
+	char buf[65536];
+	ssize_t ret;
+
+	str = g_string_sized_new(fstat(fd, &statbuf) == 0 && statbuf.st_size > 0 ?
+				 (gsize) statbuf.st_size : sizeof(buf));
+	while ((ret = read(fd, buf, sizeof(buf))) != 0) {
+		if (ret > 0)
+			g_string_append_len(str, buf, ret);
+		else if (errno != EINTR) {
+			g_string_free(str, TRUE);
+			return NULL;
+		}
+	}
 
-	rec->scanner = scanner = g_scanner_new(NULL);
-	scanner->config->skip_comment_single = FALSE;
-	scanner->config->cset_identifier_first = G_CSET_a_2_z"_0123456789"G_CSET_A_2_Z;
-	scanner->config->cset_skip_characters = " \t";
-	scanner->config->scan_binary = FALSE;
-	scanner->config->scan_octal = FALSE;
-	scanner->config->scan_float = FALSE;
-	scanner->config->scan_string_sq = TRUE;
-	scanner->config->scan_string_dq = TRUE;
-	scanner->config->scan_identifier_1char = TRUE;
-	scanner->config->identifier_2_string = TRUE;
-
-	scanner->user_data = rec;
-	scanner->input_name = name;
-	scanner->msg_handler = (GScannerMsgFunc) config_parse_error_func;
+	return g_string_free(str, FALSE);
 }
 
 int config_parse(CONFIG_REC *rec)
 {
+	char *data;
 	int fd;
 
 	g_return_val_if_fail(rec != NULL, -1);
@@ -283,22 +529,24 @@ int config_parse(CONFIG_REC *rec)
 	if (fd == -1)
 		return config_error(rec, g_strerror(errno));
 
-	config_parse_init(rec, rec->fname);
-	g_scanner_input_file(rec->scanner, fd);
-	config_parse_loop(rec, rec->mainnode, G_TOKEN_EOF);
-	g_scanner_destroy(rec->scanner);
+	data = config_read_fd(fd);
+	if (data == NULL) {
+		int error = errno;
 
+		close(fd);
+		return config_error(rec, g_strerror(error));
+	}
 	close(fd);
 
+	config_parse_text(rec, data, rec->fname);
+	g_free(data);
+
 	return rec->last_error == NULL ? 0 : -1;
 }
 
 int config_parse_data(CONFIG_REC *rec, const char *data, const char *input_name)
 {
-	config_parse_init(rec, input_name);
-	g_scanner_input_text(rec->scanner, data, strlen(data));
-	config_parse_loop(rec, rec->mainnode, G_TOKEN_EOF);
-	g_scanner_destroy(rec->scanner);
+	config_parse_text(rec, data, input_name);
 
 	return rec->last_error == NULL ? 0 : -1;
 }
@@ -319,7 +567,7 @@ CONFIG_REC *config_open(const char *fname, int create_mode)
 	rec->create_mode = create_mode;
 	rec->mainnode = g_new0(CONFIG_NODE, 1);
 	rec->mainnode->type = NODE_TYPE_BLOCK;
-	rec->cache = g_hash_table_new((GHashFunc) i_istr_hash, (GCompareFunc) i_istr_equal);
+	rec->cache = g_hash_table_new((GHashFunc) config_istr_hash, (GCompareFunc) config_istr_equal);
 	rec->cache_nodes = g_hash_table_new((GHashFunc) g_direct_hash, (GCompareFunc) g_direct_equal);
 
 	return rec;
@@ -330,6 +578,7 @@ void config_close(CONFIG_REC *rec)
 	g_return_if_fail(rec != NULL);
 
 	config_nodes_remove_all(rec);
+	config_node_index_drop(rec->mainnode);
 	g_free(rec->mainnode);
 
 	g_hash_table_foreach(rec->cache, (GHFunc) g_free, NULL);
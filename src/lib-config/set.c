@@ -34,6 +34,8 @@ static void cache_remove(CONFIG_REC *rec, CONFIG_NODE *node)
 
 void config_node_remove(CONFIG_REC *rec, CONFIG_NODE *parent, CONFIG_NODE *node)
 {
+	GSList *link;
+
 	g_return_if_fail(node != NULL);
 
 	if (parent == NULL)
@@ -41,7 +43,13 @@ void config_node_remove(CONFIG_REC *rec, CONFIG_NODE *parent, CONFIG_NODE *node)
 
 	rec->modifycounter++;
 	cache_remove(rec, node);
-	parent->value = g_slist_remove(parent->value, node);
+	link = g_slist_find(parent->value, node);
+	if (link != NULL) {
+		config_node_index_remove(parent, link);
+		if (link == parent->last)
+			parent->last = NULL;
+		parent->value = g_slist_delete_link(parent->value, link);
+	}
 
 	switch (node->type) {
 	case NODE_TYPE_KEY:
@@ -51,6 +59,7 @@ void config_node_remove(CONFIG_REC *rec, CONFIG_NODE *parent, CONFIG_NODE *node)
 		break;
 	case NODE_TYPE_BLOCK:
 	case NODE_TYPE_LIST:
+		config_node_index_drop(node);
 		while (node->value != NULL)
 			config_node_remove(rec, node, ((GSList *) node->value)->data);
 		break;
@@ -118,10 +127,10 @@ void config_node_set_str(CONFIG_REC *rec, CONFIG_NODE *parent, const char *key,
                 g_free(node->value);
 	} else {
 		node = g_new0(CONFIG_NODE, 1);
-		parent->value = g_slist_append(parent->value, node);
-
 		node->type = no_key ? NODE_TYPE_VALUE : NODE_TYPE_KEY;
 		node->key = no_key ? NULL : g_strdup(key);
+
+		config_node_append(parent, node);
 	}
 
 	node->value = g_strdup(value);
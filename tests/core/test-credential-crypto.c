@@ -0,0 +1,170 @@
+/*
+ test-credential-crypto.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+#include <string.h>
+
+#include <irssi/src/common.h>
+#include <irssi/src/core/credential.h>
+
+/* "hunter2" encrypted with the password "secret" */
+static const char old_format_value[] =
+	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f:"
+	"101112131415161718191a1b1c1d1e1f:"
+	"9i4H1Zqn20BHszbiLqz5Yg==";
+
+static const char v2_format_value[] =
+	"2:"
+	"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f:"
+	"404142434445464748494a4b4c4d4e4f:"
+	"505152535455565758595a5b5c5d5e5f:"
+	"/cgfWHtMGMDj2GxMa7O7rg==";
+
+/* Decrypting with a wrong key fails the padding check almost always, but
+   may in rare cases return garbage */
+static void assert_not_decrypted(const char *value, const char *password,
+                                 const char *plaintext)
+{
+	char *result;
+
+	result = credential_decrypt(value, password);
+	g_assert_true(result == NULL || strcmp(result, plaintext) != 0);
+	g_free(result);
+}
+
+static void test_v2_roundtrip(void)
+{
+	char *value, *result;
+
+	value = credential_encrypt("hunter2", "secret");
+	g_assert_nonnull(value);
+	g_assert_true(g_str_has_prefix(value, "2:"));
+	g_assert_null(strstr(value, "hunter2"));
+
+	result = credential_decrypt(value, "secret");
+	g_assert_cmpstr(result, ==, "hunter2");
+	g_free(result);
+
+	/* empty values are valid too */
+	g_free(value);
+	value = credential_encrypt("", "secret");
+	result = credential_decrypt(value, "secret");
+	g_assert_cmpstr(result, ==, "");
+	g_free(result);
+	g_free(value);
+
+	credential_crypto_forget_keys();
+}
+
+static void test_fixed_vectors(void)
+{
+	char *result;
+
+	result = credential_decrypt(old_format_value, "secret");
+	g_assert_cmpstr(result, ==, "hunter2");
+	g_free(result);
+
+	result = credential_decrypt(v2_format_value, "secret");
+	g_assert_cmpstr(result, ==, "hunter2");
+	g_free(result);
+
+	credential_crypto_forget_keys();
+}
+
+static void test_wrong_password(void)
+{
+	char *value;
+
+	g_assert_null(credential_decrypt(old_format_value, "Secret"));
+	g_assert_null(credential_decrypt(v2_format_value, "Secret"));
+
+	value = credential_encrypt("hunter2", "secret");
+	assert_not_decrypted(value, "wrong", "hunter2");
+	g_free(value);
+
+	credential_crypto_forget_keys();
+}
+
+static void test_malformed(void)
+{
+	char *result;
+
+	/* no separator, taken as plaintext */
+	result = credential_decrypt("plain", "secret");
+	g_assert_cmpstr(result, ==, "plain");
+	g_free(result);
+
+	g_assert_null(credential_decrypt("00:11", "secret"));
+	g_assert_null(credential_decrypt("00:11:22", "secret"));
+	g_assert_null(credential_decrypt("2:00:11:22", "secret"));
+	g_assert_null(credential_decrypt("2:zz:11:22:33", "secret"));
+}
+
+static void test_forget_keys(void)
+{
+	char *value1, *value2, *result;
+	char **parts1, **parts2;
+
+	value1 = credential_encrypt("first", "secret");
+	value2 = credential_encrypt("second", "secret");
+	g_assert_nonnull(value1);
+	g_assert_nonnull(value2);
+
+	/* both values use the cached master key */
+	parts1 = g_strsplit(value1, ":", 5);
+	parts2 = g_strsplit(value2, ":", 5);
+	g_assert_cmpstr(parts1[1], ==, parts2[1]);
+	g_assert_cmpstr(parts1[2], !=, parts2[2]);
+	g_strfreev(parts1);
+	g_strfreev(parts2);
+
+	credential_crypto_forget_keys();
+
+	result = credential_decrypt(value1, "secret");
+	g_assert_cmpstr(result, ==, "first");
+	g_free(result);
+	result = credential_decrypt(value2, "secret");
+	g_assert_cmpstr(result, ==, "second");
+	g_free(result);
+
+	/* changing the password drops the cached key */
+	assert_not_decrypted(value1, "other", "first");
+	result = credential_decrypt(value2, "secret");
+	g_assert_cmpstr(result, ==, "second");
+	g_free(result);
+
+	g_free(value1);
+	g_free(value2);
+	credential_crypto_forget_keys();
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/test/credential_crypto/v2_roundtrip", test_v2_roundtrip);
+	g_test_add_func("/test/credential_crypto/fixed_vectors", test_fixed_vectors);
+	g_test_add_func("/test/credential_crypto/wrong_password", test_wrong_password);
+	g_test_add_func("/test/credential_crypto/malformed", test_malformed);
+	g_test_add_func("/test/credential_crypto/forget_keys", test_forget_keys);
+
+	return g_test_run();
+}
@@ -0,0 +1,300 @@
+/*
+ test-session-snapshot.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include <irssi/src/common.h>
+#include <irssi/src/core/session-snapshot.h>
+
+/* Offsets in the file written by snapshot_write_sample() */
+#define OFFSET_VERSION 16
+#define OFFSET_NAME_LEN 20
+#define OFFSET_SECTION_SIZE 25
+#define OFFSET_STR_LEN 45
+#define OFFSET_STR 49
+
+static char *snapshot_path(void)
+{
+	char *path;
+	int fd;
+
+	fd = g_file_open_tmp("test-session-snapshot-XXXXXX", &path, NULL);
+	g_assert_cmpint(fd, !=, -1);
+	close(fd);
+	return path;
+}
+
+static void snapshot_write_sample(const char *path)
+{
+	SESSION_SNAPSHOT_REC *snap;
+	int i;
+
+	snap = session_snapshot_create(path);
+	g_assert_nonnull(snap);
+
+	session_snapshot_section(snap, "a");
+	session_snapshot_write_int(snap, 42);
+	session_snapshot_write_int64(snap, G_GINT64_CONSTANT(1) << 40);
+	session_snapshot_write_str(snap, "hello");
+	session_snapshot_write_str(snap, NULL);
+	session_snapshot_write_str(snap, "");
+
+	session_snapshot_section(snap, "empty");
+
+	session_snapshot_section(snap, "lines");
+	session_snapshot_write_int(snap, 100);
+	for (i = 0; i < 100; i++) {
+		char *str = g_strdup_printf("line %d", i);
+		session_snapshot_write_str(snap, str);
+		g_free(str);
+	}
+
+	g_assert_true(session_snapshot_finish(snap));
+}
+
+static char *read_file(const char *path, gsize *len)
+{
+	char *data;
+
+	g_assert_true(g_file_get_contents(path, &data, len, NULL));
+	return data;
+}
+
+static void write_file(const char *path, const char *data, gsize len)
+{
+	g_assert_true(g_file_set_contents(path, data, len, NULL));
+}
+
+/* Read all strings of every section of an opened snapshot, which must not
+   go past the end of the section even when the data is garbage */
+static void snapshot_read_all(SESSION_SNAPSHOT_REC *snap)
+{
+	static const char *const names[] = { "a", "empty", "lines" };
+	SESSION_SNAPSHOT_READER reader;
+	int i;
+
+	for (i = 0; i < G_N_ELEMENTS(names); i++) {
+		if (!session_snapshot_find(snap, names[i], &reader))
+			continue;
+
+		while (reader.data < reader.end && !reader.error)
+			session_snapshot_read_str(&reader);
+		g_assert_true(reader.data <= reader.end);
+	}
+}
+
+static void test_snapshot_roundtrip(void)
+{
+	SESSION_SNAPSHOT_REC *snap;
+	SESSION_SNAPSHOT_READER reader;
+	char *path, *str;
+	int i;
+
+	path = snapshot_path();
+	snapshot_write_sample(path);
+
+	snap = session_snapshot_open(path);
+	g_assert_nonnull(snap);
+
+	g_assert_true(session_snapshot_find(snap, "a", &reader));
+	g_assert_cmpint(session_snapshot_read_int(&reader), ==, 42);
+	g_assert_cmpint(session_snapshot_read_int64(&reader), ==, G_GINT64_CONSTANT(1) << 40);
+	g_assert_cmpstr(session_snapshot_read_str(&reader), ==, "hello");
+	g_assert_null(session_snapshot_read_str(&reader));
+	g_assert_cmpstr(session_snapshot_read_str(&reader), ==, "");
+	g_assert_false(reader.error);
+	g_assert_true(reader.data == reader.end);
+
+	/* reading past the end of the section */
+	g_assert_cmpint(session_snapshot_read_int(&reader), ==, 0);
+	g_assert_true(reader.error);
+
+	g_assert_true(session_snapshot_find(snap, "empty", &reader));
+	g_assert_true(reader.data == reader.end);
+	g_assert_null(session_snapshot_read_str(&reader));
+	g_assert_true(reader.error);
+
+	g_assert_true(session_snapshot_find(snap, "lines", &reader));
+	g_assert_cmpint(session_snapshot_read_int(&reader), ==, 100);
+	for (i = 0; i < 100; i++) {
+		str = g_strdup_printf("line %d", i);
+		g_assert_cmpstr(session_snapshot_read_str(&reader), ==, str);
+		g_free(str);
+	}
+	g_assert_false(reader.error);
+
+	g_assert_false(session_snapshot_find(snap, "missing", &reader));
+	session_snapshot_close(snap);
+
+	/* create replaces an existing file */
+	snap = session_snapshot_create(path);
+	g_assert_nonnull(snap);
+	session_snapshot_section(snap, "other");
+	g_assert_true(session_snapshot_finish(snap));
+
+	snap = session_snapshot_open(path);
+	g_assert_nonnull(snap);
+	g_assert_false(session_snapshot_find(snap, "a", &reader));
+	g_assert_true(session_snapshot_find(snap, "other", &reader));
+	session_snapshot_close(snap);
+
+	g_unlink(path);
+	g_assert_null(session_snapshot_open(path));
+	g_free(path);
+}
+
+static void test_snapshot_truncated(void)
+{
+	SESSION_SNAPSHOT_REC *snap;
+	SESSION_SNAPSHOT_READER reader;
+	char *path, *data;
+	gsize len, i;
+
+	path = snapshot_path();
+	snapshot_write_sample(path);
+	data = read_file(path, &len);
+
+	for (i = 0; i < len; i++) {
+		write_file(path, data, i);
+		snap = session_snapshot_open(path);
+		if (snap == NULL)
+			continue;
+
+		/* cut between sections, the last one is missing */
+		g_assert_false(session_snapshot_find(snap, "lines", &reader));
+		snapshot_read_all(snap);
+		session_snapshot_close(snap);
+	}
+
+	g_unlink(path);
+	g_free(data);
+	g_free(path);
+}
+
+static void corrupt_int(char *data, gsize offset, int value)
+{
+	memcpy(data + offset, &value, sizeof(value));
+}
+
+static void corrupt_int64(char *data, gsize offset, gint64 value)
+{
+	memcpy(data + offset, &value, sizeof(value));
+}
+
+static void test_snapshot_corrupted(void)
+{
+	SESSION_SNAPSHOT_REC *snap;
+	SESSION_SNAPSHOT_READER reader;
+	char *path, *data, *copy;
+	gsize len, i;
+
+	path = snapshot_path();
+	snapshot_write_sample(path);
+	data = read_file(path, &len);
+	copy = g_malloc(len);
+
+	/* headers */
+	memcpy(copy, data, len);
+	copy[0] = 'E';
+	write_file(path, copy, len);
+	g_assert_null(session_snapshot_open(path));
+
+	memcpy(copy, data, len);
+	corrupt_int(copy, OFFSET_VERSION, SESSION_SNAPSHOT_VERSION + 1);
+	write_file(path, copy, len);
+	g_assert_null(session_snapshot_open(path));
+
+	memcpy(copy, data, len);
+	corrupt_int(copy, OFFSET_NAME_LEN, -1);
+	write_file(path, copy, len);
+	g_assert_null(session_snapshot_open(path));
+
+	memcpy(copy, data, len);
+	corrupt_int(copy, OFFSET_NAME_LEN, G_MAXINT);
+	write_file(path, copy, len);
+	g_assert_null(session_snapshot_open(path));
+
+	memcpy(copy, data, len);
+	corrupt_int64(copy, OFFSET_SECTION_SIZE, -1);
+	write_file(path, copy, len);
+	g_assert_null(session_snapshot_open(path));
+
+	memcpy(copy, data, len);
+	corrupt_int64(copy, OFFSET_SECTION_SIZE, G_MAXINT64);
+	write_file(path, copy, len);
+	g_assert_null(session_snapshot_open(path));
+
+	/* string longer than its section */
+	memcpy(copy, data, len);
+	corrupt_int(copy, OFFSET_STR_LEN, 1000);
+	write_file(path, copy, len);
+	snap = session_snapshot_open(path);
+	g_assert_nonnull(snap);
+	g_assert_true(session_snapshot_find(snap, "a", &reader));
+	session_snapshot_read_int(&reader);
+	session_snapshot_read_int64(&reader);
+	g_assert_null(session_snapshot_read_str(&reader));
+	g_assert_true(reader.error);
+	session_snapshot_close(snap);
+
+	/* string without its NUL */
+	memcpy(copy, data, len);
+	copy[OFFSET_STR + strlen("hello")] = 'x';
+	write_file(path, copy, len);
+	snap = session_snapshot_open(path);
+	g_assert_nonnull(snap);
+	g_assert_true(session_snapshot_find(snap, "a", &reader));
+	session_snapshot_read_int(&reader);
+	session_snapshot_read_int64(&reader);
+	g_assert_null(session_snapshot_read_str(&reader));
+	g_assert_true(reader.error);
+	session_snapshot_close(snap);
+
+	/* any byte changed */
+	for (i = 0; i < len; i++) {
+		memcpy(copy, data, len);
+		copy[i] ^= 0xff;
+		write_file(path, copy, len);
+		snap = session_snapshot_open(path);
+		if (snap != NULL) {
+			snapshot_read_all(snap);
+			session_snapshot_close(snap);
+		}
+	}
+
+	g_unlink(path);
+	g_free(copy);
+	g_free(data);
+	g_free(path);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/test/session_snapshot/roundtrip", test_snapshot_roundtrip);
+	g_test_add_func("/test/session_snapshot/truncated", test_snapshot_truncated);
+	g_test_add_func("/test/session_snapshot/corrupted", test_snapshot_corrupted);
+
+	return g_test_run();
+}
@@ -0,0 +1,251 @@
+/*
+ test-textmatch.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <irssi/src/common.h>
+#include <irssi/src/core/textmatch.h>
+
+typedef struct {
+	char const *const description;
+	int const icase;
+	char const *const patterns[8];
+	char const *const text;
+} textmatch_test_case;
+
+textmatch_test_case const textmatch_fixtures[] = {
+	{
+		.description = "Overlapping strings",
+		.patterns    = { "he", "she", "his", "hers" },
+		.text        = "ushers and his shells",
+	},
+	{
+		.description = "Repeated characters",
+		.patterns    = { "a", "aa", "aaa" },
+		.text        = "aaaa baa",
+	},
+	{
+		.description = "Shared suffixes",
+		.patterns    = { "abcd", "bcd", "cd", "d", "xbc" },
+		.text        = "abcd xbcd bcdd",
+	},
+	{
+		.description = "Shared prefixes",
+		.patterns    = { "foo", "foobar", "fo", "foob" },
+		.text        = "foofoobar fob",
+	},
+	{
+		.description = "Same string twice",
+		.patterns    = { "nick", "nick", "ick" },
+		.text        = "nick nicky",
+	},
+	{
+		.description = "Case sensitive",
+		.patterns    = { "Nick", "nick", "NICK" },
+		.text        = "nick Nick NICK nIcK",
+	},
+	{
+		.description = "Case insensitive",
+		.icase       = TRUE,
+		.patterns    = { "Nick", "ICK", "k!" },
+		.text        = "nick Nick NICK nIcK!",
+	},
+	{
+		.description = "Failure links after a mismatch",
+		.icase       = TRUE,
+		.patterns    = { "abab", "bac", "abc" },
+		.text        = "ababac abababc",
+	},
+	{
+		.description = "Non-ASCII bytes",
+		.icase       = TRUE,
+		.patterns    = { "\xc3\xa4", "b\xc3\xa4r" },
+		.text        = "B\xc3\xa4R \xc3\x84",
+	},
+	{
+		.description = "Empty string is ignored",
+		.patterns    = { "", "a" },
+		.text        = "aba",
+	},
+	{
+		.description = "Empty text",
+		.patterns    = { "a", "bc" },
+		.text        = "",
+	},
+	{
+		.description = "No strings",
+		.patterns    = { NULL },
+		.text        = "text",
+	},
+};
+
+static void test_textmatch(const textmatch_test_case *test);
+
+static int hit_add(const char *text, int start, int end, void *pattern_data,
+		   GString *hits)
+{
+	g_string_append_printf(hits, "%d-%d:%d ", start, end, GPOINTER_TO_INT(pattern_data));
+	return TRUE;
+}
+
+/* ordered by end position and then by start position */
+static int hit_cmp(const char **a, const char **b)
+{
+	int a_start, a_end, a_n, b_start, b_end, b_n;
+
+	sscanf(*a, "%d-%d:%d", &a_start, &a_end, &a_n);
+	sscanf(*b, "%d-%d:%d", &b_start, &b_end, &b_n);
+	if (a_end != b_end)
+		return a_end - b_end;
+	if (a_start != b_start)
+		return b_start - a_start;
+	return a_n - b_n;
+}
+
+static int check_end_order(const char *text, int start, int end, void *pattern_data,
+			   int *last_end)
+{
+	g_assert_cmpint(end, >=, *last_end);
+	*last_end = end;
+	return TRUE;
+}
+
+static int hit_stop(const char *text, int start, int end, void *pattern_data,
+		    int *count)
+{
+	(*count)++;
+	return FALSE;
+}
+
+static char *hits_sort(const char *hits)
+{
+	char **list, *ret;
+
+	list = g_strsplit(hits, " ", -1);
+	if (*list != NULL)
+		qsort(list, g_strv_length(list), sizeof(char *),
+		      (int (*)(const void *, const void *)) hit_cmp);
+	ret = g_strjoinv(" ", list);
+	g_strfreev(list);
+	return ret;
+}
+
+/* every occurrence found by comparing each string at each position */
+static char *find_linear(const textmatch_test_case *test)
+{
+	GString *hits;
+	int pos, n, len;
+
+	hits = g_string_new(NULL);
+	for (pos = 0; test->text[pos] != '\0'; pos++) {
+		for (n = 0; n < G_N_ELEMENTS(test->patterns) &&
+			    test->patterns[n] != NULL; n++) {
+			len = strlen(test->patterns[n]);
+			if (len == 0 || pos + 1 < len)
+				continue;
+
+			if (test->icase ?
+			    g_ascii_strncasecmp(test->text + pos + 1 - len,
+						test->patterns[n], len) == 0 :
+			    strncmp(test->text + pos + 1 - len,
+				    test->patterns[n], len) == 0)
+				hit_add(test->text, pos + 1 - len, pos + 1,
+					GINT_TO_POINTER(n), hits);
+		}
+	}
+	if (hits->len > 0)
+		g_string_truncate(hits, hits->len - 1);
+	return g_string_free(hits, FALSE);
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	g_test_init(&argc, &argv, NULL);
+
+	for (i = 0; i < G_N_ELEMENTS(textmatch_fixtures); i++) {
+		char *name = g_strdup_printf("/test/textmatch/%d", i);
+		g_test_add_data_func(name, &textmatch_fixtures[i], (GTestDataFunc)test_textmatch);
+		g_free(name);
+	}
+
+#if GLIB_CHECK_VERSION(2,38,0)
+	g_test_set_nonfatal_assertions();
+#endif
+	return g_test_run();
+}
+
+static void test_textmatch(const textmatch_test_case *test)
+{
+	TEXTMATCH_REC *rec;
+	GString *hits;
+	char *found, *linear, *expected;
+	int n, count, last_end;
+
+	g_test_message("Testing %s", test->description);
+
+	rec = textmatch_create(test->icase);
+	count = 0;
+	for (n = 0; n < G_N_ELEMENTS(test->patterns) && test->patterns[n] != NULL; n++) {
+		textmatch_add(rec, test->patterns[n], GINT_TO_POINTER(n));
+		if (*test->patterns[n] != '\0')
+			count++;
+	}
+	g_assert_cmpint(textmatch_count(rec), ==, count);
+
+	hits = g_string_new(NULL);
+	textmatch_search(rec, test->text, (TEXTMATCH_FUNC) hit_add, hits);
+	if (hits->len > 0)
+		g_string_truncate(hits, hits->len - 1);
+
+	last_end = 0;
+	textmatch_search(rec, test->text, (TEXTMATCH_FUNC) check_end_order, &last_end);
+
+	found = hits_sort(hits->str);
+	linear = find_linear(test);
+	expected = hits_sort(linear);
+	g_assert_cmpstr(found, ==, expected);
+
+	/* returning FALSE stops the search */
+	count = 0;
+	textmatch_search(rec, test->text, (TEXTMATCH_FUNC) hit_stop, &count);
+	g_assert_cmpint(count, ==, *linear == '\0' ? 0 : 1);
+
+	/* adding after a search rebuilds the links */
+	textmatch_add(rec, test->text, GINT_TO_POINTER(-1));
+	g_string_truncate(hits, 0);
+	textmatch_search(rec, test->text, (TEXTMATCH_FUNC) hit_add, hits);
+	if (*test->text != '\0') {
+		g_assert_nonnull(strstr(hits->str, ":-1 "));
+	} else {
+		g_assert_cmpstr(hits->str, ==, "");
+	}
+
+	g_free(found);
+	g_free(linear);
+	g_free(expected);
+	g_string_free(hits, TRUE);
+	textmatch_destroy(rec);
+}
@@ -0,0 +1,207 @@
+/*
+ test-timers.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+
+#include <irssi/src/common.h>
+#include <irssi/src/core/timers.h>
+
+/* Deadlines in the tests are this far apart, so the time spent adding the
+   timers doesn't change their order */
+#define TIMER_STEP 20
+
+static GArray *fired;
+
+static void timer_record(void *data)
+{
+	int id = GPOINTER_TO_INT(data);
+
+	g_array_append_val(fired, id);
+}
+
+/* Run the main loop until `count' timers have fired */
+static void timers_run(int count)
+{
+	gint64 end;
+
+	end = g_get_monotonic_time() + 5 * G_TIME_SPAN_SECOND;
+	while (fired->len < count && g_get_monotonic_time() < end)
+		g_main_context_iteration(NULL, TRUE);
+	g_assert_cmpint(fired->len, ==, count);
+}
+
+static void assert_fired(const int *expected, int count)
+{
+	int i;
+
+	g_assert_cmpint(fired->len, ==, count);
+	for (i = 0; i < count; i++)
+		g_assert_cmpint(g_array_index(fired, int, i), ==, expected[i]);
+}
+
+static void setup(void)
+{
+	fired = g_array_new(FALSE, FALSE, sizeof(int));
+	timers_init();
+}
+
+static void teardown(void)
+{
+	timers_deinit();
+	g_array_free(fired, TRUE);
+}
+
+static void test_timers_order(void)
+{
+	static const int steps[] = { 3, 1, 4, 1, 5, 0, 2, 6, 0, 3 };
+	static const int expected[] = { 5, 8, 1, 3, 6, 0, 9, 2, 4, 7 };
+	int i;
+
+	setup();
+	for (i = 0; i < G_N_ELEMENTS(steps); i++)
+		timer_add(steps[i] * TIMER_STEP, timer_record, GINT_TO_POINTER(i));
+
+	timers_run(G_N_ELEMENTS(expected));
+	assert_fired(expected, G_N_ELEMENTS(expected));
+	teardown();
+}
+
+static void test_timers_equal_deadlines(void)
+{
+	int i, expected[64];
+
+	setup();
+
+	/* aligned to the same second, or the next one if it changed
+	   in between */
+	for (i = 0; i < G_N_ELEMENTS(expected); i++) {
+		timer_add_seconds(1, timer_record, GINT_TO_POINTER(i));
+		expected[i] = i;
+	}
+
+	timers_run(G_N_ELEMENTS(expected));
+	assert_fired(expected, G_N_ELEMENTS(expected));
+
+	/* due at once */
+	g_array_set_size(fired, 0);
+	for (i = 0; i < G_N_ELEMENTS(expected); i++)
+		timer_add(0, timer_record, GINT_TO_POINTER(i));
+
+	timers_run(G_N_ELEMENTS(expected));
+	assert_fired(expected, G_N_ELEMENTS(expected));
+	teardown();
+}
+
+static void test_timers_remove(void)
+{
+	int tags[60], expected[60];
+	int i, n, step;
+
+	setup();
+
+	for (i = 0; i < G_N_ELEMENTS(tags); i++) {
+		tags[i] = timer_add((i * 7 % 5) * TIMER_STEP, timer_record,
+				    GINT_TO_POINTER(i));
+		g_assert_cmpint(tags[i], !=, 0);
+	}
+
+	/* from the middle of the heap, not only the root or the last one */
+	for (i = 1; i < G_N_ELEMENTS(tags); i += 3)
+		timer_remove(tags[i]);
+	timer_remove(tags[G_N_ELEMENTS(tags) - 1]);
+
+	/* removed or unknown tags are ignored */
+	timer_remove(tags[1]);
+	timer_remove(0);
+
+	n = 0;
+	for (step = 0; step < 5; step++) {
+		for (i = 0; i < G_N_ELEMENTS(tags) - 1; i++) {
+			if (i % 3 != 1 && i * 7 % 5 == step)
+				expected[n++] = i;
+		}
+	}
+
+	timers_run(n);
+	assert_fired(expected, n);
+	teardown();
+}
+
+static int rearm_count;
+static int rearm_tag;
+
+static void timer_rearm(void *data)
+{
+	rearm_count++;
+	timer_record(data);
+
+	/* removing the timer that is running does nothing */
+	timer_remove(rearm_tag);
+
+	if (rearm_count < 5)
+		rearm_tag = timer_add(0, timer_rearm, data);
+}
+
+static void timer_remove_other(void *data)
+{
+	int *tag = data;
+
+	timer_remove(*tag);
+	timer_record(GINT_TO_POINTER(-1));
+}
+
+static void test_timers_rearm(void)
+{
+	static const int expected[] = { 0, 0, -1, 0, 0, 0, 2 };
+	int tag;
+
+	setup();
+	rearm_count = 0;
+	rearm_tag = timer_add(0, timer_rearm, GINT_TO_POINTER(0));
+
+	/* a timer added from a callback doesn't run in the same dispatch,
+	   even when it's already due */
+	while (rearm_count == 0)
+		g_main_context_iteration(NULL, TRUE);
+	g_assert_cmpint(rearm_count, ==, 1);
+
+	/* removed from a callback before it was due */
+	timer_add(0, timer_remove_other, &tag);
+	tag = timer_add(TIMER_STEP, timer_record, GINT_TO_POINTER(1));
+	timer_add(2 * TIMER_STEP, timer_record, GINT_TO_POINTER(2));
+
+	timers_run(G_N_ELEMENTS(expected));
+	assert_fired(expected, G_N_ELEMENTS(expected));
+	g_assert_cmpint(rearm_count, ==, 5);
+	teardown();
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/test/timers/order", test_timers_order);
+	g_test_add_func("/test/timers/equal_deadlines", test_timers_equal_deadlines);
+	g_test_add_func("/test/timers/remove", test_timers_remove);
+	g_test_add_func("/test/timers/rearm", test_timers_rearm);
+
+	return g_test_run();
+}
@@ -0,0 +1,224 @@
+/*
+ test-textbuffer-heights.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+
+#include <irssi/src/common.h>
+#include <irssi/src/fe-ansi/textbuffer-heights.h>
+
+/* The lines in order and their heights, counted again from the start for
+   every check */
+typedef struct {
+	GPtrArray *lines;
+	GArray *heights;
+} HEIGHTS_MODEL;
+
+#define model_line(model, i) ((LINE_REC *) g_ptr_array_index((model)->lines, i))
+#define model_height(model, i) g_array_index((model)->heights, int, i)
+#define model_rows(height) ((height) == LINE_HEIGHT_UNKNOWN ? 1 : (height))
+
+static int random_height(GRand *rand)
+{
+	int height = g_rand_int_range(rand, -1, 6);
+
+	return height < 0 ? LINE_HEIGHT_UNKNOWN : height;
+}
+
+static void model_insert(HEIGHTS_MODEL *model, TEXT_BUFFER_HEIGHTS_REC *heights,
+			 int pos, int height)
+{
+	LINE_REC *line;
+
+	line = g_new0(LINE_REC, 1);
+	textbuffer_heights_insert(heights, pos == 0 ? NULL : model_line(model, pos - 1),
+				  line, height);
+	g_ptr_array_insert(model->lines, pos, line);
+	g_array_insert_val(model->heights, pos, height);
+}
+
+static void model_remove(HEIGHTS_MODEL *model, TEXT_BUFFER_HEIGHTS_REC *heights, int pos)
+{
+	LINE_REC *line;
+
+	line = model_line(model, pos);
+	textbuffer_heights_remove(heights, line);
+	g_assert_false(textbuffer_heights_contains(heights, line));
+
+	g_ptr_array_remove_index(model->lines, pos);
+	g_array_remove_index(model->heights, pos);
+	g_free(line);
+}
+
+static void model_check(HEIGHTS_MODEL *model, TEXT_BUFFER_HEIGHTS_REC *heights)
+{
+	LINE_REC *line, *next_unknown;
+	int i, j, rows, unknown, total_rows, total_unknown, subline, found_unknown;
+
+	total_rows = total_unknown = 0;
+	for (i = 0; i < model->lines->len; i++) {
+		total_rows += model_rows(model_height(model, i));
+		total_unknown += model_height(model, i) == LINE_HEIGHT_UNKNOWN;
+	}
+
+	rows = unknown = 0;
+	next_unknown = NULL;
+	for (i = 0; i < model->lines->len; i++) {
+		line = model_line(model, i);
+
+		g_assert_true(textbuffer_heights_contains(heights, line));
+		g_assert_cmpint(textbuffer_heights_get(heights, line), ==, model_height(model, i));
+		g_assert_cmpint(textbuffer_heights_position(heights, line), ==, i);
+
+		g_assert_cmpint(textbuffer_heights_rows_before(heights, line, &found_unknown), ==, rows);
+		g_assert_cmpint(found_unknown, ==, unknown);
+		g_assert_cmpint(textbuffer_heights_rows_after(heights, line, &found_unknown), ==,
+				total_rows - rows);
+		g_assert_cmpint(found_unknown, ==, total_unknown - unknown);
+
+		/* every row of the line maps back to it */
+		for (j = 0; j < model_rows(model_height(model, i)); j++) {
+			subline = -1;
+			g_assert_true(textbuffer_heights_find_row(heights, rows + j, &subline) == line);
+			g_assert_cmpint(subline, ==, j);
+		}
+
+		rows += model_rows(model_height(model, i));
+		unknown += model_height(model, i) == LINE_HEIGHT_UNKNOWN;
+	}
+	g_assert_null(textbuffer_heights_find_row(heights, total_rows, &subline));
+	g_assert_null(textbuffer_heights_find_row(heights, -1, &subline));
+
+	/* first unknown height at or after each line */
+	for (i = model->lines->len - 1; i >= 0; i--) {
+		line = model_line(model, i);
+		if (model_height(model, i) == LINE_HEIGHT_UNKNOWN)
+			next_unknown = line;
+		g_assert_true(textbuffer_heights_next_unknown(heights, line) == next_unknown);
+	}
+}
+
+static int line_height_double(LINE_REC *line, HEIGHTS_MODEL *model)
+{
+	int i;
+
+	for (i = 0; i < model->lines->len; i++) {
+		if (model_line(model, i) == line)
+			break;
+	}
+	g_assert_cmpint(i, <, model->lines->len);
+
+	if (model_height(model, i) == LINE_HEIGHT_UNKNOWN)
+		model_height(model, i) = 1;
+	else if (model_height(model, i) % 2 == 1)
+		model_height(model, i) = LINE_HEIGHT_UNKNOWN;
+	else
+		model_height(model, i) *= 2;
+	return model_height(model, i);
+}
+
+static void test_heights_random(void)
+{
+	TEXT_BUFFER_HEIGHTS_REC *heights;
+	HEIGHTS_MODEL model;
+	GRand *rand;
+	int i, op, pos;
+
+	rand = g_rand_new_with_seed(1);
+	g_random_set_seed(2);
+	heights = textbuffer_heights_create();
+	model.lines = g_ptr_array_new();
+	model.heights = g_array_new(FALSE, FALSE, sizeof(int));
+
+	for (i = 0; i < 2000; i++) {
+		op = g_rand_int_range(rand, 0, 10);
+		if (model.lines->len == 0 || op < 5) {
+			pos = g_rand_int_range(rand, 0, model.lines->len + 1);
+			model_insert(&model, heights, pos, random_height(rand));
+		} else if (op < 8) {
+			pos = g_rand_int_range(rand, 0, model.lines->len);
+			model_remove(&model, heights, pos);
+		} else {
+			pos = g_rand_int_range(rand, 0, model.lines->len);
+			model_height(&model, pos) = random_height(rand);
+			textbuffer_heights_set(heights, model_line(&model, pos),
+					       model_height(&model, pos));
+		}
+
+		if (i % 50 == 0 || i > 1950)
+			model_check(&model, heights);
+	}
+
+	textbuffer_heights_reset(heights, (LINE_HEIGHT_FUNC) line_height_double, &model);
+	model_check(&model, heights);
+
+	/* from the start and the end, like scrollback */
+	while (model.lines->len > 0) {
+		model_remove(&model, heights, model.lines->len % 2 == 0 ?
+			     0 : model.lines->len - 1);
+		if (model.lines->len % 25 == 0)
+			model_check(&model, heights);
+	}
+	g_assert_null(textbuffer_heights_find_row(heights, 0, &pos));
+
+	textbuffer_heights_destroy(heights);
+	g_ptr_array_free(model.lines, TRUE);
+	g_array_free(model.heights, TRUE);
+	g_rand_free(rand);
+}
+
+static void test_heights_clear(void)
+{
+	TEXT_BUFFER_HEIGHTS_REC *heights;
+	HEIGHTS_MODEL model;
+	int i;
+
+	heights = textbuffer_heights_create();
+	model.lines = g_ptr_array_new_with_free_func(g_free);
+	model.heights = g_array_new(FALSE, FALSE, sizeof(int));
+
+	for (i = 0; i < 100; i++)
+		model_insert(&model, heights, i, i % 3 == 0 ? LINE_HEIGHT_UNKNOWN : i % 4);
+	model_check(&model, heights);
+
+	textbuffer_heights_clear(heights);
+	for (i = 0; i < model.lines->len; i++)
+		g_assert_false(textbuffer_heights_contains(heights, model_line(&model, i)));
+	g_assert_null(textbuffer_heights_find_row(heights, 0, &i));
+
+	/* setting the height of a line that isn't indexed is ignored */
+	textbuffer_heights_set(heights, model_line(&model, 0), 3);
+	g_assert_cmpint(textbuffer_heights_get(heights, model_line(&model, 0)), ==,
+			LINE_HEIGHT_UNKNOWN);
+
+	textbuffer_heights_destroy(heights);
+	g_ptr_array_free(model.lines, TRUE);
+	g_array_free(model.heights, TRUE);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/test/textbuffer_heights/random", test_heights_random);
+	g_test_add_func("/test/textbuffer_heights/clear", test_heights_clear);
+
+	return g_test_run();
+}
@@ -0,0 +1,334 @@
+/*
+ test-hilight.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+#include <string.h>
+
+#include <irssi/src/common.h>
+#include <irssi/src/core/commands.h>
+#include <irssi/src/core/core.h>
+#include <irssi/src/core/levels.h>
+#include <irssi/src/core/misc.h>
+#include <irssi/src/core/modules.h>
+#include <irssi/src/core/nickmatch-cache.h>
+#include <irssi/src/core/settings.h>
+#include <irssi/src/core/signals.h>
+#include <irssi/src/fe-common/core/hilight-text.h>
+
+#define HILIGHT_CASE_SENSITIVE 0x01
+#define HILIGHT_FULLWORD 0x02
+#define HILIGHT_REGEXP 0x04
+
+typedef struct {
+	const char *text;
+	int flags;
+	int priority;
+	const char *channel;
+} hilight_spec;
+
+typedef struct {
+	char const *const description;
+	hilight_spec const hilights[8];
+	char const *const input;
+	int const result; /* index of the hilight, -1 if none */
+	int const match_beg, match_end;
+} hilight_match_test_case;
+
+hilight_match_test_case const hilight_match_fixtures[] = {
+	{
+		.description = "No hilights match",
+		.hilights    = { { "foo" }, { "b.r", HILIGHT_REGEXP } },
+		.input       = "nothing here",
+		.result      = -1,
+	},
+	{
+		.description = "Case insensitive by default",
+		.hilights    = { { "Foo" } },
+		.input       = "a FOO b",
+		.result      = 0, .match_beg = 2, .match_end = 5,
+	},
+	{
+		.description = "Case sensitive",
+		.hilights    = { { "Foo", HILIGHT_CASE_SENSITIVE } },
+		.input       = "foo FOO Foo",
+		.result      = 0, .match_beg = 8, .match_end = 11,
+	},
+	{
+		.description = "Case sensitive, no hit",
+		.hilights    = { { "Foo", HILIGHT_CASE_SENSITIVE } },
+		.input       = "foo FOO",
+		.result      = -1,
+	},
+	{
+		.description = "Full word after a partial hit",
+		.hilights    = { { "foo", HILIGHT_FULLWORD } },
+		.input       = "foobar xfoo (foo)",
+		.result      = 0, .match_beg = 13, .match_end = 16,
+	},
+	{
+		.description = "Full word at the ends",
+		.hilights    = { { "foo", HILIGHT_FULLWORD } },
+		.input       = "foo",
+		.result      = 0, .match_beg = 0, .match_end = 3,
+	},
+	{
+		.description = "Full word, no hit",
+		.hilights    = { { "foo", HILIGHT_FULLWORD } },
+		.input       = "foobar barfoo",
+		.result      = -1,
+	},
+	{
+		.description = "Full word and case sensitive",
+		.hilights    = { { "Foo", HILIGHT_FULLWORD | HILIGHT_CASE_SENSITIVE } },
+		.input       = "Foox foo Foo",
+		.result      = 0, .match_beg = 9, .match_end = 12,
+	},
+	{
+		.description = "Equal priority, first in list wins",
+		.hilights    = { { "bar" }, { "foo" } },
+		.input       = "foo bar",
+		.result      = 0, .match_beg = 4, .match_end = 7,
+	},
+	{
+		.description = "Higher priority wins",
+		.hilights    = { { "bar" }, { "foo", 0, 5 }, { "oo", 0, 5 } },
+		.input       = "foo bar",
+		.result      = 1, .match_beg = 0, .match_end = 3,
+	},
+	{
+		.description = "Negative priority never wins",
+		.hilights    = { { "foo", 0, -1 } },
+		.input       = "foo",
+		.result      = -1,
+	},
+	{
+		.description = "Channel filter",
+		.hilights    = { { "foo", 0, 5, "#other" }, { "foo", 0, 0, "#test" } },
+		.input       = "foo",
+		.result      = 1, .match_beg = 0, .match_end = 3,
+	},
+	{
+		.description = "Shared suffix",
+		.hilights    = { { "nick" }, { "ick", 0, 1 } },
+		.input       = "nick",
+		.result      = 1, .match_beg = 1, .match_end = 4,
+	},
+	{
+		.description = "Single regexp",
+		.hilights    = { { "fo+b", HILIGHT_REGEXP } },
+		.input       = "a fooob",
+		.result      = 0, .match_beg = 2, .match_end = 7,
+	},
+	{
+		.description = "Batched regexps",
+		.hilights    = { { "x+y", HILIGHT_REGEXP }, { "f(o)+", HILIGHT_REGEXP },
+				 { "^b", HILIGHT_REGEXP } },
+		.input       = "bar foo",
+		.result      = 1, .match_beg = 4, .match_end = 7,
+	},
+	{
+		.description = "Batched regexp anchors",
+		.hilights    = { { "a$", HILIGHT_REGEXP }, { "^b", HILIGHT_REGEXP } },
+		.input       = "ab",
+		.result      = -1,
+	},
+	{
+		.description = "Backreference is not batched",
+		.hilights    = { { "x+y", HILIGHT_REGEXP }, { "(o)\\1", HILIGHT_REGEXP },
+				 { "z", HILIGHT_REGEXP } },
+		.input       = "foo",
+		.result      = 1, .match_beg = 1, .match_end = 3,
+	},
+	{
+		.description = "Named group is not batched",
+		.hilights    = { { "(?P<c>o)(?P=c)", HILIGHT_REGEXP }, { "q", HILIGHT_REGEXP } },
+		.input       = "foo",
+		.result      = 0, .match_beg = 1, .match_end = 3,
+	},
+	{
+		.description = "Text and regexp, first in list wins",
+		.hilights    = { { "o+", HILIGHT_REGEXP }, { "foo" } },
+		.input       = "foo",
+		.result      = 0, .match_beg = 1, .match_end = 3,
+	},
+	{
+		.description = "Invalid regexp",
+		.hilights    = { { "(", HILIGHT_REGEXP }, { "a(", HILIGHT_REGEXP }, { "a" } },
+		.input       = "a(",
+		.result      = 2, .match_beg = 0, .match_end = 1,
+	},
+	{
+		.description = "Empty text",
+		.hilights    = { { "foo" }, { "^$", HILIGHT_REGEXP } },
+		.input       = "",
+		.result      = 1, .match_beg = 0, .match_end = 0,
+	},
+};
+
+static void test_hilight_match(const hilight_match_test_case *test);
+
+static void hilights_clear(void)
+{
+	while (hilights != NULL)
+		hilight_remove(hilights->data);
+}
+
+static HILIGHT_REC *hilight_add(const hilight_spec *spec)
+{
+	HILIGHT_REC *rec;
+
+	rec = g_new0(HILIGHT_REC, 1);
+	rec->text = g_strdup(spec->text);
+	rec->priority = spec->priority;
+	rec->case_sensitive = (spec->flags & HILIGHT_CASE_SENSITIVE) != 0;
+	rec->fullword = (spec->flags & HILIGHT_FULLWORD) != 0;
+	rec->regexp = (spec->flags & HILIGHT_REGEXP) != 0;
+	if (spec->channel != NULL)
+		rec->channels = g_strsplit(spec->channel, " ", -1);
+	hilight_create(rec);
+	return rec;
+}
+
+/* hilight_match() as it was before the hilights were searched at once:
+   try every hilight in list order */
+static HILIGHT_REC *hilight_match_linear(const char *channel, const char *str,
+					 int *match_beg, int *match_end)
+{
+	HILIGHT_REC *best;
+	GSList *tmp;
+	int priority;
+
+	best = NULL;
+	priority = -1;
+	for (tmp = hilights; tmp != NULL; tmp = tmp->next) {
+		HILIGHT_REC *rec = tmp->data;
+		const char *match;
+		MatchInfo *info;
+
+		if (rec->priority <= priority ||
+		    (rec->channels != NULL && strarray_find(rec->channels, channel) == -1))
+			continue;
+
+		if (rec->regexp) {
+			if (rec->preg == NULL)
+				continue;
+			i_regex_match(rec->preg, str, 0, &info);
+			if (i_match_info_matches(info) &&
+			    i_match_info_fetch_pos(info, 0, match_beg, match_end)) {
+				best = rec;
+				priority = rec->priority;
+			}
+			i_match_info_free(info);
+			continue;
+		}
+
+		if (rec->case_sensitive) {
+			match = rec->fullword ? strstr_full(str, rec->text) :
+				strstr(str, rec->text);
+		} else {
+			match = rec->fullword ? stristr_full(str, rec->text) :
+				stristr(str, rec->text);
+		}
+		if (match != NULL) {
+			*match_beg = match - str;
+			*match_end = *match_beg + strlen(rec->text);
+			best = rec;
+			priority = rec->priority;
+		}
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	int i, res;
+
+	g_test_init(&argc, &argv, NULL);
+
+	core_preinit(*argv);
+	irssi_gui = IRSSI_GUI_NONE;
+
+	modules_init();
+	signals_init();
+	settings_init();
+	commands_init();
+	nickmatch_cache_init();
+	hilight_text_init();
+
+	for (i = 0; i < G_N_ELEMENTS(hilight_match_fixtures); i++) {
+		char *name = g_strdup_printf("/test/hilight_match/%d", i);
+		g_test_add_data_func(name, &hilight_match_fixtures[i],
+				     (GTestDataFunc)test_hilight_match);
+		g_free(name);
+	}
+
+#if GLIB_CHECK_VERSION(2,38,0)
+	g_test_set_nonfatal_assertions();
+#endif
+	res = g_test_run();
+
+	hilight_text_deinit();
+	nickmatch_cache_deinit();
+	commands_deinit();
+	settings_deinit();
+	signals_deinit();
+	modules_deinit();
+
+	return res;
+}
+
+static void test_hilight_match(const hilight_match_test_case *test)
+{
+	HILIGHT_REC *recs[G_N_ELEMENTS(test->hilights)];
+	HILIGHT_REC *rec, *linear;
+	int i, count, beg, end, linear_beg, linear_end;
+
+	g_test_message("Testing %s", test->description);
+
+	count = 0;
+	for (i = 0; i < G_N_ELEMENTS(test->hilights) && test->hilights[i].text != NULL; i++)
+		recs[count++] = hilight_add(&test->hilights[i]);
+
+	beg = end = -1;
+	rec = hilight_match(NULL, "#test", NULL, NULL, MSGLEVEL_PUBLIC,
+			    test->input, &beg, &end);
+	if (test->result == -1) {
+		g_assert_null(rec);
+	} else {
+		g_assert_true(rec == recs[test->result]);
+		g_assert_cmpint(beg, ==, test->match_beg);
+		g_assert_cmpint(end, ==, test->match_end);
+	}
+
+	linear_beg = linear_end = -1;
+	linear = hilight_match_linear("#test", test->input, &linear_beg, &linear_end);
+	g_assert_true(rec == linear);
+	if (rec != NULL) {
+		g_assert_cmpint(beg, ==, linear_beg);
+		g_assert_cmpint(end, ==, linear_end);
+	}
+
+	/* levels not in hilight_level are never hilighted */
+	g_assert_null(hilight_match(NULL, "#test", NULL, NULL, MSGLEVEL_CRAP,
+				    test->input, NULL, NULL));
+
+	hilights_clear();
+}
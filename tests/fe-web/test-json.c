@@ -0,0 +1,293 @@
+/*
+ test-json.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+#include <string.h>
+
+#include <irssi/src/fe-web/fe-web.h>
+
+/* Same as WEB_JSON_MAX_DEPTH in fe-web-json.c */
+#define JSON_MAX_DEPTH 32
+
+static WEB_JSON_REC *parse(const char *json)
+{
+	return fe_web_json_parse(json, strlen(json));
+}
+
+static void assert_invalid(const char *json)
+{
+	WEB_JSON_REC *value;
+
+	g_test_message("invalid: %s", json);
+	value = parse(json);
+	g_assert_null(value);
+}
+
+/* Parse a JSON string and check its unescaped value */
+static void assert_string(const char *json, const char *expected)
+{
+	WEB_JSON_REC *value;
+
+	g_test_message("string: %s", json);
+	value = parse(json);
+	g_assert_nonnull(value);
+	g_assert_cmpint(value->type, ==, WEB_JSON_STRING);
+	g_assert_cmpstr(value->str, ==, expected);
+	fe_web_json_free(value);
+}
+
+static void test_json_values(void)
+{
+	WEB_JSON_REC *value, *item;
+
+	value = parse(" {\"a\": [1, -2.5e+3, true, false, null, \"x\", {}, []],\n"
+		      "\t\"b\": {\"c\": \"d\"}, \"a\": 0 }\r\n");
+	g_assert_nonnull(value);
+	g_assert_cmpint(value->type, ==, WEB_JSON_OBJECT);
+
+	/* duplicate keys: the last one wins */
+	item = fe_web_json_get(value, "a");
+	g_assert_nonnull(item);
+	g_assert_cmpint(item->type, ==, WEB_JSON_NUMBER);
+	g_assert_cmpstr(item->str, ==, "0");
+
+	item = fe_web_json_get(fe_web_json_get(value, "b"), "c");
+	g_assert_nonnull(item);
+	g_assert_cmpstr(item->str, ==, "d");
+	g_assert_null(fe_web_json_get(value, "c"));
+	fe_web_json_free(value);
+
+	value = parse("[1, -2.5e+3, true, false, null, \"x\", {}, []]");
+	g_assert_nonnull(value);
+	g_assert_cmpint(value->type, ==, WEB_JSON_ARRAY);
+	g_assert_cmpint(value->items->len, ==, 8);
+	item = g_ptr_array_index(value->items, 1);
+	g_assert_cmpint(item->type, ==, WEB_JSON_NUMBER);
+	g_assert_cmpstr(item->str, ==, "-2.5e+3");
+	g_assert_cmpint(((WEB_JSON_REC *) g_ptr_array_index(value->items, 2))->type, ==,
+			WEB_JSON_TRUE);
+	g_assert_cmpint(((WEB_JSON_REC *) g_ptr_array_index(value->items, 4))->type, ==,
+			WEB_JSON_NULL);
+	g_assert_cmpint(((WEB_JSON_REC *) g_ptr_array_index(value->items, 6))->type, ==,
+			WEB_JSON_OBJECT);
+	fe_web_json_free(value);
+
+	/* numbers */
+	value = parse("-0");
+	g_assert_nonnull(value);
+	g_assert_cmpstr(value->str, ==, "-0");
+	fe_web_json_free(value);
+
+	assert_invalid("01");
+	assert_invalid("+1");
+	assert_invalid(".5");
+	assert_invalid("1.");
+	assert_invalid("1e");
+	assert_invalid("-");
+	assert_invalid("tru");
+	assert_invalid("nul");
+	assert_invalid("");
+	assert_invalid("   ");
+	g_assert_null(fe_web_json_parse(NULL, 0));
+}
+
+static void test_json_escapes(void)
+{
+	assert_string("\"plain\"", "plain");
+	assert_string("\"\"", "");
+	assert_string("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"", "\"\\/\b\f\n\r\t");
+	assert_string("\"\\u0041\\u00e9\\u20AC\"", "A\xc3\xa9\xe2\x82\xac");
+	assert_string("\"caf\xc3\xa9\"", "caf\xc3\xa9");
+
+	/* surrogate pairs */
+	assert_string("\"\\ud83d\\ude00\"", "\xf0\x9f\x98\x80");
+	assert_string("\"\\uD834\\uDD1E!\"", "\xf0\x9d\x84\x9e!");
+
+	/* lone surrogates and NUL become U+FFFD */
+	assert_string("\"\\ud83d\"", "\xef\xbf\xbd");
+	assert_string("\"\\ud83dx\"", "\xef\xbf\xbdx");
+	assert_string("\"\\ud83d\\u0041\"", "\xef\xbf\xbd" "A");
+	assert_string("\"\\ud83d\\ud83d\\ude00\"", "\xef\xbf\xbd\xf0\x9f\x98\x80");
+	assert_string("\"\\ude00\"", "\xef\xbf\xbd");
+	assert_string("\"a\\u0000b\"", "a\xef\xbf\xbd" "b");
+
+	assert_invalid("\"\\x\"");
+	assert_invalid("\"\\u12g4\"");
+	assert_invalid("\"\\u12\"");
+	assert_invalid("\"\\ud83d\\u\"");
+	assert_invalid("\"tab\there\"");
+	assert_invalid("\"line\nbreak\"");
+	assert_invalid("{\"a\\q\": 1}");
+}
+
+static void test_json_nesting(void)
+{
+	WEB_JSON_REC *value;
+	GString *json;
+	int i;
+
+	/* arrays */
+	json = g_string_new(NULL);
+	for (i = 0; i < JSON_MAX_DEPTH; i++)
+		g_string_append_c(json, '[');
+	for (i = 0; i < JSON_MAX_DEPTH; i++)
+		g_string_append_c(json, ']');
+	value = fe_web_json_parse(json->str, json->len);
+	g_assert_nonnull(value);
+	fe_web_json_free(value);
+
+	g_string_prepend_c(json, '[');
+	g_string_append_c(json, ']');
+	g_assert_null(fe_web_json_parse(json->str, json->len));
+
+	/* objects and arrays mixed */
+	g_string_truncate(json, 0);
+	for (i = 0; i < JSON_MAX_DEPTH; i++)
+		g_string_append(json, i % 2 == 0 ? "{\"a\":" : "[");
+	g_string_append(json, "1");
+	for (i = JSON_MAX_DEPTH - 1; i >= 0; i--)
+		g_string_append(json, i % 2 == 0 ? "}" : "]");
+	value = fe_web_json_parse(json->str, json->len);
+	g_assert_nonnull(value);
+	fe_web_json_free(value);
+
+	g_string_prepend(json, "[");
+	g_string_append(json, "]");
+	g_assert_null(fe_web_json_parse(json->str, json->len));
+
+	/* depth is counted per path, not for all containers */
+	g_string_truncate(json, 0);
+	g_string_append_c(json, '[');
+	for (i = 0; i < 1000; i++)
+		g_string_append(json, i == 0 ? "[]" : ",[]");
+	g_string_append_c(json, ']');
+	value = fe_web_json_parse(json->str, json->len);
+	g_assert_nonnull(value);
+	g_assert_cmpint(value->items->len, ==, 1000);
+	fe_web_json_free(value);
+
+	/* far too deep */
+	g_string_truncate(json, 0);
+	for (i = 0; i < 100000; i++)
+		g_string_append_c(json, '[');
+	g_assert_null(fe_web_json_parse(json->str, json->len));
+
+	g_string_free(json, TRUE);
+}
+
+static void test_json_truncated(void)
+{
+	static const char json[] =
+		"{\"type\":\"message\",\"text\":\"a\\u00e9\\ud83d\\ude00\\n\","
+		"\"list\":[1,-2.5e-3,true,false,null,{\"k\":[]}]}";
+	WEB_JSON_REC *value;
+	char *copy;
+	gsize len, i;
+
+	len = strlen(json);
+	value = fe_web_json_parse(json, len);
+	g_assert_nonnull(value);
+	fe_web_json_free(value);
+
+	/* every prefix of an object is invalid, the length is used instead
+	   of a NUL */
+	for (i = 0; i < len; i++) {
+		copy = g_malloc(i + 1);
+		memcpy(copy, json, i);
+		value = fe_web_json_parse(copy, i);
+		g_assert_null(value);
+		g_free(copy);
+	}
+}
+
+static void test_json_trailing(void)
+{
+	WEB_JSON_REC *value;
+
+	value = parse("{} \r\n\t");
+	g_assert_nonnull(value);
+	fe_web_json_free(value);
+
+	assert_invalid("{} x");
+	assert_invalid("{}}");
+	assert_invalid("[1]]");
+	assert_invalid("[1,]");
+	assert_invalid("[,1]");
+	assert_invalid("{\"a\":1,}");
+	assert_invalid("{\"a\" 1}");
+	assert_invalid("{a:1}");
+	assert_invalid("1 2");
+	assert_invalid("\"a\"\"b\"");
+	assert_invalid("truex");
+	assert_invalid("null,");
+
+	/* a NUL inside the given length isn't the end */
+	g_assert_null(fe_web_json_parse("{}\0", 3));
+	g_assert_null(fe_web_json_parse("\"a\0b\"", 5));
+}
+
+static void test_json_getters(void)
+{
+	WEB_JSON_REC *value;
+	char *str;
+
+	value = parse("{\"s\":\"str\",\"n\":42,\"neg\":-5,\"big\":99999999999,"
+		      "\"t\":true,\"f\":false,\"z\":null,\"u\":18446744073709551615}");
+	g_assert_nonnull(value);
+
+	str = fe_web_json_get_string(value, "s");
+	g_assert_cmpstr(str, ==, "str");
+	g_free(str);
+	g_assert_null(fe_web_json_get_string(value, "n"));
+	g_assert_null(fe_web_json_get_string(value, "missing"));
+
+	g_assert_cmpint(fe_web_json_get_int(value, "n", -1), ==, 42);
+	g_assert_cmpint(fe_web_json_get_int(value, "neg", -1), ==, -5);
+	g_assert_cmpint(fe_web_json_get_int(value, "big", -1), ==, G_MAXINT);
+	g_assert_cmpint(fe_web_json_get_int(value, "t", -1), ==, 1);
+	g_assert_cmpint(fe_web_json_get_int(value, "f", -1), ==, 0);
+	g_assert_cmpint(fe_web_json_get_int(value, "z", -1), ==, -1);
+	g_assert_cmpint(fe_web_json_get_int(value, "s", -1), ==, -1);
+
+	g_assert_true(fe_web_json_get_uint64(value, "big", 0) == G_GUINT64_CONSTANT(99999999999));
+	g_assert_true(fe_web_json_get_uint64(value, "u", 0) == G_MAXUINT64);
+	g_assert_true(fe_web_json_get_uint64(value, "neg", 7) == 7);
+
+	g_assert_true(fe_web_json_has_key(value, "z"));
+	g_assert_false(fe_web_json_has_key(value, "missing"));
+	g_assert_null(fe_web_json_get(fe_web_json_get(value, "s"), "s"));
+
+	fe_web_json_free(value);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/fe-web/json/values", test_json_values);
+	g_test_add_func("/fe-web/json/escapes", test_json_escapes);
+	g_test_add_func("/fe-web/json/nesting", test_json_nesting);
+	g_test_add_func("/fe-web/json/truncated", test_json_truncated);
+	g_test_add_func("/fe-web/json/trailing", test_json_trailing);
+	g_test_add_func("/fe-web/json/getters", test_json_getters);
+
+	return g_test_run();
+}
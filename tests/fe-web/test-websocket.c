@@ -0,0 +1,186 @@
+/*
+ test-websocket.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <irssi/src/fe-web/fe-web.h>
+
+/* Message sizes around the 16 kB output buffer of the converters */
+static const gsize message_sizes[] = {
+	0, 1, 100, 16383, 16384, 16385, 32768, 65536 + 7
+};
+
+static guchar *make_payload(GRand *rand, gsize len)
+{
+	guchar *data;
+	gsize i;
+
+	/* mostly text with some noise, so the compressed size varies */
+	data = g_malloc(len + 1);
+	for (i = 0; i < len; i++) {
+		data[i] = g_rand_int_range(rand, 0, 4) == 0 ?
+			(guchar) g_rand_int_range(rand, 0, 256) :
+			(guchar) ('a' + i % 26);
+	}
+	return data;
+}
+
+static void test_deflate_roundtrip(void)
+{
+	GConverter *deflate, *inflate;
+	GByteArray *compressed, *plain;
+	GRand *rand;
+	guchar *payload;
+	gsize i;
+
+	/* the same converters are used for all messages, like the server
+	   does */
+	deflate = G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW, -1));
+	inflate = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW));
+	rand = g_rand_new_with_seed(7692);
+
+	for (i = 0; i < G_N_ELEMENTS(message_sizes); i++) {
+		payload = make_payload(rand, message_sizes[i]);
+
+		compressed = fe_web_websocket_deflate(deflate, payload, message_sizes[i]);
+		g_assert_nonnull(compressed);
+
+		plain = fe_web_websocket_inflate(inflate, compressed->data, compressed->len);
+		g_assert_nonnull(plain);
+		g_assert_cmpmem(plain->data, plain->len, payload, message_sizes[i]);
+		g_assert_cmpint(plain->data[plain->len], ==, '\0');
+
+		g_byte_array_free(compressed, TRUE);
+		g_byte_array_free(plain, TRUE);
+		g_free(payload);
+	}
+
+	g_rand_free(rand);
+	g_object_unref(deflate);
+	g_object_unref(inflate);
+}
+
+static void test_inflate_corrupted(void)
+{
+	static const guchar garbage[] = { 0xff, 0xff, 0xff, 0xff, 0x00, 0x12 };
+	GConverter *inflate;
+
+	inflate = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW));
+	g_assert_null(fe_web_websocket_inflate(inflate, garbage, sizeof(garbage)));
+	g_object_unref(inflate);
+}
+
+static void test_inflate_truncated(void)
+{
+	GConverter *deflate, *inflate;
+	GByteArray *compressed;
+	GRand *rand;
+	guchar *payload;
+
+	deflate = G_CONVERTER(g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW, -1));
+	inflate = G_CONVERTER(g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_RAW));
+	rand = g_rand_new_with_seed(6455);
+	payload = make_payload(rand, 1000);
+
+	compressed = fe_web_websocket_deflate(deflate, payload, 1000);
+	g_assert_nonnull(compressed);
+	g_assert_null(fe_web_websocket_inflate(inflate, compressed->data, compressed->len - 1));
+
+	/* trailing garbage after the end of the stream */
+	g_byte_array_append(compressed, (const guchar *) "x", 1);
+	g_assert_null(fe_web_websocket_inflate(inflate, compressed->data, compressed->len));
+
+	g_byte_array_free(compressed, TRUE);
+	g_free(payload);
+	g_rand_free(rand);
+	g_object_unref(deflate);
+	g_object_unref(inflate);
+}
+
+static void test_has_protocol(void)
+{
+	g_assert_true(fe_web_websocket_has_protocol("erssi-deflate", "erssi-deflate"));
+	g_assert_true(fe_web_websocket_has_protocol("chat, erssi-deflate ", "erssi-deflate"));
+	g_assert_false(fe_web_websocket_has_protocol("erssi-deflate2, chat", "erssi-deflate"));
+	g_assert_false(fe_web_websocket_has_protocol("", "erssi-deflate"));
+	g_assert_false(fe_web_websocket_has_protocol(NULL, "erssi-deflate"));
+}
+
+static void test_message_fragments(void)
+{
+	GByteArray *payload;
+	guchar *message;
+	const guchar *pos, *data;
+	gsize message_len, len, frames;
+	guint64 data_len;
+	guchar mask_key[4];
+	int fin, opcode, masked;
+
+	payload = g_byte_array_new();
+	for (len = 0; len < 3 * FE_WEB_FRAGMENT_SIZE + 100; len++) {
+		guchar c = len % 251;
+		g_byte_array_append(payload, &c, 1);
+	}
+
+	message = fe_web_websocket_create_message(0x2, payload->data, payload->len,
+	                                          &message_len);
+
+	/* each fragment is a complete frame of its own */
+	frames = 0;
+	for (pos = message; pos < message + message_len; pos += len) {
+		len = fe_web_websocket_frame_len(pos, message + message_len - pos);
+		g_assert_cmpint(len, >, 0);
+		g_assert_cmpint(fe_web_websocket_parse_frame(pos, len, &fin, &opcode, &masked,
+		                                             &data_len, mask_key, &data), ==, 1);
+
+		g_assert_cmpint(opcode, ==, frames == 0 ? 0x2 : 0x0);
+		g_assert_cmpint(fin, ==, pos + len == message + message_len);
+		g_assert_cmpint(masked, ==, 0);
+		g_assert_cmpmem(data, data_len,
+		                payload->data + frames * FE_WEB_FRAGMENT_SIZE,
+		                MIN(FE_WEB_FRAGMENT_SIZE, payload->len - frames * FE_WEB_FRAGMENT_SIZE));
+		frames++;
+	}
+	g_assert_cmpint(frames, ==, 4);
+
+	/* a small message is a single frame */
+	g_free(message);
+	message = fe_web_websocket_create_message(0x1, payload->data, 100, &message_len);
+	g_assert_cmpint(fe_web_websocket_frame_len(message, message_len), ==, message_len);
+	g_assert_cmpint(fe_web_websocket_frame_len(message, message_len - 1), ==, 0);
+
+	g_free(message);
+	g_byte_array_free(payload, TRUE);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/fe-web/websocket/deflate-roundtrip", test_deflate_roundtrip);
+	g_test_add_func("/fe-web/websocket/inflate-corrupted", test_inflate_corrupted);
+	g_test_add_func("/fe-web/websocket/inflate-truncated", test_inflate_truncated);
+	g_test_add_func("/fe-web/websocket/has-protocol", test_has_protocol);
+	g_test_add_func("/fe-web/websocket/message-fragments", test_message_fragments);
+
+	return g_test_run();
+}
@@ -0,0 +1,285 @@
+/*
+ test-ignore.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+#include <string.h>
+
+#include <irssi/src/common.h>
+#include <irssi/src/core/core.h>
+#include <irssi/src/core/ignore.h>
+#include <irssi/src/core/levels.h>
+#include <irssi/src/core/misc.h>
+#include <irssi/src/core/modules.h>
+#include <irssi/src/core/nickmatch-cache.h>
+#include <irssi/src/core/settings.h>
+#include <irssi/src/core/signals.h>
+
+static const char *const masks[] = {
+	"nick",
+	"NIC*",
+	"n?ck",
+	"*ck",
+	"*",
+	"nick!*@*",
+	"Nick!user@host.example.org",
+	"*!*@*.example.org",
+	"*!*@host.example.org",
+	"*!user@host.example.org",
+	"*!*user@*",
+	"*!*@*",
+	"*!*@*.example.*",
+	"ni*!*@*",
+	"other!*@*",
+	"*!*@*.net",
+	"*?!*",
+};
+
+typedef struct {
+	const char *nick;
+	const char *host;
+} ignore_input;
+
+static const ignore_input inputs[] = {
+	{ "nick", "user@host.example.org" },
+	{ "NICK", "ident@sub.host.example.org" },
+	{ "nicky", "user@other.example.net" },
+	{ "ick", "user@host.example.org" },
+	{ "foo", "user@host.example.org" },
+	{ "foo", "baruser@example.com" },
+	{ "other", "a@b" },
+	{ "x", "user@example.org" },
+	{ "", "" },
+};
+
+static const char *const texts[] = {
+	NULL,
+	"this is spam",
+	"hello",
+};
+
+static IGNORE_REC *ignore_add(const char *mask, int exception, const char *pattern)
+{
+	IGNORE_REC *rec;
+
+	rec = g_new0(IGNORE_REC, 1);
+	rec->mask = g_strdup(mask);
+	rec->pattern = g_strdup(pattern);
+	rec->level = MSGLEVEL_MSGS;
+	rec->exception = exception;
+	ignore_add_rec(rec);
+	return rec;
+}
+
+static void ignore_clear(void)
+{
+	while (ignores != NULL) {
+		IGNORE_REC *rec = ignores->data;
+
+		rec->level = 0;
+		ignore_update_rec(rec);
+	}
+}
+
+/* ignore_check() as it was before the masks were indexed: try every ignore
+   in list order */
+static int ignore_check_linear(const char *nick, const char *host, const char *text)
+{
+	GSList *tmp;
+	char *nickmask;
+	int len, best_mask, best_match, best_patt;
+
+	nickmask = g_strconcat(nick, "!", host, NULL);
+	best_mask = best_patt = -1; best_match = FALSE;
+	for (tmp = ignores; tmp != NULL; tmp = tmp->next) {
+		IGNORE_REC *rec = tmp->data;
+
+		if (strchr(rec->mask, '!') != NULL ?
+		    !match_wildcards(rec->mask, nickmask) :
+		    !match_wildcards(rec->mask, nick))
+			continue;
+		if (rec->pattern != NULL &&
+		    (text == NULL || stristr(text, rec->pattern) == NULL))
+			continue;
+
+		len = strlen(rec->mask);
+		if (len > best_mask) {
+			best_mask = len;
+			best_match = !rec->exception;
+		} else if (len == best_mask) {
+			len = rec->pattern == NULL ? 0 : strlen(rec->pattern);
+			if (len > best_patt) {
+				best_patt = len;
+				best_match = !rec->exception;
+			} else if (len == best_patt && rec->exception)
+				best_match = 0;
+		}
+	}
+	g_free(nickmask);
+	return best_match;
+}
+
+static void assert_matches_linear(void)
+{
+	int i, j;
+
+	for (i = 0; i < G_N_ELEMENTS(inputs); i++) {
+		for (j = 0; j < G_N_ELEMENTS(texts); j++) {
+			g_test_message("%s!%s '%s'", inputs[i].nick, inputs[i].host,
+				       texts[j] == NULL ? "" : texts[j]);
+			g_assert_cmpint(ignore_check(NULL, inputs[i].nick, inputs[i].host,
+						     NULL, texts[j], MSGLEVEL_MSGS), ==,
+					ignore_check_linear(inputs[i].nick, inputs[i].host,
+							    texts[j]));
+		}
+	}
+}
+
+static void test_ignore_single_masks(void)
+{
+	int i;
+
+	for (i = 0; i < G_N_ELEMENTS(masks); i++) {
+		g_test_message("mask %s", masks[i]);
+		ignore_add(masks[i], FALSE, NULL);
+		assert_matches_linear();
+		ignore_clear();
+	}
+}
+
+static void test_ignore_expected(void)
+{
+	ignore_add("nick", FALSE, NULL);
+	g_assert_true(ignore_check(NULL, "NICK", "a@b", NULL, NULL, MSGLEVEL_MSGS));
+	g_assert_false(ignore_check(NULL, "nicky", "a@b", NULL, NULL, MSGLEVEL_MSGS));
+	g_assert_false(ignore_check(NULL, "nick", "a@b", NULL, NULL, MSGLEVEL_PUBLIC));
+	ignore_clear();
+
+	ignore_add("*!*@*.example.org", FALSE, NULL);
+	g_assert_true(ignore_check(NULL, "a", "u@host.example.org", NULL, NULL, MSGLEVEL_MSGS));
+	g_assert_true(ignore_check(NULL, "a", "u@HOST.Example.ORG", NULL, NULL, MSGLEVEL_MSGS));
+	g_assert_false(ignore_check(NULL, "a", "u@example.org", NULL, NULL, MSGLEVEL_MSGS));
+	g_assert_false(ignore_check(NULL, "a", "u@host.example.org.net", NULL, NULL, MSGLEVEL_MSGS));
+	ignore_clear();
+
+	ignore_add("*!user@host.example.org", FALSE, NULL);
+	g_assert_true(ignore_check(NULL, "a", "user@host.example.org", NULL, NULL, MSGLEVEL_MSGS));
+	g_assert_false(ignore_check(NULL, "a", "xuser@host.example.org", NULL, NULL, MSGLEVEL_MSGS));
+	ignore_clear();
+
+	ignore_add("*!*@*", FALSE, NULL);
+	g_assert_true(ignore_check(NULL, "a", "b@c", NULL, NULL, MSGLEVEL_MSGS));
+	ignore_clear();
+}
+
+static void test_ignore_exceptions(void)
+{
+	/* longer mask wins */
+	ignore_add("*!*@*.example.org", FALSE, NULL);
+	ignore_add("nick!*@*", TRUE, NULL);
+	g_assert_true(ignore_check(NULL, "nick", "u@host.example.org", NULL, NULL, MSGLEVEL_MSGS));
+	ignore_add("nick!*@host.example.org", TRUE, NULL);
+	g_assert_false(ignore_check(NULL, "nick", "u@host.example.org", NULL, NULL, MSGLEVEL_MSGS));
+	g_assert_true(ignore_check(NULL, "other", "u@host.example.org", NULL, NULL, MSGLEVEL_MSGS));
+	ignore_clear();
+
+	/* with equal masks the list order decides */
+	ignore_add("*!*@*.io", TRUE, NULL);
+	ignore_add("nick!*@*", FALSE, NULL);
+	g_assert_true(ignore_check(NULL, "nick", "u@a.io", NULL, NULL, MSGLEVEL_MSGS));
+	ignore_clear();
+
+	ignore_add("nick!*@*", FALSE, NULL);
+	ignore_add("*!*@*.io", TRUE, NULL);
+	g_assert_false(ignore_check(NULL, "nick", "u@a.io", NULL, NULL, MSGLEVEL_MSGS));
+	ignore_clear();
+
+	/* longer pattern wins */
+	ignore_add("nick", FALSE, "spam");
+	ignore_add("nick", TRUE, "is spam");
+	g_assert_false(ignore_check(NULL, "nick", "a@b", NULL, "this is spam", MSGLEVEL_MSGS));
+	g_assert_true(ignore_check(NULL, "nick", "a@b", NULL, "spam", MSGLEVEL_MSGS));
+	ignore_clear();
+}
+
+static void test_ignore_linear(void)
+{
+	int round, i, n;
+
+	/* exceptions and patterns at different places in the list, so the
+	   ties between equal masks are resolved by the order */
+	for (round = 0; round < 8; round++) {
+		n = G_N_ELEMENTS(masks);
+		for (i = 0; i < n; i++) {
+			int pos = (i * 5 + round) % n;
+
+			ignore_add(masks[pos], (i + round) % 3 == 0,
+				   (i + round) % 4 == 0 ? "spam" : NULL);
+		}
+		assert_matches_linear();
+
+		/* removing from the middle */
+		for (i = 0; i < 3; i++) {
+			IGNORE_REC *rec = g_slist_nth_data(ignores, (round + i * 4) % 10);
+
+			rec->level = 0;
+			ignore_update_rec(rec);
+			assert_matches_linear();
+		}
+
+		/* updating moves the ignore to the end of the list */
+		((IGNORE_REC *) ignores->data)->exception ^= 1;
+		ignore_update_rec(ignores->data);
+		assert_matches_linear();
+
+		ignore_clear();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int res;
+
+	g_test_init(&argc, &argv, NULL);
+
+	core_preinit(*argv);
+	irssi_gui = IRSSI_GUI_NONE;
+
+	modules_init();
+	signals_init();
+	settings_init();
+	nickmatch_cache_init();
+	ignore_init();
+
+	g_test_add_func("/test/ignore/single_masks", test_ignore_single_masks);
+	g_test_add_func("/test/ignore/expected", test_ignore_expected);
+	g_test_add_func("/test/ignore/exceptions", test_ignore_exceptions);
+	g_test_add_func("/test/ignore/linear", test_ignore_linear);
+
+	res = g_test_run();
+
+	ignore_deinit();
+	nickmatch_cache_deinit();
+	settings_deinit();
+	signals_deinit();
+	modules_deinit();
+
+	return res;
+}
@@ -0,0 +1,205 @@
+/*
+ test-config.c : irssi
+
+    Copyright (C) 2024-2025 erssi-org team
+    Lead Developer: Jerzy (kofany) Dąbrowski <https://github.com/kofany>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <irssi/src/common.h>
+#include <irssi/src/lib-config/iconfig.h>
+
+static const char sample_config[] =
+	"# comment\n"
+	"\n"
+	"servers = (\n"
+	"  { address = \"irc.example.org\"; port = \"6667\"; },\n"
+	"  { address = 'single quoted'; }\n"
+	");\n"
+	"settings = {\n"
+	"  core = { real_name = \"a\\\"b\\\\c\\001d\"; Nick = bare_word; };\n"
+	"};\n";
+
+static char *config_write_tmp(CONFIG_REC *config)
+{
+	char *fname;
+	int fd;
+
+	fd = g_file_open_tmp("test-config-XXXXXX", &fname, NULL);
+	g_assert_cmpint(fd, !=, -1);
+	close(fd);
+
+	g_assert_cmpint(config_write(config, fname, 0600), ==, 0);
+	return fname;
+}
+
+static char *read_file(const char *fname)
+{
+	char *data;
+
+	g_assert_true(g_file_get_contents(fname, &data, NULL, NULL));
+	return data;
+}
+
+static void test_parse_roundtrip(void)
+{
+	CONFIG_REC *config, *config2;
+	CONFIG_NODE *node;
+	char *fname, *data, *data2;
+
+	config = config_open(NULL, -1);
+	g_assert_cmpint(config_parse_data(config, sample_config, "internal"), ==, 0);
+
+	g_assert_cmpstr(config_get_str(config, "settings/core", "real_name", NULL), ==,
+			"a\"b\\c\001d");
+	g_assert_cmpstr(config_get_str(config, "settings/core", "nick", NULL), ==, "bare_word");
+
+	node = config_node_traverse(config, "(servers", FALSE);
+	g_assert_nonnull(node);
+	g_assert_cmpstr(config_node_get_str(config_node_nth(node, 1), "address", NULL), ==,
+			"single quoted");
+
+	/* what we write must parse back to the same file */
+	fname = config_write_tmp(config);
+	data = read_file(fname);
+	g_assert_nonnull(strstr(data, "# comment\n\n"));
+
+	config2 = config_open(fname, -1);
+	g_assert_cmpint(config_parse(config2), ==, 0);
+	g_assert_cmpint(config_write(config2, NULL, -1), ==, 0);
+	data2 = read_file(fname);
+	g_assert_cmpstr(data, ==, data2);
+
+	g_unlink(fname);
+	g_free(fname);
+	g_free(data);
+	g_free(data2);
+	config_close(config2);
+	config_close(config);
+}
+
+static void test_parse_errors(void)
+{
+	CONFIG_REC *config;
+
+	config = config_open(NULL, -1);
+	g_assert_cmpint(config_parse_data(config, "a = \"b\";\nc = \"unterminated\n", "test"), ==, -1);
+	g_assert_nonnull(strstr(config_last_error(config), "unterminated string constant"));
+	g_assert_cmpstr(config_get_str(config, NULL, "a", NULL), ==, "b");
+
+	g_assert_cmpint(config_parse_data(config, "a = { b = \"c\"; ", "test"), ==, -1);
+	config_close(config);
+}
+
+static void test_node_index(void)
+{
+	CONFIG_REC *config;
+	CONFIG_NODE *block;
+	char key[32], value[32];
+	int i;
+
+	config = config_open(NULL, -1);
+	block = config_node_traverse(config, "block", TRUE);
+	for (i = 0; i < 100; i++) {
+		g_snprintf(key, sizeof(key), "key%d", i);
+		g_snprintf(value, sizeof(value), "%d", i);
+		config_node_set_str(config, block, key, value);
+	}
+
+	g_assert_cmpstr(config_node_get_str(block, "KEY50", NULL), ==, "50");
+	g_assert_nonnull(block->index);
+
+	config_node_set_str(config, block, "key50", NULL);
+	g_assert_null(config_node_find(block, "key50"));
+	config_node_set_str(config, block, "key50", "again");
+	g_assert_cmpstr(config_node_get_str(block, "key50", NULL), ==, "again");
+	g_assert_true(((CONFIG_NODE *) g_slist_last(block->value)->data) ==
+		      config_node_find(block, "key50"));
+
+	/* inserting to the middle keeps lookups right */
+	config_node_section_index(config, block, "sub", 0, NODE_TYPE_BLOCK);
+	g_assert_cmpstr(((CONFIG_NODE *) ((GSList *) block->value)->data)->key, ==, "sub");
+	g_assert_nonnull(config_node_find(block, "sub"));
+	g_assert_cmpstr(config_node_get_str(block, "key99", NULL), ==, "99");
+
+	config_close(config);
+}
+
+/* run with -m perf */
+static void test_perf_load_save(void)
+{
+	CONFIG_REC *config;
+	GString *data;
+	char *fname, key[32];
+	double parse_time, lookup_time, write_time;
+	int i, count;
+
+	data = g_string_new(NULL);
+	for (count = 0; data->len < 1024 * 1024; count++) {
+		if (count % 1000 == 0)
+			g_string_append_printf(data, "%sblock%d = {\n",
+					       count == 0 ? "" : "};\n", count / 1000);
+		g_string_append_printf(data, "  # comment %d\n  key_%d = \"value \\\"%d\\\"\";\n",
+				       count, count, count);
+	}
+	g_string_append(data, "};\n");
+
+	config = config_open(NULL, -1);
+	g_test_timer_start();
+	g_assert_cmpint(config_parse_data(config, data->str, "perf"), ==, 0);
+	parse_time = g_test_timer_elapsed();
+
+	g_test_timer_start();
+	for (i = 0; i < count; i++) {
+		CONFIG_NODE *block;
+
+		g_snprintf(key, sizeof(key), "block%d", i / 1000);
+		block = config_node_traverse(config, key, FALSE);
+		g_snprintf(key, sizeof(key), "KEY_%d", i);
+		g_assert_nonnull(config_node_find(block, key));
+	}
+	lookup_time = g_test_timer_elapsed();
+
+	g_test_timer_start();
+	fname = config_write_tmp(config);
+	write_time = g_test_timer_elapsed();
+
+	g_test_message("%" G_GSIZE_FORMAT " bytes, %d keys: parse %.3fs, lookups %.3fs, write %.3fs",
+		       data->len, count, parse_time, lookup_time, write_time);
+	g_test_minimized_result(parse_time + write_time, "load+save %.3fs",
+				parse_time + write_time);
+
+	g_unlink(fname);
+	g_free(fname);
+	g_string_free(data, TRUE);
+	config_close(config);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/lib-config/parse-roundtrip", test_parse_roundtrip);
+	g_test_add_func("/lib-config/parse-errors", test_parse_errors);
+	g_test_add_func("/lib-config/node-index", test_node_index);
+	if (g_test_perf())
+		g_test_add_func("/lib-config/perf/load-save", test_perf_load_save);
+
+	return g_test_run();
+}